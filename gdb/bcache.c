@@ -85,12 +85,15 @@ bcache::expand_hash_table ()
 
   /* Find the next size.  */
   new_num_buckets = m_num_buckets * 2;
-  for (unsigned long a_size : sizes)
-    if (a_size > m_num_buckets)
-      {
-	new_num_buckets = a_size;
-	break;
-      }
+  if (m_num_buckets == 0 && m_initial_num_buckets != 0)
+    new_num_buckets = m_initial_num_buckets;
+  else
+    for (unsigned long a_size : sizes)
+      if (a_size > m_num_buckets)
+	{
+	  new_num_buckets = a_size;
+	  break;
+	}
 
   /* Allocate the new table.  */
   {
@@ -142,7 +145,15 @@ bcache::expand_hash_table ()
 const void *
 bcache::insert (const void *addr, int length, bool *added)
 {
-  unsigned long full_hash;
+  return insert_hashed (addr, length, this->hash (addr, length), added);
+}
+
+/* See bcache.h.  */
+
+const void *
+bcache::insert_hashed (const void *addr, int length,
+		       unsigned long full_hash, bool *added)
+{
   unsigned short half_hash;
   int hash_index;
   struct bstring *s;
@@ -167,8 +178,6 @@ bcache::insert (const void *addr, int length, bool *added)
   m_total_count++;
   m_total_size += length;
 
-  full_hash = this->hash (addr, length);
-
   half_hash = (full_hash >> 16);
   hash_index = full_hash % m_num_buckets;
 
@@ -251,6 +260,50 @@ print_percentage (int portion, int total)
 }
 
 
+/* See bcache.h.  */
+
+void
+bcache::print_totals (const char *type,
+		      gdb::array_view<const bcache *const> caches)
+{
+  unsigned long unique_count = 0;
+  long total_count = 0;
+  long unique_size = 0;
+  long total_size = 0;
+  long structure_size = 0;
+
+  for (const bcache *cache : caches)
+    {
+      unique_count += cache->m_unique_count;
+      total_count += cache->m_total_count;
+      unique_size += cache->m_unique_size;
+      total_size += cache->m_total_size;
+      structure_size += cache->m_structure_size;
+    }
+
+  gdb_printf (_("  M_Cached '%s' statistics:\n"), type);
+  gdb_printf (_("    Total object count:  %ld\n"), total_count);
+  gdb_printf (_("    Unique object count: %lu\n"), unique_count);
+  gdb_printf (_("    Percentage of duplicates, by count: "));
+  print_percentage (total_count - unique_count, total_count);
+  gdb_printf ("\n");
+
+  gdb_printf (_("    Total object size:   %ld\n"), total_size);
+  gdb_printf (_("    Unique object size:  %ld\n"), unique_size);
+  gdb_printf (_("    Percentage of duplicates, by size:  "));
+  print_percentage (total_size - unique_size, total_size);
+  gdb_printf ("\n");
+
+  gdb_printf (_("    \
+Total memory used by bcache, including overhead: %ld\n"),
+	      structure_size);
+  gdb_printf (_("    Percentage memory overhead: "));
+  print_percentage (structure_size - unique_size, unique_size);
+  gdb_printf (_("    Net memory savings:         "));
+  print_percentage (total_size - structure_size, total_size);
+  gdb_printf ("\n");
+}
+
 /* Print statistics on BCACHE's memory usage and efficacity at
    eliminating duplication.  NAME should describe the kind of data
    BCACHE holds.  Statistics are printed using `gdb_printf' and
@@ -325,18 +378,8 @@ bcache::print_statistics (const char *type)
     xfree (entry_size);
   }
 
-  gdb_printf (_("  M_Cached '%s' statistics:\n"), type);
-  gdb_printf (_("    Total object count:  %ld\n"), m_total_count);
-  gdb_printf (_("    Unique object count: %lu\n"), m_unique_count);
-  gdb_printf (_("    Percentage of duplicates, by count: "));
-  print_percentage (m_total_count - m_unique_count, m_total_count);
-  gdb_printf ("\n");
-
-  gdb_printf (_("    Total object size:   %ld\n"), m_total_size);
-  gdb_printf (_("    Unique object size:  %ld\n"), m_unique_size);
-  gdb_printf (_("    Percentage of duplicates, by size:  "));
-  print_percentage (m_total_size - m_unique_size, m_total_size);
-  gdb_printf ("\n");
+  const bcache *self = this;
+  print_totals (type, gdb::make_array_view (&self, 1));
 
   gdb_printf (_("    Max entry size:     %d\n"), max_entry_size);
   gdb_printf (_("    Average entry size: "));
@@ -348,15 +391,6 @@ bcache::print_statistics (const char *type)
   gdb_printf (_("    Median entry size:  %d\n"), median_entry_size);
   gdb_printf ("\n");
 
-  gdb_printf (_("    \
-Total memory used by bcache, including overhead: %ld\n"),
-	      m_structure_size);
-  gdb_printf (_("    Percentage memory overhead: "));
-  print_percentage (m_structure_size - m_unique_size, m_unique_size);
-  gdb_printf (_("    Net memory savings:         "));
-  print_percentage (m_total_size - m_structure_size, m_total_size);
-  gdb_printf ("\n");
-
   gdb_printf (_("    Hash table size:           %3d\n"), 
 	      m_num_buckets);
   gdb_printf (_("    Hash table expands:        %lu\n"),
@@ -381,11 +415,77 @@ Total memory used by bcache, including overhead: %ld\n"),
 }
 
 int
-bcache::memory_used ()
+bcache::memory_used () const
 {
   if (m_total_count == 0)
     return 0;
-  return obstack_memory_used (&m_cache);
+  return obstack_memory_used (const_cast<struct obstack *> (&m_cache));
+}
+
+
+/* The concurrent bcache.  */
+
+/* See bcache.h.  */
+
+const void *
+concurrent_bcache::insert (const void *addr, int length, bool *added)
+{
+  unsigned long full_hash = fast_hash (addr, length, 0);
+
+  /* Within a shard, the hash picks the bucket and its upper half is
+     the half hash, so the shard is picked from a mix of all the bits
+     of the hash rather than from some of them.  */
+  uint64_t mixed = (uint64_t) full_hash * 0x9e3779b97f4a7c15ull;
+  shard &s = m_shards[mixed >> (64 - n_shard_bits)];
+
+#if CXX_STD_THREAD
+  std::unique_lock<std::mutex> lock (s.mutex, std::try_to_lock);
+  if (!lock.owns_lock ())
+    {
+      m_contended_count.fetch_add (1, std::memory_order_relaxed);
+      lock.lock ();
+    }
+#endif
+
+  return s.cache.insert_hashed (addr, length, full_hash, added);
+}
+
+/* See bcache.h.  */
+
+void
+concurrent_bcache::print_statistics (const char *type)
+{
+  const bcache *caches[n_shards];
+  unsigned long expand_count = 0;
+  unsigned long half_hash_miss_count = 0;
+
+  for (int i = 0; i < n_shards; i++)
+    {
+      caches[i] = &m_shards[i].cache;
+      expand_count += m_shards[i].cache.m_expand_count;
+      half_hash_miss_count += m_shards[i].cache.m_half_hash_miss_count;
+    }
+
+  bcache::print_totals (type, caches);
+
+  gdb_printf (_("    Shards:                    %d\n"), n_shards);
+  gdb_printf (_("    Hash table expands:        %lu\n"), expand_count);
+  gdb_printf (_("    Half hash misses:          %lu\n"),
+	      half_hash_miss_count);
+  gdb_printf (_("    Contended insertions:      %lu\n"),
+	      m_contended_count.load (std::memory_order_relaxed));
+  gdb_printf ("\n");
+}
+
+/* See bcache.h.  */
+
+int
+concurrent_bcache::memory_used () const
+{
+  int result = 0;
+  for (const shard &s : m_shards)
+    result += s.cache.memory_used ();
+  return result;
 }
 
 } /* namespace gdb */
@@ -22,6 +22,12 @@
 #ifndef BCACHE_H
 #define BCACHE_H 1
 
+#include "gdbsupport/array-view.h"
+#include <atomic>
+#if CXX_STD_THREAD
+#include <mutex>
+#endif
+
 /* A bcache is a data structure for factoring out duplication in
    read-only structures.  You give the bcache some string of bytes S.
    If the bcache already contains a copy of S, it hands you back a
@@ -142,6 +148,13 @@ struct bstring;
 
 struct bcache
 {
+  /* Create a bcache.  INITIAL_SIZE is the number of hash buckets to
+     start with, or zero for the default.  */
+  explicit bcache (unsigned int initial_size = 0)
+    : m_initial_num_buckets (initial_size)
+  {
+  }
+
   virtual ~bcache ();
 
   /* Find a copy of the LENGTH bytes at ADDR in BCACHE.  If BCACHE has
@@ -159,7 +172,7 @@ struct bcache
      kind of data this bcache holds.  Statistics are printed using
      `gdb_printf' and its ilk.  */
   void print_statistics (const char *type);
-  int memory_used ();
+  int memory_used () const;
 
 protected:
 
@@ -173,12 +186,28 @@ struct bcache
 
 private:
 
+  friend class concurrent_bcache;
+
+  /* Like insert, but FULL_HASH is the hash of the LENGTH bytes at
+     ADDR, as computed by the 'hash' method.  */
+  const void *insert_hashed (const void *addr, int length,
+			     unsigned long full_hash, bool *added);
+
+  /* Print the statistics on the objects held by CACHES and the memory
+     they use, summed over all of them, under a header naming TYPE.  */
+  static void print_totals (const char *type,
+			    gdb::array_view<const bcache *const> caches);
+
   /* All the bstrings are allocated here.  */
   struct obstack m_cache {};
 
   /* How many hash buckets we're using.  */
   unsigned int m_num_buckets = 0;
 
+  /* How many hash buckets to start with, or zero to pick the first
+     size from the table in expand_hash_table.  */
+  unsigned int m_initial_num_buckets;
+
   /* Hash buckets.  This table is allocated using malloc, so when we
      grow the table we can return the old table to the system.  */
   struct bstring **m_bucket = nullptr;
@@ -205,6 +234,61 @@ struct bcache
   void expand_hash_table ();
 };
 
+/* A bcache that several threads can insert into at the same time.
+   The strings are spread over a fixed number of shards according to
+   their hash, and each shard is a bcache with its own lock, so that
+   threads inserting different strings rarely have to wait for each
+   other.  The hash and comparison functions are those of the plain
+   bcache.  */
+
+class concurrent_bcache
+{
+public:
+
+  concurrent_bcache () = default;
+
+  DISABLE_COPY_AND_ASSIGN (concurrent_bcache);
+
+  /* Like bcache::insert.  This can be called from any thread.  */
+  const void *insert (const void *addr, int length, bool *added = nullptr);
+
+  /* Like bcache::print_statistics, but print the totals over all the
+     shards, and how often an insertion had to wait for another
+     thread.  This must not be called while other threads may be
+     inserting.  */
+  void print_statistics (const char *type);
+
+  /* Like bcache::memory_used.  This must not be called while other
+     threads may be inserting.  */
+  int memory_used () const;
+
+private:
+
+  /* A shard of the cache.  Every shard allocates its hash table on
+     first use, so the table starts small; it grows with the number of
+     strings as usual.  */
+  struct shard
+  {
+    bcache cache { 127 };
+#if CXX_STD_THREAD
+    std::mutex mutex;
+#endif
+  };
+
+  /* The number of shards is 1 << N_SHARD_BITS.  Every objfile has a
+     concurrent bcache, so this is kept small; it only needs to be
+     large compared to the number of threads that insert at the same
+     time.  */
+  static constexpr int n_shard_bits = 3;
+  static constexpr int n_shards = 1 << n_shard_bits;
+
+  shard m_shards[n_shards];
+
+  /* The number of insertions that found the lock of their shard held
+     by another thread.  */
+  std::atomic<unsigned long> m_contended_count { 0 };
+};
+
 } /* namespace gdb */
 
 #endif /* BCACHE_H */
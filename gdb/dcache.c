@@ -23,8 +23,12 @@
 #include "gdbcore.h"
 #include "target-dcache.h"
 #include "inferior.h"
-#include "splay-tree.h"
 #include "gdbarch.h"
+#include "hashtab.h"
+#include "memattr.h"
+#include "cli/cli-cmds.h"
+#include "gdbsupport/byte-vector.h"
+#include <algorithm>
 
 /* Commands with a prefix of `{set,show} dcache'.  */
 static struct cmd_list_element *dcache_set_list = NULL;
@@ -43,14 +47,23 @@ static struct cmd_list_element *dcache_show_list = NULL;
    significantly.  This is most useful when accessing a large amount
    of data, such as when performing a backtrace.
 
-   The cache is a splay tree along with a linked list for replacement.
+   The cache is a hash table along with a linked list for replacement.
    Each block caches a LINE_SIZE area of memory.  Within each line we
    remember the address of the line (which must be a multiple of
-   LINE_SIZE) and the actual data block.
+   LINE_SIZE) and the actual data block.  Lines are replaced in least
+   recently used order.
 
    Lines are only allocated as needed, so DCACHE_SIZE really specifies the
    *maximum* number of lines in the cache.
 
+   When a miss follows right after the lines that were last read from
+   the target, the access is assumed to be sequential, and the cache
+   reads ahead: the next lines are read along with the missing one, in
+   a single target request.  The number of lines read ahead doubles
+   with each sequential miss, up to DCACHE_READ_AHEAD.  This turns
+   walking an array, or dumping a block of memory, into a few large
+   reads instead of one read per line.
+
    At present, the cache is write-through rather than writeback: as soon
    as data is written to the cache, it is also immediately written to
    the target.  Therefore, cache lines are never "dirty".  Whether a given
@@ -83,6 +96,11 @@ static unsigned dcache_size = DCACHE_DEFAULT_SIZE;
 #define DCACHE_DEFAULT_LINE_SIZE 64
 static unsigned dcache_line_size = DCACHE_DEFAULT_LINE_SIZE;
 
+/* The maximum number of lines to read ahead of a sequential miss.
+   Zero disables reading ahead.  */
+#define DCACHE_DEFAULT_READ_AHEAD 64
+static unsigned dcache_read_ahead = DCACHE_DEFAULT_READ_AHEAD;
+
 /* Each cache block holds LINE_SIZE bytes of data
    starting at a multiple-of-LINE_SIZE address.  */
 
@@ -92,7 +110,7 @@ static unsigned dcache_line_size = DCACHE_DEFAULT_LINE_SIZE;
 
 struct dcache_block
 {
-  /* For least-recently-allocated and free lists.  */
+  /* For least-recently-used and free lists.  */
   struct dcache_block *prev;
   struct dcache_block *next;
 
@@ -103,8 +121,9 @@ struct dcache_block
 
 struct dcache_struct
 {
-  splay_tree tree;
-  struct dcache_block *oldest; /* least-recently-allocated list.  */
+  /* The lines in the cache, hashed by address.  */
+  htab_t lines;
+  struct dcache_block *oldest; /* least-recently-used list.  */
 
   /* The free list is maintained identically to OLDEST to simplify
      the code: we only need one set of accessors.  */
@@ -120,13 +139,25 @@ struct dcache_struct
   /* The process target of last inferior to use the cache or
      nullptr.  */
   process_stratum_target *proc_target;
+
+  /* The address just past the last lines read from the target.  A miss
+     at this address is taken as a sequential access.  */
+  CORE_ADDR fill_end;
+
+  /* The number of lines to read ahead of the next sequential miss.  */
+  unsigned read_ahead;
+
+  /* Statistics, for "maint info dcache".  These are not reset when the
+     cache is invalidated.  */
+  ULONGEST hits;
+  ULONGEST misses;
+  ULONGEST lines_read_ahead;
+  ULONGEST target_reads;
 };
 
 typedef void (block_func) (struct dcache_block *block, void *param);
 
-static struct dcache_block *dcache_hit (DCACHE *dcache, CORE_ADDR addr);
-
-static int dcache_read_line (DCACHE *dcache, struct dcache_block *db);
+static struct dcache_block *dcache_lookup (DCACHE *dcache, CORE_ADDR addr);
 
 static struct dcache_block *dcache_alloc (DCACHE *dcache, CORE_ADDR addr);
 
@@ -141,7 +172,7 @@ show_dcache_enabled_p (struct ui_file *file, int from_tty,
 
 /* Add BLOCK to circular block list BLIST, behind the block at *BLIST.
    *BLIST is not updated (unless it was previously NULL of course).
-   This is for the least-recently-allocated list's sake:
+   This is for the least-recently-used list's sake:
    BLIST points to the oldest block.
    ??? This makes for poor cache usage of the free list,
    but is it measurable?  */
@@ -156,7 +187,7 @@ append_block (struct dcache_block **blist, struct dcache_block *block)
       block->prev->next = block;
       (*blist)->prev = block;
       /* We don't update *BLIST here to maintain the invariant that for the
-	 least-recently-allocated list *BLIST points to the oldest block.  */
+	 least-recently-used list *BLIST points to the oldest block.  */
     }
   else
     {
@@ -180,7 +211,7 @@ remove_block (struct dcache_block **blist, struct dcache_block *block)
       block->next->prev = block->prev;
       block->prev->next = block->next;
       /* If we removed the block *BLIST points to, shift it to the next block
-	 to maintain the invariant that for the least-recently-allocated list
+	 to maintain the invariant that for the least-recently-used list
 	 *BLIST points to the oldest block.  */
       if (*blist == block)
 	*blist = block->next;
@@ -223,7 +254,7 @@ free_block (struct dcache_block *block, void *param)
 void
 dcache_free (DCACHE *dcache)
 {
-  splay_tree_delete (dcache->tree);
+  htab_delete (dcache->lines);
   for_each_block (&dcache->oldest, free_block, NULL);
   for_each_block (&dcache->freelist, free_block, NULL);
   xfree (dcache);
@@ -239,7 +270,6 @@ invalidate_block (struct dcache_block *block, void *param)
 {
   DCACHE *dcache = (DCACHE *) param;
 
-  splay_tree_remove (dcache->tree, (splay_tree_key) block->addr);
   append_block (&dcache->freelist, block);
 }
 
@@ -249,11 +279,14 @@ void
 dcache_invalidate (DCACHE *dcache)
 {
   for_each_block (&dcache->oldest, invalidate_block, dcache);
+  htab_empty (dcache->lines);
 
   dcache->oldest = NULL;
   dcache->size = 0;
   dcache->ptid = null_ptid;
   dcache->proc_target = nullptr;
+  dcache->fill_end = 0;
+  dcache->read_ahead = 0;
 
   if (dcache->line_size != dcache_line_size)
     {
@@ -266,16 +299,46 @@ dcache_invalidate (DCACHE *dcache)
     }
 }
 
+/* Return the hash code of the line at ADDR.  */
+
+static hashval_t
+dcache_hash_addr (CORE_ADDR addr)
+{
+  return (hashval_t) (addr ^ (addr >> 32));
+}
+
+/* Hash function for the lines of a dcache.  */
+
+static hashval_t
+hash_dcache_block (const void *p)
+{
+  const struct dcache_block *db = (const struct dcache_block *) p;
+
+  return dcache_hash_addr (db->addr);
+}
+
+/* Equality function for the lines of a dcache.  The lines are
+   looked up by address, so B is a pointer to a CORE_ADDR.  */
+
+static int
+eq_dcache_block (const void *a, const void *b)
+{
+  const struct dcache_block *db = (const struct dcache_block *) a;
+
+  return db->addr == *(const CORE_ADDR *) b;
+}
+
 /* Invalidate the line associated with ADDR.  */
 
 static void
 dcache_invalidate_line (DCACHE *dcache, CORE_ADDR addr)
 {
-  struct dcache_block *db = dcache_hit (dcache, addr);
+  struct dcache_block *db = dcache_lookup (dcache, addr);
 
   if (db)
     {
-      splay_tree_remove (dcache->tree, (splay_tree_key) db->addr);
+      htab_remove_elt_with_hash (dcache->lines, &db->addr,
+				 dcache_hash_addr (db->addr));
       remove_block (&dcache->oldest, db);
       append_block (&dcache->freelist, db);
       --dcache->size;
@@ -286,39 +349,50 @@ dcache_invalidate_line (DCACHE *dcache, CORE_ADDR addr)
    containing it.  Otherwise return NULL.  */
 
 static struct dcache_block *
-dcache_hit (DCACHE *dcache, CORE_ADDR addr)
+dcache_lookup (DCACHE *dcache, CORE_ADDR addr)
 {
-  struct dcache_block *db;
+  CORE_ADDR line = MASK (dcache, addr);
+
+  return ((struct dcache_block *)
+	  htab_find_with_hash (dcache->lines, &line, dcache_hash_addr (line)));
+}
 
-  splay_tree_node node = splay_tree_lookup (dcache->tree,
-					    (splay_tree_key) MASK (dcache, addr));
+/* Like dcache_lookup, but this is for reading ADDR: the hit is
+   counted, and the line becomes the most recently used one.  */
+
+static struct dcache_block *
+dcache_hit (DCACHE *dcache, CORE_ADDR addr)
+{
+  struct dcache_block *db = dcache_lookup (dcache, addr);
 
-  if (!node)
+  if (!db)
     return NULL;
 
-  db = (struct dcache_block *) node->value;
   db->refs++;
+  dcache->hits++;
+
+  /* Move DB to the end of the list, it's the newest.  */
+  if (db->next != dcache->oldest)
+    {
+      remove_block (&dcache->oldest, db);
+      append_block (&dcache->oldest, db);
+    }
+
   return db;
 }
 
-/* Fill a cache line from target memory.
-   The result is 1 for success, 0 if the (entire) cache line
+/* Read LEN bytes of target memory at MEMADDR into MYADDR, for filling
+   cache lines.  The result is 1 for success, 0 if the (entire) range
    wasn't readable.  */
 
 static int
-dcache_read_line (DCACHE *dcache, struct dcache_block *db)
+dcache_read_range (DCACHE *dcache, CORE_ADDR memaddr, gdb_byte *myaddr,
+		   ULONGEST len)
 {
-  CORE_ADDR memaddr;
-  gdb_byte *myaddr;
-  int len;
   int res;
-  int reg_len;
+  ULONGEST reg_len;
   struct mem_region *region;
 
-  len = dcache->line_size;
-  memaddr = db->addr;
-  myaddr  = db->data;
-
   while (len > 0)
     {
       /* Don't overrun if this block is right at the end of the region.  */
@@ -338,6 +412,7 @@ dcache_read_line (DCACHE *dcache, struct dcache_block *db)
 	  continue;
 	}
 
+      dcache->target_reads++;
       res = target_read_raw_memory (memaddr, myaddr, reg_len);
       if (res != 0)
 	return 0;
@@ -360,11 +435,12 @@ dcache_alloc (DCACHE *dcache, CORE_ADDR addr)
 
   if (dcache->size >= dcache_size)
     {
-      /* Evict the least recently allocated line.  */
+      /* Evict the least recently used line.  */
       db = dcache->oldest;
       remove_block (&dcache->oldest, db);
 
-      splay_tree_remove (dcache->tree, (splay_tree_key) db->addr);
+      htab_remove_elt_with_hash (dcache->lines, &db->addr,
+				 dcache_hash_addr (db->addr));
     }
   else
     {
@@ -385,61 +461,80 @@ dcache_alloc (DCACHE *dcache, CORE_ADDR addr)
   /* Put DB at the end of the list, it's the newest.  */
   append_block (&dcache->oldest, db);
 
-  splay_tree_insert (dcache->tree, (splay_tree_key) db->addr,
-		     (splay_tree_value) db);
+  void **slot = htab_find_slot_with_hash (dcache->lines, &db->addr,
+					  dcache_hash_addr (db->addr),
+					  INSERT);
+  gdb_assert (*slot == NULL);
+  *slot = db;
 
   return db;
 }
 
-/* Using the data cache DCACHE, store in *PTR the contents of the byte at
-   address ADDR in the remote machine.  
-
-   Returns 1 for success, 0 for error.  */
+/* Read the line containing ADDR, which is not in the cache, from
+   target memory, along with the lines to read ahead if this is a
+   sequential access.  Return the line containing ADDR, or NULL if it
+   wasn't readable.  */
 
-static int
-dcache_peek_byte (DCACHE *dcache, CORE_ADDR addr, gdb_byte *ptr)
+static struct dcache_block *
+dcache_fill (DCACHE *dcache, CORE_ADDR addr)
 {
-  struct dcache_block *db = dcache_hit (dcache, addr);
+  CORE_ADDR line = MASK (dcache, addr);
+  CORE_ADDR line_size = dcache->line_size;
 
-  if (!db)
-    {
-      db = dcache_alloc (dcache, addr);
+  dcache->misses++;
 
-      if (!dcache_read_line (dcache, db))
-	 return 0;
-    }
+  if (dcache_read_ahead > 0 && line == dcache->fill_end)
+    dcache->read_ahead = std::min (std::max (2 * dcache->read_ahead, 1u),
+				   dcache_read_ahead);
+  else
+    dcache->read_ahead = 0;
 
-  *ptr = db->data[XFORM (dcache, addr)];
-  return 1;
-}
+  /* Only read ahead lines that are not cached yet, that are in the
+     same memory region, and that can all be kept in the cache.  */
+  unsigned n = 1;
+  if (dcache->read_ahead > 0)
+    {
+      struct mem_region *region = lookup_mem_region (line);
 
-/* Write the byte at PTR into ADDR in the data cache.
+      while (n <= dcache->read_ahead && n < dcache_size)
+	{
+	  CORE_ADDR next = line + n * line_size;
 
-   The caller should have written the data through to target memory
-   already.
+	  if (next < line
+	      || (region->hi != 0 && next >= region->hi)
+	      || dcache_lookup (dcache, next) != NULL)
+	    break;
+	  ++n;
+	}
+    }
 
-   If ADDR is not in cache, this function does nothing; writing to an
-   area of memory which wasn't present in the cache doesn't cause it
-   to be loaded in.  */
+  gdb::byte_vector buf (n * line_size);
+  if (!dcache_read_range (dcache, line, buf.data (), buf.size ()))
+    {
+      if (n == 1)
+	return NULL;
+
+      /* Reading ahead may have gone past the end of the mapped
+	 memory.  Just read the line that is needed.  */
+      n = 1;
+      dcache->read_ahead = 0;
+      if (!dcache_read_range (dcache, line, buf.data (), line_size))
+	return NULL;
+    }
 
-static void
-dcache_poke_byte (DCACHE *dcache, CORE_ADDR addr, const gdb_byte *ptr)
-{
-  struct dcache_block *db = dcache_hit (dcache, addr);
+  struct dcache_block *result = NULL;
+  for (unsigned i = 0; i < n; i++)
+    {
+      struct dcache_block *db = dcache_alloc (dcache, line + i * line_size);
 
-  if (db)
-    db->data[XFORM (dcache, addr)] = *ptr;
-}
+      memcpy (db->data, buf.data () + i * line_size, line_size);
+      if (i == 0)
+	result = db;
+    }
 
-static int
-dcache_splay_tree_compare (splay_tree_key a, splay_tree_key b)
-{
-  if (a > b)
-    return 1;
-  else if (a == b)
-    return 0;
-  else
-    return -1;
+  dcache->lines_read_ahead += n - 1;
+  dcache->fill_end = line + n * line_size;
+  return result;
 }
 
 /* Allocate and initialize a data cache.  */
@@ -449,9 +544,9 @@ dcache_init (void)
 {
   DCACHE *dcache = XNEW (DCACHE);
 
-  dcache->tree = splay_tree_new (dcache_splay_tree_compare,
-				 NULL,
-				 NULL);
+  dcache->lines = htab_create_alloc (DCACHE_DEFAULT_SIZE / 4,
+				     hash_dcache_block, eq_dcache_block,
+				     NULL, xcalloc, xfree);
 
   dcache->oldest = NULL;
   dcache->freelist = NULL;
@@ -459,6 +554,12 @@ dcache_init (void)
   dcache->line_size = dcache_line_size;
   dcache->ptid = null_ptid;
   dcache->proc_target = nullptr;
+  dcache->fill_end = 0;
+  dcache->read_ahead = 0;
+  dcache->hits = 0;
+  dcache->misses = 0;
+  dcache->lines_read_ahead = 0;
+  dcache->target_reads = 0;
 
   return dcache;
 }
@@ -487,15 +588,24 @@ dcache_read_memory_partial (struct target_ops *ops, DCACHE *dcache,
       dcache->proc_target = proc_target;
     }
 
-  for (i = 0; i < len; i++)
+  i = 0;
+  while (i < len)
     {
-      if (!dcache_peek_byte (dcache, memaddr + i, myaddr + i))
+      CORE_ADDR addr = memaddr + i;
+      struct dcache_block *db = dcache_hit (dcache, addr);
+
+      if (!db)
 	{
-	  /* That failed.  Discard its cache line so we don't have a
-	     partially read line.  */
-	  dcache_invalidate_line (dcache, memaddr + i);
-	  break;
+	  db = dcache_fill (dcache, addr);
+	  if (!db)
+	    break;
 	}
+
+      ULONGEST offset = XFORM (dcache, addr);
+      ULONGEST n = std::min (len - i, dcache->line_size - offset);
+
+      memcpy (myaddr + i, db->data + offset, n);
+      i += n;
     }
 
   if (i == 0)
@@ -530,17 +640,56 @@ dcache_update (DCACHE *dcache, enum target_xfer_status status,
 	       CORE_ADDR memaddr, const gdb_byte *myaddr,
 	       ULONGEST len)
 {
-  ULONGEST i;
+  ULONGEST i = 0;
+
+  while (i < len)
+    {
+      CORE_ADDR addr = memaddr + i;
+      ULONGEST offset = XFORM (dcache, addr);
+      ULONGEST n = std::min (len - i, dcache->line_size - offset);
+
+      if (status == TARGET_XFER_OK)
+	{
+	  /* Writing to an area of memory which wasn't present in the
+	     cache doesn't cause it to be loaded in.  */
+	  struct dcache_block *db = dcache_lookup (dcache, addr);
 
-  for (i = 0; i < len; i++)
-    if (status == TARGET_XFER_OK)
-      dcache_poke_byte (dcache, memaddr + i, myaddr + i);
-    else
+	  if (db)
+	    memcpy (db->data + offset, myaddr + i, n);
+	}
+      else
+	{
+	  /* Discard the whole cache line so we don't have a partially
+	     valid line.  */
+	  dcache_invalidate_line (dcache, addr);
+	}
+
+      i += n;
+    }
+}
+
+/* Return the lines of DCACHE, sorted by address.  */
+
+static std::vector<struct dcache_block *>
+dcache_sorted_lines (DCACHE *dcache)
+{
+  std::vector<struct dcache_block *> result;
+  struct dcache_block *db = dcache->oldest;
+
+  if (db)
+    do
       {
-	/* Discard the whole cache line so we don't have a partially
-	   valid line.  */
-	dcache_invalidate_line (dcache, memaddr + i);
+	result.push_back (db);
+	db = db->next;
       }
+    while (db != dcache->oldest);
+
+  std::sort (result.begin (), result.end (),
+	     [] (const dcache_block *a, const dcache_block *b)
+	     {
+	       return a->addr < b->addr;
+	     });
+  return result;
 }
 
 /* Print DCACHE line INDEX.  */
@@ -548,9 +697,8 @@ dcache_update (DCACHE *dcache, enum target_xfer_status status,
 static void
 dcache_print_line (DCACHE *dcache, int index)
 {
-  splay_tree_node n;
   struct dcache_block *db;
-  int i, j;
+  int j;
 
   if (dcache == NULL)
     {
@@ -558,22 +706,15 @@ dcache_print_line (DCACHE *dcache, int index)
       return;
     }
 
-  n = splay_tree_min (dcache->tree);
+  std::vector<struct dcache_block *> lines = dcache_sorted_lines (dcache);
 
-  for (i = index; i > 0; --i)
-    {
-      if (!n)
-	break;
-      n = splay_tree_successor (dcache->tree, n->key);
-    }
-
-  if (!n)
+  if ((size_t) index >= lines.size ())
     {
       gdb_printf (_("No such cache line exists.\n"));
       return;
     }
-    
-  db = (struct dcache_block *) n->value;
+
+  db = lines[index];
 
   gdb_printf (_("Line %d: address %s [%d hits]\n"),
 	      index, paddress (current_inferior ()->arch (), db->addr),
@@ -595,7 +736,6 @@ dcache_print_line (DCACHE *dcache, int index)
 static void
 dcache_info_1 (DCACHE *dcache, const char *exp)
 {
-  splay_tree_node n;
   int i, refcount;
 
   if (exp)
@@ -628,21 +768,15 @@ dcache_info_1 (DCACHE *dcache, const char *exp)
 	      target_pid_to_str (dcache->ptid).c_str ());
 
   refcount = 0;
-
-  n = splay_tree_min (dcache->tree);
   i = 0;
 
-  while (n)
+  for (struct dcache_block *db : dcache_sorted_lines (dcache))
     {
-      struct dcache_block *db = (struct dcache_block *) n->value;
-
       gdb_printf (_("Line %d: address %s [%d hits]\n"),
 		  i, paddress (current_inferior ()->arch (), db->addr),
 		  db->refs);
       i++;
       refcount += db->refs;
-
-      n = splay_tree_successor (dcache->tree, n->key);
     }
 
   gdb_printf (_("Cache state: %d active lines, %d hits\n"), i, refcount);
@@ -654,6 +788,38 @@ info_dcache_command (const char *exp, int tty)
   dcache_info_1 (target_dcache_get (), exp);
 }
 
+/* Implement "maint info dcache".  */
+
+static void
+maint_info_dcache_command (const char *exp, int tty)
+{
+  DCACHE *dcache = target_dcache_get ();
+
+  gdb_printf (_("Dcache %u lines of %u bytes each, "
+		"reading ahead up to %u lines.\n"),
+	      dcache_size,
+	      dcache ? (unsigned) dcache->line_size : dcache_line_size,
+	      dcache_read_ahead);
+
+  if (dcache == NULL)
+    {
+      gdb_printf (_("No data cache available.\n"));
+      return;
+    }
+
+  ULONGEST accesses = dcache->hits + dcache->misses;
+
+  gdb_printf (_("Active lines: %d\n"), dcache->size);
+  gdb_printf (_("Hits: %s\n"), pulongest (dcache->hits));
+  gdb_printf (_("Misses: %s\n"), pulongest (dcache->misses));
+  if (accesses > 0)
+    gdb_printf (_("Hit rate: %.1f%%\n"),
+		100.0 * dcache->hits / accesses);
+  gdb_printf (_("Lines read ahead: %s\n"),
+	      pulongest (dcache->lines_read_ahead));
+  gdb_printf (_("Target reads: %s\n"), pulongest (dcache->target_reads));
+}
+
 static void
 set_dcache_size (const char *args, int from_tty,
 		 struct cmd_list_element *c)
@@ -666,6 +832,13 @@ set_dcache_size (const char *args, int from_tty,
   target_dcache_invalidate ();
 }
 
+static void
+set_dcache_read_ahead (const char *args, int from_tty,
+		       struct cmd_list_element *c)
+{
+  target_dcache_invalidate ();
+}
+
 static void
 set_dcache_line_size (const char *args, int from_tty,
 		      struct cmd_list_element *c)
@@ -704,6 +877,13 @@ With no arguments, this command prints the cache configuration and a\n\
 summary of each line in the cache.  With an argument, dump\"\n\
 the contents of the given line."));
 
+  add_cmd ("dcache", class_maintenance, maint_info_dcache_command, _("\
+Print statistics about the dcache of the current address space.\n\
+Usage: maintenance info dcache\n\
+This shows how many reads were served from the cache, how many lines\n\
+were read ahead, and how many reads were sent to the target."),
+	   &maintenanceinfolist);
+
   add_setshow_prefix_cmd ("dcache", class_obscure,
 			  _("\
 Use this command to set number of lines in dcache and line-size."),
@@ -727,4 +907,15 @@ Show number of dcache lines."),
 			     set_dcache_size,
 			     NULL,
 			     &dcache_set_list, &dcache_show_list);
+  add_setshow_zuinteger_cmd ("read-ahead", class_obscure,
+			     &dcache_read_ahead, _("\
+Set the maximum number of dcache lines to read ahead."), _("\
+Show the maximum number of dcache lines to read ahead."), _("\
+When memory is read sequentially, the dcache reads the following lines\n\
+along with the missing one, in a single request to the target.  The\n\
+number of lines read ahead doubles with each sequential miss, up to\n\
+this limit.  Zero disables reading ahead."),
+			     set_dcache_read_ahead,
+			     NULL,
+			     &dcache_set_list, &dcache_show_list);
 }
@@ -43,6 +43,39 @@ show_debug_displaced (struct ui_file *file, int from_tty,
   gdb_printf (file, _("Displace stepping debugging is %s.\n"), value);
 }
 
+/* Alignment of the buffers taken from the reserved region.  This is
+   enough for the instructions of all architectures.  */
+
+static constexpr ULONGEST reserve_buffer_alignment = 16;
+
+/* See displaced-stepping.h.  */
+
+void
+displaced_step_buffers::set_reserve (CORE_ADDR addr, ULONGEST len,
+				     ULONGEST buf_len)
+{
+  gdb_assert (buf_len > 0);
+
+  m_reserve_next = align_up (addr, reserve_buffer_alignment);
+  m_reserve_end = addr + len;
+  m_reserve_stride = align_up (buf_len, reserve_buffer_alignment);
+}
+
+/* See displaced-stepping.h.  */
+
+bool
+displaced_step_buffers::grow ()
+{
+  if (!can_grow ())
+    return false;
+
+  m_buffers.emplace_back (m_reserve_next);
+  m_reserve_next += m_reserve_stride;
+
+  displaced_debug_printf ("grew the pool to %zu buffers", m_buffers.size ());
+  return true;
+}
+
 displaced_step_prepare_status
 displaced_step_buffers::prepare (thread_info *thread, CORE_ADDR &displaced_pc)
 {
@@ -97,6 +130,17 @@ displaced_step_buffers::prepare (thread_info *thread, CORE_ADDR &displaced_pc)
 	}
     }
 
+  /* All the buffers are in use or unusable.  Rather than making the
+     thread wait for one of them, take a new one from the reserved
+     region, if any is left.  */
+  while (buffer == nullptr && grow ())
+    {
+      displaced_step_buffer &candidate = m_buffers.back ();
+
+      if (!breakpoint_in_range_p (aspace, candidate.addr, len))
+	buffer = &candidate;
+    }
+
   if (buffer == nullptr)
     return fail_status;
 
@@ -166,8 +210,8 @@ displaced_step_buffers::prepare (thread_info *thread, CORE_ADDR &displaced_pc)
   reset_buffer.release ();
 
   /* Tell infrun not to try preparing a displaced step again for this inferior if
-     all buffers are taken.  */
-  thread->inf->displaced_step_state.unavailable = true;
+     all buffers are taken, and the pool can't grow.  */
+  thread->inf->displaced_step_state.unavailable = !can_grow ();
   for (const displaced_step_buffer &buf : m_buffers)
     {
       if (buf.current_thread == nullptr)
@@ -150,7 +150,9 @@ struct displaced_step_thread_state
   gdbarch *m_original_gdbarch = nullptr;
 };
 
-/* Control access to multiple displaced stepping buffers at fixed addresses.  */
+/* Control access to multiple displaced stepping buffers.  The pool starts
+   with buffers at fixed addresses, and may grow into a reserved region of
+   memory when all of them are in use.  */
 
 struct displaced_step_buffers
 {
@@ -164,6 +166,12 @@ struct displaced_step_buffers
       m_buffers.emplace_back (buffer_addr);
   }
 
+  /* Let the pool add buffers of BUF_LEN bytes, as needed, in the LEN
+     bytes of memory starting at ADDR.  This memory must be executable,
+     and must never be otherwise accessed by the inferior, since any
+     thread may be executing out of it.  */
+  void set_reserve (CORE_ADDR addr, ULONGEST len, ULONGEST buf_len);
+
   displaced_step_prepare_status prepare (thread_info *thread,
 					 CORE_ADDR &displaced_pc);
 
@@ -175,8 +183,26 @@ struct displaced_step_buffers
 
   void restore_in_ptid (ptid_t ptid);
 
+  /* Return the number of buffers in the pool.  */
+  size_t size () const
+  {
+    return m_buffers.size ();
+  }
+
 private:
 
+  /* Return true if the reserved region has room for another buffer.  */
+  bool can_grow () const
+  {
+    return (m_reserve_stride != 0
+	    && m_reserve_next < m_reserve_end
+	    && m_reserve_end - m_reserve_next >= m_reserve_stride);
+  }
+
+  /* Add a buffer from the reserved region to the pool.  Return false if
+     the reserved region is exhausted.  */
+  bool grow ();
+
   /* State of a single buffer.  */
 
   struct displaced_step_buffer
@@ -205,6 +231,12 @@ struct displaced_step_buffers
   };
 
   std::vector<displaced_step_buffer> m_buffers;
+
+  /* The part of the reserved region not yet handed out to a buffer, and
+     the distance between two buffers taken from it.  */
+  CORE_ADDR m_reserve_next = 0;
+  CORE_ADDR m_reserve_end = 0;
+  ULONGEST m_reserve_stride = 0;
 };
 
 #endif /* DISPLACED_STEPPING_H */
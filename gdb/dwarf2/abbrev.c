@@ -158,6 +158,12 @@ abbrev_table::read (struct dwarf2_section_info *section,
       unsigned int sibling_offset = -1;
       bool is_csize = true;
 
+      /* The steps needed to skip the attributes quickly, and the size
+	 of the constant-size attributes since the last step.  */
+      std::vector<attr_skip> skips;
+      unsigned int run_size = 0;
+      bool has_sibling = false;
+
       bool has_hardcoded_declaration = false;
       bool has_specification_or_origin = false;
       bool has_name = false;
@@ -217,49 +223,64 @@ abbrev_table::read (struct dwarf2_section_info *section,
 	      break;
 
 	    case DW_AT_sibling:
+	      has_sibling = true;
 	      if (is_csize && cur_attr.form == DW_FORM_ref4)
 		sibling_offset = size;
 	      break;
 	    }
 
+	  unsigned int attr_size;
 	  switch (cur_attr.form)
 	    {
 	    case DW_FORM_data1:
 	    case DW_FORM_ref1:
 	    case DW_FORM_flag:
 	    case DW_FORM_strx1:
-	      size += 1;
+	      attr_size = 1;
 	      break;
 	    case DW_FORM_flag_present:
 	    case DW_FORM_implicit_const:
+	      attr_size = 0;
 	      break;
 	    case DW_FORM_data2:
 	    case DW_FORM_ref2:
 	    case DW_FORM_strx2:
-	      size += 2;
+	      attr_size = 2;
 	      break;
 	    case DW_FORM_strx3:
-	      size += 3;
+	      attr_size = 3;
 	      break;
 	    case DW_FORM_data4:
 	    case DW_FORM_ref4:
 	    case DW_FORM_strx4:
-	      size += 4;
+	      attr_size = 4;
 	      break;
 	    case DW_FORM_data8:
 	    case DW_FORM_ref8:
 	    case DW_FORM_ref_sig8:
-	      size += 8;
+	      attr_size = 8;
 	      break;
 	    case DW_FORM_data16:
-	      size += 16;
+	      attr_size = 16;
 	      break;
 
 	    default:
-	      is_csize = false;
+	      attr_size = -1;
 	      break;
 	    }
 
+	  if (attr_size == (unsigned int) -1)
+	    {
+	      is_csize = false;
+	      skips.push_back ({ run_size, (unsigned short) num_attrs });
+	      run_size = 0;
+	    }
+	  else
+	    {
+	      size += attr_size;
+	      run_size += attr_size;
+	    }
+
 	  ++num_attrs;
 	  obstack_grow (obstack, &cur_attr, sizeof (cur_attr));
 	}
@@ -303,6 +324,25 @@ abbrev_table::read (struct dwarf2_section_info *section,
 	sibling_offset = -1;
       cur_abbrev->size_if_constant = is_csize ? size : 0;
       cur_abbrev->sibling_offset = sibling_offset;
+      cur_abbrev->has_sibling = has_sibling;
+
+      /* A constant size that overflowed is handled by the skip
+	 steps too.  */
+      if (is_csize && cur_abbrev->size_if_constant != size)
+	{
+	  cur_abbrev->size_if_constant = 0;
+	  run_size = size;
+	}
+      cur_abbrev->num_skips = skips.size ();
+      cur_abbrev->trailing_size = run_size;
+      if (skips.empty ())
+	cur_abbrev->skips = nullptr;
+      else
+	{
+	  attr_skip *copy = XOBNEWVEC (obstack, attr_skip, skips.size ());
+	  std::copy (skips.begin (), skips.end (), copy);
+	  cur_abbrev->skips = copy;
+	}
 
       abbrev_table->add_abbrev (cur_abbrev);
     }
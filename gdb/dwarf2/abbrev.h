@@ -38,6 +38,17 @@ struct attr_abbrev
   LONGEST implicit_const;
 };
 
+/* One step of skipping the attributes of a DIE whose size is not
+   constant.  The attributes from the previous step up to ATTR have a
+   size that only depends on their form, and take FIXED_SIZE bytes in
+   total; the size of attribute ATTR itself has to be computed from
+   the unit or the data.  */
+struct attr_skip
+{
+  unsigned int fixed_size;
+  unsigned short attr;
+};
+
 /* This data structure holds the information of an abbrev.  */
 struct abbrev_info
 {
@@ -48,8 +59,16 @@ struct abbrev_info
   /* True if the DIE has children.  */
   bool has_children;
   bool interesting;
+  /* True if the DIE has a DW_AT_sibling attribute.  */
+  bool has_sibling;
   unsigned short size_if_constant;
   unsigned short sibling_offset;
+  /* When SIZE_IF_CONSTANT is zero, the steps needed to skip the
+     attributes, and the total size of the constant-size attributes
+     after the last step.  */
+  unsigned short num_skips;
+  unsigned int trailing_size;
+  const struct attr_skip *skips;
   /* Number of attributes.  */
   unsigned short num_attrs;
   /* An array of attribute descriptions, allocated using the struct
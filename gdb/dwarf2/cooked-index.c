@@ -26,14 +26,17 @@
 #include "c-lang.h"
 #include "ada-lang.h"
 #include "split-name.h"
+#include "objfiles.h"
 #include "observable.h"
 #include "run-on-main-thread.h"
 #include <algorithm>
 #include "gdbsupport/gdb-safe-ctype.h"
+#include "gdbsupport/parallel-for.h"
 #include "gdbsupport/selftest.h"
 #include <chrono>
 #include <unordered_set>
 #include "cli/cli-cmds.h"
+#include "cli/cli-style.h"
 
 /* We don't want gdb to exit while it is in the process of writing to
    the index cache.  So, all live cooked index vectors are stored
@@ -248,13 +251,22 @@ cooked_index_shard::add (sect_offset die_offset, enum dwarf_tag tag,
 
 /* See cooked-index.h.  */
 
-void
-cooked_index_shard::finalize ()
+cooked_index_entry *
+cooked_index_shard::add_from_cache (sect_offset die_offset,
+				    enum dwarf_tag tag,
+				    cooked_index_flag flags,
+				    const char *name,
+				    const char *canonical,
+				    dwarf2_per_cu_data *per_cu,
+				    bool searchable)
 {
-  m_future = gdb::thread_pool::g_thread_pool->post_task ([this] ()
-    {
-      do_finalize ();
-    });
+  cooked_index_entry *result = create (die_offset, tag, flags, name,
+				       nullptr, per_cu);
+  result->canonical = canonical;
+  if (searchable)
+    m_entries.push_back (result);
+  m_from_cache = true;
+  return result;
 }
 
 /* See cooked-index.h.  */
@@ -284,7 +296,7 @@ cooked_index_shard::handle_gnat_encoded_entry (cooked_index_entry *entry,
 	{
 	  gdb::unique_xmalloc_ptr<char> new_name
 	    = make_unique_xstrndup (name.data (), name.length ());
-	  last = create (entry->die_offset, DW_TAG_namespace,
+	  last = create (entry->die_offset (), DW_TAG_namespace,
 			 0, new_name.get (), parent,
 			 entry->per_cu);
 	  last->canonical = last->name;
@@ -302,28 +314,10 @@ cooked_index_shard::handle_gnat_encoded_entry (cooked_index_entry *entry,
 /* See cooked-index.h.  */
 
 void
-cooked_index_shard::do_finalize ()
+cooked_index_shard::prepare_finalize
+     (std::vector<cooked_index_entry *> *c_entries,
+      std::vector<cooked_index_entry *> *cplus_entries)
 {
-  auto hash_name_ptr = [] (const void *p)
-    {
-      const cooked_index_entry *entry = (const cooked_index_entry *) p;
-      return htab_hash_pointer (entry->name);
-    };
-
-  auto eq_name_ptr = [] (const void *a, const void *b) -> int
-    {
-      const cooked_index_entry *ea = (const cooked_index_entry *) a;
-      const cooked_index_entry *eb = (const cooked_index_entry *) b;
-      return ea->name == eb->name;
-    };
-
-  /* We can use pointer equality here because names come from
-     .debug_str, which will normally be unique-ified by the linker.
-     Also, duplicates are relatively harmless -- they just mean a bit
-     of extra memory is used.  */
-  htab_up seen_names (htab_create_alloc (10, hash_name_ptr, eq_name_ptr,
-					 nullptr, xcalloc, xfree));
-
   auto hash_entry = [] (const void *e)
     {
       const cooked_index_entry *entry = (const cooked_index_entry *) e;
@@ -360,44 +354,29 @@ cooked_index_shard::do_finalize ()
 	      m_names.push_back (std::move (canon_name));
 	    }
 	}
-      else if (entry->per_cu->lang () == language_cplus
-	       || entry->per_cu->lang () == language_c)
-	{
-	  void **slot = htab_find_slot (seen_names.get (), entry,
-					INSERT);
-	  if (*slot == nullptr)
-	    {
-	      gdb::unique_xmalloc_ptr<char> canon_name
-		= (entry->per_cu->lang () == language_cplus
-		   ? cp_canonicalize_string (entry->name)
-		   : c_canonicalize_name (entry->name));
-	      if (canon_name == nullptr)
-		entry->canonical = entry->name;
-	      else
-		{
-		  entry->canonical = canon_name.get ();
-		  m_names.push_back (std::move (canon_name));
-		}
-	      *slot = entry;
-	    }
-	  else
-	    {
-	      const cooked_index_entry *other
-		= (const cooked_index_entry *) *slot;
-	      entry->canonical = other->canonical;
-	    }
-	}
+      else if (entry->per_cu->lang () == language_cplus)
+	cplus_entries->push_back (entry);
+      else if (entry->per_cu->lang () == language_c)
+	c_entries->push_back (entry);
       else
 	entry->canonical = entry->name;
     }
 
   m_names.shrink_to_fit ();
   m_entries.shrink_to_fit ();
-  std::sort (m_entries.begin (), m_entries.end (),
-	     [] (const cooked_index_entry *a, const cooked_index_entry *b)
-	     {
-	       return *a < *b;
-	     });
+}
+
+/* See cooked-index.h.  */
+
+void
+cooked_index_shard::sort_entries ()
+{
+  gdb::parallel_sort (m_entries.begin (), m_entries.end (),
+		      [] (const cooked_index_entry *a,
+			  const cooked_index_entry *b)
+		      {
+			return *a < *b;
+		      });
 }
 
 /* See cooked-index.h.  */
@@ -405,8 +384,6 @@ cooked_index_shard::do_finalize ()
 cooked_index_shard::range
 cooked_index_shard::find (const std::string &name, bool completing) const
 {
-  wait ();
-
   cooked_index_entry::comparison_mode mode = (completing
 					      ? cooked_index_entry::COMPLETE
 					      : cooked_index_entry::MATCH);
@@ -428,26 +405,11 @@ cooked_index_shard::find (const std::string &name, bool completing) const
   return range (lower, upper);
 }
 
-/* See cooked-index.h.  */
-
-void
-cooked_index_shard::wait (bool allow_quit) const
-{
-  if (allow_quit)
-    {
-      std::chrono::milliseconds duration { 15 };
-      while (m_future.wait_for (duration) == gdb::future_status::timeout)
-	QUIT;
-    }
-  else
-    m_future.wait ();
-}
-
-cooked_index::cooked_index (vec_type &&vec)
-  : m_vector (std::move (vec))
+cooked_index::cooked_index (vec_type &&vec, bool addresses_only)
+  : m_vector (std::move (vec)),
+    m_addresses_only (addresses_only)
 {
-  for (auto &idx : m_vector)
-    idx->finalize ();
+  m_finalize_tasks.post (m_finalize_task);
 
   /* ACTIVE_VECTORS is not locked, and this assert ensures that this
      will be caught if ever moved to the background.  */
@@ -457,26 +419,273 @@ cooked_index::cooked_index (vec_type &&vec)
 
 /* See cooked-index.h.  */
 
+struct cooked_index::pending_write
+{
+  pending_write (dwarf2_per_bfd *per_bfd_)
+    : per_bfd (per_bfd_),
+      ctx (global_index_cache, per_bfd_)
+  {
+  }
+
+  dwarf2_per_bfd *per_bfd;
+  index_cache_store_context ctx;
+};
+
+/* See cooked-index.h.  */
+
 void
 cooked_index::start_writing_index (dwarf2_per_bfd *per_bfd)
 {
-  index_cache_store_context ctx (global_index_cache, per_bfd);
+  std::unique_ptr<pending_write> write (new pending_write (per_bfd));
 
-  /* This must be set after all the finalization tasks have been
-     started, because it may call 'wait'.  */
-  m_write_future
-    = gdb::thread_pool::g_thread_pool->post_task ([this, per_bfd,
-#if __cplusplus >= 201402L
-						   ctx = std::move (ctx)
-#else
-						   ctx
+#if CXX_STD_THREAD
+  std::lock_guard<std::mutex> guard (m_write_mutex);
 #endif
-						   ] ()
+  gdb_assert (m_pending_write == nullptr);
+  m_pending_write = std::move (write);
+  if (m_finalized)
+    post_write_task ();
+}
+
+/* See cooked-index.h.  */
+
+void
+cooked_index::post_write_task ()
+{
+  std::shared_ptr<pending_write> write (std::move (m_pending_write));
+  m_write_future
+    = gdb::thread_pool::g_thread_pool->post_task ([this, write] ()
 	{
-	  maybe_write_index (per_bfd, ctx);
+	  maybe_write_index (write->per_bfd, write->ctx);
 	});
 }
 
+/* See cooked-index.h.  */
+
+void
+cooked_index::wait_completely ()
+{
+  /* Any write to the index cache is only started at the end of
+     finalization.  */
+  while (m_finalize_tasks.wait_for (std::chrono::milliseconds (15))
+	 == gdb::future_status::timeout)
+    ;
+
+  if (m_write_future.valid ())
+    m_write_future.wait ();
+}
+
+/* See cooked-index.h.  */
+
+void
+cooked_index::complete (vec_type &&vec)
+{
+  gdb_assert (m_addresses_only);
+  gdb_assert (is_main_thread ());
+
+  /* The old shards may still be being finalized.  */
+  m_finalize_tasks.wait ();
+
+  m_vector = std::move (vec);
+  m_addresses_only = false;
+  m_finalized = false;
+  m_finalize_tasks.post (m_finalize_task);
+}
+
+/* A table used to canonicalize each distinct name only once, while
+   the entries are processed concurrently.  It maps a name to the
+   first entry with that name, called its owner.  Like the rest of the
+   index, this relies on the names coming from .debug_str, so that
+   equal names normally have the same address; a name that is
+   duplicated anyway is just canonicalized more than once.
+
+   The table uses open addressing, and a slot is claimed with a
+   compare-and-swap, so no locking is needed.  It is created with
+   enough slots for all the entries, and so never fills up.  */
+
+class canonical_name_table
+{
+public:
+
+  /* Create a table for up to N_ENTRIES entries.  */
+  explicit canonical_name_table (size_t n_entries)
+  {
+    size_t n_slots = 16;
+    while (n_slots < 2 * n_entries)
+      n_slots *= 2;
+    m_mask = n_slots - 1;
+    m_slots.reset (new std::atomic<cooked_index_entry *>[n_slots]);
+    for (size_t i = 0; i < n_slots; ++i)
+      m_slots[i].store (nullptr, std::memory_order_relaxed);
+  }
+
+  DISABLE_COPY_AND_ASSIGN (canonical_name_table);
+
+  /* Try to make ENTRY the owner of its name.  Return true if it is
+     now the owner, in which case the caller must set its canonical
+     name.  Otherwise, the canonical name can be found with 'owner'
+     once all the entries have been claimed.  */
+  bool claim (cooked_index_entry *entry)
+  {
+    for (size_t i = first_slot (entry->name); ; i = (i + 1) & m_mask)
+      {
+	cooked_index_entry *owner = m_slots[i].load (std::memory_order_acquire);
+	if (owner == nullptr
+	    && m_slots[i].compare_exchange_strong (owner, entry,
+						   std::memory_order_acq_rel))
+	  return true;
+	/* If the compare-and-swap failed, OWNER is now the entry that
+	   was stored by another thread.  */
+	if (owner->name == entry->name)
+	  return false;
+      }
+  }
+
+  /* Return the owner of the name of ENTRY.  */
+  const cooked_index_entry *owner (const cooked_index_entry *entry) const
+  {
+    for (size_t i = first_slot (entry->name); ; i = (i + 1) & m_mask)
+      {
+	const cooked_index_entry *owner
+	  = m_slots[i].load (std::memory_order_acquire);
+	gdb_assert (owner != nullptr);
+	if (owner->name == entry->name)
+	  return owner;
+      }
+  }
+
+private:
+
+  /* Return the slot where the search for NAME starts.  */
+  size_t first_slot (const char *name) const
+  {
+    return htab_hash_pointer (name) & m_mask;
+  }
+
+  /* The slots.  The number of slots is a power of 2.  */
+  std::unique_ptr<std::atomic<cooked_index_entry *>[]> m_slots;
+
+  /* The number of slots, minus one.  */
+  size_t m_mask;
+};
+
+/* See cooked-index.h.  */
+
+void
+cooked_index::canonicalize_names
+     (const std::vector<cooked_index_entry *> &entries, enum language lang)
+{
+  using iter_type = std::vector<cooked_index_entry *>::const_iterator;
+
+  canonical_name_table table (entries.size ());
+
+  /* First let each name be canonicalized by its owner.  The cost of
+     canonicalization varies a lot from name to name, so guided
+     scheduling is used.  The new names are interned in a concurrent
+     bcache, which also shares the names that different spellings
+     canonicalize to.  */
+  gdb::parallel_for_each_guided (256, entries.begin (), entries.end (),
+				 [&] (iter_type iter, iter_type end)
+    {
+      for (; iter != end; ++iter)
+	{
+	  cooked_index_entry *entry = *iter;
+	  if (!table.claim (entry))
+	    continue;
+
+	  gdb::unique_xmalloc_ptr<char> canon_name
+	    = (lang == language_cplus
+	       ? cp_canonicalize_string (entry->name)
+	       : c_canonicalize_name (entry->name));
+	  if (canon_name == nullptr)
+	    entry->canonical = entry->name;
+	  else
+	    entry->canonical
+	      = ((const char *)
+		 m_canonical_names.insert (canon_name.get (),
+					   strlen (canon_name.get ()) + 1));
+	}
+    });
+
+  /* Now that all the owners are done, the other entries can share
+     their names.  */
+  gdb::parallel_for_each_guided (1024, entries.begin (), entries.end (),
+				 [&] (iter_type iter, iter_type end)
+    {
+      for (; iter != end; ++iter)
+	{
+	  cooked_index_entry *entry = *iter;
+	  if (entry->canonical == nullptr)
+	    entry->canonical = table.owner (entry)->canonical;
+	}
+    });
+}
+
+/* See cooked-index.h.  */
+
+void
+cooked_index::do_finalize ()
+{
+  using clock = std::chrono::steady_clock;
+  using shard_iter = vec_type::iterator;
+  using entries_pair = std::pair<std::vector<cooked_index_entry *>,
+				 std::vector<cooked_index_entry *>>;
+
+  clock::time_point start = clock::now ();
+
+  /* Shards read from the index cache are already finalized.  */
+  auto shard_size = [] (shard_iter iter)
+    {
+      return (*iter)->m_from_cache ? 1 : (*iter)->m_entries.size () + 1;
+    };
+
+  std::vector<entries_pair> lang_entries
+    = gdb::parallel_for_each_guided (1, m_vector.begin (), m_vector.end (),
+				     [] (shard_iter iter, shard_iter end)
+      {
+	entries_pair result;
+	for (; iter != end; ++iter)
+	  if (!(*iter)->m_from_cache)
+	    (*iter)->prepare_finalize (&result.first, &result.second);
+	return result;
+      }, gdb::make_function_view (shard_size));
+
+  std::vector<cooked_index_entry *> c_entries;
+  std::vector<cooked_index_entry *> cplus_entries;
+  for (const entries_pair &chunk : lang_entries)
+    {
+      c_entries.insert (c_entries.end (), chunk.first.begin (),
+			chunk.first.end ());
+      cplus_entries.insert (cplus_entries.end (), chunk.second.begin (),
+			    chunk.second.end ());
+    }
+  lang_entries.clear ();
+
+  clock::time_point prepared = clock::now ();
+  m_finalize_times.prepare = prepared - start;
+
+  canonicalize_names (c_entries, language_c);
+  canonicalize_names (cplus_entries, language_cplus);
+
+  clock::time_point canonicalized = clock::now ();
+  m_finalize_times.canonicalize = canonicalized - prepared;
+
+  /* Each sort is itself parallel, so the shards are simply sorted
+     one after the other.  */
+  for (auto &shard : m_vector)
+    if (!shard->m_from_cache)
+      shard->sort_entries ();
+
+  m_finalize_times.sort = clock::now () - canonicalized;
+
+#if CXX_STD_THREAD
+  std::lock_guard<std::mutex> guard (m_write_mutex);
+#endif
+  m_finalized = true;
+  if (m_pending_write != nullptr)
+    post_write_task ();
+}
+
 cooked_index::~cooked_index ()
 {
   /* The 'finalize' method may be run in a different thread.  If
@@ -484,11 +693,10 @@ cooked_index::~cooked_index ()
      will end up writing to freed memory.  Waiting for this to
      complete avoids this problem; and the cost seems ignorable
      because creating and immediately destroying the debug info is a
-     relatively rare thing to do.  */
-  for (auto &item : m_vector)
-    item->wait (false);
+     relatively rare thing to do.  This wait is done by the
+     destructor of M_FINALIZE_TASKS.
 
-  /* Likewise for the index-creating future, though this one must also
+     Likewise for the index-creating future, though this one must also
      waited for by the per-BFD object to ensure the required data
      remains live.  */
   wait_completely ();
@@ -501,6 +709,22 @@ cooked_index::~cooked_index ()
 
 /* See cooked-index.h.  */
 
+void
+cooked_index::wait (bool allow_quit) const
+{
+  if (allow_quit)
+    {
+      std::chrono::milliseconds duration { 15 };
+      while (m_finalize_tasks.wait_for (duration)
+	     == gdb::future_status::timeout)
+	QUIT;
+    }
+
+  m_finalize_tasks.wait ();
+}
+
+/* See cooked-index.h.  */
+
 dwarf2_per_cu_data *
 cooked_index::lookup (CORE_ADDR addr)
 {
@@ -526,9 +750,49 @@ cooked_index::get_addrmaps () const
 
 /* See cooked-index.h.  */
 
+cooked_index::memory_usage
+cooked_index::get_memory_usage () const
+{
+  wait ();
+
+  memory_usage result;
+  auto add_names
+    = [&] (const std::vector<gdb::unique_xmalloc_ptr<char>> &names)
+      {
+	result.vectors += names.capacity () * sizeof (names[0]);
+	for (const auto &name : names)
+	  result.names += strlen (name.get ()) + 1;
+      };
+
+  for (const auto &shard : m_vector)
+    {
+      result.entries += shard->m_entries.size ();
+      result.storage += obstack_memory_used (&shard->m_storage);
+      result.vectors += (shard->m_entries.capacity ()
+			 * sizeof (shard->m_entries[0]));
+      add_names (shard->m_names);
+    }
+  result.names += m_canonical_names.memory_used ();
+
+  return result;
+}
+
+/* See cooked-index.h.  */
+
+void
+cooked_index::print_bcache_statistics ()
+{
+  wait ();
+  m_canonical_names.print_statistics ("canonical names");
+}
+
+/* See cooked-index.h.  */
+
 cooked_index::range
 cooked_index::find (const std::string &name, bool completing) const
 {
+  wait ();
+
   std::vector<cooked_index_shard::range> result_range;
   result_range.reserve (m_vector.size ());
   for (auto &entry : m_vector)
@@ -584,7 +848,7 @@ cooked_index::dump (gdbarch *arch) const
       gdb_printf ("    qualified:  %s\n", entry->full_name (&temp_storage, false));
       gdb_printf ("    DWARF tag:  %s\n", dwarf_tag_name (entry->tag));
       gdb_printf ("    flags:      %s\n", to_string (entry->flags).c_str ());
-      gdb_printf ("    DIE offset: %s\n", sect_offset_str (entry->die_offset));
+      gdb_printf ("    DIE offset: %s\n", sect_offset_str (entry->die_offset ()));
 
       if (entry->parent_entry != nullptr)
 	gdb_printf ("    parent:     ((cooked_index_entry *) %p) [%s]\n",
@@ -642,9 +906,6 @@ void
 cooked_index::maybe_write_index (dwarf2_per_bfd *per_bfd,
 				 const index_cache_store_context &ctx)
 {
-  /* Wait for finalization.  */
-  wait ();
-
   /* (maybe) store an index in the cache.  */
   global_index_cache.store (per_bfd, ctx);
 }
@@ -667,6 +928,82 @@ maintenance_wait_for_index_cache (const char *args, int from_tty)
   wait_for_index_cache (0);
 }
 
+/* Implement "maintenance info cooked-index".  */
+
+static void
+maintenance_info_cooked_index (const char *args, int from_tty)
+{
+  for (objfile *objfile : current_program_space->objfiles ())
+    {
+      dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
+      if (per_objfile == nullptr)
+	continue;
+
+      dwarf2_per_bfd *per_bfd = per_objfile->per_bfd;
+      cooked_index *table
+	= dynamic_cast<cooked_index *> (per_bfd->index_table.get ());
+      if (table == nullptr)
+	continue;
+
+      const char *state;
+      bool finalized = false;
+      if (table->addresses_only ())
+	state = _("addresses only");
+      else if (per_bfd->index_cache_res != nullptr)
+	state = _("read from the index cache");
+      else
+	{
+	  state = _("complete");
+	  finalized = true;
+	}
+
+      size_t n_cus = 0, n_scanned = 0;
+      for (const auto &per_cu : per_bfd->all_units)
+	if (!per_cu->is_debug_types)
+	  {
+	    ++n_cus;
+	    if (per_cu->scanned.load (std::memory_order_relaxed))
+	      ++n_scanned;
+	  }
+
+      gdb_printf (_("Cooked index for %ps:\n"),
+		  styled_string (file_name_style.style (),
+				 objfile_name (objfile)));
+      gdb_printf (_("  State: %s\n"), state);
+      gdb_printf (_("  Compilation units: %zu (%zu indexed)\n"),
+		  n_cus, n_scanned);
+      gdb_printf (_("  Type units: %zu\n"),
+		  per_bfd->all_units.size () - n_cus);
+      gdb_printf (_("  Shards: %zu\n"), table->shard_count ());
+
+      if (finalized)
+	{
+	  using ms = std::chrono::duration<double, std::milli>;
+	  const cooked_index::finalize_times &times
+	    = table->get_finalize_times ();
+	  gdb_printf (_("  Preparation time: %.3f ms\n"),
+		      ms (times.prepare).count ());
+	  gdb_printf (_("  Canonicalization time: %.3f ms\n"),
+		      ms (times.canonicalize).count ());
+	  gdb_printf (_("  Sorting time: %.3f ms\n"),
+		      ms (times.sort).count ());
+	}
+
+      if (!table->addresses_only ())
+	{
+	  cooked_index::memory_usage usage = table->get_memory_usage ();
+	  gdb_printf (_("  Entries: %zu\n"), usage.entries);
+	  gdb_printf (_("  Entry size: %zu bytes\n"),
+		      sizeof (cooked_index_entry));
+	  gdb_printf (_("  Entry storage: %zu bytes\n"), usage.storage);
+	  gdb_printf (_("  Vectors: %zu bytes\n"), usage.vectors);
+	  gdb_printf (_("  Names: %zu bytes\n"), usage.names);
+	  gdb_printf (_("  Total memory: %zu bytes\n"),
+		      usage.storage + usage.vectors + usage.names);
+	}
+    }
+}
+
 void _initialize_cooked_index ();
 void
 _initialize_cooked_index ()
@@ -681,5 +1018,12 @@ Wait until all pending writes to the index cache have completed.\n\
 Usage: maintenance wait-for-index-cache"),
 	   &maintenancelist);
 
+  add_cmd ("cooked-index", class_maintenance,
+	   maintenance_info_cooked_index, _("\
+Print the state of the DWARF index of each objfile.\n\
+This shows whether the units of the objfile have been indexed yet.\n\
+Usage: maintenance info cooked-index"),
+	   &maintenanceinfolist);
+
   gdb::observers::gdb_exiting.attach (wait_for_index_cache, "cooked-index");
 }
@@ -29,6 +29,7 @@
 #include "quick-symbol.h"
 #include "gdbsupport/gdb_obstack.h"
 #include "addrmap.h"
+#include "bcache.h"
 #include "gdbsupport/iterator-range.h"
 #include "gdbsupport/thread-pool.h"
 #include "dwarf2/mapped-index.h"
@@ -63,7 +64,7 @@ std::string to_string (cooked_index_flag flags);
 /* Return true if LANG requires canonicalization.  This is used
    primarily to work around an issue computing the name of "main".
    This function must be kept in sync with
-   cooked_index_shard::do_finalize.  */
+   cooked_index_shard::prepare_finalize.  */
 
 extern bool language_requires_canonicalization (enum language lang);
 
@@ -81,12 +82,20 @@ struct cooked_index_entry : public allocate_on_obstack
 		      const cooked_index_entry *parent_entry_,
 		      dwarf2_per_cu_data *per_cu_)
     : name (name_),
-      tag (tag_),
-      flags (flags_),
-      die_offset (die_offset_),
       parent_entry (parent_entry_),
-      per_cu (per_cu_)
+      per_cu (per_cu_),
+      m_die_offset (to_underlying (die_offset_)),
+      tag (tag_),
+      flags (flags_)
   {
+    /* Sections of a terabyte or more are not supported.  */
+    gdb_assert (m_die_offset == to_underlying (die_offset_));
+  }
+
+  /* The offset of this DIE.  */
+  sect_offset die_offset () const
+  {
+    return (sect_offset) m_die_offset;
   }
 
   /* Return true if this entry matches SEARCH_FLAGS.  */
@@ -210,19 +219,13 @@ struct cooked_index_entry : public allocate_on_obstack
   }
 
   /* The name as it appears in DWARF.  This always points into one of
-     the mapped DWARF sections.  Note that this may be the name or the
-     linkage name -- two entries are created for DIEs which have both
-     attributes.  */
+     the mapped DWARF sections, or into a mapped index cache file.
+     Note that this may be the name or the linkage name -- two entries
+     are created for DIEs which have both attributes.  */
   const char *name;
   /* The canonical name.  For C++ names, this may differ from NAME.
      In all other cases, this is equal to NAME.  */
   const char *canonical = nullptr;
-  /* The DWARF tag.  */
-  enum dwarf_tag tag;
-  /* Any flags attached to this entry.  */
-  cooked_index_flag flags;
-  /* The offset of this DIE.  */
-  sect_offset die_offset;
   /* The parent entry.  This is NULL for top-level entries.
      Otherwise, it points to the parent entry, such as a namespace or
      class.  */
@@ -230,6 +233,20 @@ struct cooked_index_entry : public allocate_on_obstack
   /* The CU from which this entry originates.  */
   dwarf2_per_cu_data *per_cu;
 
+private:
+
+  /* The offset of this DIE; see die_offset.  This shares a word with
+     the tag and the flags below, as there can be tens of millions of
+     entries in a large program.  */
+  uint64_t m_die_offset : 40;
+
+public:
+
+  /* The DWARF tag.  */
+  ENUM_BITFIELD (dwarf_tag) tag : 16;
+  /* Any flags attached to this entry.  */
+  cooked_index_flag flags;
+
 private:
 
   /* A helper method for full_name.  Emits the full scope of this
@@ -239,6 +256,10 @@ struct cooked_index_entry : public allocate_on_obstack
 		    bool for_name) const;
 };
 
+/* On LP64 hosts, the layout above leaves no padding in an entry.  */
+static_assert (sizeof (void *) != 8 || sizeof (cooked_index_entry) == 40,
+	       "cooked_index_entry is not packed");
+
 class cooked_index;
 
 /* An index of interesting DIEs.  This is "cooked", in contrast to a
@@ -251,7 +272,13 @@ class cooked_index;
 class cooked_index_shard
 {
 public:
-  cooked_index_shard () = default;
+  cooked_index_shard ()
+  {
+    /* The default alignment of an obstack is that of long double,
+       which would pad every entry.  */
+    obstack_alignment_mask (&m_storage) = alignof (cooked_index_entry) - 1;
+  }
+
   DISABLE_COPY_AND_ASSIGN (cooked_index_shard);
 
   /* Create a new cooked_index_entry and register it with this object.
@@ -269,13 +296,31 @@ class cooked_index_shard
     m_addrmap = new (&m_storage) addrmap_fixed (&m_storage, map);
   }
 
-  /* Finalize the index.  This should be called a single time, when
-     the index has been fully populated.  It enters all the entries
-     into the internal table.  */
-  void finalize ();
+  /* Create a new entry that was read from the index cache.  The
+     entry's names have already been canonicalized, so it is not
+     processed any further.  If SEARCHABLE is false, the entry is
+     only reachable as the parent of other entries.  Searchable
+     entries must be added in sorted order.  When all entries have
+     been added, the shard is not finalized.  */
+  cooked_index_entry *add_from_cache (sect_offset die_offset,
+				      enum dwarf_tag tag,
+				      cooked_index_flag flags,
+				      const char *name,
+				      const char *canonical,
+				      dwarf2_per_cu_data *per_cu,
+				      bool searchable);
+
+  /* Make room for N searchable entries.  */
+  void reserve (size_t n)
+  {
+    m_entries.reserve (n);
+  }
 
-  /* Wait for this index's finalization to be complete.  */
-  void wait (bool allow_quit = true) const;
+  /* Set the entry that represents the program's "main".  */
+  void set_main (cooked_index_entry *entry)
+  {
+    m_main = entry;
+  }
 
   friend class cooked_index;
 
@@ -286,7 +331,6 @@ class cooked_index_shard
   /* Return a range of all the entries.  */
   range all_entries () const
   {
-    wait ();
     return { m_entries.cbegin (), m_entries.cend () };
   }
 
@@ -334,8 +378,17 @@ class cooked_index_shard
   gdb::unique_xmalloc_ptr<char> handle_gnat_encoded_entry
        (cooked_index_entry *entry, htab_t gnat_entries);
 
-  /* A helper method that does the work of 'finalize'.  */
-  void do_finalize ();
+  /* The first step of finalization, done for each shard separately.
+     Set the canonical name of the entries that do not need C or C++
+     canonicalization, and append the ones that do to C_ENTRIES and
+     CPLUS_ENTRIES.  The canonicalization of these is done by
+     cooked_index for all the shards at once.  */
+  void prepare_finalize (std::vector<cooked_index_entry *> *c_entries,
+			 std::vector<cooked_index_entry *> *cplus_entries);
+
+  /* The last step of finalization: sort the entries by canonical
+     name, so that they can be searched.  */
+  void sort_entries ();
 
   /* Storage for the entries.  */
   auto_obstack m_storage;
@@ -346,12 +399,11 @@ class cooked_index_shard
   /* The addrmap.  This maps address ranges to dwarf2_per_cu_data
      objects.  */
   addrmap *m_addrmap = nullptr;
-  /* Storage for canonical names.  */
+  /* Storage for names created for Ada entries.  */
   std::vector<gdb::unique_xmalloc_ptr<char>> m_names;
-  /* A future that tracks when the 'finalize' method is done.  Note
-     that the 'get' method is never called on this future, only
-     'wait'.  */
-  gdb::future<void> m_future;
+  /* True if the entries were read from the index cache, and so do
+     not need to be finalized.  */
+  bool m_from_cache = false;
 };
 
 /* The main index of DIEs.  The parallel DIE indexers create
@@ -367,17 +419,17 @@ class cooked_index : public dwarf_scanner_base
      object.  */
   using vec_type = std::vector<std::unique_ptr<cooked_index_shard>>;
 
-  explicit cooked_index (vec_type &&vec);
+  /* Create an index from the shards in VEC.  If ADDRESSES_ONLY is
+     true, the shards only hold an address map, and the units still
+     have to be indexed; see 'complete'.  */
+  explicit cooked_index (vec_type &&vec, bool addresses_only = false);
   ~cooked_index () override;
   DISABLE_COPY_AND_ASSIGN (cooked_index);
 
   /* Wait until the finalization of the entire cooked_index is
-     done.  */
-  void wait () const
-  {
-    for (auto &item : m_vector)
-      item->wait ();
-  }
+     done.  If ALLOW_QUIT is true, the wait may be interrupted by the
+     user.  */
+  void wait (bool allow_quit = true) const;
 
   /* A range over a vector of subranges.  */
   using range = range_chain<cooked_index_shard::range>;
@@ -390,6 +442,7 @@ class cooked_index : public dwarf_scanner_base
   /* Return a range of all the entries.  */
   range all_entries () const
   {
+    wait ();
     std::vector<cooked_index_shard::range> result_range;
     result_range.reserve (m_vector.size ());
     for (auto &entry : m_vector)
@@ -424,14 +477,71 @@ class cooked_index : public dwarf_scanner_base
      the index code ensures this itself -- e.g., 'all_entries' will
      wait on the 'finalize' future.  However, on destruction, if an
      index is being written, it's also necessary to wait for that to
-     complete.  */
-  void wait_completely () override
+     complete.  An index read from the index cache is never
+     written.  */
+  void wait_completely () override;
+
+  /* Start writing to the index cache, if the user asked for this.
+     The write itself only begins once finalization is done.  */
+  void start_writing_index (dwarf2_per_bfd *per_bfd);
+
+  /* Return true if this index only holds an address map so far.  */
+  bool addresses_only () const
   {
-    m_write_future.wait ();
+    return m_addresses_only;
   }
 
-  /* Start writing to the index cache, if the user asked for this.  */
-  void start_writing_index (dwarf2_per_bfd *per_bfd);
+  /* Replace the shards of an index that only holds an address map
+     with VEC, the shards that result from indexing all the units.  */
+  void complete (vec_type &&vec);
+
+  /* Return the number of shards in this index.  */
+  size_t shard_count () const
+  {
+    return m_vector.size ();
+  }
+
+  /* How long the phases of finalization took.  All of them are zero
+     if the entries were read from the index cache.  */
+  struct finalize_times
+  {
+    /* Handling the names that need no C or C++ canonicalization.  */
+    std::chrono::steady_clock::duration prepare {};
+    /* Canonicalizing the C and C++ names.  */
+    std::chrono::steady_clock::duration canonicalize {};
+    /* Sorting the entries.  */
+    std::chrono::steady_clock::duration sort {};
+  };
+
+  /* Return how long the phases of finalization took.  This waits for
+     finalization to be done.  */
+  const finalize_times &get_finalize_times () const
+  {
+    wait ();
+    return m_finalize_times;
+  }
+
+  /* The memory used by an index.  */
+  struct memory_usage
+  {
+    /* The number of entries that can be searched.  */
+    size_t entries = 0;
+    /* The bytes allocated for the entries and the address maps.  */
+    size_t storage = 0;
+    /* The bytes allocated for the vectors of entries.  */
+    size_t vectors = 0;
+    /* The bytes allocated for the names created by GDB.  Other names
+       point into the DWARF or into the index cache file.  */
+    size_t names = 0;
+  };
+
+  /* Return the memory used by this index.  This waits for
+     finalization to be done.  */
+  memory_usage get_memory_usage () const;
+
+  /* Print the statistics of the cache of canonical names.  This waits
+     for finalization to be done.  */
+  void print_bcache_statistics ();
 
 private:
 
@@ -439,12 +549,81 @@ class cooked_index : public dwarf_scanner_base
   void maybe_write_index (dwarf2_per_bfd *per_bfd,
 			  const index_cache_store_context &);
 
+  /* A write to the index cache that was requested, but that has not
+     been started yet.  */
+  struct pending_write;
+
+  /* Post the task that writes the index to the index cache, as
+     requested by M_PENDING_WRITE.  This is called with
+     M_WRITE_MUTEX held, once finalization is done.  */
+  void post_write_task ();
+
+  /* Finalize the shards: set the canonical name of every entry, and
+     sort the entries.  This runs in the background, and splits the
+     work across the thread pool.  */
+  void do_finalize ();
+
+  /* Canonicalize the names of ENTRIES, which all have language LANG,
+     storing the new names in M_NAMES.  */
+  void canonicalize_names (const std::vector<cooked_index_entry *> &entries,
+			   enum language lang);
+
+  /* The task that runs do_finalize in the background.  This is a
+     member so that no allocation is needed to post it.  */
+  struct finalize_task final : public gdb::pool_task
+  {
+    explicit finalize_task (cooked_index *index)
+      : m_index (index)
+    {
+    }
+
+    void run () override
+    {
+      m_index->do_finalize ();
+    }
+
+    cooked_index *m_index;
+  };
+
   /* The vector of cooked_index objects.  This is stored because the
      entries are stored on the obstacks in those objects.  */
   vec_type m_vector;
 
+  /* Storage for the canonical C and C++ names.  The threads that
+     canonicalize the names intern them here directly.  */
+  gdb::concurrent_bcache m_canonical_names;
+
+  /* How long finalization took.  */
+  finalize_times m_finalize_times;
+
+  /* The task used to finalize the shards.  */
+  finalize_task m_finalize_task { this };
+
+  /* The group holding M_FINALIZE_TASK.  This must follow the members
+     above, so that it is destroyed first: the destructor waits for
+     the task, which refers to them.  */
+  mutable gdb::task_group m_finalize_tasks;
+
   /* A future that tracks when the 'index_write' method is done.  */
   gdb::future<void> m_write_future;
+
+  /* The write requested by 'start_writing_index', until it is
+     started.  The write task must not be posted before finalization
+     is done: a worker thread waiting for the finalization tasks may
+     run other tasks meanwhile, and so must not run one that itself
+     waits for finalization.  */
+  std::unique_ptr<pending_write> m_pending_write;
+
+  /* True once 'do_finalize' is done.  */
+  bool m_finalized = false;
+
+#if CXX_STD_THREAD
+  /* Protects M_PENDING_WRITE, M_FINALIZED and M_WRITE_FUTURE.  */
+  std::mutex m_write_mutex;
+#endif
+
+  /* True if the units have not been indexed yet.  */
+  bool m_addresses_only;
 };
 
 #endif /* GDB_DWARF2_COOKED_INDEX_H */
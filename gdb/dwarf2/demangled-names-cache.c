@@ -0,0 +1,269 @@
+/* Caching of the demangled names of minimal symbols.
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "dwarf2/demangled-names-cache.h"
+
+#include "build-id.h"
+#include "objfiles.h"
+#include "gdbsupport/byte-vector.h"
+#include "gdbsupport/version.h"
+#include <algorithm>
+
+/* The demangled names of the minimal symbols of an objfile are saved in
+   the index cache, so that they need not be computed again the next
+   time the objfile is loaded.  The file is written in host byte order,
+   and is used in place after being mapped into memory.  It is made of:
+
+   - a demangled_names_file_header;
+   - N_ENTRIES demangled_names_file_entry, sorted by hash and then by
+     linkage name;
+   - a string table of STRINGS_SIZE bytes, holding NUL-terminated
+     strings.  */
+
+#define DEMANGLED_NAMES_FILE_MAGIC "GDBDMGL"
+#define DEMANGLED_NAMES_FILE_VERSION 1
+
+/* Used to mark the absence of a demangled name.  */
+#define DEMANGLED_NAMES_FILE_NONE ((uint32_t) -1)
+
+struct demangled_names_file_header
+{
+  char magic[8];
+  uint32_t version;
+  /* Set to 1, to detect a file written with the wrong byte
+     order.  */
+  uint32_t byte_order;
+  /* The offset in the string table of the version of GDB that wrote
+     the file.  The demanglers change from one version to the next, so
+     a file written by another version is ignored.  */
+  uint32_t gdb_version;
+  uint32_t n_entries;
+  uint32_t strings_size;
+  uint32_t padding;
+};
+
+struct demangled_names_file_entry
+{
+  /* The fast_hash of the linkage name.  */
+  uint32_t hash;
+  /* The offset of the linkage name in the string table.  */
+  uint32_t linkage_name;
+  /* The offset of the demangled name in the string table, or
+     DEMANGLED_NAMES_FILE_NONE.  */
+  uint32_t demangled_name;
+  /* The language that symbol_find_demangled_name found for the
+     symbol.  */
+  uint32_t language;
+};
+
+static_assert (sizeof (demangled_names_file_header) % 8 == 0, "");
+static_assert (sizeof (demangled_names_file_entry) % 8 == 0, "");
+
+/* See demangled-names-cache.h.  */
+
+demangled_names_cache::demangled_names_cache (struct objfile *objfile)
+  : m_objfile (objfile)
+{
+  /* Separate debug objfiles share the build id of the objfile they
+     belong to, so only the latter uses the cache.  */
+  if (!global_index_cache.enabled ()
+      || objfile->separate_debug_objfile_backlink != nullptr)
+    return;
+
+  m_build_id = build_id_bfd_get (objfile->obfd.get ());
+  if (m_build_id == nullptr)
+    return;
+
+  m_found = init (global_index_cache.lookup_demangled_names (m_build_id,
+							     &m_resource));
+}
+
+/* See demangled-names-cache.h.  */
+
+bool
+demangled_names_cache::init (gdb::array_view<const gdb_byte> contents)
+{
+  const demangled_names_file_header *header
+    = (const demangled_names_file_header *) contents.data ();
+
+  if (contents.size () < sizeof (*header)
+      || ((uintptr_t) contents.data () & 7) != 0
+      || memcmp (header->magic, DEMANGLED_NAMES_FILE_MAGIC,
+		 sizeof (header->magic)) != 0
+      || header->version != DEMANGLED_NAMES_FILE_VERSION
+      || header->byte_order != 1)
+    return false;
+
+  size_t entries_size
+    = (size_t) header->n_entries * sizeof (demangled_names_file_entry);
+  if (contents.size () - sizeof (*header) < entries_size
+      || (contents.size () - sizeof (*header) - entries_size
+	  != header->strings_size)
+      || header->strings_size == 0
+      || contents[contents.size () - 1] != '\0')
+    return false;
+
+  m_entries = (const demangled_names_file_entry *) (header + 1);
+  m_n_entries = header->n_entries;
+  m_strings = (const char *) contents.data () + sizeof (*header)
+	      + entries_size;
+  m_strings_size = header->strings_size;
+
+  const char *writer = string (header->gdb_version);
+  return writer != nullptr && strcmp (writer, version) == 0;
+}
+
+/* See demangled-names-cache.h.  */
+
+bool
+demangled_names_cache::lookup (const char *linkage_name, hashval_t hash,
+			       enum language *language,
+			       const char **demangled) const
+{
+  if (!m_found)
+    return false;
+
+  const demangled_names_file_entry *end = m_entries + m_n_entries;
+  const demangled_names_file_entry *it
+    = std::lower_bound (m_entries, end, hash,
+			[] (const demangled_names_file_entry &e, hashval_t h)
+      {
+	return e.hash < h;
+      });
+
+  for (; it != end && it->hash == hash; ++it)
+    {
+      const char *name = string (it->linkage_name);
+
+      if (name == nullptr || strcmp (name, linkage_name) != 0)
+	continue;
+
+      if (it->language >= nr_languages)
+	return false;
+      *language = (enum language) it->language;
+      if (it->demangled_name == DEMANGLED_NAMES_FILE_NONE)
+	*demangled = nullptr;
+      else
+	{
+	  *demangled = string (it->demangled_name);
+	  if (*demangled == nullptr)
+	    return false;
+	}
+      return true;
+    }
+
+  return false;
+}
+
+/* See demangled-names-cache.h.  */
+
+void
+demangled_names_cache::save (int n_demangled) const
+{
+  if (m_build_id == nullptr || (m_found && n_demangled == 0))
+    return;
+
+  struct name
+  {
+    hashval_t hash;
+    const char *linkage_name;
+    const char *demangled_name;
+    enum language language;
+  };
+
+  std::vector<name> names;
+  names.reserve (m_objfile->per_bfd->minimal_symbol_count);
+  for (minimal_symbol *msym : m_objfile->msymbols ())
+    {
+      const char *linkage_name = msym->linkage_name ();
+
+      /* Ada symbols are searched by their linkage name, and have no
+	 demangled name once installed.  */
+      const char *demangled_name = (msym->language () == language_ada
+				    ? nullptr
+				    : msym->demangled_name ());
+
+      names.push_back ({fast_hash (linkage_name, strlen (linkage_name)),
+			linkage_name, demangled_name, msym->language ()});
+    }
+
+  std::sort (names.begin (), names.end (),
+	     [] (const name &a, const name &b)
+    {
+      if (a.hash != b.hash)
+	return a.hash < b.hash;
+      return strcmp (a.linkage_name, b.linkage_name) < 0;
+    });
+  names.erase (std::unique (names.begin (), names.end (),
+			    [] (const name &a, const name &b)
+	{
+	  return strcmp (a.linkage_name, b.linkage_name) == 0;
+	}),
+	       names.end ());
+
+  std::string strings;
+  auto add_string = [&] (const char *str)
+    {
+      uint32_t offset = strings.size ();
+      strings.append (str, strlen (str) + 1);
+      return offset;
+    };
+
+  std::vector<demangled_names_file_entry> entries;
+  entries.reserve (names.size ());
+  uint32_t gdb_version = add_string (version);
+  for (const name &n : names)
+    {
+      demangled_names_file_entry entry;
+
+      entry.hash = n.hash;
+      entry.linkage_name = add_string (n.linkage_name);
+      entry.demangled_name = (n.demangled_name == nullptr
+			      ? DEMANGLED_NAMES_FILE_NONE
+			      : add_string (n.demangled_name));
+      entry.language = n.language;
+      entries.push_back (entry);
+
+      if (strings.size () >= DEMANGLED_NAMES_FILE_NONE)
+	return;
+    }
+
+  demangled_names_file_header header;
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, DEMANGLED_NAMES_FILE_MAGIC, sizeof (header.magic));
+  header.version = DEMANGLED_NAMES_FILE_VERSION;
+  header.byte_order = 1;
+  header.gdb_version = gdb_version;
+  header.n_entries = entries.size ();
+  header.strings_size = strings.size ();
+
+  gdb::byte_vector contents (sizeof (header)
+			     + entries.size () * sizeof (entries[0])
+			     + strings.size ());
+  gdb_byte *p = contents.data ();
+  memcpy (p, &header, sizeof (header));
+  p += sizeof (header);
+  if (!entries.empty ())
+    memcpy (p, entries.data (), entries.size () * sizeof (entries[0]));
+  p += entries.size () * sizeof (entries[0]);
+  memcpy (p, strings.data (), strings.size ());
+
+  global_index_cache.store_demangled_names (m_build_id, contents);
+}
@@ -0,0 +1,87 @@
+/* Caching of the demangled names of minimal symbols.
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef DWARF2_DEMANGLED_NAMES_CACHE_H
+#define DWARF2_DEMANGLED_NAMES_CACHE_H
+
+#include "dwarf2/index-cache.h"
+
+struct demangled_names_file_entry;
+
+/* The demangled names of the minimal symbols of an objfile, as saved in
+   the index cache by a previous session, so that they need not be
+   computed again.  See demangled-names-cache.c for the format of the
+   file.  */
+
+class demangled_names_cache
+{
+public:
+
+  /* Look for the names of the minimal symbols of OBJFILE in the index
+     cache.  Nothing is looked up if the index cache is disabled.  */
+  explicit demangled_names_cache (struct objfile *objfile);
+
+  DISABLE_COPY_AND_ASSIGN (demangled_names_cache);
+
+  /* Return true if the names of the objfile were found.  */
+  bool found () const
+  { return m_found; }
+
+  /* Look for LINKAGE_NAME, whose fast_hash is HASH.  If it is found,
+     return true, and store the results of symbol_find_demangled_name
+     for it in *LANGUAGE and *DEMANGLED.  *DEMANGLED is set to NULL if
+     the name has no demangled form.  This can be called from several
+     threads at once.  */
+  bool lookup (const char *linkage_name, hashval_t hash,
+	       enum language *language, const char **demangled) const;
+
+  /* Save the names of the now installed minimal symbols of the objfile
+     in the index cache for the next session, unless they were all
+     found there.  N_DEMANGLED is the number of names that had to be
+     demangled.  */
+  void save (int n_demangled) const;
+
+private:
+
+  /* Use CONTENTS as the file.  Return false if it is not a valid file
+     written by this GDB, in which case it must not be used.  */
+  bool init (gdb::array_view<const gdb_byte> contents);
+
+  /* Return the string at OFFSET in the string table, or NULL if
+     OFFSET is out of bounds.  */
+  const char *string (uint32_t offset) const
+  { return offset < m_strings_size ? m_strings + offset : nullptr; }
+
+  /* The objfile, and its build id, or NULL if the names of the objfile
+     are not cached.  */
+  struct objfile *m_objfile;
+  const bfd_build_id *m_build_id = nullptr;
+
+  /* Whether the file was found, and the resources holding it.  */
+  bool m_found = false;
+  std::unique_ptr<index_cache_resource> m_resource;
+
+  /* The entries and string table of the file.  */
+  const demangled_names_file_entry *m_entries = nullptr;
+  uint32_t m_n_entries = 0;
+  const char *m_strings = nullptr;
+  uint32_t m_strings_size = 0;
+};
+
+#endif /* DWARF2_DEMANGLED_NAMES_CACHE_H */
@@ -33,6 +33,9 @@
 #include "regcache.h"
 #include "value.h"
 #include "record.h"
+#include "observable.h"
+#include "cli/cli-cmds.h"
+#include "cli/cli-style.h"
 
 #include "complaints.h"
 #include "dwarf2/frame.h"
@@ -889,6 +892,162 @@ struct dwarf2_frame_cache
   struct dwarf2_frame_fn_data *fn_data;
 };
 
+/* A row of the unwind table described by an FDE: the rules for the
+   CFA and for the registers that are in effect at some PC.  Computing
+   a row means running the CIE and FDE programs up to that PC, so the
+   rows are kept per objfile across stops; see get_unwind_row.  */
+
+struct dwarf2_unwind_row
+{
+  /* The architecture the row was computed for.  */
+  struct gdbarch *gdbarch = nullptr;
+
+  /* The unrelocated entry PC of the function the row was computed
+     with, if it was known and within the FDE.  */
+  gdb::optional<unrelocated_addr> entry_pc;
+
+  /* The register rules, indexed by DWARF column.  */
+  std::vector<struct dwarf2_frame_state_reg> reg;
+
+  /* The CFA rule, as in dwarf2_frame_state_reg_info.  */
+  LONGEST cfa_offset = 0;
+  ULONGEST cfa_reg = 0;
+  enum cfa_how_kind cfa_how = CFA_UNSET;
+  const gdb_byte *cfa_exp = nullptr;
+
+  /* The return address column of the CIE.  */
+  ULONGEST retaddr_column = 0;
+
+  /* See dwarf2_frame_state.  */
+  bool armcc_cfa_offsets_reversed = false;
+
+  /* Set if the CFA at the entry PC is the stack pointer plus
+     ENTRY_CFA_SP_OFFSET.  */
+  bool entry_cfa_sp_offset_p = false;
+  LONGEST entry_cfa_sp_offset = 0;
+};
+
+/* The unwind rows computed for the FDEs of an objfile.  */
+
+struct dwarf2_unwind_row_cache
+{
+  /* The rows, keyed by the unrelocated PC they were computed for.  */
+  std::unordered_map<unrelocated_addr, dwarf2_unwind_row> rows;
+
+  /* The rows that were in ROWS when it was last flushed.  They are
+     kept until the next flush so that a row returned by get_unwind_row
+     stays valid while its caller still uses it.  */
+  std::unordered_map<unrelocated_addr, dwarf2_unwind_row> retired_rows;
+
+  /* The number of lookups, and how many of them found a row.  */
+  unsigned long lookups = 0;
+  unsigned long hits = 0;
+
+  /* The number of times ROWS was flushed because it was full.  */
+  unsigned long flushes = 0;
+};
+
+/* The maximum number of unwind rows cached for each objfile.  Zero
+   means no limit.  */
+
+static unsigned int dwarf2_unwind_cache_limit = 4096;
+
+static const registry<objfile>::key<dwarf2_unwind_row_cache>
+  dwarf2_frame_row_cache_data;
+
+/* Return the row of the unwind table of FDE, which is in OBJFILE, for
+   PC.  FDE_PC is the relocated initial location of FDE.  ENTRY_PC, if
+   set, is the entry PC of the function, which is within FDE.  The row
+   is computed only if it is not already in the cache of OBJFILE.  */
+
+static const dwarf2_unwind_row &
+get_unwind_row (struct gdbarch *gdbarch, struct dwarf2_fde *fde,
+		CORE_ADDR fde_pc, CORE_ADDR pc,
+		gdb::optional<CORE_ADDR> entry_pc, struct objfile *objfile)
+{
+  CORE_ADDR text_offset = objfile->text_section_offset ();
+
+  dwarf2_unwind_row_cache *row_cache
+    = dwarf2_frame_row_cache_data.get (objfile);
+  if (row_cache == nullptr)
+    row_cache = dwarf2_frame_row_cache_data.emplace (objfile);
+
+  unrelocated_addr key = (unrelocated_addr) (pc - text_offset);
+  gdb::optional<unrelocated_addr> entry_key;
+  if (entry_pc.has_value ())
+    entry_key = (unrelocated_addr) (*entry_pc - text_offset);
+
+  ++row_cache->lookups;
+  auto iter = row_cache->rows.find (key);
+  if (iter != row_cache->rows.end ()
+      && iter->second.gdbarch == gdbarch
+      && iter->second.entry_pc.has_value () == entry_key.has_value ()
+      && (!entry_key.has_value () || *iter->second.entry_pc == *entry_key))
+    {
+      ++row_cache->hits;
+      return iter->second;
+    }
+
+  /* Allocate and initialize the frame state.  */
+  struct dwarf2_frame_state fs (fde_pc, fde->cie);
+
+  /* Check for "quirks" - known bugs in producers.  */
+  dwarf2_frame_find_quirks (&fs, fde);
+
+  /* First decode all the insns in the CIE.  */
+  execute_cfa_program (fde, fde->cie->initial_instructions,
+		       fde->cie->end, gdbarch, pc, &fs, text_offset);
+
+  /* Save the initialized register set.  */
+  fs.initial = fs.regs;
+
+  dwarf2_unwind_row row;
+  const gdb_byte *instr = fde->instructions;
+  if (entry_pc.has_value ())
+    {
+      /* Decode the insns in the FDE up to the entry PC.  */
+      instr = execute_cfa_program (fde, fde->instructions, fde->end, gdbarch,
+				   *entry_pc, &fs, text_offset);
+
+      if (fs.regs.cfa_how == CFA_REG_OFFSET
+	  && (dwarf_reg_to_regnum (gdbarch, fs.regs.cfa_reg)
+	      == gdbarch_sp_regnum (gdbarch)))
+	{
+	  row.entry_cfa_sp_offset = fs.regs.cfa_offset;
+	  row.entry_cfa_sp_offset_p = true;
+	}
+    }
+
+  /* Then decode the insns in the FDE up to our target PC.  */
+  execute_cfa_program (fde, instr, fde->end, gdbarch, pc, &fs, text_offset);
+
+  row.gdbarch = gdbarch;
+  row.entry_pc = entry_key;
+  row.reg = std::move (fs.regs.reg);
+  row.cfa_offset = fs.regs.cfa_offset;
+  row.cfa_reg = fs.regs.cfa_reg;
+  row.cfa_how = fs.regs.cfa_how;
+  row.cfa_exp = fs.regs.cfa_exp;
+  row.retaddr_column = fs.retaddr_column;
+  row.armcc_cfa_offsets_reversed = fs.armcc_cfa_offsets_reversed;
+
+  /* Start over once the cache is full.  Moving the map keeps its
+     elements where they are, so rows handed out before the flush remain
+     valid.  */
+  if (dwarf2_unwind_cache_limit != 0
+      && row_cache->rows.size () >= dwarf2_unwind_cache_limit
+      && iter == row_cache->rows.end ())
+    {
+      row_cache->retired_rows = std::move (row_cache->rows);
+      row_cache->rows.clear ();
+      ++row_cache->flushes;
+    }
+
+  dwarf2_unwind_row &result = row_cache->rows[key];
+  result = std::move (row);
+  return result;
+}
+
 static struct dwarf2_frame_cache *
 dwarf2_frame_cache (frame_info_ptr this_frame, void **this_cache)
 {
@@ -896,8 +1055,6 @@ dwarf2_frame_cache (frame_info_ptr this_frame, void **this_cache)
   const int num_regs = gdbarch_num_cooked_regs (gdbarch);
   struct dwarf2_frame_cache *cache;
   struct dwarf2_fde *fde;
-  CORE_ADDR entry_pc;
-  const gdb_byte *instr;
 
   if (*this_cache)
     return (struct dwarf2_frame_cache *) *this_cache;
@@ -931,69 +1088,40 @@ dwarf2_frame_cache (frame_info_ptr this_frame, void **this_cache)
 
   CORE_ADDR text_offset = cache->per_objfile->objfile->text_section_offset ();
 
-  /* Allocate and initialize the frame state.  */
-  struct dwarf2_frame_state fs (pc1, fde->cie);
-
   cache->addr_size = fde->cie->addr_size;
 
-  /* Check for "quirks" - known bugs in producers.  */
-  dwarf2_frame_find_quirks (&fs, fde);
-
-  /* First decode all the insns in the CIE.  */
-  execute_cfa_program (fde, fde->cie->initial_instructions,
-		       fde->cie->end, gdbarch,
-		       get_frame_address_in_block (this_frame), &fs,
-		       text_offset);
-
-  /* Save the initialized register set.  */
-  fs.initial = fs.regs;
-
   /* Fetching the entry pc for THIS_FRAME won't necessarily result
      in an address that's within the range of FDE locations.  This
      is due to the possibility of the function occupying non-contiguous
      ranges.  */
-  LONGEST entry_cfa_sp_offset;
-  int entry_cfa_sp_offset_p = 0;
-  if (get_frame_func_if_available (this_frame, &entry_pc)
-      && fde->initial_location <= (unrelocated_addr) (entry_pc - text_offset)
-      && (unrelocated_addr) (entry_pc - text_offset) < fde->end_addr ())
-    {
-      /* Decode the insns in the FDE up to the entry PC.  */
-      instr = execute_cfa_program (fde, fde->instructions, fde->end, gdbarch,
-				   entry_pc, &fs, text_offset);
-
-      if (fs.regs.cfa_how == CFA_REG_OFFSET
-	  && (dwarf_reg_to_regnum (gdbarch, fs.regs.cfa_reg)
-	      == gdbarch_sp_regnum (gdbarch)))
-	{
-	  entry_cfa_sp_offset = fs.regs.cfa_offset;
-	  entry_cfa_sp_offset_p = 1;
-	}
-    }
-  else
-    instr = fde->instructions;
-
-  /* Then decode the insns in the FDE up to our target PC.  */
-  execute_cfa_program (fde, instr, fde->end, gdbarch,
-		       get_frame_address_in_block (this_frame), &fs,
-		       text_offset);
+  gdb::optional<CORE_ADDR> entry_pc;
+  CORE_ADDR func;
+  if (get_frame_func_if_available (this_frame, &func)
+      && fde->initial_location <= (unrelocated_addr) (func - text_offset)
+      && (unrelocated_addr) (func - text_offset) < fde->end_addr ())
+    entry_pc = func;
+
+  const dwarf2_unwind_row &row
+    = get_unwind_row (gdbarch, fde, pc1,
+		      get_frame_address_in_block (this_frame), entry_pc,
+		      cache->per_objfile->objfile);
 
   try
     {
       /* Calculate the CFA.  */
-      switch (fs.regs.cfa_how)
+      switch (row.cfa_how)
 	{
 	case CFA_REG_OFFSET:
-	  cache->cfa = read_addr_from_reg (this_frame, fs.regs.cfa_reg);
-	  if (fs.armcc_cfa_offsets_reversed)
-	    cache->cfa -= fs.regs.cfa_offset;
+	  cache->cfa = read_addr_from_reg (this_frame, row.cfa_reg);
+	  if (row.armcc_cfa_offsets_reversed)
+	    cache->cfa -= row.cfa_offset;
 	  else
-	    cache->cfa += fs.regs.cfa_offset;
+	    cache->cfa += row.cfa_offset;
 	  break;
 
 	case CFA_EXP:
 	  cache->cfa =
-	    execute_stack_op (fs.regs.cfa_exp, fs.regs.cfa_exp_len,
+	    execute_stack_op (row.cfa_exp, row.cfa_exp_len,
 			      cache->addr_size, this_frame, 0, 0,
 			      cache->per_objfile);
 	  break;
@@ -1028,7 +1156,7 @@ dwarf2_frame_cache (frame_info_ptr this_frame, void **this_cache)
   {
     int column;		/* CFI speak for "register number".  */
 
-    for (column = 0; column < fs.regs.reg.size (); column++)
+    for (column = 0; column < row.reg.size (); column++)
       {
 	/* Use the GDB register number as the destination index.  */
 	int regnum = dwarf_reg_to_regnum (gdbarch, column);
@@ -1048,16 +1176,17 @@ dwarf2_frame_cache (frame_info_ptr this_frame, void **this_cache)
 	   problems when a debug info register falls outside of the
 	   table.  We need a way of iterating through all the valid
 	   DWARF2 register numbers.  */
-	if (fs.regs.reg[column].how == DWARF2_FRAME_REG_UNSPECIFIED)
+	if (row.reg[column].how == DWARF2_FRAME_REG_UNSPECIFIED)
 	  {
 	    if (cache->reg[regnum].how == DWARF2_FRAME_REG_UNSPECIFIED)
 	      complaint (_("\
 incomplete CFI data; unspecified registers (e.g., %s) at %s"),
 			 gdbarch_register_name (gdbarch, regnum),
-			 paddress (gdbarch, fs.pc));
+			 paddress (gdbarch,
+				   get_frame_address_in_block (this_frame)));
 	  }
 	else
-	  cache->reg[regnum] = fs.regs.reg[column];
+	  cache->reg[regnum] = row.reg[column];
       }
   }
 
@@ -1072,8 +1201,8 @@ incomplete CFI data; unspecified registers (e.g., %s) at %s"),
 	    || cache->reg[regnum].how == DWARF2_FRAME_REG_RA_OFFSET)
 	  {
 	    const std::vector<struct dwarf2_frame_state_reg> &regs
-	      = fs.regs.reg;
-	    ULONGEST retaddr_column = fs.retaddr_column;
+	      = row.reg;
+	    ULONGEST retaddr_column = row.retaddr_column;
 
 	    /* It seems rather bizarre to specify an "empty" column as
 	       the return adress column.  However, this is exactly
@@ -1082,7 +1211,7 @@ incomplete CFI data; unspecified registers (e.g., %s) at %s"),
 	       register corresponding to the return address column.
 	       Incidentally, that's how we should treat a return
 	       address column specifying "same value" too.  */
-	    if (fs.retaddr_column < fs.regs.reg.size ()
+	    if (row.retaddr_column < row.reg.size ()
 		&& regs[retaddr_column].how != DWARF2_FRAME_REG_UNSPECIFIED
 		&& regs[retaddr_column].how != DWARF2_FRAME_REG_SAME_VALUE)
 	      {
@@ -1095,12 +1224,12 @@ incomplete CFI data; unspecified registers (e.g., %s) at %s"),
 	      {
 		if (cache->reg[regnum].how == DWARF2_FRAME_REG_RA)
 		  {
-		    cache->reg[regnum].loc.reg = fs.retaddr_column;
+		    cache->reg[regnum].loc.reg = row.retaddr_column;
 		    cache->reg[regnum].how = DWARF2_FRAME_REG_SAVED_REG;
 		  }
 		else
 		  {
-		    cache->retaddr_reg.loc.reg = fs.retaddr_column;
+		    cache->retaddr_reg.loc.reg = row.retaddr_column;
 		    cache->retaddr_reg.how = DWARF2_FRAME_REG_SAVED_REG;
 		  }
 	      }
@@ -1108,13 +1237,13 @@ incomplete CFI data; unspecified registers (e.g., %s) at %s"),
       }
   }
 
-  if (fs.retaddr_column < fs.regs.reg.size ()
-      && fs.regs.reg[fs.retaddr_column].how == DWARF2_FRAME_REG_UNDEFINED)
+  if (row.retaddr_column < row.reg.size ()
+      && row.reg[row.retaddr_column].how == DWARF2_FRAME_REG_UNDEFINED)
     cache->undefined_retaddr = 1;
 
   dwarf2_tailcall_sniffer_first (this_frame, &cache->tailcall_cache,
-				 (entry_cfa_sp_offset_p
-				  ? &entry_cfa_sp_offset : NULL));
+				 (row.entry_cfa_sp_offset_p
+				  ? &row.entry_cfa_sp_offset : NULL));
 
   return cache;
 }
@@ -2251,6 +2380,52 @@ dwarf2_build_frame_info (struct objfile *objfile)
   set_comp_unit (objfile, unit.release ());
 }
 
+/* The rows depend on the symbols through the producer quirks, so drop
+   them all when an objfile is added.  */
+
+static void
+dwarf2_frame_new_objfile (struct objfile *objfile)
+{
+  for (struct objfile *iter : objfile->pspace->objfiles ())
+    {
+      dwarf2_unwind_row_cache *row_cache
+	= dwarf2_frame_row_cache_data.get (iter);
+      if (row_cache != nullptr)
+	{
+	  row_cache->rows.clear ();
+	  row_cache->retired_rows.clear ();
+	}
+    }
+}
+
+/* Implement "maintenance info dwarf-unwind-cache".  */
+
+static void
+maintenance_info_dwarf_unwind_cache (const char *args, int from_tty)
+{
+  for (struct objfile *objfile : current_program_space->objfiles ())
+    {
+      dwarf2_unwind_row_cache *row_cache
+	= dwarf2_frame_row_cache_data.get (objfile);
+      if (row_cache == nullptr)
+	continue;
+
+      gdb_printf (_("DWARF unwind rows for %ps:\n"),
+		  styled_string (file_name_style.style (),
+				 objfile_name (objfile)));
+      gdb_printf (_("  Rows cached: %zu\n"), row_cache->rows.size ());
+      gdb_printf (_("  Lookups: %lu\n"), row_cache->lookups);
+      gdb_printf (_("  Hits: %lu\n"), row_cache->hits);
+      gdb_printf (_("  Flushes: %lu\n"), row_cache->flushes);
+      gdb_printf (_("  Hit rate: "));
+      if (row_cache->lookups == 0)
+	gdb_printf (_("(not applicable)\n"));
+      else
+	gdb_printf ("%.1f%%\n",
+		    100.0 * row_cache->hits / row_cache->lookups);
+    }
+}
+
 /* Handle 'maintenance show dwarf unwinders'.  */
 
 static void
@@ -2263,6 +2438,19 @@ show_dwarf_unwinders_enabled_p (struct ui_file *file, int from_tty,
 	      value);
 }
 
+/* Handle 'maintenance show dwarf unwind-cache-limit'.  */
+
+static void
+show_dwarf_unwind_cache_limit (struct ui_file *file, int from_tty,
+			       struct cmd_list_element *c,
+			       const char *value)
+{
+  gdb_printf (file,
+	      _("The maximum number of cached DWARF unwind rows "
+		"per objfile is %s.\n"),
+	      value);
+}
+
 void _initialize_dwarf2_frame ();
 void
 _initialize_dwarf2_frame ()
@@ -2279,6 +2467,29 @@ architecture that doesn't support them will have no effect."),
 			   &set_dwarf_cmdlist,
 			   &show_dwarf_cmdlist);
 
+  add_setshow_uinteger_cmd ("unwind-cache-limit", class_maintenance,
+			    &dwarf2_unwind_cache_limit, _("\
+Set the maximum number of DWARF unwind rows cached for each objfile."), _("\
+Show the maximum number of DWARF unwind rows cached for each objfile."), _("\
+When an objfile has this many cached rows, its cache is emptied before\n\
+another row is added.\n\
+Literal \"unlimited\" or zero means no limit."),
+			    NULL,
+			    show_dwarf_unwind_cache_limit,
+			    &set_dwarf_cmdlist,
+			    &show_dwarf_cmdlist);
+
+  add_cmd ("dwarf-unwind-cache", class_maintenance,
+	   maintenance_info_dwarf_unwind_cache, _("\
+Print statistics about the cached DWARF unwind rows of each objfile.\n\
+The rows computed from the call frame information are kept across\n\
+stops until the objfiles change.\n\
+Usage: maintenance info dwarf-unwind-cache"),
+	   &maintenanceinfolist);
+
+  gdb::observers::new_objfile.attach (dwarf2_frame_new_objfile,
+				      "dwarf2-frame");
+
 #if GDB_SELF_TEST
   selftests::register_test_foreach_arch ("execute_cfa_program",
 					 selftests::execute_cfa_program_test);
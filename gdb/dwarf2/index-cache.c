@@ -26,6 +26,9 @@
 #include "command.h"
 #include "gdbsupport/scoped_mmap.h"
 #include "gdbsupport/pathstuff.h"
+#include "gdbsupport/filestuff.h"
+#include "gdbsupport/gdb_unlinker.h"
+#include "gdbsupport/scoped_fd.h"
 #include "dwarf2/index-write.h"
 #include "dwarf2/read.h"
 #include "dwarf2/dwz.h"
@@ -179,6 +182,25 @@ index_cache::store (dwarf2_per_bfd *per_bfd,
       index_cache_debug ("couldn't store index cache for objfile %s: %s",
 			 bfd_get_filename (per_bfd->obfd), except.what ());
     }
+
+  try
+    {
+      index_cache_debug ("writing cooked index cache for objfile %s",
+			 bfd_get_filename (per_bfd->obfd));
+
+      /* Also write GDB's own form of the index.  This can be used
+	 directly, without building any tables, but it can only be
+	 read by this same version of GDB.  */
+      write_dwarf_index (per_bfd, m_dir.c_str (),
+			 ctx.build_id_str.c_str (), dwz_build_id_ptr,
+			 dw_index_kind::COOKED_INDEX);
+    }
+  catch (const gdb_exception_error &except)
+    {
+      index_cache_debug ("couldn't store cooked index cache for "
+			 "objfile %s: %s",
+			 bfd_get_filename (per_bfd->obfd), except.what ());
+    }
 }
 
 #if HAVE_SYS_MMAN_H
@@ -199,8 +221,8 @@ struct index_cache_resource_mmap final : public index_cache_resource
 /* See dwarf-index-cache.h.  */
 
 gdb::array_view<const gdb_byte>
-index_cache::lookup_gdb_index (const bfd_build_id *build_id,
-			       std::unique_ptr<index_cache_resource> *resource)
+index_cache::lookup (const bfd_build_id *build_id, const char *suffix,
+		     std::unique_ptr<index_cache_resource> *resource)
 {
   if (!enabled ())
     return {};
@@ -212,8 +234,8 @@ index_cache::lookup_gdb_index (const bfd_build_id *build_id,
       return {};
     }
 
-  /* Compute where we would expect a gdb index file for this build id to be.  */
-  std::string filename = make_index_filename (build_id, INDEX4_SUFFIX);
+  /* Compute where we would expect an index file for this build id to be.  */
+  std::string filename = make_index_filename (build_id, suffix);
 
   try
     {
@@ -245,8 +267,8 @@ index_cache::lookup_gdb_index (const bfd_build_id *build_id,
 /* See dwarf-index-cache.h.  This is a no-op on unsupported systems.  */
 
 gdb::array_view<const gdb_byte>
-index_cache::lookup_gdb_index (const bfd_build_id *build_id,
-			       std::unique_ptr<index_cache_resource> *resource)
+index_cache::lookup (const bfd_build_id *build_id, const char *suffix,
+		     std::unique_ptr<index_cache_resource> *resource)
 {
   return {};
 }
@@ -255,6 +277,86 @@ index_cache::lookup_gdb_index (const bfd_build_id *build_id,
 
 /* See dwarf-index-cache.h.  */
 
+gdb::array_view<const gdb_byte>
+index_cache::lookup_gdb_index (const bfd_build_id *build_id,
+			       std::unique_ptr<index_cache_resource> *resource)
+{
+  return lookup (build_id, INDEX4_SUFFIX, resource);
+}
+
+/* See dwarf-index-cache.h.  */
+
+gdb::array_view<const gdb_byte>
+index_cache::lookup_cooked_index
+  (const bfd_build_id *build_id,
+   std::unique_ptr<index_cache_resource> *resource)
+{
+  return lookup (build_id, COOKED_INDEX_SUFFIX, resource);
+}
+
+/* See dwarf-index-cache.h.  */
+
+gdb::array_view<const gdb_byte>
+index_cache::lookup_demangled_names
+  (const bfd_build_id *build_id,
+   std::unique_ptr<index_cache_resource> *resource)
+{
+  return lookup (build_id, DEMANGLED_NAMES_SUFFIX, resource);
+}
+
+/* See dwarf-index-cache.h.  */
+
+void
+index_cache::store_demangled_names (const bfd_build_id *build_id,
+				    gdb::array_view<const gdb_byte> contents)
+{
+  if (!enabled () || m_dir.empty ())
+    return;
+
+  std::string filename = make_index_filename (build_id,
+					      DEMANGLED_NAMES_SUFFIX);
+
+  try
+    {
+      index_cache_debug ("writing %s", filename.c_str ());
+
+      if (!mkdir_recursive (m_dir.c_str ()))
+	error (_("could not make cache directory: %s"),
+	       safe_strerror (errno));
+
+      /* Write to a temporary file, and move it in place once it is
+	 complete, so that a concurrent GDB never sees a partial
+	 file.  */
+      gdb::char_vector filename_temp = make_temp_filename (filename);
+      scoped_fd out_fd = gdb_mkostemp_cloexec (filename_temp.data (),
+					       O_BINARY);
+      if (out_fd.get () == -1)
+	perror_with_name (("mkstemp"));
+
+      gdb::unlinker unlink_file (filename_temp.data ());
+      gdb_file_up out_file = out_fd.to_file ("wb");
+      if (out_file == nullptr)
+	error (_("Can't open `%s' for writing"), filename_temp.data ());
+
+      if (fwrite (contents.data (), 1, contents.size (), out_file.get ())
+	    != contents.size ()
+	  || fflush (out_file.get ()) != 0)
+	error (_("couldn't write %s"), filename_temp.data ());
+
+      out_file.reset ();
+      unlink_file.keep ();
+      if (rename (filename_temp.data (), filename.c_str ()) != 0)
+	perror_with_name (("rename"));
+    }
+  catch (const gdb_exception_error &except)
+    {
+      index_cache_debug ("couldn't write %s: %s",
+			 filename.c_str (), except.what ());
+    }
+}
+
+/* See dwarf-index-cache.h.  */
+
 std::string
 index_cache::make_index_filename (const bfd_build_id *build_id,
 				  const char *suffix) const
@@ -90,6 +90,25 @@ class index_cache
   lookup_gdb_index (const bfd_build_id *build_id,
 		    std::unique_ptr<index_cache_resource> *resource);
 
+  /* Likewise, but look for a cooked index file, as written by
+     'store'.  See read-cooked-index.h for the format of this file.  */
+  gdb::array_view<const gdb_byte>
+  lookup_cooked_index (const bfd_build_id *build_id,
+		       std::unique_ptr<index_cache_resource> *resource);
+
+  /* Likewise, but look for the demangled names of the minimal symbols
+     of an objfile, as written by store_demangled_names.  See
+     demangled-names-cache.c for the format of this file.  */
+  gdb::array_view<const gdb_byte>
+  lookup_demangled_names (const bfd_build_id *build_id,
+			  std::unique_ptr<index_cache_resource> *resource);
+
+  /* Store CONTENTS in the cache as the demangled names of the minimal
+     symbols of the objfile with build id BUILD_ID.  Errors are only
+     reported as debug messages.  */
+  void store_demangled_names (const bfd_build_id *build_id,
+			      gdb::array_view<const gdb_byte> contents);
+
   /* Return the number of cache hits.  */
   unsigned int n_hits () const
   { return m_n_hits; }
@@ -114,6 +133,12 @@ class index_cache
 
 private:
 
+  /* Look for a file matching BUILD_ID, with suffix SUFFIX.  This
+     implements the lookup methods above.  */
+  gdb::array_view<const gdb_byte>
+  lookup (const bfd_build_id *build_id, const char *suffix,
+	  std::unique_ptr<index_cache_resource> *resource);
+
   /* Compute the absolute filename where the index of the objfile with build
      id BUILD_ID will be stored.  SUFFIX is appended at the end of the
      filename.  */
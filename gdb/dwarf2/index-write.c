@@ -32,6 +32,7 @@
 #include "dwarf2/index-common.h"
 #include "dwarf2.h"
 #include "dwarf2/read.h"
+#include "dwarf2/read-cooked-index.h"
 #include "dwarf2/dwz.h"
 #include "gdb/gdb-index.h"
 #include "gdbcmd.h"
@@ -1424,6 +1425,156 @@ write_debug_names (dwarf2_per_bfd *per_bfd, cooked_index *table,
   assert_file_size (out_file, expected_bytes);
 }
 
+/* Write a cooked index cache file for PER_BFD into OUT_FILE.  The
+   format is described in read-cooked-index.h.  */
+
+static void
+write_cooked_index_file (dwarf2_per_bfd *per_bfd, cooked_index *table,
+			 FILE *out_file, const char *dwz_build_id)
+{
+  /* Type units read from DWO files are only discovered while
+     scanning, so the reader would not be able to find them.  */
+  if (per_bfd->dwo_files != nullptr)
+    error (_("Cannot write a cooked index for an objfile using DWO files"));
+
+  std::vector<cooked_index_file_unit> units (per_bfd->all_units.size ());
+  for (size_t i = 0; i < per_bfd->all_units.size (); ++i)
+    {
+      dwarf2_per_cu_data *per_cu = per_bfd->all_units[i].get ();
+      gdb_assert (per_cu->index == i);
+
+      cooked_index_file_unit &unit = units[i];
+      unit.sect_off = to_underlying (per_cu->sect_off);
+      unit.length = per_cu->length ();
+      unit.lang = per_cu->lang (false);
+      unit.dw_lang = per_cu->dw_lang ();
+      unit.unit_type = per_cu->unit_type (false);
+      unit.flags = ((per_cu->is_dwz ? 1 : 0)
+		    | (per_cu->is_debug_types ? 2 : 0));
+    }
+
+  /* The searchable entries come first, sorted across all the shards
+     so that the reader can use a single shard.  */
+  std::vector<const cooked_index_entry *> entries;
+  for (const cooked_index_entry *entry : table->all_entries ())
+    entries.push_back (entry);
+  const size_t n_entries = entries.size ();
+  std::sort (entries.begin (), entries.end (),
+	     [] (const cooked_index_entry *a, const cooked_index_entry *b)
+	     {
+	       return *a < *b;
+	     });
+
+  std::unordered_map<const cooked_index_entry *, uint32_t> entry_indices;
+  for (size_t i = 0; i < n_entries; ++i)
+    entry_indices[entries[i]] = i;
+
+  /* Some parents, like the synthesized Ada packages, are not
+     searchable; append them after the searchable entries.  ENTRIES
+     grows while iterating, so the parents of the appended entries
+     are handled as well.  */
+  for (size_t i = 0; i < entries.size (); ++i)
+    {
+      const cooked_index_entry *parent = entries[i]->parent_entry;
+      if (parent != nullptr
+	  && entry_indices.emplace (parent, entries.size ()).second)
+	entries.push_back (parent);
+    }
+
+  if (entries.size () >= COOKED_INDEX_FILE_NONE)
+    error (_("Too many entries for a cooked index"));
+
+  /* Names mostly point into .debug_str, where they are already
+     unique, so identical pointers are shared.  */
+  data_buf strings;
+  std::unordered_map<const char *, uint32_t> string_offsets;
+  auto add_string = [&] (const char *str)
+    {
+      auto inserted = string_offsets.emplace (str, strings.size ());
+      if (inserted.second)
+	strings.append_cstr0 (str);
+      return inserted.first->second;
+    };
+
+  uint32_t dwz_name = add_string (dwz_build_id == nullptr
+				  ? "" : dwz_build_id);
+
+  std::vector<cooked_index_file_entry> records (entries.size ());
+  for (size_t i = 0; i < entries.size (); ++i)
+    {
+      const cooked_index_entry *entry = entries[i];
+      cooked_index_file_entry &record = records[i];
+
+      record.die_offset = to_underlying (entry->die_offset ());
+      record.name = add_string (entry->name);
+      record.canonical = add_string (entry->canonical);
+      record.parent = (entry->parent_entry == nullptr
+		       ? COOKED_INDEX_FILE_NONE
+		       : entry_indices.at (entry->parent_entry));
+      record.unit = entry->per_cu->index;
+      record.tag = entry->tag;
+      record.flags = entry->flags;
+    }
+
+  if (strings.size () >= COOKED_INDEX_FILE_NONE)
+    error (_("Too many names for a cooked index"));
+
+  std::vector<uint32_t> addrmap_sizes;
+  std::vector<cooked_index_file_transition> transitions;
+  for (const addrmap *map : table->get_addrmaps ())
+    {
+      size_t before = transitions.size ();
+      map->foreach ([&] (CORE_ADDR start, const void *obj)
+	{
+	  const dwarf2_per_cu_data *per_cu
+	    = static_cast<const dwarf2_per_cu_data *> (obj);
+	  cooked_index_file_transition transition {};
+	  transition.address = start;
+	  transition.unit = (per_cu == nullptr
+			     ? COOKED_INDEX_FILE_NONE
+			     : per_cu->index);
+	  transitions.push_back (transition);
+	  return 0;
+	});
+      addrmap_sizes.push_back (transitions.size () - before);
+    }
+  /* Keep the following section aligned by adding an empty map.  */
+  if ((addrmap_sizes.size () % 2) != 0)
+    addrmap_sizes.push_back (0);
+
+  const cooked_index_entry *main_entry = table->get_main ();
+
+  cooked_index_file_header header {};
+  memcpy (header.magic, COOKED_INDEX_FILE_MAGIC, sizeof (header.magic));
+  header.version = COOKED_INDEX_FILE_VERSION;
+  header.byte_order = 1;
+  header.n_units = units.size ();
+  header.n_entries = n_entries;
+  header.n_records = records.size ();
+  header.main_entry = (main_entry == nullptr
+		       ? COOKED_INDEX_FILE_NONE
+		       : entry_indices.at (main_entry));
+  header.dwz_build_id = dwz_name;
+  header.n_addrmaps = addrmap_sizes.size ();
+  header.n_transitions = transitions.size ();
+  header.strings_size = strings.size ();
+
+  file_write (out_file, &header, sizeof (header));
+  file_write (out_file, units);
+  file_write (out_file, records);
+  file_write (out_file, addrmap_sizes);
+  file_write (out_file, transitions);
+  strings.file_write (out_file);
+
+  assert_file_size (out_file,
+		    (sizeof (header)
+		     + units.size () * sizeof (units[0])
+		     + records.size () * sizeof (records[0])
+		     + addrmap_sizes.size () * sizeof (addrmap_sizes[0])
+		     + transitions.size () * sizeof (transitions[0])
+		     + strings.size ()));
+}
+
 /* This represents an index file being written (work-in-progress).
 
    The data is initially written to a temporary file.  When the finalize method
@@ -1493,15 +1644,23 @@ write_dwarf_index (dwarf2_per_bfd *per_bfd, const char *dir,
     error (_("Cannot make an index when the file has multiple .debug_types sections"));
 
   const char *index_suffix = (index_kind == dw_index_kind::DEBUG_NAMES
-			      ? INDEX5_SUFFIX : INDEX4_SUFFIX);
+			      ? INDEX5_SUFFIX
+			      : index_kind == dw_index_kind::COOKED_INDEX
+			      ? COOKED_INDEX_SUFFIX : INDEX4_SUFFIX);
 
   index_wip_file objfile_index_wip (dir, basename, index_suffix);
   gdb::optional<index_wip_file> dwz_index_wip;
 
-  if (dwz_basename != NULL)
+  /* A cooked index covers the units of the dwz file as well, and
+     only records the name of the dwz file.  */
+  if (dwz_basename != NULL && index_kind != dw_index_kind::COOKED_INDEX)
       dwz_index_wip.emplace (dir, dwz_basename, index_suffix);
 
-  if (index_kind == dw_index_kind::DEBUG_NAMES)
+  if (index_kind == dw_index_kind::COOKED_INDEX)
+    write_cooked_index_file (per_bfd, table,
+			     objfile_index_wip.out_file.get (),
+			     dwz_basename);
+  else if (index_kind == dw_index_kind::DEBUG_NAMES)
     {
       index_wip_file str_wip_file (dir, basename, DEBUG_STR_SUFFIX);
 
@@ -1566,6 +1725,7 @@ save_gdb_index_command (const char *arg, int from_tty)
 	      if (dwz != NULL)
 		dwz_basename = lbasename (dwz->filename ());
 
+	      dwarf2_complete_index (per_objfile);
 	      write_dwarf_index (per_objfile->per_bfd, arg, basename,
 				 dwz_basename, index_kind);
 	    }
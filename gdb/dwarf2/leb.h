@@ -27,6 +27,8 @@
 #ifndef GDB_DWARF2_LEB_H
 #define GDB_DWARF2_LEB_H
 
+#include "count-one-bits.h"
+
 /* Read dwarf information from a buffer.  */
 
 static inline unsigned int
@@ -82,6 +84,113 @@ extern LONGEST read_signed_leb128 (bfd *, const gdb_byte *, unsigned int *);
 
 extern ULONGEST read_unsigned_leb128 (bfd *, const gdb_byte *, unsigned int *);
 
+/* Return the length of the LEB128 number at BUF, or 0 if it is longer
+   than 8 bytes.  8 bytes must be readable at BUF.
+
+   All the bytes are examined at once, as a single 64-bit word: the
+   number ends at the first byte whose high bit is clear.  */
+
+static inline unsigned int
+leb128_word_length (const gdb_byte *buf)
+{
+#ifdef WORDS_BIGENDIAN
+  /* Not worth the byte swapping.  */
+  return 0;
+#else
+  uint64_t word;
+  memcpy (&word, buf, sizeof (word));
+
+  uint64_t ends = ~word & 0x8080808080808080ull;
+  if (ends == 0)
+    return 0;
+  /* The lowest set bit of ENDS is bit 8N+7 for a number of length
+     N+1.  */
+#if defined (__GNUC__)
+  return (__builtin_ctzll (ends) + 1) / 8;
+#else
+  return (count_one_bits_ll ((ends & -ends) - 1) + 1) / 8;
+#endif
+#endif
+}
+
+/* Decode the LEB128 number of LENGTH bytes at BUF, as returned by
+   leb128_word_length, without sign extension.
+
+   The 7-bit groups are gathered in parallel, by merging pairs of
+   adjacent groups into 14-bit groups, then 28-bit groups, and then
+   the whole 56-bit value.  */
+
+static inline ULONGEST
+decode_leb128_word (const gdb_byte *buf, unsigned int length)
+{
+  uint64_t word;
+  memcpy (&word, buf, sizeof (word));
+
+  if (length < 8)
+    word &= ((uint64_t) 1 << (8 * length)) - 1;
+  word &= 0x7f7f7f7f7f7f7f7full;
+  word = ((word & 0x007f007f007f007full)
+	  | ((word & 0x7f007f007f007f00ull) >> 1));
+  word = ((word & 0x00003fff00003fffull)
+	  | ((word & 0x3fff00003fff0000ull) >> 2));
+  word = ((word & 0x000000000fffffffull)
+	  | ((word & 0x0fffffff00000000ull) >> 4));
+  return word;
+}
+
+/* Like read_unsigned_leb128, but BUF_END is the end of the buffer
+   holding the number.  Knowing it allows the common short numbers to
+   be decoded without a loop.  */
+
+static inline ULONGEST
+read_unsigned_leb128 (bfd *abfd, const gdb_byte *buf,
+		      const gdb_byte *buf_end, unsigned int *bytes_read_ptr)
+{
+  /* Most numbers in DWARF are a single byte.  */
+  if (buf < buf_end && (*buf & 0x80) == 0)
+    {
+      *bytes_read_ptr = 1;
+      return *buf;
+    }
+
+  if (buf_end - buf >= 8)
+    {
+      unsigned int length = leb128_word_length (buf);
+      if (length != 0)
+	{
+	  *bytes_read_ptr = length;
+	  return decode_leb128_word (buf, length);
+	}
+    }
+
+  return read_unsigned_leb128 (abfd, buf, bytes_read_ptr);
+}
+
+/* Like read_signed_leb128, but BUF_END is the end of the buffer
+   holding the number.  */
+
+static inline LONGEST
+read_signed_leb128 (bfd *abfd, const gdb_byte *buf,
+		    const gdb_byte *buf_end, unsigned int *bytes_read_ptr)
+{
+  if (buf_end - buf >= 8)
+    {
+      unsigned int length = leb128_word_length (buf);
+      if (length != 0)
+	{
+	  ULONGEST result = decode_leb128_word (buf, length);
+	  unsigned int shift = 7 * length;
+
+	  if ((result & ((ULONGEST) 1 << (shift - 1))) != 0)
+	    result |= -((ULONGEST) 1 << shift);
+	  *bytes_read_ptr = length;
+	  return result;
+	}
+    }
+
+  return read_signed_leb128 (abfd, buf, bytes_read_ptr);
+}
+
 /* Read the initial length from a section.  The (draft) DWARF 3
    specification allows the initial length to take up either 4 bytes
    or 12 bytes.  If the first 4 bytes are 0xffffffff, then the next 8
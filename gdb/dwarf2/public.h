@@ -32,6 +32,10 @@ enum class dw_index_kind
 
   /* DWARF5 .debug_names.  */
   DEBUG_NAMES,
+
+  /* GDB's own serialization of its cooked index.  This is only used
+     by the index cache.  */
+  COOKED_INDEX,
 };
 
 /* Initialize for reading DWARF for OBJFILE, and push the appropriate
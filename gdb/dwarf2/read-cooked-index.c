@@ -0,0 +1,274 @@
+/* Reading code for cooked index cache files
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "dwarf2/read-cooked-index.h"
+
+#include "build-id.h"
+#include "dwarf2/cooked-index.h"
+#include "dwarf2/dwz.h"
+#include "dwarf2/read.h"
+
+/* The sections of the file are arrays of these, and must stay
+   aligned.  */
+static_assert (sizeof (cooked_index_file_header) % 8 == 0, "");
+static_assert (sizeof (cooked_index_file_unit) % 8 == 0, "");
+static_assert (sizeof (cooked_index_file_entry) % 8 == 0, "");
+static_assert (sizeof (cooked_index_file_transition) % 8 == 0, "");
+
+/* A view of the sections of a cooked index cache file.  */
+
+struct cooked_index_file_view
+{
+  const cooked_index_file_header *header = nullptr;
+  gdb::array_view<const cooked_index_file_unit> units;
+  gdb::array_view<const cooked_index_file_entry> entries;
+  gdb::array_view<const uint32_t> addrmap_sizes;
+  gdb::array_view<const cooked_index_file_transition> transitions;
+  const char *strings = nullptr;
+
+  /* Return the string at OFFSET in the string table.  */
+  const char *string (uint32_t offset) const
+  {
+    return strings + offset;
+  }
+};
+
+/* Round SIZE up to the alignment of every section of the file.  */
+
+static size_t
+align_section (size_t size)
+{
+  return (size + 7) & ~(size_t) 7;
+}
+
+/* Split CONTENTS into its sections, storing them in VIEW.  Return
+   false if CONTENTS is not a valid file.  */
+
+static bool
+split_cooked_index_file (gdb::array_view<const gdb_byte> contents,
+			 cooked_index_file_view *view)
+{
+  const gdb_byte *start = contents.data ();
+  size_t size = contents.size ();
+  size_t offset = 0;
+
+  /* Return a pointer to the next section of the file, of N elements
+     of ELT_SIZE bytes, or nullptr if the file is too short.  */
+  auto next_section = [&] (size_t elt_size, size_t n) -> const void *
+    {
+      if (n > (size - offset) / elt_size)
+	return nullptr;
+      const void *result = start + offset;
+      offset = align_section (offset + elt_size * n);
+      if (offset > size)
+	offset = size;
+      return result;
+    };
+
+  /* The mapping is page-aligned; anything else is unexpected.  */
+  if (((uintptr_t) start & 7) != 0)
+    return false;
+
+  view->header = ((const cooked_index_file_header *)
+		  next_section (sizeof (cooked_index_file_header), 1));
+  const cooked_index_file_header *header = view->header;
+  if (header == nullptr
+      || memcmp (header->magic, COOKED_INDEX_FILE_MAGIC,
+		 sizeof (header->magic)) != 0
+      || header->version != COOKED_INDEX_FILE_VERSION
+      || header->byte_order != 1
+      || header->n_entries > header->n_records
+      || (header->main_entry != COOKED_INDEX_FILE_NONE
+	  && header->main_entry >= header->n_entries))
+    return false;
+
+  const void *units = next_section (sizeof (cooked_index_file_unit),
+				    header->n_units);
+  const void *entries = next_section (sizeof (cooked_index_file_entry),
+				      header->n_records);
+  const void *sizes = next_section (sizeof (uint32_t), header->n_addrmaps);
+  const void *transitions
+    = next_section (sizeof (cooked_index_file_transition),
+		    header->n_transitions);
+  if (units == nullptr || entries == nullptr || sizes == nullptr
+      || transitions == nullptr
+      || header->strings_size != size - offset
+      || header->strings_size == 0
+      || start[size - 1] != '\0')
+    return false;
+
+  view->units = gdb::make_array_view
+    ((const cooked_index_file_unit *) units, header->n_units);
+  view->entries = gdb::make_array_view
+    ((const cooked_index_file_entry *) entries, header->n_records);
+  view->addrmap_sizes = gdb::make_array_view
+    ((const uint32_t *) sizes, header->n_addrmaps);
+  view->transitions = gdb::make_array_view
+    ((const cooked_index_file_transition *) transitions,
+     header->n_transitions);
+  view->strings = (const char *) start + offset;
+
+  uint64_t n_transitions = 0;
+  for (uint32_t n : view->addrmap_sizes)
+    n_transitions += n;
+  return n_transitions == header->n_transitions;
+}
+
+/* Return true if the units described by VIEW are the units of
+   PER_BFD.  */
+
+static bool
+units_match (const cooked_index_file_view &view, dwarf2_per_bfd *per_bfd)
+{
+  if (view.units.size () != per_bfd->all_units.size ()
+      || view.header->dwz_build_id >= view.header->strings_size)
+    return false;
+
+  /* The units of the dwz file are described in this file too, so it
+     must be the same dwz file.  */
+  std::string dwz_build_id;
+  const dwz_file *dwz = dwarf2_get_dwz_file (per_bfd);
+  if (dwz != nullptr)
+    {
+      const bfd_build_id *build_id = build_id_bfd_get (dwz->dwz_bfd.get ());
+      if (build_id == nullptr)
+	return false;
+      dwz_build_id = build_id_to_string (build_id);
+    }
+  if (dwz_build_id != view.string (view.header->dwz_build_id))
+    return false;
+
+  for (size_t i = 0; i < view.units.size (); ++i)
+    {
+      const cooked_index_file_unit &unit = view.units[i];
+      dwarf2_per_cu_data *per_cu = per_bfd->all_units[i].get ();
+
+      if (unit.sect_off != (uint64_t) to_underlying (per_cu->sect_off)
+	  || unit.length != per_cu->length ()
+	  || ((unit.flags & 1) != 0) != per_cu->is_dwz
+	  || ((unit.flags & 2) != 0) != per_cu->is_debug_types
+	  || unit.lang >= nr_languages)
+	return false;
+
+      dwarf_unit_type unit_type = per_cu->unit_type (false);
+      if (unit_type != 0 && unit.unit_type != 0
+	  && unit_type != unit.unit_type)
+	return false;
+    }
+
+  return true;
+}
+
+/* See read-cooked-index.h.  */
+
+cooked_index *
+read_cooked_index_cache (dwarf2_per_objfile *per_objfile,
+			 gdb::array_view<const gdb_byte> contents)
+{
+  dwarf2_per_bfd *per_bfd = per_objfile->per_bfd;
+
+  cooked_index_file_view view;
+  if (!split_cooked_index_file (contents, &view)
+      || !units_match (view, per_bfd))
+    return nullptr;
+
+  /* Check all the references before changing anything, so that a
+     corrupt file can simply be ignored.  */
+  uint64_t strings_size = view.header->strings_size;
+  for (const cooked_index_file_entry &entry : view.entries)
+    if (entry.name >= strings_size
+	|| entry.canonical >= strings_size
+	|| entry.unit >= view.units.size ()
+	|| (entry.parent != COOKED_INDEX_FILE_NONE
+	    && entry.parent >= view.entries.size ()))
+      return nullptr;
+  for (const cooked_index_file_transition &transition : view.transitions)
+    if (transition.unit != COOKED_INDEX_FILE_NONE
+	&& transition.unit >= view.units.size ())
+      return nullptr;
+
+  /* Restore the unit information that the scanner would have
+     computed.  */
+  for (size_t i = 0; i < view.units.size (); ++i)
+    {
+      const cooked_index_file_unit &unit = view.units[i];
+      dwarf2_per_cu_data *per_cu = per_bfd->all_units[i].get ();
+
+      if (unit.unit_type != 0)
+	{
+	  per_cu->set_unit_type ((dwarf_unit_type) unit.unit_type);
+	  if (unit.lang != language_unknown)
+	    per_cu->set_lang ((enum language) unit.lang,
+			      (dwarf_source_language) unit.dw_lang);
+	}
+    }
+
+  std::unique_ptr<cooked_index_shard> shard (new cooked_index_shard);
+  shard->reserve (view.header->n_entries);
+
+  /* The names point directly into the mapped file.  Only the entry
+     objects themselves are created, in a single pass.  */
+  std::vector<cooked_index_entry *> entries (view.entries.size ());
+  for (size_t i = 0; i < view.entries.size (); ++i)
+    {
+      const cooked_index_file_entry &entry = view.entries[i];
+      entries[i]
+	= shard->add_from_cache ((sect_offset) entry.die_offset,
+				 (enum dwarf_tag) entry.tag,
+				 (cooked_index_flag_enum) entry.flags,
+				 view.string (entry.name),
+				 view.string (entry.canonical),
+				 per_bfd->all_units[entry.unit].get (),
+				 i < view.header->n_entries);
+    }
+
+  for (size_t i = 0; i < view.entries.size (); ++i)
+    if (view.entries[i].parent != COOKED_INDEX_FILE_NONE)
+      entries[i]->parent_entry = entries[view.entries[i].parent];
+
+  if (view.header->main_entry != COOKED_INDEX_FILE_NONE)
+    shard->set_main (entries[view.header->main_entry]);
+
+  /* Rebuild the address map.  The maps are stored in the order they
+     were searched, so only empty parts of the map are set.  */
+  addrmap_mutable addrmap;
+  size_t next = 0;
+  for (uint32_t n : view.addrmap_sizes)
+    {
+      for (uint32_t i = 0; i < n; ++i, ++next)
+	{
+	  const cooked_index_file_transition &transition
+	    = view.transitions[next];
+	  if (transition.unit == COOKED_INDEX_FILE_NONE)
+	    continue;
+
+	  CORE_ADDR end = (CORE_ADDR) -1;
+	  if (i + 1 < n)
+	    end = view.transitions[next + 1].address - 1;
+	  addrmap.set_empty (transition.address, end,
+			     per_bfd->all_units[transition.unit].get ());
+	}
+    }
+  shard->install_addrmap (&addrmap);
+
+  cooked_index::vec_type vec;
+  vec.push_back (std::move (shard));
+  return new cooked_index (std::move (vec));
+}
@@ -0,0 +1,130 @@
+/* Reading code for cooked index cache files
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef DWARF2_READ_COOKED_INDEX_H
+#define DWARF2_READ_COOKED_INDEX_H
+
+#include "gdbsupport/array-view.h"
+
+struct dwarf2_per_objfile;
+class cooked_index;
+
+/* The layout of a cooked index cache file.  These files are only
+   ever read by the GDB that wrote them, so everything is stored in
+   host byte order, and the file can be used directly after mapping
+   it into memory.  The file consists of:
+
+   - A header, cooked_index_file_header.
+   - One cooked_index_file_unit for each unit of the objfile (and of
+     its dwz file), in the order of dwarf2_per_bfd::all_units.  This
+     is used to check that the cache still matches the objfile.
+   - The entries, as cooked_index_file_entry.  The first N_ENTRIES
+     of these are sorted by canonical name, and are the entries that
+     can be found by searching.  The remaining ones are only
+     referenced as parents.
+   - For each address map, the number of transitions in it, as a
+     uint32_t; padded to a multiple of 8 bytes.
+   - The transitions of all the address maps, in order, as
+     cooked_index_file_transition.
+   - The string table.  Names are stored as offsets into this
+     table.  It is never empty.
+
+   All the sections are aligned to 8 bytes.  */
+
+/* The magic string at the start of the file.  */
+#define COOKED_INDEX_FILE_MAGIC "GDBCOOK"
+
+/* The current version of the file format.  This must be bumped
+   whenever the layout below or the meaning of any of the stored
+   values changes.  */
+#define COOKED_INDEX_FILE_VERSION 1
+
+/* Used to mark the absence of a unit or entry.  */
+#define COOKED_INDEX_FILE_NONE ((uint32_t) -1)
+
+struct cooked_index_file_header
+{
+  char magic[8];
+  uint32_t version;
+  /* Set to 1, to detect a file written with the wrong byte
+     order.  */
+  uint32_t byte_order;
+  uint32_t n_units;
+  /* The number of searchable entries.  */
+  uint32_t n_entries;
+  /* The total number of entries.  */
+  uint32_t n_records;
+  /* The index of the "main" entry, or COOKED_INDEX_FILE_NONE.  */
+  uint32_t main_entry;
+  uint32_t n_addrmaps;
+  uint32_t n_transitions;
+  /* The build id of the dwz file, as an offset into the string
+     table.  This is the empty string if there is no dwz file.  */
+  uint32_t dwz_build_id;
+  uint32_t padding;
+  uint64_t strings_size;
+};
+
+struct cooked_index_file_unit
+{
+  uint64_t sect_off;
+  uint32_t length;
+  /* The language, as an enum language.  */
+  uint32_t lang;
+  /* The language, as a DW_LANG_* value.  */
+  uint16_t dw_lang;
+  /* The DW_UT_* unit type, or 0 if not yet known.  */
+  uint8_t unit_type;
+  /* Bit 0 is set for a unit in the dwz file, and bit 1 for a type
+     unit.  */
+  uint8_t flags;
+  uint32_t padding;
+};
+
+struct cooked_index_file_entry
+{
+  uint64_t die_offset;
+  uint32_t name;
+  uint32_t canonical;
+  uint32_t parent;
+  uint32_t unit;
+  uint16_t tag;
+  uint8_t flags;
+  uint8_t padding[5];
+};
+
+struct cooked_index_file_transition
+{
+  uint64_t address;
+  uint32_t unit;
+  uint32_t padding;
+};
+
+/* Create a cooked index for PER_OBJFILE from CONTENTS, the contents
+   of a cooked index cache file.  The units of the objfile must
+   already have been created.  Return nullptr if CONTENTS is invalid
+   or does not match the objfile.
+
+   The entries of the new index refer to CONTENTS, which must remain
+   valid as long as the index is in use.  */
+
+extern cooked_index *read_cooked_index_cache
+  (dwarf2_per_objfile *per_objfile, gdb::array_view<const gdb_byte> contents);
+
+#endif /* DWARF2_READ_COOKED_INDEX_H */
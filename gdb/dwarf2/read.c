@@ -41,6 +41,7 @@
 #include "dwarf2/dwz.h"
 #include "dwarf2/macro.h"
 #include "dwarf2/die.h"
+#include "dwarf2/read-cooked-index.h"
 #include "dwarf2/read-debug-names.h"
 #include "dwarf2/read-gdb-index.h"
 #include "dwarf2/sect-names.h"
@@ -74,6 +75,7 @@
 #include "gdb_bfd.h"
 #include "f-lang.h"
 #include "source.h"
+#include "minsyms.h"
 #include "build-id.h"
 #include "namespace.h"
 #include "gdbsupport/function-view.h"
@@ -122,6 +124,14 @@ unsigned int dwarf_line_debug = 0;
 /* When true, cross-check physname against demangler.  */
 static bool check_physname = false;
 
+/* When true, the units are only indexed when a lookup needs them,
+   and .debug_aranges is used for address lookups until then.  */
+static bool dwarf_lazy_indexing = false;
+
+/* When true, the DIEs of the units are read on the thread pool
+   when many units are expanded at once.  */
+static bool dwarf_parallel_expansion = true;
+
 /* This is used to store the data that is always per objfile.  */
 static const registry<objfile>::key<dwarf2_per_objfile>
      dwarf2_objfile_data_key;
@@ -603,6 +613,15 @@ class cutu_reader : public die_reader_specs
      for dummy CUs.  */
   void keep ();
 
+  /* Release the new CU, transferring ownership to the caller instead
+     of putting it on the chain.  This cannot be done for dummy
+     CUs.  */
+  std::unique_ptr<dwarf2_cu> release_cu ()
+  {
+    gdb_assert (!dummy_p);
+    return std::move (m_new_cu);
+  }
+
   /* Release the abbrev table, transferring ownership to the
      caller.  */
   abbrev_table_up release_abbrev_table ()
@@ -1058,6 +1077,9 @@ static void load_full_comp_unit (dwarf2_per_cu_data *per_cu,
 				 bool skip_partial,
 				 enum language pretend_language);
 
+static void read_comp_unit_dies (cutu_reader *reader,
+				 enum language pretend_language);
+
 static void process_full_comp_unit (dwarf2_cu *cu,
 				    enum language pretend_language);
 
@@ -1722,13 +1744,21 @@ static dwarf2_cu *
 load_cu (dwarf2_per_cu_data *per_cu, dwarf2_per_objfile *per_objfile,
 	 bool skip_partial)
 {
-  if (per_cu->is_debug_types)
-    load_full_type_unit (per_cu, per_objfile);
-  else
-    load_full_comp_unit (per_cu, per_objfile, per_objfile->get_cu (per_cu),
-			 skip_partial, language_minimal);
-
   dwarf2_cu *cu = per_objfile->get_cu (per_cu);
+
+  /* The DIEs may already have been read by
+     dw2_instantiate_symtabs.  */
+  if (cu == nullptr || cu->dies == nullptr)
+    {
+      if (per_cu->is_debug_types)
+	load_full_type_unit (per_cu, per_objfile);
+      else
+	load_full_comp_unit (per_cu, per_objfile, cu, skip_partial,
+			     language_minimal);
+
+      cu = per_objfile->get_cu (per_cu);
+    }
+
   if (cu == nullptr)
     return nullptr;  /* Dummy CU.  */
 
@@ -1796,6 +1826,148 @@ dw2_instantiate_symtab (dwarf2_per_cu_data *per_cu,
   return per_objfile->get_symtab (per_cu);
 }
 
+/* Read the DIEs of UNITS on the thread pool.  Return the new CUs, in
+   the same order as UNITS; an element is null if the unit is a type
+   unit, is a dummy unit, or could not be read.  Errors are not
+   reported here: the unit is simply read again when it is expanded,
+   which reports the error in the usual way.  */
+
+static std::vector<std::unique_ptr<dwarf2_cu>>
+read_comp_units_in_parallel (gdb::array_view<dwarf2_per_cu_data *> units,
+			     dwarf2_per_objfile *per_objfile,
+			     bool skip_partial)
+{
+  std::vector<std::unique_ptr<dwarf2_cu>> result (units.size ());
+
+  /* The sections have to be read before the workers can use
+     them.  */
+  per_objfile->per_bfd->map_info_sections (per_objfile->objfile);
+
+  /* Ensure that complaints are handled correctly.  */
+  complaint_interceptor complaint_handler;
+
+  auto task_size_ = [&] (size_t i)
+    {
+      return (size_t) units[i]->length ();
+    };
+  auto task_size = gdb::make_function_view (task_size_);
+
+  /* Each CU is read into its own obstack, so the workers only ever
+     touch their own CUs.  */
+  gdb::parallel_for_each_guided (1, (size_t) 0, units.size (),
+				 [&] (size_t iter, size_t end)
+    {
+      abbrev_cache cache;
+      for (; iter != end; ++iter)
+	{
+	  dwarf2_per_cu_data *per_cu = units[iter];
+	  if (per_cu->is_debug_types)
+	    continue;
+
+	  try
+	    {
+	      cutu_reader reader (per_cu, per_objfile, nullptr, nullptr,
+				  skip_partial, &cache);
+	      if (reader.dummy_p)
+		continue;
+
+	      read_comp_unit_dies (&reader, language_minimal);
+	      result[iter] = reader.release_cu ();
+	      cache.add (reader.release_abbrev_table ());
+	    }
+	  catch (const gdb_exception_error &except)
+	    {
+	    }
+	}
+    }, task_size);
+
+  return result;
+}
+
+/* The amount of .debug_info that dw2_instantiate_symtabs reads in
+   one batch.  This bounds the memory used by DIEs that are waiting
+   to be turned into symbols.  */
+
+static const size_t parallel_expansion_batch_size = 16 * 1024 * 1024;
+
+/* Ensure that the symbols for all of UNITS have been read in, in
+   order.  If EXPANSION_NOTIFY is not empty, call it for each symtab
+   that is newly expanded, and stop and return false if it returns
+   false; otherwise return true.
+
+   Building symbols and types changes the objfile, so it is always
+   done on the main thread.  When parallel expansion is enabled and
+   every unit will be expanded, the DIEs of the units are first read
+   on the thread pool, in batches; each CU is then handed to the
+   serial expansion as if it had just been loaded.  */
+
+static bool
+dw2_instantiate_symtabs
+  (gdb::array_view<dwarf2_per_cu_data *> units,
+   dwarf2_per_objfile *per_objfile,
+   bool skip_partial,
+   gdb::function_view<expand_symtabs_exp_notify_ftype> expansion_notify)
+{
+  /* A notification function may stop the expansion early, in which
+     case reading the DIEs of the remaining units is wasted.  */
+  bool parallel = (dwarf_parallel_expansion
+		   && expansion_notify == nullptr
+		   && units.size () > 1
+		   && gdb::thread_pool::g_thread_pool->thread_count () > 0);
+
+  size_t i = 0;
+  while (i < units.size ())
+    {
+      /* Find the next batch of units that still need expanding.  */
+      std::vector<dwarf2_per_cu_data *> batch;
+      size_t batch_size = 0;
+      for (; i < units.size (); ++i)
+	{
+	  dwarf2_per_cu_data *per_cu = units[i];
+	  if (per_objfile->symtab_set_p (per_cu))
+	    continue;
+
+	  batch.push_back (per_cu);
+	  batch_size += per_cu->length ();
+	  if (!parallel || batch_size >= parallel_expansion_batch_size)
+	    {
+	      ++i;
+	      break;
+	    }
+	}
+
+      std::vector<std::unique_ptr<dwarf2_cu>> cus;
+      if (parallel && batch.size () > 1)
+	cus = read_comp_units_in_parallel (batch, per_objfile, skip_partial);
+
+      for (size_t j = 0; j < batch.size (); ++j)
+	{
+	  QUIT;
+
+	  dwarf2_per_cu_data *per_cu = batch[j];
+
+	  /* The unit may have been expanded as a dependency of an
+	     earlier one.  */
+	  if (per_objfile->symtab_set_p (per_cu))
+	    continue;
+
+	  if (j < cus.size () && cus[j] != nullptr
+	      && per_objfile->get_cu (per_cu) == nullptr)
+	    per_objfile->set_cu (per_cu, std::move (cus[j]));
+
+	  compunit_symtab *symtab
+	    = dw2_instantiate_symtab (per_cu, per_objfile, skip_partial);
+
+	  if (expansion_notify != nullptr
+	      && symtab != nullptr
+	      && !expansion_notify (symtab))
+	    return false;
+	}
+    }
+
+  return true;
+}
+
 /* See read.h.  */
 
 dwarf2_per_cu_data_up
@@ -2231,19 +2403,17 @@ void
 dwarf2_base_index_functions::expand_all_symtabs (struct objfile *objfile)
 {
   dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
-  int total_units = per_objfile->per_bfd->all_units.size ();
 
-  for (int i = 0; i < total_units; ++i)
-    {
-      dwarf2_per_cu_data *per_cu = per_objfile->per_bfd->get_cu (i);
+  std::vector<dwarf2_per_cu_data *> units;
+  for (dwarf2_per_cu_data *per_cu : all_units_range (per_objfile->per_bfd))
+    units.push_back (per_cu);
 
-      /* We don't want to directly expand a partial CU, because if we
-	 read it with the wrong language, then assertion failures can
-	 be triggered later on.  See PR symtab/23010.  So, tell
-	 dw2_instantiate_symtab to skip partial CUs -- any important
-	 partial CU will be read via DW_TAG_imported_unit anyway.  */
-      dw2_instantiate_symtab (per_cu, per_objfile, true);
-    }
+  /* We don't want to directly expand a partial CU, because if we
+     read it with the wrong language, then assertion failures can
+     be triggered later on.  See PR symtab/23010.  So, tell
+     dw2_instantiate_symtabs to skip partial CUs -- any important
+     partial CU will be read via DW_TAG_imported_unit anyway.  */
+  dw2_instantiate_symtabs (units, per_objfile, true, nullptr);
 }
 
 
@@ -3177,9 +3347,10 @@ recursively_find_pc_sect_compunit_symtab (struct compunit_symtab *cust,
 }
 
 dwarf2_per_cu_data *
-dwarf2_base_index_functions::find_per_cu (dwarf2_per_bfd *per_bfd,
+dwarf2_base_index_functions::find_per_cu (dwarf2_per_objfile *per_objfile,
 					  CORE_ADDR adjusted_pc)
 {
+  dwarf2_per_bfd *per_bfd = per_objfile->per_bfd;
   if (per_bfd->index_addrmap == nullptr)
     return nullptr;
 
@@ -3200,7 +3371,7 @@ dwarf2_base_index_functions::find_pc_sect_compunit_symtab
   dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
 
   CORE_ADDR baseaddr = objfile->text_section_offset ();
-  struct dwarf2_per_cu_data *data = find_per_cu (per_objfile->per_bfd,
+  struct dwarf2_per_cu_data *data = find_per_cu (per_objfile,
 						 pc - baseaddr);
   if (data == nullptr)
     return nullptr;
@@ -3429,6 +3600,24 @@ dwarf2_initialize_objfile (struct objfile *objfile)
       return;
     }
 
+  /* ... otherwise, try to find GDB's own index in the index cache.
+     It is only checked against the objfile when the DWARF would
+     otherwise be scanned.  */
+  const bfd_build_id *build_id = build_id_bfd_get (objfile->obfd.get ());
+  if (build_id != nullptr)
+    {
+      per_bfd->cooked_index_contents
+	= global_index_cache.lookup_cooked_index (build_id,
+						  &per_bfd->index_cache_res);
+      if (!per_bfd->cooked_index_contents.empty ())
+	{
+	  dwarf_read_debug_printf ("found cooked index from cache");
+	  global_index_cache.hit ();
+	  objfile->qf.push_front (make_cooked_index_funcs ());
+	  return;
+	}
+    }
+
   /* ... otherwise, try to find the index in the index cache.  */
   if (dwarf2_read_gdb_index (per_objfile,
 			     get_gdb_index_contents_from_cache,
@@ -5084,6 +5273,31 @@ process_skeletonless_type_units (dwarf2_per_objfile *per_objfile,
     }
 }
 
+/* Set the name of the program's "main" for OBJFILE, if INDEX knows
+   it.  */
+
+static void
+set_main_name_from_index (struct objfile *objfile, cooked_index *index)
+{
+  const cooked_index_entry *main_entry = index->get_main ();
+  if (main_entry != nullptr)
+    {
+      /* We only do this for names not requiring canonicalization.  At
+	 this point in the process names have not been canonicalized.
+	 However, currently, languages that require this step also do
+	 not use DW_AT_main_subprogram.  An assert is appropriate here
+	 because this filtering is done in get_main.  */
+      enum language lang = main_entry->per_cu->lang ();
+      gdb_assert (!language_requires_canonicalization (lang));
+      dwarf2_per_bfd *per_bfd = main_entry->per_cu->per_bfd;
+      const char *full_name = main_entry->full_name (&per_bfd->obstack, true);
+      set_objfile_main_name (objfile, full_name, lang);
+    }
+}
+
+static cooked_index::vec_type index_all_units
+  (dwarf2_per_objfile *per_objfile);
+
 /* Build the partial symbol table by doing a quick pass through the
    .debug_info and .debug_abbrev sections.  */
 
@@ -5098,13 +5312,81 @@ dwarf2_build_psymtabs_hard (dwarf2_per_objfile *per_objfile)
 
   per_bfd->map_info_sections (objfile);
 
-  cooked_index_storage index_storage;
   create_all_units (per_objfile);
-  build_type_psymtabs (per_objfile, &index_storage);
-  std::vector<std::unique_ptr<cooked_index_shard>> indexes;
 
   per_bfd->quick_file_names_table
     = create_quick_file_names_table (per_bfd->all_units.size ());
+
+  if (!per_bfd->cooked_index_contents.empty ())
+    {
+      cooked_index *vec
+	= read_cooked_index_cache (per_objfile,
+				   per_bfd->cooked_index_contents);
+      per_bfd->cooked_index_contents = {};
+      if (vec != nullptr)
+	{
+	  dwarf_read_debug_printf ("Using cooked index cache for %s",
+				   objfile_name (objfile));
+	  per_bfd->index_table.reset (vec);
+	  set_main_name_from_index (objfile, vec);
+	  return;
+	}
+
+      /* The file may have been written for some other version of the
+	 objfile.  Build the index normally, which will also replace
+	 the file.  */
+      dwarf_read_debug_printf ("Cooked index cache for %s is unusable",
+			       objfile_name (objfile));
+      per_bfd->index_cache_res.reset ();
+    }
+
+  if (dwarf_lazy_indexing && !per_bfd->debug_aranges.empty ())
+    {
+      /* Only read the address map for now; the units are indexed
+	 when some lookup needs them.  See get_cooked_index.  */
+      addrmap_mutable addrmap;
+      if (read_addrmap_from_aranges (per_objfile, &per_bfd->debug_aranges,
+				     &addrmap))
+	{
+	  std::unique_ptr<cooked_index_shard> shard (new cooked_index_shard);
+	  shard->install_addrmap (&addrmap);
+
+	  cooked_index::vec_type indexes;
+	  indexes.push_back (std::move (shard));
+	  per_bfd->index_table.reset (new cooked_index (std::move (indexes),
+							true));
+
+	  dwarf_read_debug_printf ("Deferred indexing of %s",
+				   objfile_name (objfile));
+	  return;
+	}
+    }
+
+  cooked_index *vec = new cooked_index (index_all_units (per_objfile));
+  per_bfd->index_table.reset (vec);
+
+  /* Cannot start writing the index entry until after the
+     'index_table' member has been set.  */
+  vec->start_writing_index (per_bfd);
+
+  set_main_name_from_index (objfile, vec);
+
+  dwarf_read_debug_printf ("Done building psymtabs of %s",
+			   objfile_name (objfile));
+}
+
+/* Scan all the units of PER_OBJFILE, and return the resulting index
+   shards.  */
+
+static cooked_index::vec_type
+index_all_units (dwarf2_per_objfile *per_objfile)
+{
+  dwarf2_per_bfd *per_bfd = per_objfile->per_bfd;
+
+  cooked_index_storage index_storage;
+  build_type_psymtabs (per_objfile, &index_storage);
+  std::vector<std::unique_ptr<cooked_index_shard>> indexes;
+
   if (!per_bfd->debug_aranges.empty ())
     read_addrmap_from_aranges (per_objfile, &per_bfd->debug_aranges,
 			       index_storage.get_addrmap ());
@@ -5122,17 +5404,20 @@ dwarf2_build_psymtabs_hard (dwarf2_per_objfile *per_objfile)
       };
     auto task_size = gdb::make_function_view (task_size_);
 
-    /* Each thread returns a pair holding a cooked index, and a vector
-       of errors that should be printed.  The latter is done because
-       GDB's I/O system is not thread-safe.  run_on_main_thread could be
-       used, but that would mean the messages are printed after the
-       prompt, which looks weird.  */
+    /* Each chunk of work returns a pair holding a cooked index, and a
+       vector of errors that should be printed.  The latter is done
+       because GDB's I/O system is not thread-safe.  run_on_main_thread
+       could be used, but that would mean the messages are printed
+       after the prompt, which looks weird.
+
+       Guided scheduling is used so that a single huge CU does not
+       keep the other threads waiting.  */
     using result_type = std::pair<std::unique_ptr<cooked_index_shard>,
 				  std::vector<gdb_exception>>;
     std::vector<result_type> results
-      = gdb::parallel_for_each (1, per_bfd->all_units.begin (),
-				per_bfd->all_units.end (),
-				[=] (iter_type iter, iter_type end)
+      = gdb::parallel_for_each_guided (1, per_bfd->all_units.begin (),
+				       per_bfd->all_units.end (),
+				       [=] (iter_type iter, iter_type end)
       {
 	std::vector<gdb_exception> errors;
 	cooked_index_storage thread_storage;
@@ -5172,29 +5457,98 @@ dwarf2_build_psymtabs_hard (dwarf2_per_objfile *per_objfile)
   indexes.push_back (index_storage.release ());
   indexes.shrink_to_fit ();
 
-  cooked_index *vec = new cooked_index (std::move (indexes));
-  per_bfd->index_table.reset (vec);
+  return indexes;
+}
 
-  /* Cannot start writing the index entry until after the
-     'index_table' member has been set.  */
-  vec->start_writing_index (per_bfd);
+/* Return the cooked index of PER_OBJFILE.  If COMPLETE is true and
+   the units have not been indexed yet, because lazy indexing is in
+   use, index them all now.  */
 
-  const cooked_index_entry *main_entry = vec->get_main ();
-  if (main_entry != nullptr)
+static cooked_index *
+get_cooked_index (dwarf2_per_objfile *per_objfile, bool complete = true)
+{
+  dwarf2_per_bfd *per_bfd = per_objfile->per_bfd;
+  cooked_index *table
+    = (gdb::checked_static_cast<cooked_index *>
+       (per_bfd->index_table.get ()));
+
+  if (complete && table != nullptr && table->addresses_only ())
     {
-      /* We only do this for names not requiring canonicalization.  At
-	 this point in the process names have not been canonicalized.
-	 However, currently, languages that require this step also do
-	 not use DW_AT_main_subprogram.  An assert is appropriate here
-	 because this filtering is done in get_main.  */
-      enum language lang = main_entry->per_cu->lang ();
-      gdb_assert (!language_requires_canonicalization (lang));
-      const char *full_name = main_entry->full_name (&per_bfd->obstack, true);
-      set_objfile_main_name (objfile, full_name, lang);
+      struct objfile *objfile = per_objfile->objfile;
+
+      dwarf_read_debug_printf ("Indexing all units of %s",
+			       objfile_name (objfile));
+
+      table->complete (index_all_units (per_objfile));
+      table->start_writing_index (per_bfd);
+      set_main_name_from_index (objfile, table);
+
+      dwarf_read_debug_printf ("Done indexing all units of %s",
+			       objfile_name (objfile));
     }
 
-  dwarf_read_debug_printf ("Done building psymtabs of %s",
-			   objfile_name (objfile));
+  return table;
+}
+
+/* See read.h.  */
+
+void
+dwarf2_complete_index (dwarf2_per_objfile *per_objfile)
+{
+  /* Other kinds of index are always complete.  */
+  if (dynamic_cast<cooked_index *> (per_objfile->per_bfd->index_table.get ())
+      != nullptr)
+    get_cooked_index (per_objfile);
+}
+
+/* Return true if .debug_aranges described the addresses of all the
+   compilation units of PER_BFD, so that an address that is not found
+   in it does not belong to any unit.  */
+
+static bool
+all_units_have_addresses (dwarf2_per_bfd *per_bfd)
+{
+  for (const auto &per_cu : per_bfd->all_units)
+    if (!per_cu->is_debug_types && !per_cu->is_dwz && !per_cu->addresses_seen)
+      return false;
+  return true;
+}
+
+/* Return the language of "main" in the objfile of PER_OBJFILE, whose
+   index TABLE only holds addresses so far.  Only the unit holding the
+   minimal symbol for "main" is read.  Set *SYMBOL_FOUND_P if the
+   language is known.  */
+
+static enum language
+lazy_main_language (dwarf2_per_objfile *per_objfile, cooked_index *table,
+		    bool *symbol_found_p)
+{
+  bound_minimal_symbol msym
+    = lookup_minimal_symbol ("main", nullptr, per_objfile->objfile);
+  if (msym.minsym == nullptr)
+    return language_unknown;
+
+  dwarf2_per_cu_data *per_cu
+    = table->lookup ((CORE_ADDR) msym.minsym->unrelocated_address ());
+  if (per_cu == nullptr)
+    return language_unknown;
+
+  /* Reading the unit DIE is enough to find the language.  */
+  if (per_cu->lang (false) == language_unknown)
+    {
+      cutu_reader reader (per_cu, per_objfile, nullptr, nullptr, false);
+      if (reader.dummy_p || reader.comp_unit_die == nullptr)
+	return language_unknown;
+      prepare_one_comp_unit (reader.cu, reader.comp_unit_die,
+			     language_minimal);
+    }
+
+  enum language lang = per_cu->lang (false);
+  if (!(lang == language_c || lang == language_cplus))
+    return language_unknown;
+
+  *symbol_found_p = true;
+  return lang;
 }
 
 static void
@@ -5351,7 +5705,7 @@ peek_die_abbrev (const die_reader_specs &reader,
   dwarf2_cu *cu = reader.cu;
   bfd *abfd = reader.abfd;
   unsigned int abbrev_number
-    = read_unsigned_leb128 (abfd, info_ptr, bytes_read);
+    = read_unsigned_leb128 (abfd, info_ptr, reader.buffer_end, bytes_read);
 
   if (abbrev_number == 0)
     return NULL;
@@ -5389,6 +5743,133 @@ skip_children (const struct die_reader_specs *reader, const gdb_byte *info_ptr)
     }
 }
 
+/* Return a pointer just after the LEB128 number at BUF, which must
+   end before BUF_END.  */
+
+static inline const gdb_byte *
+skip_attribute_leb128 (const gdb_byte *buf, const gdb_byte *buf_end)
+{
+  if (buf_end - buf >= 8)
+    {
+      unsigned int length = leb128_word_length (buf);
+      if (length != 0)
+	return buf + length;
+    }
+
+  return safe_skip_leb128 (buf, buf_end);
+}
+
+/* Skip an attribute of form FORM at INFO_PTR, in the unit being read
+   by READER, and return a pointer just after it.  */
+
+static const gdb_byte *
+skip_one_attribute (const struct die_reader_specs *reader, unsigned int form,
+		    const gdb_byte *info_ptr)
+{
+  unsigned int bytes_read;
+  bfd *abfd = reader->abfd;
+  struct dwarf2_cu *cu = reader->cu;
+  const gdb_byte *buffer_end = reader->buffer_end;
+
+ skip_attribute:
+  switch (form)
+    {
+    case DW_FORM_ref_addr:
+      /* In DWARF 2, DW_FORM_ref_addr is address sized; in DWARF 3
+	 and later it is offset sized.  */
+      if (cu->header.version == 2)
+	info_ptr += cu->header.addr_size;
+      else
+	info_ptr += cu->header.offset_size;
+      break;
+    case DW_FORM_GNU_ref_alt:
+      info_ptr += cu->header.offset_size;
+      break;
+    case DW_FORM_addr:
+      info_ptr += cu->header.addr_size;
+      break;
+    case DW_FORM_data1:
+    case DW_FORM_ref1:
+    case DW_FORM_flag:
+    case DW_FORM_strx1:
+      info_ptr += 1;
+      break;
+    case DW_FORM_flag_present:
+    case DW_FORM_implicit_const:
+      break;
+    case DW_FORM_data2:
+    case DW_FORM_ref2:
+    case DW_FORM_strx2:
+      info_ptr += 2;
+      break;
+    case DW_FORM_strx3:
+      info_ptr += 3;
+      break;
+    case DW_FORM_data4:
+    case DW_FORM_ref4:
+    case DW_FORM_strx4:
+      info_ptr += 4;
+      break;
+    case DW_FORM_data8:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_sig8:
+      info_ptr += 8;
+      break;
+    case DW_FORM_data16:
+      info_ptr += 16;
+      break;
+    case DW_FORM_string:
+      read_direct_string (abfd, info_ptr, &bytes_read);
+      info_ptr += bytes_read;
+      break;
+    case DW_FORM_sec_offset:
+    case DW_FORM_strp:
+    case DW_FORM_GNU_strp_alt:
+      info_ptr += cu->header.offset_size;
+      break;
+    case DW_FORM_exprloc:
+    case DW_FORM_block:
+      info_ptr += read_unsigned_leb128 (abfd, info_ptr, buffer_end,
+					&bytes_read);
+      info_ptr += bytes_read;
+      break;
+    case DW_FORM_block1:
+      info_ptr += 1 + read_1_byte (abfd, info_ptr);
+      break;
+    case DW_FORM_block2:
+      info_ptr += 2 + read_2_bytes (abfd, info_ptr);
+      break;
+    case DW_FORM_block4:
+      info_ptr += 4 + read_4_bytes (abfd, info_ptr);
+      break;
+    case DW_FORM_addrx:
+    case DW_FORM_strx:
+    case DW_FORM_sdata:
+    case DW_FORM_udata:
+    case DW_FORM_ref_udata:
+    case DW_FORM_GNU_addr_index:
+    case DW_FORM_GNU_str_index:
+    case DW_FORM_rnglistx:
+    case DW_FORM_loclistx:
+      info_ptr = skip_attribute_leb128 (info_ptr, buffer_end);
+      break;
+    case DW_FORM_indirect:
+      form = read_unsigned_leb128 (abfd, info_ptr, buffer_end, &bytes_read);
+      info_ptr += bytes_read;
+      /* We need to continue parsing from here, so just go back to
+	 the top.  */
+      goto skip_attribute;
+
+    default:
+      error (_("Dwarf Error: Cannot handle %s "
+	       "in DWARF reader [in module %s]"),
+	     dwarf_form_name (form),
+	     bfd_get_filename (abfd));
+    }
+
+  return info_ptr;
+}
+
 /* Scan the debug information for CU starting at INFO_PTR in buffer BUFFER.
    INFO_PTR should point just after the initial uleb128 of a DIE, and the
    abbrev corresponding to that skipped uleb128 should be passed in
@@ -5402,19 +5883,16 @@ static const gdb_byte *
 skip_one_die (const struct die_reader_specs *reader, const gdb_byte *info_ptr,
 	      const struct abbrev_info *abbrev, bool do_skip_children)
 {
-  unsigned int bytes_read;
   struct attribute attr;
-  bfd *abfd = reader->abfd;
   struct dwarf2_cu *cu = reader->cu;
   const gdb_byte *buffer = reader->buffer;
-  const gdb_byte *buffer_end = reader->buffer_end;
-  unsigned int form, i;
+  unsigned int i;
 
   if (do_skip_children && abbrev->sibling_offset != (unsigned short) -1)
     {
       /* We only handle DW_FORM_ref4 here.  */
       const gdb_byte *sibling_data = info_ptr + abbrev->sibling_offset;
-      unsigned int offset = read_4_bytes (abfd, sibling_data);
+      unsigned int offset = read_4_bytes (reader->abfd, sibling_data);
       const gdb_byte *sibling_ptr
 	= buffer + to_underlying (cu->header.sect_off) + offset;
       if (sibling_ptr >= info_ptr && sibling_ptr < reader->buffer_end)
@@ -5428,6 +5906,24 @@ skip_one_die (const struct die_reader_specs *reader, const gdb_byte *info_ptr,
 	return skip_children (reader, info_ptr);
       return info_ptr;
     }
+  else if (!do_skip_children || !abbrev->has_sibling)
+    {
+      /* The sibling is not needed, so the runs of constant-size
+	 attributes can be skipped at once, and only the others have
+	 to be looked at.  */
+      for (i = 0; i < abbrev->num_skips; i++)
+	{
+	  const attr_skip &skip = abbrev->skips[i];
+	  info_ptr = skip_one_attribute (reader,
+					 abbrev->attrs[skip.attr].form,
+					 info_ptr + skip.fixed_size);
+	}
+      info_ptr += abbrev->trailing_size;
+
+      if (do_skip_children && abbrev->has_children)
+	return skip_children (reader, info_ptr);
+      return info_ptr;
+    }
 
   for (i = 0; i < abbrev->num_attrs; i++)
     {
@@ -5455,101 +5951,7 @@ skip_one_die (const struct die_reader_specs *reader, const gdb_byte *info_ptr,
 	}
 
       /* If it isn't DW_AT_sibling, skip this attribute.  */
-      form = abbrev->attrs[i].form;
-    skip_attribute:
-      switch (form)
-	{
-	case DW_FORM_ref_addr:
-	  /* In DWARF 2, DW_FORM_ref_addr is address sized; in DWARF 3
-	     and later it is offset sized.  */
-	  if (cu->header.version == 2)
-	    info_ptr += cu->header.addr_size;
-	  else
-	    info_ptr += cu->header.offset_size;
-	  break;
-	case DW_FORM_GNU_ref_alt:
-	  info_ptr += cu->header.offset_size;
-	  break;
-	case DW_FORM_addr:
-	  info_ptr += cu->header.addr_size;
-	  break;
-	case DW_FORM_data1:
-	case DW_FORM_ref1:
-	case DW_FORM_flag:
-	case DW_FORM_strx1:
-	  info_ptr += 1;
-	  break;
-	case DW_FORM_flag_present:
-	case DW_FORM_implicit_const:
-	  break;
-	case DW_FORM_data2:
-	case DW_FORM_ref2:
-	case DW_FORM_strx2:
-	  info_ptr += 2;
-	  break;
-	case DW_FORM_strx3:
-	  info_ptr += 3;
-	  break;
-	case DW_FORM_data4:
-	case DW_FORM_ref4:
-	case DW_FORM_strx4:
-	  info_ptr += 4;
-	  break;
-	case DW_FORM_data8:
-	case DW_FORM_ref8:
-	case DW_FORM_ref_sig8:
-	  info_ptr += 8;
-	  break;
-	case DW_FORM_data16:
-	  info_ptr += 16;
-	  break;
-	case DW_FORM_string:
-	  read_direct_string (abfd, info_ptr, &bytes_read);
-	  info_ptr += bytes_read;
-	  break;
-	case DW_FORM_sec_offset:
-	case DW_FORM_strp:
-	case DW_FORM_GNU_strp_alt:
-	  info_ptr += cu->header.offset_size;
-	  break;
-	case DW_FORM_exprloc:
-	case DW_FORM_block:
-	  info_ptr += read_unsigned_leb128 (abfd, info_ptr, &bytes_read);
-	  info_ptr += bytes_read;
-	  break;
-	case DW_FORM_block1:
-	  info_ptr += 1 + read_1_byte (abfd, info_ptr);
-	  break;
-	case DW_FORM_block2:
-	  info_ptr += 2 + read_2_bytes (abfd, info_ptr);
-	  break;
-	case DW_FORM_block4:
-	  info_ptr += 4 + read_4_bytes (abfd, info_ptr);
-	  break;
-	case DW_FORM_addrx:
-	case DW_FORM_strx:
-	case DW_FORM_sdata:
-	case DW_FORM_udata:
-	case DW_FORM_ref_udata:
-	case DW_FORM_GNU_addr_index:
-	case DW_FORM_GNU_str_index:
-	case DW_FORM_rnglistx:
-	case DW_FORM_loclistx:
-	  info_ptr = safe_skip_leb128 (info_ptr, buffer_end);
-	  break;
-	case DW_FORM_indirect:
-	  form = read_unsigned_leb128 (abfd, info_ptr, &bytes_read);
-	  info_ptr += bytes_read;
-	  /* We need to continue parsing from here, so just go back to
-	     the top.  */
-	  goto skip_attribute;
-
-	default:
-	  error (_("Dwarf Error: Cannot handle %s "
-		   "in DWARF reader [in module %s]"),
-		 dwarf_form_name (form),
-		 bfd_get_filename (abfd));
-	}
+      info_ptr = skip_one_attribute (reader, abbrev->attrs[i].form, info_ptr);
     }
 
   if (do_skip_children && abbrev->has_children)
@@ -5557,7 +5959,7 @@ skip_one_die (const struct die_reader_specs *reader, const gdb_byte *info_ptr,
   else
     return info_ptr;
 }
-
+
 /* Reading in full CUs.  */
 
 /* Add PER_CU to the queue.  */
@@ -5728,8 +6130,19 @@ load_full_comp_unit (dwarf2_per_cu_data *this_cu,
   if (reader.dummy_p)
     return;
 
-  struct dwarf2_cu *cu = reader.cu;
-  const gdb_byte *info_ptr = reader.info_ptr;
+  read_comp_unit_dies (&reader, pretend_language);
+  reader.keep ();
+}
+
+/* Read all the DIEs of the unit being read by READER into its CU,
+   and prepare the CU for building symbols.  This only touches the CU
+   itself, so it can be done on a worker thread.  */
+
+static void
+read_comp_unit_dies (cutu_reader *reader, enum language pretend_language)
+{
+  struct dwarf2_cu *cu = reader->cu;
+  const gdb_byte *info_ptr = reader->info_ptr;
 
   gdb_assert (cu->die_hash == NULL);
   cu->die_hash =
@@ -5741,11 +6154,11 @@ load_full_comp_unit (dwarf2_per_cu_data *this_cu,
 			  hashtab_obstack_allocate,
 			  dummy_obstack_deallocate);
 
-  if (reader.comp_unit_die->has_children)
-    reader.comp_unit_die->child
-      = read_die_and_siblings (&reader, reader.info_ptr,
-			       &info_ptr, reader.comp_unit_die);
-  cu->dies = reader.comp_unit_die;
+  if (reader->comp_unit_die->has_children)
+    reader->comp_unit_die->child
+      = read_die_and_siblings (reader, reader->info_ptr,
+			       &info_ptr, reader->comp_unit_die);
+  cu->dies = reader->comp_unit_die;
   /* comp_unit_die is not stored in die_hash, no need.  */
 
   /* We try not to read any attributes in this function, because not
@@ -5755,8 +6168,6 @@ load_full_comp_unit (dwarf2_per_cu_data *this_cu,
      Similarly, if we do not read the producer, we can not apply
      producer-specific interpretation.  */
   prepare_one_comp_unit (cu, cu->dies, pretend_language);
-
-  reader.keep ();
 }
 
 /* Add a DIE to the delayed physname list.  */
@@ -16002,7 +16413,8 @@ read_full_die_1 (const struct die_reader_specs *reader,
   bfd *abfd = reader->abfd;
 
   sect_offset sect_off = (sect_offset) (info_ptr - reader->buffer);
-  abbrev_number = read_unsigned_leb128 (abfd, info_ptr, &bytes_read);
+  abbrev_number = read_unsigned_leb128 (abfd, info_ptr, reader->buffer_end,
+					&bytes_read);
   info_ptr += bytes_read;
   if (!abbrev_number)
     {
@@ -16498,7 +16910,7 @@ cooked_indexer::recurse (cutu_reader *reader,
     {
       /* Both start and end are inclusive, so use both "+ 1" and "- 1" to
 	 limit the range to the children of parent_entry.  */
-      CORE_ADDR start = form_addr (parent_entry->die_offset + 1,
+      CORE_ADDR start = form_addr (parent_entry->die_offset () + 1,
 				   reader->cu->per_cu->is_dwz);
       CORE_ADDR end = form_addr (sect_offset (info_ptr - 1 - reader->buffer),
 				 reader->cu->per_cu->is_dwz);
@@ -16687,7 +17099,7 @@ cooked_indexer::make_index (cutu_reader *reader)
 
 struct cooked_index_functions : public dwarf2_base_index_functions
 {
-  dwarf2_per_cu_data *find_per_cu (dwarf2_per_bfd *per_bfd,
+  dwarf2_per_cu_data *find_per_cu (dwarf2_per_objfile *per_objfile,
 				   CORE_ADDR adjusted_pc) override;
 
   struct compunit_symtab *find_compunit_symtab_by_address
@@ -16696,9 +17108,7 @@ struct cooked_index_functions : public dwarf2_base_index_functions
   void dump (struct objfile *objfile) override
   {
     dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
-    cooked_index *index
-      = (gdb::checked_static_cast<cooked_index *>
-	  (per_objfile->per_bfd->index_table.get ()));
+    cooked_index *index = get_cooked_index (per_objfile);
     if (index == nullptr)
       return;
 
@@ -16707,6 +17117,18 @@ struct cooked_index_functions : public dwarf2_base_index_functions
     index->dump (objfile->arch ());
   }
 
+  void print_stats (struct objfile *objfile, bool print_bcache) override
+  {
+    dwarf2_base_index_functions::print_stats (objfile, print_bcache);
+    if (!print_bcache)
+      return;
+
+    dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
+    cooked_index *index = get_cooked_index (per_objfile, false);
+    if (index != nullptr && !index->addresses_only ())
+      index->print_bcache_statistics ();
+  }
+
   void expand_matching_symbols
     (struct objfile *,
      const lookup_name_info &lookup_name,
@@ -16746,18 +17168,21 @@ struct cooked_index_functions : public dwarf2_base_index_functions
       return language_unknown;
 
     dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
-    struct dwarf2_per_bfd *per_bfd = per_objfile->per_bfd;
-    if (per_bfd->index_table == nullptr)
+    cooked_index *table = get_cooked_index (per_objfile, false);
+    if (table == nullptr)
       return language_unknown;
 
+    /* When the units have not been indexed yet, find the unit holding
+       "main" through the minimal symbol and its address, so that
+       startup does not have to index everything.  */
+    if (table->addresses_only ())
+      return lazy_main_language (per_objfile, table, symbol_found_p);
+
     /* Expansion of large CUs can be slow.  By returning the language of main
        here for C and C++, we avoid CU expansion during set_initial_language.
        But by doing a symbol lookup in the cooked index, we are forced to wait
        for finalization to complete.  See PR symtab/30174 for ideas how to
        bypass that as well.  */
-    cooked_index *table
-      = (gdb::checked_static_cast<cooked_index *>
-	 (per_bfd->index_table.get ()));
 
     for (const cooked_index_entry *entry : table->find (name, false))
       {
@@ -16777,15 +17202,25 @@ struct cooked_index_functions : public dwarf2_base_index_functions
 };
 
 dwarf2_per_cu_data *
-cooked_index_functions::find_per_cu (dwarf2_per_bfd *per_bfd,
+cooked_index_functions::find_per_cu (dwarf2_per_objfile *per_objfile,
 				     CORE_ADDR adjusted_pc)
 {
-  cooked_index *table
-    = (gdb::checked_static_cast<cooked_index *>
-       (per_bfd->index_table.get ()));
+  cooked_index *table = get_cooked_index (per_objfile, false);
   if (table == nullptr)
     return nullptr;
-  return table->lookup (adjusted_pc);
+
+  dwarf2_per_cu_data *result = table->lookup (adjusted_pc);
+
+  /* When lazily indexing, the address map only comes from
+     .debug_aranges.  If some units are missing from it, the address
+     may be in one of them, and all the units must be indexed to find
+     out.  */
+  if (result == nullptr
+      && table->addresses_only ()
+      && !all_units_have_addresses (per_objfile->per_bfd))
+    result = get_cooked_index (per_objfile)->lookup (adjusted_pc);
+
+  return result;
 }
 
 struct compunit_symtab *
@@ -16796,9 +17231,7 @@ cooked_index_functions::find_compunit_symtab_by_address
     return nullptr;
 
   dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
-  cooked_index *table
-    = (gdb::checked_static_cast<cooked_index *>
-       (per_objfile->per_bfd->index_table.get ()));
+  cooked_index *table = get_cooked_index (per_objfile);
   if (table == nullptr)
     return nullptr;
 
@@ -16819,9 +17252,7 @@ cooked_index_functions::expand_matching_symbols
       symbol_compare_ftype *ordered_compare)
 {
   dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
-  cooked_index *table
-    = (gdb::checked_static_cast<cooked_index *>
-       (per_objfile->per_bfd->index_table.get ()));
+  cooked_index *table = get_cooked_index (per_objfile);
   if (table == nullptr)
     return;
 
@@ -16861,9 +17292,9 @@ cooked_index_functions::expand_symtabs_matching
 {
   dwarf2_per_objfile *per_objfile = get_dwarf2_per_objfile (objfile);
 
-  cooked_index *table
-    = (gdb::checked_static_cast<cooked_index *>
-       (per_objfile->per_bfd->index_table.get ()));
+  /* Without a name, the index itself is not needed.  */
+  cooked_index *table = get_cooked_index (per_objfile,
+					  lookup_name != nullptr);
   if (table == nullptr)
     return true;
 
@@ -16875,17 +17306,14 @@ cooked_index_functions::expand_symtabs_matching
   gdb_assert (lookup_name != nullptr || symbol_matcher == nullptr);
   if (lookup_name == nullptr)
     {
+      std::vector<dwarf2_per_cu_data *> units;
       for (dwarf2_per_cu_data *per_cu
 	     : all_units_range (per_objfile->per_bfd))
-	{
-	  QUIT;
+	if (file_matcher == nullptr || per_cu->mark)
+	  units.push_back (per_cu);
 
-	  if (!dw2_expand_symtabs_matching_one (per_cu, per_objfile,
-						file_matcher,
-						expansion_notify))
-	    return false;
-	}
-      return true;
+      return dw2_instantiate_symtabs (units, per_objfile, false,
+				      expansion_notify);
     }
 
   lookup_name_info lookup_name_without_params
@@ -16904,6 +17332,12 @@ cooked_index_functions::expand_symtabs_matching
     language_ada
   };
 
+  /* The units to expand, in the order they were found.  Unless there
+     is a notification function, these are only expanded once the
+     search is done, so that they can be read in parallel.  */
+  std::vector<dwarf2_per_cu_data *> units;
+  std::unordered_set<dwarf2_per_cu_data *> units_seen;
+
   for (enum language lang : unique_styles)
     {
       std::vector<gdb::string_view> name_vec
@@ -16974,14 +17408,23 @@ cooked_index_functions::expand_symtabs_matching
 		continue;
 	    }
 
-	  if (!dw2_expand_symtabs_matching_one (entry->per_cu, per_objfile,
-						file_matcher,
-						expansion_notify))
-	    return false;
+	  /* A notification function may stop the search early, so
+	     expand right away in that case.  */
+	  if (expansion_notify != nullptr)
+	    {
+	      if (!dw2_expand_symtabs_matching_one (entry->per_cu,
+						    per_objfile,
+						    file_matcher,
+						    expansion_notify))
+		return false;
+	    }
+	  else if (units_seen.insert (entry->per_cu).second)
+	    units.push_back (entry->per_cu);
 	}
     }
 
-  return true;
+  return dw2_instantiate_symtabs (units, per_objfile, false,
+				  expansion_notify);
 }
 
 /* Return a new cooked_index_functions object.  */
@@ -17239,6 +17682,7 @@ read_attribute_value (const struct die_reader_specs *reader,
   dwarf2_per_objfile *per_objfile = cu->per_objfile;
   struct objfile *objfile = per_objfile->objfile;
   bfd *abfd = reader->abfd;
+  const gdb_byte *buffer_end = reader->buffer_end;
   struct comp_unit_head *cu_header = &cu->header;
   unsigned int bytes_read;
   struct dwarf_block *blk;
@@ -17312,6 +17756,7 @@ read_attribute_value (const struct die_reader_specs *reader,
     case DW_FORM_loclistx:
       {
 	attr->set_unsigned_reprocess (read_unsigned_leb128 (abfd, info_ptr,
+							    buffer_end,
 							    &bytes_read));
 	info_ptr += bytes_read;
 	if (allow_reprocess)
@@ -17358,7 +17803,8 @@ read_attribute_value (const struct die_reader_specs *reader,
     case DW_FORM_exprloc:
     case DW_FORM_block:
       blk = dwarf_alloc_block (cu);
-      blk->size = read_unsigned_leb128 (abfd, info_ptr, &bytes_read);
+      blk->size = read_unsigned_leb128 (abfd, info_ptr, buffer_end,
+					&bytes_read);
       info_ptr += bytes_read;
       blk->data = read_n_bytes (abfd, info_ptr, blk->size);
       info_ptr += blk->size;
@@ -17381,12 +17827,14 @@ read_attribute_value (const struct die_reader_specs *reader,
       attr->set_unsigned (1);
       break;
     case DW_FORM_sdata:
-      attr->set_signed (read_signed_leb128 (abfd, info_ptr, &bytes_read));
+      attr->set_signed (read_signed_leb128 (abfd, info_ptr, buffer_end,
+					    &bytes_read));
       info_ptr += bytes_read;
       break;
     case DW_FORM_rnglistx:
       {
 	attr->set_unsigned_reprocess (read_unsigned_leb128 (abfd, info_ptr,
+							    buffer_end,
 							    &bytes_read));
 	info_ptr += bytes_read;
 	if (allow_reprocess)
@@ -17394,7 +17842,8 @@ read_attribute_value (const struct die_reader_specs *reader,
       }
       break;
     case DW_FORM_udata:
-      attr->set_unsigned (read_unsigned_leb128 (abfd, info_ptr, &bytes_read));
+      attr->set_unsigned (read_unsigned_leb128 (abfd, info_ptr, buffer_end,
+						&bytes_read));
       info_ptr += bytes_read;
       break;
     case DW_FORM_ref1:
@@ -17423,16 +17872,17 @@ read_attribute_value (const struct die_reader_specs *reader,
       break;
     case DW_FORM_ref_udata:
       attr->set_unsigned ((to_underlying (cu_header->sect_off)
-			   + read_unsigned_leb128 (abfd, info_ptr,
+			   + read_unsigned_leb128 (abfd, info_ptr, buffer_end,
 						   &bytes_read)));
       info_ptr += bytes_read;
       break;
     case DW_FORM_indirect:
-      form = read_unsigned_leb128 (abfd, info_ptr, &bytes_read);
+      form = read_unsigned_leb128 (abfd, info_ptr, buffer_end, &bytes_read);
       info_ptr += bytes_read;
       if (form == DW_FORM_implicit_const)
 	{
-	  implicit_const = read_signed_leb128 (abfd, info_ptr, &bytes_read);
+	  implicit_const = read_signed_leb128 (abfd, info_ptr, buffer_end,
+					       &bytes_read);
 	  info_ptr += bytes_read;
 	}
       info_ptr = read_attribute_value (reader, attr, form, implicit_const,
@@ -17444,6 +17894,7 @@ read_attribute_value (const struct die_reader_specs *reader,
     case DW_FORM_addrx:
     case DW_FORM_GNU_addr_index:
       attr->set_unsigned_reprocess (read_unsigned_leb128 (abfd, info_ptr,
+							  buffer_end,
 							  &bytes_read));
       info_ptr += bytes_read;
       if (allow_reprocess)
@@ -17479,7 +17930,8 @@ read_attribute_value (const struct die_reader_specs *reader,
 	  }
 	else
 	  {
-	    str_index = read_unsigned_leb128 (abfd, info_ptr, &bytes_read);
+	    str_index = read_unsigned_leb128 (abfd, info_ptr, buffer_end,
+					      &bytes_read);
 	    info_ptr += bytes_read;
 	  }
 	attr->set_unsigned_reprocess (str_index);
@@ -22094,6 +22546,25 @@ show_check_physname (struct ui_file *file, int from_tty,
 	      value);
 }
 
+static void
+show_dwarf_lazy_indexing (struct ui_file *file, int from_tty,
+			  struct cmd_list_element *c, const char *value)
+{
+  gdb_printf (file,
+	      _("Whether DWARF units are indexed lazily is %s.\n"),
+	      value);
+}
+
+static void
+show_dwarf_parallel_expansion (struct ui_file *file, int from_tty,
+			       struct cmd_list_element *c, const char *value)
+{
+  gdb_printf (file,
+	      _("Whether DWARF units are read in parallel when expanded "
+		"is %s.\n"),
+	      value);
+}
+
 void _initialize_dwarf2_read ();
 void
 _initialize_dwarf2_read ()
@@ -22120,6 +22591,30 @@ caching, which can slow down startup."),
 			    &set_dwarf_cmdlist,
 			    &show_dwarf_cmdlist);
 
+  add_setshow_boolean_cmd ("lazy-indexing", class_obscure,
+			   &dwarf_lazy_indexing, _("\
+Set whether DWARF units are indexed lazily."), _("\
+Show whether DWARF units are indexed lazily."), _("\
+When on, an objfile that has .debug_aranges is not indexed when it is\n\
+loaded.  Addresses are looked up with .debug_aranges, and the units are\n\
+only indexed when a symbol has to be searched by name."),
+			   NULL,
+			   show_dwarf_lazy_indexing,
+			   &set_dwarf_cmdlist,
+			   &show_dwarf_cmdlist);
+
+  add_setshow_boolean_cmd ("parallel-expansion", class_obscure,
+			   &dwarf_parallel_expansion, _("\
+Set whether DWARF units are read in parallel when expanded."), _("\
+Show whether DWARF units are read in parallel when expanded."), _("\
+When on, and many units are expanded into full symbols at once, the\n\
+DIEs of the units are read using the worker threads.  The symbols\n\
+themselves are always built by the main thread."),
+			   NULL,
+			   show_dwarf_parallel_expansion,
+			   &set_dwarf_cmdlist,
+			   &show_dwarf_cmdlist);
+
   add_setshow_zuinteger_cmd ("dwarf-read", no_class, &dwarf_read_debug, _("\
 Set debugging of the DWARF reader."), _("\
 Show debugging of the DWARF reader."), _("\
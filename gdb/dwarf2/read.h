@@ -553,6 +553,12 @@ struct dwarf2_per_bfd
      resources associated to the open file, memory mapping, etc.  */
   std::unique_ptr<index_cache_resource> index_cache_res;
 
+  /* If a cooked index was found in the index cache, this holds the
+     contents of the file, which are kept alive by INDEX_CACHE_RES.
+     The index is created from it when the DWARF would otherwise be
+     scanned.  */
+  gdb::array_view<const gdb_byte> cooked_index_contents;
+
   /* Mapping from abstract origin DIE to concrete DIEs that reference it as
      DW_AT_abstract_origin.  */
   std::unordered_map<sect_offset, std::vector<sect_offset>,
@@ -876,7 +882,7 @@ struct dwarf2_base_index_functions : public quick_symbol_functions
 
   /* A helper function that finds the per-cu object from an "adjusted"
      PC -- a PC with the base text offset removed.  */
-  virtual dwarf2_per_cu_data *find_per_cu (dwarf2_per_bfd *per_bfd,
+  virtual dwarf2_per_cu_data *find_per_cu (dwarf2_per_objfile *per_objfile,
 					   CORE_ADDR adjusted_pc);
 
   struct compunit_symtab *find_pc_sect_compunit_symtab
@@ -960,4 +966,9 @@ extern bool read_addrmap_from_aranges (dwarf2_per_objfile *per_objfile,
 				       dwarf2_section_info *section,
 				       addrmap *mutable_map);
 
+/* If the units of PER_OBJFILE have not all been indexed yet, because
+   lazy indexing is in use, index them now.  */
+
+extern void dwarf2_complete_index (dwarf2_per_objfile *per_objfile);
+
 #endif /* DWARF2READ_H */
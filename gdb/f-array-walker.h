@@ -124,6 +124,10 @@ struct fortran_array_walker_base_impl
   void start_dimension (struct type *index_type, LONGEST nelts, bool inner_p)
   { /* Nothing.  */ }
 
+  /* Called once GDB has walked over the whole array.  */
+  void finish ()
+  { /* Nothing.  */ }
+
   /* Called when GDB finishes iterating over a dimension of the array.  The
      argument INNER_P is true for the inner most dimension (the dimension
      containing the actual elements of the array), and false for more outer
@@ -209,6 +213,7 @@ class fortran_array_walker
   walk ()
   {
     walk_1 (m_type, 0, false);
+    m_impl.finish ();
   }
 
 private:
@@ -37,6 +37,7 @@
 #include "target-float.h"
 #include "gdbarch.h"
 #include "gdbcmd.h"
+#include "target.h"
 #include "f-array-walker.h"
 #include "f-exp.h"
 
@@ -330,18 +331,49 @@ class fortran_lazy_array_repacker_impl
       m_addr (address)
   { /* Nothing.  */ }
 
-  /* Create a lazy value in target memory representing a single element,
-     then load the element into GDB's memory and copy the contents into the
-     destination value.  */
+  /* Record where in target memory the element is, and where in the
+     destination value it goes.  The elements are read by FINISH.  */
   void process_element (struct type *elt_type, LONGEST elt_off,
 			LONGEST index, bool last_p)
   {
-    copy_element_to_dest (value_at_lazy (elt_type, m_addr + elt_off));
+    ULONGEST len = elt_type->length ();
+
+    m_ranges.push_back ({m_addr + elt_off,
+			 m_dest->contents_raw ().data () + m_dest_offset,
+			 len});
+    m_dest_offset += len;
+  }
+
+  /* Read all the elements at once; the elements of a slice with a stride
+     are scattered in memory, and reading them one by one costs a round
+     trip to the target for each.  */
+  void finish ()
+  {
+    size_t failed;
+
+    if (target_read_memory_vec (m_ranges, &failed) == 0)
+      return;
+
+    /* Read the element that could not be read, and the following
+       ones, one by one.  This throws the memory error, or marks the
+       bytes that are unavailable in the destination value.  */
+    for (size_t i = failed; i < m_ranges.size (); ++i)
+      {
+	const memory_read_range &range = m_ranges[i];
+	LONGEST offset = range.buf - m_dest->contents_raw ().data ();
+
+	read_value_memory (m_dest, offset * TARGET_CHAR_BIT, false,
+			   range.addr, range.buf, range.len);
+      }
   }
 
 private:
   /* The address in target memory where the parent value starts.  */
   CORE_ADDR m_addr;
+
+  /* The memory ranges of the elements, in the order they appear in the
+     destination value.  */
+  std::vector<memory_read_range> m_ranges;
 };
 
 /* A class used by FORTRAN_VALUE_SUBARRAY when repacking Fortran array
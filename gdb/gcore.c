@@ -30,6 +30,7 @@
 #include "gcore.h"
 #include "cli/cli-decode.h"
 #include <fcntl.h>
+#include <sys/stat.h>
 #include "regcache.h"
 #include "regset.h"
 #include "gdb_bfd.h"
@@ -38,15 +39,28 @@
 #include "gdbsupport/gdb_unlinker.h"
 #include "gdbsupport/byte-vector.h"
 #include "gdbsupport/scope-exit.h"
+#include "gdbsupport/filestuff.h"
+#include "gdbsupport/thread-pool.h"
+#include <atomic>
+#include <chrono>
 
 /* The largest amount of memory to read from the target at once.  We
    must throttle it to limit the amount of memory used by GDB during
    generate-core-file for programs with large resident data.  */
 #define MAX_COPY_BYTES (1024 * 1024)
 
+/* The number of buffers of MAX_COPY_BYTES bytes in use at once while
+   copying memory: one is being read from the target while the others
+   are being written out.  */
+#define GCORE_COPY_BUFFERS 4
+
+/* The granularity at which memory that is entirely zero is left as
+   holes in the core file.  */
+#define GCORE_PAGE_SIZE 4096
+
 static const char *default_gcore_target (void);
 static enum bfd_architecture default_gcore_arch (void);
-static int gcore_memory_sections (bfd *);
+static int gcore_memory_sections (bfd *, gcore_stats *);
 
 /* create_gcore_bfd -- helper for gcore_command (exported).
    Open a new bfd core file for output, and return the handle.  */
@@ -66,7 +80,7 @@ create_gcore_bfd (const char *filename)
 /* write_gcore_file_1 -- do the actual work of write_gcore_file.  */
 
 static void
-write_gcore_file_1 (bfd *obfd)
+write_gcore_file_1 (bfd *obfd, gcore_stats *stats)
 {
   gdb::unique_xmalloc_ptr<char> note_data;
   int note_size = 0;
@@ -99,7 +113,7 @@ write_gcore_file_1 (bfd *obfd)
   bfd_set_section_size (note_sec, note_size);
 
   /* Now create the memory/load sections.  */
-  if (gcore_memory_sections (obfd) == 0)
+  if (gcore_memory_sections (obfd, stats) == 0)
     error (_("gcore: failed to get corefile memory sections from target."));
 
   /* Write out the contents of the note section.  */
@@ -108,15 +122,30 @@ write_gcore_file_1 (bfd *obfd)
     warning (_("writing note section (%s)"), bfd_errmsg (bfd_get_error ()));
 }
 
-/* write_gcore_file -- helper for gcore_command (exported).
-   Compose and write the corefile data to the core file.  */
+/* See gcore.h.  */
 
 void
-write_gcore_file (bfd *obfd)
+write_gcore_file (bfd *obfd, gcore_stats *stats)
 {
   target_prepare_to_generate_core ();
   SCOPE_EXIT { target_done_generating_core (); };
-  write_gcore_file_1 (obfd);
+  write_gcore_file_1 (obfd, stats);
+}
+
+/* Print STATS, the statistics about saving a core file.  */
+
+static void
+print_gcore_stats (const gcore_stats &stats)
+{
+  const double mib = 1024.0 * 1024.0;
+
+  gdb_printf (_("Saved %.1f MiB of memory in %.2f seconds"),
+	      stats.bytes / mib, stats.seconds);
+  if (stats.seconds > 0)
+    gdb_printf (_(" (%.1f MiB/s)"), stats.bytes / mib / stats.seconds);
+  if (stats.holes > 0)
+    gdb_printf (_(", %.1f MiB of zeros left as holes"), stats.holes / mib);
+  gdb_printf (".\n");
 }
 
 /* gcore_command -- implements the 'gcore' command.
@@ -143,6 +172,8 @@ gcore_command (const char *args, int from_tty)
     gdb_printf ("Opening corefile '%s' for output.\n",
 		corefilename.get ());
 
+  gdb::optional<gcore_stats> stats;
+
   if (target_supports_dumpcore ())
     target_dumpcore (corefilename.get ());
   else
@@ -154,13 +185,16 @@ gcore_command (const char *args, int from_tty)
       gdb::unlinker unlink_file (corefilename.get ());
 
       /* Call worker function.  */
-      write_gcore_file (obfd.get ());
+      stats.emplace ();
+      write_gcore_file (obfd.get (), &*stats);
 
       /* Succeeded.  */
       unlink_file.keep ();
     }
 
   gdb_printf ("Saved corefile %s\n", corefilename.get ());
+  if (info_verbose && stats.has_value ())
+    print_gcore_stats (*stats);
 }
 
 static enum bfd_architecture
@@ -567,10 +601,205 @@ objfile_find_memory_regions (struct target_ops *self,
   return 0;
 }
 
-static void
-gcore_copy_callback (bfd *obfd, asection *osec)
+/* Return true if the LEN bytes at DATA are all zero.  */
+
+static bool
+gcore_all_zero (const gdb_byte *data, size_t len)
+{
+  return len == 0 || (data[0] == 0 && memcmp (data, data + 1, len - 1) == 0);
+}
+
+/* Copies the contents of the "load" sections of a core file from
+   target memory.
+
+   The target is only accessed from the main thread.  It reads memory
+   into one of several buffers, and the thread pool writes each buffer
+   out while the next ones are read.  Pages that are entirely zero are
+   not written, leaving holes in the file, which reads back as zeros.
+
+   Writing from the thread pool needs pwrite, on a file descriptor of
+   our own, at the file positions BFD assigned to the sections.  When
+   that is not available, buffers are written through BFD in the main
+   thread instead, zero pages included.  */
+
+class gcore_memory_copier
+{
+public:
+
+  explicit gcore_memory_copier (bfd *obfd);
+
+  /* Waits for the writes in progress.  */
+  ~gcore_memory_copier ();
+
+  DISABLE_COPY_AND_ASSIGN (gcore_memory_copier);
+
+  /* Copy the contents of OSEC, if it is a "load" section.  */
+  void copy_section (asection *osec);
+
+  /* Wait for all the writes to complete, and fill STATS.  */
+  void finish (gcore_stats *stats);
+
+private:
+
+  /* A buffer of target memory, and where it goes in the file.  */
+  struct buffer
+  {
+    gdb::byte_vector data;
+    asection *osec = nullptr;
+    file_ptr offset = 0;
+    gdb::future<void> pending;
+  };
+
+  /* Wait for the write of BUF to complete, if it is in progress.  */
+  void wait (buffer &buf);
+
+  /* Write the data in BUF to the file, except for its zero pages when
+     writing with pwrite.  This may run in a worker thread.  */
+  void write_buffer (const buffer &buf);
+
+  /* Write the LEN bytes at DATA at OFFSET in OSEC.  */
+  void write_range (asection *osec, file_ptr offset, const gdb_byte *data,
+		    size_t len);
+
+  bfd *m_bfd;
+
+  /* Our own descriptor for the core file, when writing with pwrite.  */
+  scoped_fd m_fd;
+
+  /* The end of the last section, in the file.  */
+  file_ptr m_end = 0;
+
+  std::vector<buffer> m_buffers;
+
+  /* The buffer to read into next.  */
+  size_t m_next = 0;
+
+  ULONGEST m_bytes = 0;
+  std::atomic<ULONGEST> m_holes {0};
+
+  /* The errno of the first failed write, or 0.  */
+  std::atomic<int> m_errno {0};
+
+  std::chrono::steady_clock::time_point m_start
+    = std::chrono::steady_clock::now ();
+};
+
+gcore_memory_copier::gcore_memory_copier (bfd *obfd)
+  : m_bfd (obfd),
+    m_buffers (GCORE_COPY_BUFFERS)
+{
+#ifdef HAVE_PWRITE
+  /* Have BFD lay out the file, so that section file positions are
+     known.  Writing nothing is enough.  */
+  gdb_byte dummy = 0;
+  for (asection *sect : gdb_bfd_sections (obfd))
+    if ((bfd_section_flags (sect) & SEC_HAS_CONTENTS) != 0)
+      {
+	if (bfd_get_flavour (obfd) == bfd_target_elf_flavour
+	    && bfd_set_section_contents (obfd, sect, &dummy, 0, 0))
+	  m_fd = gdb_open_cloexec (bfd_get_filename (obfd), O_WRONLY, 0);
+	break;
+      }
+#endif
+}
+
+gcore_memory_copier::~gcore_memory_copier ()
+{
+  for (buffer &buf : m_buffers)
+    if (buf.pending.valid ())
+      buf.pending.wait ();
+}
+
+void
+gcore_memory_copier::wait (buffer &buf)
+{
+  if (buf.pending.valid ())
+    buf.pending.get ();
+}
+
+void
+gcore_memory_copier::write_range (asection *osec, file_ptr offset,
+				  const gdb_byte *data, size_t len)
+{
+  if (m_errno.load (std::memory_order_relaxed) != 0)
+    return;
+
+#ifdef HAVE_PWRITE
+  if (m_fd.get () >= 0)
+    {
+      file_ptr pos = osec->filepos + offset;
+
+      while (len > 0)
+	{
+	  ssize_t n = pwrite (m_fd.get (), data, len, pos);
+
+	  if (n < 0 && errno == EINTR)
+	    continue;
+	  if (n <= 0)
+	    {
+	      int expected = 0;
+	      m_errno.compare_exchange_strong (expected,
+					       n < 0 ? errno : ENOSPC);
+	      return;
+	    }
+	  data += n;
+	  pos += n;
+	  len -= n;
+	}
+      return;
+    }
+#endif
+
+  if (!bfd_set_section_contents (m_bfd, osec, data, offset, len))
+    {
+      warning (_("Failed to write corefile contents (%s)."),
+	       bfd_errmsg (bfd_get_error ()));
+      m_errno = EIO;
+    }
+}
+
+void
+gcore_memory_copier::write_buffer (const buffer &buf)
+{
+  const gdb_byte *data = buf.data.data ();
+  size_t size = buf.data.size ();
+  size_t run_start = 0;
+  ULONGEST holes = 0;
+
+  /* Only the pwrite path makes sure, in finish, that the file extends
+     over trailing holes.  Through BFD, write the zero pages too.  */
+  if (m_fd.get () < 0)
+    {
+      write_range (buf.osec, buf.offset, data, size);
+      return;
+    }
+
+  /* Write each run of pages that are not all zero.  */
+  for (size_t pos = 0; pos < size; pos += GCORE_PAGE_SIZE)
+    {
+      size_t len = std::min ((size_t) GCORE_PAGE_SIZE, size - pos);
+
+      if (gcore_all_zero (data + pos, len))
+	{
+	  if (run_start < pos)
+	    write_range (buf.osec, buf.offset + run_start,
+			 data + run_start, pos - run_start);
+	  run_start = pos + len;
+	  holes += len;
+	}
+    }
+
+  if (run_start < size)
+    write_range (buf.osec, buf.offset + run_start, data + run_start,
+		 size - run_start);
+
+  m_holes += holes;
+}
+
+void
+gcore_memory_copier::copy_section (asection *osec)
 {
-  bfd_size_type size, total_size = bfd_section_size (osec);
+  bfd_size_type total_size = bfd_section_size (osec);
   file_ptr offset = 0;
 
   /* Read-only sections are marked; we don't have to copy their contents.  */
@@ -581,16 +810,22 @@ gcore_copy_callback (bfd *obfd, asection *osec)
   if (!startswith (bfd_section_name (osec), "load"))
     return;
 
-  size = std::min (total_size, (bfd_size_type) MAX_COPY_BYTES);
-  gdb::byte_vector memhunk (size);
+  m_end = std::max (m_end, (file_ptr) (osec->filepos + total_size));
 
-  while (total_size > 0)
+  while (total_size > 0 && m_errno.load () == 0)
     {
-      if (size > total_size)
-	size = total_size;
+      bfd_size_type size
+	= std::min (total_size, (bfd_size_type) MAX_COPY_BYTES);
+      buffer &buf = m_buffers[m_next];
+      m_next = (m_next + 1) % m_buffers.size ();
+
+      wait (buf);
+      buf.data.resize (size);
+      buf.osec = osec;
+      buf.offset = offset;
 
       if (target_read_memory (bfd_section_vma (osec) + offset,
-			      memhunk.data (), size) != 0)
+			      buf.data.data (), size) != 0)
 	{
 	  warning (_("Memory read failed for corefile "
 		     "section, %s bytes at %s."),
@@ -599,19 +834,55 @@ gcore_copy_callback (bfd *obfd, asection *osec)
 			     bfd_section_vma (osec)));
 	  break;
 	}
-      if (!bfd_set_section_contents (obfd, osec, memhunk.data (),
-				     offset, size))
-	{
-	  warning (_("Failed to write corefile contents (%s)."),
-		   bfd_errmsg (bfd_get_error ()));
-	  break;
-	}
 
+      if (m_fd.get () >= 0)
+	buf.pending = gdb::thread_pool::g_thread_pool->post_task
+	  ([this, &buf] ()
+	    {
+	      write_buffer (buf);
+	    });
+      else
+	write_buffer (buf);
+
+      m_bytes += size;
       total_size -= size;
       offset += size;
     }
 }
 
+void
+gcore_memory_copier::finish (gcore_stats *stats)
+{
+  for (buffer &buf : m_buffers)
+    wait (buf);
+
+#ifdef HAVE_PWRITE
+  /* If the last pages were all zero, nothing was written there.  Make
+     sure the file is long enough to have them read back as zero.  */
+  struct stat st;
+  if (m_fd.get () >= 0
+      && m_errno == 0
+      && fstat (m_fd.get (), &st) == 0
+      && st.st_size < m_end
+      && ftruncate (m_fd.get (), m_end) != 0)
+    m_errno = errno;
+#endif
+
+  if (m_fd.get () >= 0 && m_errno != 0)
+    warning (_("Failed to write corefile contents (%s)."),
+	     safe_strerror (m_errno));
+
+  if (stats != nullptr)
+    {
+      std::chrono::duration<double> elapsed
+	= std::chrono::steady_clock::now () - m_start;
+
+      stats->bytes = m_bytes;
+      stats->holes = m_holes;
+      stats->seconds = elapsed.count ();
+    }
+}
+
 /* Callback to copy contents to a particular memory tag section.  */
 
 static void
@@ -627,7 +898,7 @@ gcore_copy_memtag_section_callback (bfd *obfd, asection *osec)
 }
 
 static int
-gcore_memory_sections (bfd *obfd)
+gcore_memory_sections (bfd *obfd, gcore_stats *stats)
 {
   /* Try gdbarch method first, then fall back to target method.  */
   gdbarch *arch = current_inferior ()->arch ();
@@ -653,11 +924,13 @@ gcore_memory_sections (bfd *obfd)
     make_output_phdrs (obfd, sect);
 
   /* Copy memory region and memory tag contents.  */
+  gcore_memory_copier copier (obfd);
   for (asection *sect : gdb_bfd_sections (obfd))
     {
-      gcore_copy_callback (obfd, sect);
+      copier.copy_section (sect);
       gcore_copy_memtag_section_callback (obfd, sect);
     }
+  copier.finish (stats);
 
   return 1;
 }
@@ -24,8 +24,27 @@
 
 struct thread_info;
 
+/* Statistics about the memory written to a core file.  */
+
+struct gcore_stats
+{
+  /* The number of bytes of memory saved.  */
+  ULONGEST bytes = 0;
+
+  /* How many of those were in pages entirely zero, which were left as
+     holes in the file instead of being written.  */
+  ULONGEST holes = 0;
+
+  /* The time it took to save them, in seconds.  */
+  double seconds = 0;
+};
+
 extern gdb_bfd_ref_ptr create_gcore_bfd (const char *filename);
-extern void write_gcore_file (bfd *obfd);
+
+/* Compose and write the core file data to OBFD.  If STATS is not
+   NULL, fill it with statistics about the memory written.  */
+
+extern void write_gcore_file (bfd *obfd, gcore_stats *stats = nullptr);
 extern int objfile_find_memory_regions (struct target_ops *self,
 					find_memory_region_ftype func,
 					void *obfd);
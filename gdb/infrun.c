@@ -68,6 +68,7 @@
 #include "gdbsupport/forward-scope-exit.h"
 #include "gdbsupport/gdb_select.h"
 #include <unordered_map>
+#include <chrono>
 #include "async-event.h"
 #include "gdbsupport/selftest.h"
 #include "scoped-mock-context.h"
@@ -5310,6 +5311,100 @@ handle_one (const wait_one_event &event)
   return false;
 }
 
+/* How long stop_all_threads took, for "maint info stop-latency".  */
+
+struct stop_latency_bucket
+{
+  /* Number of calls that fell in this bucket.  */
+  unsigned int count = 0;
+
+  /* Total and longest time those calls took.  */
+  std::chrono::steady_clock::duration total {};
+  std::chrono::steady_clock::duration max {};
+};
+
+/* Entry N covers the calls that had to stop more than 2^(N-1) and at
+   most 2^N threads.  */
+
+static std::vector<stop_latency_bucket> stop_latency_buckets;
+
+/* Record that stopping NTHREADS threads took ELAPSED.  */
+
+static void
+record_stop_latency (int nthreads, std::chrono::steady_clock::duration elapsed)
+{
+  size_t bucket = 0;
+  while ((1 << bucket) < nthreads)
+    bucket++;
+
+  if (stop_latency_buckets.size () <= bucket)
+    stop_latency_buckets.resize (bucket + 1);
+
+  stop_latency_bucket &b = stop_latency_buckets[bucket];
+  b.count++;
+  b.total += elapsed;
+  b.max = std::max (b.max, elapsed);
+}
+
+/* Implement the "maint info stop-latency" command.  */
+
+static void
+maintenance_info_stop_latency (const char *args, int from_tty)
+{
+  struct ui_out *uiout = current_uiout;
+
+  int nrows = 0;
+  for (const stop_latency_bucket &b : stop_latency_buckets)
+    if (b.count > 0)
+      nrows++;
+
+  if (nrows == 0)
+    {
+      uiout->message (_("No threads have been stopped.\n"));
+      return;
+    }
+
+  auto to_ms = [] (std::chrono::steady_clock::duration d)
+    {
+      return std::chrono::duration<double, std::milli> (d).count ();
+    };
+
+  ui_out_emit_table table_emitter (uiout, 4, nrows, "stop-latency");
+
+  uiout->table_header (11, ui_left, "threads", "Threads");
+  uiout->table_header (8, ui_right, "stops", "Stops");
+  uiout->table_header (12, ui_right, "average", "Average (ms)");
+  uiout->table_header (12, ui_right, "max", "Max (ms)");
+  uiout->table_body ();
+
+  for (size_t i = 0; i < stop_latency_buckets.size (); i++)
+    {
+      const stop_latency_bucket &b = stop_latency_buckets[i];
+
+      if (b.count == 0)
+	continue;
+
+      ui_out_emit_tuple tuple_emitter (uiout, nullptr);
+
+      if (i <= 1)
+	uiout->field_unsigned ("threads", 1 << i);
+      else
+	uiout->field_fmt ("threads", "%d-%d", (1 << (i - 1)) + 1, 1 << i);
+      uiout->field_unsigned ("stops", b.count);
+      uiout->field_fmt ("average", "%.3f", to_ms (b.total) / b.count);
+      uiout->field_fmt ("max", "%.3f", to_ms (b.max));
+      uiout->text ("\n");
+    }
+}
+
+/* Implement the "maint flush stop-latency" command.  */
+
+static void
+maintenance_flush_stop_latency (const char *args, int from_tty)
+{
+  stop_latency_buckets.clear ();
+}
+
 /* See infrun.h.  */
 
 void
@@ -5319,6 +5414,10 @@ stop_all_threads (const char *reason, inferior *inf)
   int pass;
   int iterations = 0;
 
+  /* For "maint info stop-latency".  */
+  auto start_time = std::chrono::steady_clock::now ();
+  int stops_requested = 0;
+
   gdb_assert (exists_non_stop_target ());
 
   INFRUN_SCOPED_DEBUG_START_END ("reason=%s, inf=%d", reason,
@@ -5406,6 +5505,7 @@ stop_all_threads (const char *reason, inferior *inf)
 					   t->ptid.to_string ().c_str ());
 		      target_stop (t->ptid);
 		      t->stop_requested = 1;
+		      stops_requested++;
 		    }
 		  else
 		    {
@@ -5444,6 +5544,10 @@ stop_all_threads (const char *reason, inferior *inf)
 	    }
 	}
     }
+
+  if (stops_requested > 0)
+    record_stop_latency (stops_requested,
+			 std::chrono::steady_clock::now () - start_time);
 }
 
 /* Handle a TARGET_WAITKIND_NO_RESUMED event.  */
@@ -10196,6 +10300,18 @@ enabled by default on some platforms."),
      isn't another convenience variable of the same name.  */
   create_internalvar_type_lazy ("_siginfo", &siginfo_funcs, nullptr);
 
+  add_cmd ("stop-latency", class_maintenance, maintenance_info_stop_latency,
+	   _("\
+Show how long stopping all threads took, by number of threads.\n\
+Each time GDB has to interrupt running threads to present an all-stop\n\
+view of the program, it records how many it had to stop and how long\n\
+that took.  This command shows those times, grouped by thread count."),
+	   &maintenanceinfolist);
+
+  add_cmd ("stop-latency", class_maintenance, maintenance_flush_stop_latency,
+	   _("Forget the times shown by \"maint info stop-latency\"."),
+	   &maintenanceflushlist);
+
   add_setshow_boolean_cmd ("observer", no_class,
 			   &observer_mode_1, _("\
 Set whether gdb controls the inferior in observer mode."), _("\
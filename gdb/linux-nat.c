@@ -54,6 +54,7 @@
 #include <dirent.h>
 #include "xml-support.h"
 #include <sys/vfs.h>
+#include <sys/uio.h>
 #include "solib.h"
 #include "nat/linux-osdata.h"
 #include "linux-tdep.h"
@@ -69,7 +70,10 @@
 #include "gdbsupport/scope-exit.h"
 #include "gdbsupport/gdb-sigmask.h"
 #include "gdbsupport/common-debug.h"
+#include "nat/linux-process-vm.h"
 #include <unordered_map>
+#include <unordered_set>
+#include <deque>
 
 /* This comment documents high-level logic of this file.
 
@@ -242,6 +246,7 @@ static struct lwp_info *find_lwp_pid (ptid_t ptid);
 static int lwp_status_pending_p (struct lwp_info *lp);
 
 static void save_stop_reason (struct lwp_info *lp);
+static void linux_nat_filter_event (int lwpid, int status);
 
 static bool proc_mem_file_is_writable ();
 static void close_proc_mem_file (pid_t pid);
@@ -404,20 +409,6 @@ linux_nat_target::post_startup_inferior (ptid_t ptid)
   linux_init_ptrace_procfs (ptid.pid (), 0);
 }
 
-/* Return the number of known LWPs in the tgid given by PID.  */
-
-static int
-num_lwps (int pid)
-{
-  int count = 0;
-
-  for (const lwp_info *lp ATTRIBUTE_UNUSED : all_lwps ())
-    if (lp->ptid.pid () == pid)
-      count++;
-
-  return count;
-}
-
 /* Deleter for lwp_info unique_ptr specialisation.  */
 
 struct lwp_deleter
@@ -632,6 +623,12 @@ lwp_lwpid_htab_add_lwp (struct lwp_info *lp)
 
 static intrusive_list<lwp_info> lwp_list;
 
+/* Number of LWPs in LWP_LIST, keyed by tgid.  Kept up to date by
+   lwp_list_add and lwp_list_remove, so that num_lwps does not have to
+   walk the list each time a thread exits.  */
+
+static std::unordered_map<int, int> lwp_list_counts;
+
 /* See linux-nat.h.  */
 
 lwp_info_range
@@ -654,6 +651,7 @@ static void
 lwp_list_add (struct lwp_info *lp)
 {
   lwp_list.push_front (*lp);
+  lwp_list_counts[lp->ptid.pid ()]++;
 }
 
 /* Remove LP from sorted-by-reverse-creation-order doubly-linked
@@ -664,6 +662,20 @@ lwp_list_remove (struct lwp_info *lp)
 {
   /* Remove from sorted-by-creation-order list.  */
   lwp_list.erase (lwp_list.iterator_to (*lp));
+
+  auto it = lwp_list_counts.find (lp->ptid.pid ());
+  gdb_assert (it != lwp_list_counts.end () && it->second > 0);
+  if (--it->second == 0)
+    lwp_list_counts.erase (it);
+}
+
+/* Return the number of known LWPs in the tgid given by PID.  */
+
+static int
+num_lwps (int pid)
+{
+  auto it = lwp_list_counts.find (pid);
+  return it != lwp_list_counts.end () ? it->second : 0;
 }
 
 
@@ -860,6 +872,20 @@ struct lwp_info *
 iterate_over_lwps (ptid_t filter,
 		   gdb::function_view<iterate_over_lwps_ftype> callback)
 {
+  /* A filter naming a single LWP is common (e.g., infrun stopping or
+     resuming threads one by one on top of an always-non-stop target).
+     Look it up in the hash table rather than walking every LWP of
+     every process, which made stopping all threads quadratic in their
+     number.  */
+  if (filter.lwp_p ())
+    {
+      lwp_info *lp = find_lwp_pid (filter);
+
+      if (lp != nullptr && lp->ptid.matches (filter) && callback (lp) != 0)
+	return lp;
+      return nullptr;
+    }
+
   for (lwp_info *lp : all_lwps_safe ())
     {
       if (lp->ptid.matches (filter))
@@ -2174,6 +2200,22 @@ wait_lwp (struct lwp_info *lp)
   return status;
 }
 
+/* LWPs we sent a SIGSTOP to and whose stop we may not have collected
+   yet.  See reap_signalled_lwps.  */
+
+static std::vector<ptid_t> signalled_lwps;
+
+/* Return true if we no longer need to collect the stop of the LWP
+   with PTID, an entry of SIGNALLED_LWPS.  */
+
+static bool
+signalled_lwp_stale (ptid_t ptid)
+{
+  lwp_info *lp = find_lwp_pid (ptid);
+
+  return lp == nullptr || lp->stopped || !lp->signalled;
+}
+
 /* Send a SIGSTOP to LP.  */
 
 static int
@@ -2193,6 +2235,15 @@ stop_callback (struct lwp_info *lp)
 
       lp->signalled = 1;
       gdb_assert (lp->status == 0);
+
+      /* Stops are usually collected with wait_lwp in all-stop;
+	 don't let their entries pile up.  */
+      if (signalled_lwps.size () >= 2 * htab_elements (lwp_lwpid_htab))
+	signalled_lwps.erase (std::remove_if (signalled_lwps.begin (),
+					      signalled_lwps.end (),
+					      signalled_lwp_stale),
+			      signalled_lwps.end ());
+      signalled_lwps.push_back (lp->ptid);
     }
 
   return 0;
@@ -2774,6 +2825,122 @@ resumed_callback (struct lwp_info *lp)
   return lp->resumed;
 }
 
+/* LWPs whose events linux_nat_wait_1 pulled out of the kernel, in
+   the order they arrived.  Entries may go stale (the event was
+   reported, discarded, or the LWP is gone); they are dropped lazily.
+   When GDB stops all threads of a non-stop target, every stop is
+   reported by a separate target_wait call; taking the next event from
+   here instead of scanning every LWP for one keeps that linear in the
+   number of threads.  */
+
+static std::deque<ptid_t> lwp_event_queue;
+
+/* Append LWPID to LWP_EVENT_QUEUE if linux_nat_filter_event left it
+   with an event to report.  The queue is only drained on non-stop
+   targets, see find_event_lwp, so nothing is queued otherwise.  */
+
+static void
+queue_lwp_event (pid_t lwpid)
+{
+  if (!target_is_non_stop_p ())
+    return;
+
+  lwp_info *lp = find_lwp_pid (ptid_t (lwpid));
+
+  if (lp != nullptr && lwp_status_pending_p (lp))
+    lwp_event_queue.push_back (lp->ptid);
+}
+
+/* Collect the stops of the LWPs in SIGNALLED_LWPS that have already
+   stopped, waiting for each by its LWP id.  waitpid (-1, ...) has to
+   look through every traced child in the kernel, so pulling the stops
+   of thousands of threads out of it one at a time is quadratic;
+   waiting for a specific LWP is not.  Whatever is left is still
+   picked up by the waitpid (-1, ...) loop in linux_nat_wait_1.  */
+
+static void
+reap_signalled_lwps ()
+{
+  /* linux_nat_filter_event may request more stops.  */
+  std::vector<ptid_t> pending = std::move (signalled_lwps);
+  signalled_lwps.clear ();
+
+  for (ptid_t ptid : pending)
+    {
+      /* Already collected some other way.  */
+      if (signalled_lwp_stale (ptid))
+	continue;
+
+      int status;
+      pid_t lwpid = my_waitpid (ptid.lwp (), &status, __WALL | WNOHANG);
+
+      if (lwpid == 0)
+	signalled_lwps.push_back (ptid);
+      else if (lwpid > 0)
+	{
+	  linux_nat_debug_printf ("waitpid %ld received %s",
+				  (long) lwpid,
+				  status_to_str (status).c_str ());
+
+	  linux_nat_filter_event (lwpid, status);
+	  queue_lwp_event (lwpid);
+	}
+    }
+}
+
+/* Return the oldest LWP in LWP_EVENT_QUEUE matching FILTER that has
+   an event to report, or NULL if there is none.  The entry stays
+   queued until its event is consumed.  */
+
+static lwp_info *
+find_queued_event_lwp (ptid_t filter)
+{
+  for (auto it = lwp_event_queue.begin (); it != lwp_event_queue.end (); )
+    {
+      lwp_info *lp = find_lwp_pid (*it);
+
+      /* status_callback may discard the event.  */
+      if (lp != nullptr
+	  && lwp_status_pending_p (lp)
+	  && lp->ptid.matches (filter)
+	  && status_callback (lp))
+	return lp;
+
+      if (lp == nullptr || !lwp_status_pending_p (lp))
+	it = lwp_event_queue.erase (it);
+      else
+	++it;
+    }
+
+  return nullptr;
+}
+
+/* Find an LWP matching FILTER with a pending event to report.  Set
+   *QUEUED if it was taken from LWP_EVENT_QUEUE, in which case the
+   caller need not pick among all LWPs with events to avoid starvation:
+   the queue is already first-in, first-out.  */
+
+static lwp_info *
+find_event_lwp (ptid_t filter, bool *queued)
+{
+  /* In all-stop, select_event_lwp must still get to prefer the LWP
+     being single-stepped, so don't bypass it.  */
+  if (target_is_non_stop_p ())
+    {
+      lwp_info *lp = find_queued_event_lwp (filter);
+      if (lp != nullptr)
+	{
+	  *queued = true;
+	  return lp;
+	}
+    }
+  else
+    lwp_event_queue.clear ();
+
+  *queued = false;
+  return iterate_over_lwps (filter, status_callback);
+}
+
 /* Check if we should go on and pass this event to common code.
 
    If so, save the status to the lwp_info structure associated to LWPID.  */
@@ -3153,7 +3320,8 @@ linux_nat_wait_1 (ptid_t ptid, struct target_waitstatus *ourstatus,
   block_child_signals (&prev_mask);
 
   /* First check if there is a LWP with a wait status pending.  */
-  lp = iterate_over_lwps (ptid, status_callback);
+  bool queued;
+  lp = find_event_lwp (ptid, &queued);
   if (lp != NULL)
     {
       linux_nat_debug_printf ("Using pending wait status %s for %s.",
@@ -3165,10 +3333,19 @@ linux_nat_wait_1 (ptid_t ptid, struct target_waitstatus *ourstatus,
      pull all events out of the kernel.  We'll randomly select an
      event LWP out of all that have events, to prevent starvation.  */
 
+  bool reap_signalled = true;
   while (lp == NULL)
     {
       pid_t lwpid;
 
+      /* Collect the stops we requested first; see
+	 reap_signalled_lwps.  */
+      if (reap_signalled)
+	{
+	  reap_signalled_lwps ();
+	  reap_signalled = false;
+	}
+
       /* Always use -1 and WNOHANG, due to couple of a kernel/ptrace
 	 quirks:
 
@@ -3196,6 +3373,8 @@ linux_nat_wait_1 (ptid_t ptid, struct target_waitstatus *ourstatus,
 				  status_to_str (status).c_str ());
 
 	  linux_nat_filter_event (lwpid, status);
+	  queue_lwp_event (lwpid);
+
 	  /* Retry until nothing comes out of waitpid.  A single
 	     SIGCHLD can indicate more than one child stopped.  */
 	  continue;
@@ -3211,7 +3390,7 @@ linux_nat_wait_1 (ptid_t ptid, struct target_waitstatus *ourstatus,
 
       /* ... and find an LWP with a status to report to the core, if
 	 any.  */
-      lp = iterate_over_lwps (ptid, status_callback);
+      lp = find_event_lwp (ptid, &queued);
       if (lp != NULL)
 	break;
 
@@ -3247,6 +3426,7 @@ linux_nat_wait_1 (ptid_t ptid, struct target_waitstatus *ourstatus,
 
       /* Block until we get an event reported with SIGCHLD.  */
       wait_for_signal ();
+      reap_signalled = true;
     }
 
   gdb_assert (lp);
@@ -3267,7 +3447,7 @@ linux_nat_wait_1 (ptid_t ptid, struct target_waitstatus *ourstatus,
   /* If we're not waiting for a specific LWP, choose an event LWP from
      among those that have had events.  Giving equal priority to all
      LWPs that have had events helps prevent starvation.  */
-  if (ptid == minus_one_ptid || ptid.is_pid ())
+  if ((ptid == minus_one_ptid || ptid.is_pid ()) && !queued)
     select_event_lwp (ptid, &lp, &status);
 
   gdb_assert (lp != NULL);
@@ -3434,8 +3614,10 @@ linux_nat_target::wait (ptid_t ptid, struct target_waitstatus *ourstatus,
      interested in reporting the event (target_wait on a
      specific_process, for example, see linux_nat_wait_1), and
      meanwhile the event became uninteresting.  Don't bother resuming
-     LWPs we're not going to wait for if they'd stop immediately.  */
-  if (target_is_non_stop_p ())
+     LWPs we're not going to wait for if they'd stop immediately.
+     Skip this while there's a queued event to report; linux_nat_wait_1
+     does it too once it runs out of events.  */
+  if (target_is_non_stop_p () && find_queued_event_lwp (ptid) == nullptr)
     iterate_over_lwps (minus_one_ptid,
 		       [=] (struct lwp_info *info)
 		       {
@@ -3696,6 +3878,12 @@ linux_proc_xfer_memory_partial (int pid, gdb_byte *readbuf,
 				const gdb_byte *writebuf, ULONGEST offset,
 				LONGEST len, ULONGEST *xfered_len);
 
+static enum target_xfer_status
+linux_process_vm_xfer_memory_partial (int pid, gdb_byte *readbuf,
+				      const gdb_byte *writebuf,
+				      ULONGEST offset, LONGEST len,
+				      ULONGEST *xfered_len);
+
 enum target_xfer_status
 linux_nat_target::xfer_partial (enum target_object object,
 				const char *annex, gdb_byte *readbuf,
@@ -3742,12 +3930,129 @@ linux_nat_target::xfer_partial (enum target_object object,
 	return linux_proc_xfer_memory_partial (inferior_ptid.pid (), readbuf,
 					       writebuf, offset, len,
 					       xfered_len);
+
+      /* Otherwise, try process_vm_readv/writev before falling back to
+	 PTRACE_PEEKTEXT/PTRACE_POKETEXT, which need a system call per
+	 word.  process_vm_writev can't write to read-only mappings,
+	 such as the code where breakpoints are inserted; ptrace
+	 handles those.  */
+      enum target_xfer_status status
+	= linux_process_vm_xfer_memory_partial (inferior_ptid.pid (),
+						readbuf, writebuf, offset,
+						len, xfered_len);
+      if (status == TARGET_XFER_OK)
+	return status;
     }
 
   return inf_ptrace_target::xfer_partial (object, annex, readbuf, writebuf,
 					  offset, len, xfered_len);
 }
 
+/* Set if process_vm_readv and process_vm_writev are not available in
+   this kernel.  */
+
+static bool process_vm_unsupported = false;
+
+/* The processes for which process_vm_readv and process_vm_writev are
+   not allowed.  Like proc_mem_file_map, this is keyed by process id,
+   and a process is removed from it when it exits or execs.  */
+
+static std::unordered_set<int> process_vm_denied_pids;
+
+/* Return true if process_vm_readv and process_vm_writev may be used
+   to access the memory of process PID, which the current inferior
+   belongs to.  Unlike /proc/PID/mem, they do not stick to one address
+   space.  If a running thread execs, they may access the new one, so
+   only use them while everything is stopped.  */
+
+static bool
+process_vm_usable_p (int pid)
+{
+  return (!process_vm_unsupported
+	  && inferior_ptid != null_ptid
+	  && !threads_are_executing (linux_target)
+	  && process_vm_denied_pids.count (pid) == 0);
+}
+
+/* Record that a process_vm_readv or process_vm_writev call for PID
+   failed with errno.  */
+
+static void
+process_vm_failed (int pid)
+{
+  linux_nat_debug_printf ("process_vm_readv/writev for pid %d failed: %s (%d)",
+			  pid, safe_strerror (errno), errno);
+  if (linux_process_vm_unsupported_errno (errno))
+    process_vm_unsupported = true;
+  else if (linux_process_vm_denied_errno (errno))
+    process_vm_denied_pids.insert (pid);
+}
+
+/* Implement the to_xfer_partial target method for memory with
+   process_vm_readv or process_vm_writev, for when /proc/PID/mem can't
+   be used.  Like /proc/PID/mem, this transfers the whole range with a
+   single system call.  */
+
+static enum target_xfer_status
+linux_process_vm_xfer_memory_partial (int pid, gdb_byte *readbuf,
+				      const gdb_byte *writebuf,
+				      ULONGEST offset, LONGEST len,
+				      ULONGEST *xfered_len)
+{
+  if (!process_vm_usable_p (pid))
+    return TARGET_XFER_E_IO;
+
+  ssize_t ret = (readbuf != nullptr
+		 ? linux_process_vm_read (pid, offset, readbuf, len)
+		 : linux_process_vm_write (pid, offset, writebuf, len));
+  if (ret <= 0)
+    {
+      if (ret == -1)
+	process_vm_failed (pid);
+      return TARGET_XFER_E_IO;
+    }
+
+  *xfered_len = ret;
+  return TARGET_XFER_OK;
+}
+
+/* Implement the "read_memory_vec" target_ops method, with
+   process_vm_readv, which reads many ranges in a single system
+   call.  */
+
+ULONGEST
+linux_nat_target::read_memory_vec
+  (gdb::array_view<const memory_read_range> ranges)
+{
+  int pid = inferior_ptid.pid ();
+
+  if (!process_vm_usable_p (pid))
+    return 0;
+
+  int addr_bit = gdbarch_addr_bit (current_inferior ()->arch ());
+
+  /* Mask the addresses like xfer_partial does, if they need it.  */
+  std::vector<memory_read_range> masked;
+  if (addr_bit < (sizeof (ULONGEST) * HOST_CHAR_BIT))
+    {
+      ULONGEST addr_mask = ((ULONGEST) 1 << addr_bit) - 1;
+
+      masked.assign (ranges.begin (), ranges.end ());
+      for (memory_read_range &range : masked)
+	range.addr &= addr_mask;
+      ranges = masked;
+    }
+
+  ssize_t done = linux_process_vm_read_ranges (pid, ranges);
+  if (done == -1)
+    {
+      process_vm_failed (pid);
+      return 0;
+    }
+
+  return done;
+}
+
 bool
 linux_nat_target::thread_alive (ptid_t ptid)
 {
@@ -3869,12 +4174,14 @@ class proc_mem_file
    memory.  */
 static std::unordered_map<int, proc_mem_file> proc_mem_file_map;
 
-/* Close the /proc/PID/mem file for PID.  */
+/* Close the /proc/PID/mem file for PID, and forget whether
+   process_vm_readv and process_vm_writev are allowed for it.  */
 
 static void
 close_proc_mem_file (pid_t pid)
 {
   proc_mem_file_map.erase (pid);
+  process_vm_denied_pids.erase (pid);
 }
 
 /* Open the /proc/PID/mem file for the process (thread group) of PTID.
@@ -3982,7 +4289,15 @@ linux_proc_xfer_memory_partial (int pid, gdb_byte *readbuf,
 {
   auto iter = proc_mem_file_map.find (pid);
   if (iter == proc_mem_file_map.end ())
-    return TARGET_XFER_EOF;
+    {
+      /* Opening the file failed.  Try process_vm_readv/writev, which
+	 do their own permission checks, before giving up.  */
+      if (linux_process_vm_xfer_memory_partial (pid, readbuf, writebuf,
+						offset, len, xfered_len)
+	  == TARGET_XFER_OK)
+	return TARGET_XFER_OK;
+      return TARGET_XFER_EOF;
+    }
 
   int fd = iter->second.fd ();
 
@@ -2602,6 +2602,89 @@ linux_displaced_step_location (struct gdbarch *gdbarch)
   return addr;
 }
 
+/* The smallest page size the inferior's executable may be mapped
+   with.  */
+
+static constexpr CORE_ADDR linux_min_page_size = 4096;
+
+/* Find memory that the displaced stepping buffers of INF can grow into,
+   when many threads need to step over breakpoints at the same time.
+   This is the end of the last page of the main executable's code
+   segment, past the segment itself: it is mapped executable, but the
+   program never accesses it.  Return true and set *ADDR and *LEN if
+   such memory exists.  */
+
+static bool
+linux_displaced_step_reserve (inferior *inf, CORE_ADDR *addr, ULONGEST *len)
+{
+  objfile *objf = inf->pspace->symfile_object_file;
+  if (objf == nullptr)
+    return false;
+
+  bfd *abfd = objf->obfd.get ();
+  long phdrs_size = bfd_get_elf_phdr_upper_bound (abfd);
+  if (phdrs_size == -1)
+    return false;
+
+  gdb::unique_xmalloc_ptr<Elf_Internal_Phdr>
+    phdrs ((Elf_Internal_Phdr *) xmalloc (phdrs_size));
+  int num_phdrs = bfd_get_elf_phdrs (abfd, phdrs.get ());
+  if (num_phdrs == -1)
+    return false;
+
+  /* Only trust the program headers if they describe the program that is
+     running.  */
+  CORE_ADDR entry;
+  CORE_ADDR offset = objf->text_section_offset ();
+  CORE_ADDR file_entry = bfd_get_start_address (abfd);
+  if (target_auxv_search (AT_ENTRY, &entry) <= 0
+      || entry != file_entry + offset)
+    return false;
+
+  const Elf_Internal_Phdr *text = nullptr;
+  for (int i = 0; i < num_phdrs; i++)
+    {
+      const Elf_Internal_Phdr &phdr = phdrs.get ()[i];
+
+      if (phdr.p_type == PT_LOAD
+	  && (phdr.p_flags & PF_X) != 0
+	  && file_entry >= phdr.p_vaddr
+	  && file_entry - phdr.p_vaddr < phdr.p_memsz)
+	{
+	  text = &phdr;
+	  break;
+	}
+    }
+
+  if (text == nullptr)
+    return false;
+
+  CORE_ADDR start = text->p_vaddr + text->p_memsz;
+  CORE_ADDR end = align_up (start, linux_min_page_size);
+
+  /* Don't step on another segment sharing the last page.  */
+  for (int i = 0; i < num_phdrs; i++)
+    {
+      const Elf_Internal_Phdr &phdr = phdrs.get ()[i];
+
+      if (phdr.p_type == PT_LOAD
+	  && phdr.p_vaddr + phdr.p_memsz > start
+	  && phdr.p_vaddr < end)
+	{
+	  if (phdr.p_vaddr < start)
+	    return false;
+	  end = phdr.p_vaddr;
+	}
+    }
+
+  if (end <= start)
+    return false;
+
+  *addr = start + offset;
+  *len = end - start;
+  return true;
+}
+
 /* See linux-tdep.h.  */
 
 displaced_step_prepare_status
@@ -2626,6 +2709,18 @@ linux_displaced_step_prepare (gdbarch *arch, thread_info *thread,
 	buffers.push_back (disp_step_buf_addr + i * buf_len);
 
       per_inferior->disp_step_bufs.emplace (buffers);
+
+      CORE_ADDR reserve_addr;
+      ULONGEST reserve_len;
+      if (linux_displaced_step_reserve (thread->inf, &reserve_addr,
+					&reserve_len))
+	{
+	  displaced_debug_printf ("%s bytes reserved for more buffers at %s",
+				  pulongest (reserve_len),
+				  paddress (arch, reserve_addr));
+	  per_inferior->disp_step_bufs->set_reserve (reserve_addr, reserve_len,
+						     buf_len);
+	}
     }
 
   return per_inferior->disp_step_bufs->prepare (thread, displaced_pc);
@@ -42,6 +42,7 @@
 #include "gdbsupport/selftest.h"
 #include "inferior.h"
 #include "gdbsupport/thread-pool.h"
+#include "gdbsupport/parallel-for.h"
 
 #include "cli/cli-decode.h"
 #include "cli/cli-utils.h"
@@ -889,6 +890,14 @@ maintenance_show_worker_threads (struct ui_file *file, int from_tty,
 	      report_threads);
 }
 
+static void
+maintenance_show_parallel_for_debug (struct ui_file *file, int from_tty,
+				     struct cmd_list_element *c,
+				     const char *value)
+{
+  gdb_printf (file, _("Debugging of parallel for loops is %s.\n"), value);
+}
+
 
 /* If true, display time usage both at startup and for each command.  */
 
@@ -1458,6 +1467,18 @@ such as demangling symbol names."),
 				       &maintenance_set_cmdlist,
 				       &maintenance_show_cmdlist);
 
+  add_setshow_boolean_cmd ("parallel-for-debug", class_maintenance,
+			   &gdb::parallel_for_each_debug, _("\
+Set whether to print debug output about parallel for loops."), _("\
+Show whether to print debug output about parallel for loops."), _("\
+When enabled, GDB prints how the work of parallel for loops, such as\n\
+DWARF indexing, is distributed across the worker threads, including\n\
+the time taken by each chunk of work."),
+			   nullptr,
+			   maintenance_show_parallel_for_debug,
+			   &maintenance_set_cmdlist,
+			   &maintenance_show_cmdlist);
+
   /* Add the "maint set/show selftest" commands.  */
   static cmd_list_element *set_selftest_cmdlist = nullptr;
   static cmd_list_element *show_selftest_cmdlist = nullptr;
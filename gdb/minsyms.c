@@ -55,6 +55,7 @@
 #include "gdbsupport/gdb-safe-ctype.h"
 #include "gdbsupport/parallel-for.h"
 #include "inferior.h"
+#include "dwarf2/demangled-names-cache.h"
 
 #if CXX_STD_THREAD
 #include <mutex>
@@ -190,38 +191,97 @@ msymbol_hash (const char *string)
   return hash;
 }
 
-/* Add the minimal symbol SYM to an objfile's minsym hash table, TABLE.  */
-static void
-add_minsym_to_hash_table (struct minimal_symbol *sym,
-			  struct minimal_symbol **table,
-			  unsigned int hash_value)
+/* Tables with fewer entries than this are built as a single shard, by
+   the calling thread.  */
+
+#define MINSYM_HASH_SHARD_THRESHOLD 8192
+
+/* See objfiles.h.  */
+
+void
+minimal_symbol_hash_table::build
+     (minimal_symbol *symbols, size_t count,
+      gdb::function_view<bool (size_t, unsigned int *)> get_hash)
 {
-  if (sym->hash_next == NULL)
+  gdb_assert (count < empty_slot);
+
+  m_symbols = symbols;
+  m_shards.clear ();
+  m_slots.clear ();
+
+  /* Gather the entries, highest index first: a symbol that is found
+     first by a lookup is the one that was added last, as it was when
+     the table used chaining.  */
+  std::vector<slot> entries;
+  entries.reserve (count);
+  for (size_t i = count; i > 0; --i)
     {
-      unsigned int hash = hash_value % MINIMAL_SYMBOL_HASH_SIZE;
+      unsigned int hash;
 
-      sym->hash_next = table[hash];
-      table[hash] = sym;
+      if (get_hash (i - 1, &hash))
+	entries.push_back ({hash, (uint32_t) (i - 1)});
     }
-}
 
-/* Add the minimal symbol SYM to an objfile's minsym demangled hash table,
-   TABLE.  */
-static void
-add_minsym_to_demangled_hash_table (struct minimal_symbol *sym,
-				    struct objfile *objfile,
-				    unsigned int hash_value)
-{
-  if (sym->demangled_hash_next == NULL)
-    {
-      objfile->per_bfd->demangled_hash_languages.set (sym->language ());
+  if (entries.empty ())
+    return;
 
-      struct minimal_symbol **table
-	= objfile->per_bfd->msymbol_demangled_hash;
-      unsigned int hash_index = hash_value % MINIMAL_SYMBOL_HASH_SIZE;
-      sym->demangled_hash_next = table[hash_index];
-      table[hash_index] = sym;
+  /* Aim for shards of a few thousand entries each, so that they can be
+     filled in parallel.  */
+  m_shard_bits = 0;
+  if (entries.size () >= MINSYM_HASH_SHARD_THRESHOLD)
+    while (m_shard_bits < 8
+	   && ((entries.size () >> m_shard_bits)
+	       > MINSYM_HASH_SHARD_THRESHOLD / 2))
+      ++m_shard_bits;
+  size_t nshards = (size_t) 1 << m_shard_bits;
+
+  /* Distribute the entries among the shards, keeping their order.  */
+  std::vector<size_t> first (nshards + 1, 0);
+  for (const slot &e : entries)
+    ++first[shard_of (mix (e.hash)) + 1];
+  for (size_t i = 0; i < nshards; ++i)
+    first[i + 1] += first[i];
+
+  std::vector<slot> sorted (entries.size ());
+  std::vector<size_t> fill (first.begin (), first.end () - 1);
+  for (const slot &e : entries)
+    sorted[fill[shard_of (mix (e.hash))]++] = e;
+
+  /* Give each shard at least twice as many slots as it has entries, so
+     that probe sequences stay short.  */
+  m_shards.resize (nshards);
+  size_t total = 0;
+  for (size_t i = 0; i < nshards; ++i)
+    {
+      size_t n = first[i + 1] - first[i];
+      size_t size = 4;
+      while (size < 2 * n)
+	size *= 2;
+
+      m_shards[i].start = total;
+      m_shards[i].mask = size - 1;
+      total += size;
     }
+  m_slots.resize (total, {0, empty_slot});
+
+  gdb::parallel_for_each (1, (size_t) 0, nshards,
+			  [&] (size_t begin, size_t end)
+    {
+      for (size_t s = begin; s < end; ++s)
+	{
+	  const shard &sh = m_shards[s];
+
+	  for (size_t j = first[s]; j < first[s + 1]; ++j)
+	    {
+	      const slot &e = sorted[j];
+	      uint32_t i = mix (e.hash) & sh.mask;
+
+	      while (m_slots[sh.start + i].index != empty_slot)
+		i = (i + 1) & sh.mask;
+	      m_slots[sh.start + i] = e;
+	    }
+	}
+    });
 }
 
 /* Worker object for lookup_minimal_symbol.  Stores temporary results
@@ -291,6 +351,36 @@ found_minimal_symbols::maybe_collect (const char *sfile,
   return false;
 }
 
+/* See objfiles.h.  */
+
+void
+minimal_symbol_address_index::build (const minimal_symbol *symbols,
+				     size_t count)
+{
+  gdb_assert (count < UINT32_MAX);
+
+  m_addrs.resize (count + 1);
+  m_positions.resize (count + 1);
+  fill (symbols, 0, 1);
+}
+
+/* See objfiles.h.  */
+
+size_t
+minimal_symbol_address_index::fill (const minimal_symbol *symbols,
+				    size_t next, size_t k)
+{
+  /* An in-order walk of the tree visits the nodes in sorted order.  */
+  if (k < m_addrs.size ())
+    {
+      next = fill (symbols, next, 2 * k);
+      m_addrs[k] = symbols[next].unrelocated_address ();
+      m_positions[k] = next;
+      next = fill (symbols, next + 1, 2 * k + 1);
+    }
+  return next;
+}
+
 /* Walk the mangled name hash table, and pass each symbol whose name
    matches LOOKUP_NAME according to NAMECMP to FOUND.  */
 
@@ -298,21 +388,18 @@ static void
 lookup_minimal_symbol_mangled (const char *lookup_name,
 			       const char *sfile,
 			       struct objfile *objfile,
-			       struct minimal_symbol **table,
+			       const minimal_symbol_hash_table &table,
 			       unsigned int hash,
 			       int (*namecmp) (const char *, const char *),
 			       found_minimal_symbols &found)
 {
-  for (minimal_symbol *msymbol = table[hash];
-       msymbol != NULL;
-       msymbol = msymbol->hash_next)
+  table.find (hash, [&] (minimal_symbol *msymbol)
     {
       const char *symbol_name = msymbol->linkage_name ();
 
-      if (namecmp (symbol_name, lookup_name) == 0
-	  && found.maybe_collect (sfile, objfile, msymbol))
-	return;
-    }
+      return (namecmp (symbol_name, lookup_name) == 0
+	      && found.maybe_collect (sfile, objfile, msymbol));
+    });
 }
 
 /* Walk the demangled name hash table, and pass each symbol whose name
@@ -322,21 +409,18 @@ static void
 lookup_minimal_symbol_demangled (const lookup_name_info &lookup_name,
 				 const char *sfile,
 				 struct objfile *objfile,
-				 struct minimal_symbol **table,
+				 const minimal_symbol_hash_table &table,
 				 unsigned int hash,
 				 symbol_name_matcher_ftype *matcher,
 				 found_minimal_symbols &found)
 {
-  for (minimal_symbol *msymbol = table[hash];
-       msymbol != NULL;
-       msymbol = msymbol->demangled_hash_next)
+  table.find (hash, [&] (minimal_symbol *msymbol)
     {
       const char *symbol_name = msymbol->search_name ();
 
-      if (matcher (symbol_name, lookup_name, NULL)
-	  && found.maybe_collect (sfile, objfile, msymbol))
-	return;
-    }
+      return (matcher (symbol_name, lookup_name, NULL)
+	      && found.maybe_collect (sfile, objfile, msymbol));
+    });
 }
 
 /* Look through all the current minimal symbol tables and find the
@@ -365,7 +449,7 @@ lookup_minimal_symbol (const char *name, const char *sfile,
 {
   found_minimal_symbols found;
 
-  unsigned int mangled_hash = msymbol_hash (name) % MINIMAL_SYMBOL_HASH_SIZE;
+  unsigned int mangled_hash = msymbol_hash (name);
 
   auto *mangled_cmp
     = (case_sensitivity == case_sensitive_on
@@ -406,14 +490,12 @@ lookup_minimal_symbol (const char *name, const char *sfile,
 		    continue;
 		  enum language lang = (enum language) iter;
 
-		  unsigned int hash
-		    = (lookup_name.search_name_hash (lang)
-		       % MINIMAL_SYMBOL_HASH_SIZE);
+		  unsigned int hash = lookup_name.search_name_hash (lang);
 
 		  symbol_name_matcher_ftype *match
 		    = language_def (lang)->get_symbol_name_matcher
 							(lookup_name);
-		  struct minimal_symbol **msymbol_demangled_hash
+		  const minimal_symbol_hash_table &msymbol_demangled_hash
 		    = objfile->per_bfd->msymbol_demangled_hash;
 
 		  lookup_minimal_symbol_demangled (lookup_name, sfile, objfile,
@@ -527,20 +609,21 @@ iterate_over_minimal_symbols
   /* The first pass is over the ordinary hash table.  */
     {
       const char *name = linkage_name_str (lookup_name);
-      unsigned int hash = msymbol_hash (name) % MINIMAL_SYMBOL_HASH_SIZE;
+      unsigned int hash = msymbol_hash (name);
       auto *mangled_cmp
 	= (case_sensitivity == case_sensitive_on
 	   ? strcmp
 	   : strcasecmp);
+      bool stop = false;
 
-      for (minimal_symbol *iter = objf->per_bfd->msymbol_hash[hash];
-	   iter != NULL;
-	   iter = iter->hash_next)
+      objf->per_bfd->msymbol_hash.find (hash, [&] (minimal_symbol *iter)
 	{
-	  if (mangled_cmp (iter->linkage_name (), name) == 0)
-	    if (callback (iter))
-	      return;
-	}
+	  stop = (mangled_cmp (iter->linkage_name (), name) == 0
+		  && callback (iter));
+	  return stop;
+	});
+      if (stop)
+	return;
     }
 
   /* The second pass is over the demangled table.  Once for each
@@ -556,14 +639,18 @@ iterate_over_minimal_symbols
       symbol_name_matcher_ftype *name_match
 	= lang_def->get_symbol_name_matcher (lookup_name);
 
-      unsigned int hash
-	= lookup_name.search_name_hash (lang) % MINIMAL_SYMBOL_HASH_SIZE;
-      for (minimal_symbol *iter = objf->per_bfd->msymbol_demangled_hash[hash];
-	   iter != NULL;
-	   iter = iter->demangled_hash_next)
-	if (name_match (iter->search_name (), lookup_name, NULL))
-	  if (callback (iter))
-	    return;
+      unsigned int hash = lookup_name.search_name_hash (lang);
+      bool stop = false;
+
+      objf->per_bfd->msymbol_demangled_hash.find (hash,
+						  [&] (minimal_symbol *iter)
+	{
+	  stop = (name_match (iter->search_name (), lookup_name, NULL)
+		  && callback (iter));
+	  return stop;
+	});
+      if (stop)
+	return;
     }
 }
 
@@ -572,19 +659,22 @@ iterate_over_minimal_symbols
 bound_minimal_symbol
 lookup_minimal_symbol_linkage (const char *name, struct objfile *objf)
 {
-  unsigned int hash = msymbol_hash (name) % MINIMAL_SYMBOL_HASH_SIZE;
+  unsigned int hash = msymbol_hash (name);
 
   for (objfile *objfile : objf->separate_debug_objfiles ())
     {
-      for (minimal_symbol *msymbol = objfile->per_bfd->msymbol_hash[hash];
-	   msymbol != NULL;
-	   msymbol = msymbol->hash_next)
+      minimal_symbol *found = nullptr;
+
+      objfile->per_bfd->msymbol_hash.find (hash, [&] (minimal_symbol *msymbol)
 	{
 	  if (strcmp (msymbol->linkage_name (), name) == 0
 	      && (msymbol->type () == mst_data
 		  || msymbol->type () == mst_bss))
-	    return {msymbol, objfile};
-	}
+	    found = msymbol;
+	  return found != nullptr;
+	});
+      if (found != nullptr)
+	return {found, objfile};
     }
 
   return {};
@@ -617,11 +707,10 @@ lookup_minimal_symbol_linkage (const char *name, bool only_main)
 struct bound_minimal_symbol
 lookup_minimal_symbol_text (const char *name, struct objfile *objf)
 {
-  struct minimal_symbol *msymbol;
   struct bound_minimal_symbol found_symbol;
   struct bound_minimal_symbol found_file_symbol;
 
-  unsigned int hash = msymbol_hash (name) % MINIMAL_SYMBOL_HASH_SIZE;
+  unsigned int hash = msymbol_hash (name);
 
   for (objfile *objfile : current_program_space->objfiles ())
     {
@@ -631,9 +720,8 @@ lookup_minimal_symbol_text (const char *name, struct objfile *objf)
       if (objf == NULL || objf == objfile
 	  || objf == objfile->separate_debug_objfile_backlink)
 	{
-	  for (msymbol = objfile->per_bfd->msymbol_hash[hash];
-	       msymbol != NULL && found_symbol.minsym == NULL;
-	       msymbol = msymbol->hash_next)
+	  objfile->per_bfd->msymbol_hash.find (hash,
+					       [&] (minimal_symbol *msymbol)
 	    {
 	      if (strcmp (msymbol->linkage_name (), name) == 0 &&
 		  (msymbol->type () == mst_text
@@ -652,7 +740,8 @@ lookup_minimal_symbol_text (const char *name, struct objfile *objf)
 		      break;
 		    }
 		}
-	    }
+	      return found_symbol.minsym != NULL;
+	    });
 	}
     }
   /* External symbols are best.  */
@@ -669,23 +758,25 @@ struct minimal_symbol *
 lookup_minimal_symbol_by_pc_name (CORE_ADDR pc, const char *name,
 				  struct objfile *objf)
 {
-  struct minimal_symbol *msymbol;
-
-  unsigned int hash = msymbol_hash (name) % MINIMAL_SYMBOL_HASH_SIZE;
+  unsigned int hash = msymbol_hash (name);
 
   for (objfile *objfile : current_program_space->objfiles ())
     {
       if (objf == NULL || objf == objfile
 	  || objf == objfile->separate_debug_objfile_backlink)
 	{
-	  for (msymbol = objfile->per_bfd->msymbol_hash[hash];
-	       msymbol != NULL;
-	       msymbol = msymbol->hash_next)
+	  minimal_symbol *found = nullptr;
+
+	  objfile->per_bfd->msymbol_hash.find (hash,
+					       [&] (minimal_symbol *msymbol)
 	    {
 	      if (msymbol->value_address (objfile) == pc
 		  && strcmp (msymbol->linkage_name (), name) == 0)
-		return msymbol;
-	    }
+		found = msymbol;
+	      return found != nullptr;
+	    });
+	  if (found != nullptr)
+	    return found;
 	}
     }
 
@@ -747,9 +838,7 @@ lookup_minimal_symbol_by_pc_section (CORE_ADDR pc_in, struct obj_section *sectio
 				     lookup_msym_prefer prefer,
 				     bound_minimal_symbol *previous)
 {
-  int lo;
   int hi;
-  int newobj;
   struct minimal_symbol *msymbol;
   struct minimal_symbol *best_symbol = NULL;
   struct objfile *best_objfile = NULL;
@@ -793,54 +882,26 @@ lookup_minimal_symbol_by_pc_section (CORE_ADDR pc_in, struct obj_section *sectio
 	  int best_zero_sized = -1;
 
 	  msymbol = objfile->per_bfd->msymbols.get ();
-	  lo = 0;
-	  hi = objfile->per_bfd->minimal_symbol_count - 1;
-
-	  /* This code assumes that the minimal symbols are sorted by
-	     ascending address values.  If the pc value is greater than or
-	     equal to the first symbol's address, then some symbol in this
-	     minimal symbol table is a suitable candidate for being the
-	     "best" symbol.  This includes the last real symbol, for cases
-	     where the pc value is larger than any address in this vector.
-
-	     By iterating until the address associated with the current
-	     hi index (the endpoint of the test interval) is less than
-	     or equal to the desired pc value, we accomplish two things:
-	     (1) the case where the pc value is larger than any minimal
-	     symbol address is trivially solved, (2) the address associated
-	     with the hi index is always the one we want when the iteration
-	     terminates.  In essence, we are iterating the test interval
-	     down until the pc value is pushed out of it from the high end.
-
-	     Warning: this code is trickier than it would appear at first.  */
+
+	  /* If the pc value is greater than or equal to the first
+	     symbol's address, then some symbol in this minimal symbol
+	     table is a suitable candidate for being the "best" symbol.
+	     This includes the last real symbol, for cases where the pc
+	     value is larger than any address in this vector.
+
+	     Start from the last symbol at or before the pc value.  If
+	     there are several symbols at that address, the index gives
+	     the last one.  That way we can find the right symbol if it
+	     has an index greater than the first one.  */
 
 	  unrelocated_addr unrel_pc;
-	  if (frob_address (objfile, pc, &unrel_pc)
-	      && unrel_pc >= msymbol[lo].unrelocated_address ())
-	    {
-	      while (msymbol[hi].unrelocated_address () > unrel_pc)
-		{
-		  /* pc is still strictly less than highest address.  */
-		  /* Note "new" will always be >= lo.  */
-		  newobj = (lo + hi) / 2;
-		  if ((msymbol[newobj].unrelocated_address () >= unrel_pc)
-		      || (lo == newobj))
-		    {
-		      hi = newobj;
-		    }
-		  else
-		    {
-		      lo = newobj;
-		    }
-		}
+	  if (frob_address (objfile, pc, &unrel_pc))
+	    hi = objfile->per_bfd->msymbol_address_index.find (unrel_pc);
+	  else
+	    hi = -1;
 
-	      /* If we have multiple symbols at the same address, we want
-		 hi to point to the last one.  That way we can find the
-		 right symbol if it has an index greater than hi.  */
-	      while (hi < objfile->per_bfd->minimal_symbol_count - 1
-		     && (msymbol[hi].unrelocated_address ()
-			 == msymbol[hi + 1].unrelocated_address ()))
-		hi++;
+	  if (hi >= 0)
+	    {
 
 	      /* Skip various undesirable symbols.  */
 	      while (hi >= 0)
@@ -1327,16 +1388,6 @@ compact_minimal_symbols (struct minimal_symbol *msymbol, int mcount,
   return (mcount);
 }
 
-static void
-clear_minimal_symbol_hash_tables (struct objfile *objfile)
-{
-  for (size_t i = 0; i < MINIMAL_SYMBOL_HASH_SIZE; i++)
-    {
-      objfile->per_bfd->msymbol_hash[i] = 0;
-      objfile->per_bfd->msymbol_demangled_hash[i] = 0;
-    }
-}
-
 /* This struct is used to store values we compute for msymbols on the
    background threads but don't need to keep around long term.  */
 struct computed_hash_values
@@ -1360,25 +1411,29 @@ build_minimal_symbol_hash_tables
   (struct objfile *objfile,
    const std::vector<computed_hash_values>& hash_values)
 {
-  int i;
-  struct minimal_symbol *msym;
-
-  /* (Re)insert the actual entries.  */
-  int mcount = objfile->per_bfd->minimal_symbol_count;
-  for ((i = 0,
-	msym = objfile->per_bfd->msymbols.get ());
-       i < mcount;
-       i++, msym++)
+  objfile_per_bfd_storage *per_bfd = objfile->per_bfd;
+  minimal_symbol *msymbols = per_bfd->msymbols.get ();
+  size_t mcount = per_bfd->minimal_symbol_count;
+
+  per_bfd->msymbol_hash.build (msymbols, mcount,
+			       [&] (size_t i, unsigned int *hash)
     {
-      msym->hash_next = 0;
-      add_minsym_to_hash_table (msym, objfile->per_bfd->msymbol_hash,
-				hash_values[i].minsym_hash);
-
-      msym->demangled_hash_next = 0;
-      if (msym->search_name () != msym->linkage_name ())
-	add_minsym_to_demangled_hash_table
-	  (msym, objfile, hash_values[i].minsym_demangled_hash);
-    }
+      *hash = hash_values[i].minsym_hash;
+      return true;
+    });
+
+  per_bfd->msymbol_demangled_hash.build (msymbols, mcount,
+					 [&] (size_t i, unsigned int *hash)
+    {
+      minimal_symbol *msym = &msymbols[i];
+
+      if (msym->search_name () == msym->linkage_name ())
+	return false;
+
+      per_bfd->demangled_hash_languages.set (msym->language ());
+      *hash = hash_values[i].minsym_demangled_hash;
+      return true;
+    });
 }
 
 /* Add the minimal symbols in the existing bunches to the objfile's official
@@ -1452,9 +1507,6 @@ minimal_symbol_reader::install ()
 	 The strings themselves are also located in the storage_obstack
 	 of this objfile.  */
 
-      if (m_objfile->per_bfd->minimal_symbol_count != 0)
-	clear_minimal_symbol_hash_tables (m_objfile);
-
       m_objfile->per_bfd->minimal_symbol_count = mcount;
       m_objfile->per_bfd->msymbols = std::move (msym_holder);
 
@@ -1466,31 +1518,55 @@ minimal_symbol_reader::install ()
 
       std::vector<computed_hash_values> hash_values (mcount);
 
+      /* The demangled names saved in the index cache, if any.  */
+      demangled_names_cache cache (m_objfile);
+      std::atomic<int> n_demangled (0);
+
       msymbols = m_objfile->per_bfd->msymbols.get ();
-      /* Arbitrarily require at least 10 elements in a thread.  */
-      gdb::parallel_for_each (10, &msymbols[0], &msymbols[mcount],
+      /* Demangling costs vary wildly from one symbol to the next, so
+	 use guided scheduling, which balances the work dynamically.
+	 Arbitrarily require at least 10 elements in a chunk.  */
+      gdb::parallel_for_each_guided (10, &msymbols[0], &msymbols[mcount],
 	 [&] (minimal_symbol *start, minimal_symbol *end)
 	 {
 	   for (minimal_symbol *msym = start; msym < end; ++msym)
 	     {
 	       size_t idx = msym - msymbols;
 	       hash_values[idx].name_length = strlen (msym->linkage_name ());
+	       /* This mangled_name_hash computation has to be outside of
+		  the name_set check, or compute_and_set_names below will
+		  be called with an invalid hash value.  */
+	       hash_values[idx].mangled_name_hash
+		 = fast_hash (msym->linkage_name (),
+			      hash_values[idx].name_length);
 	       if (!msym->name_set)
 		 {
 		   /* This will be freed later, by compute_and_set_names.  */
-		   gdb::unique_xmalloc_ptr<char> demangled_name
-		     = symbol_find_demangled_name (msym, msym->linkage_name ());
+		   gdb::unique_xmalloc_ptr<char> demangled_name;
+		   enum language language;
+		   const char *cached;
+
+		   if (msym->language () == language_unknown
+		       && cache.lookup (msym->linkage_name (),
+					hash_values[idx].mangled_name_hash,
+					&language, &cached))
+		     {
+		       msym->m_language = language;
+		       if (cached != nullptr)
+			 demangled_name.reset (xstrdup (cached));
+		     }
+		   else
+		     {
+		       demangled_name
+			 = symbol_find_demangled_name (msym,
+						       msym->linkage_name ());
+		       ++n_demangled;
+		     }
 		   msym->set_demangled_name
 		     (demangled_name.release (),
 		      &m_objfile->per_bfd->storage_obstack);
 		   msym->name_set = 1;
 		 }
-	       /* This mangled_name_hash computation has to be outside of
-		  the name_set check, or compute_and_set_names below will
-		  be called with an invalid hash value.  */
-	       hash_values[idx].mangled_name_hash
-		 = fast_hash (msym->linkage_name (),
-			      hash_values[idx].name_length);
 	       hash_values[idx].minsym_hash
 		 = msymbol_hash (msym->linkage_name ());
 	       /* We only use this hash code if the search name differs
@@ -1520,6 +1596,13 @@ minimal_symbol_reader::install ()
 	 });
 
       build_minimal_symbol_hash_tables (m_objfile, hash_values);
+      m_objfile->per_bfd->msymbol_address_index.build (msymbols, mcount);
+
+      if (cache.found ())
+	symtab_create_debug_printf ("demangled %d minimal symbols, found "
+				    "the others in the index cache",
+				    n_demangled.load ());
+      cache.save (n_demangled.load ());
     }
 }
 
@@ -0,0 +1,173 @@
+/* Access the memory of another process with process_vm_readv and
+   process_vm_writev.
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "gdbsupport/common-defs.h"
+#include "nat/linux-process-vm.h"
+
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* The kernel accepts at most IOV_MAX (1024) ranges per call.  */
+
+static const size_t max_iov = 1024;
+
+/* Fill in IOV for LEN bytes at ADDR in the other process.  Return false
+   if ADDR can't be represented in a pointer of this process, e.g.,
+   when a 32-bit GDB debugs a 64-bit process.  */
+
+static bool
+remote_iov (struct iovec *iov, CORE_ADDR addr, size_t len)
+{
+  if (addr != (uintptr_t) addr)
+    return false;
+
+  iov->iov_base = (void *) (uintptr_t) addr;
+  iov->iov_len = len;
+  return true;
+}
+
+/* Transfer LEN bytes between BUF and ADDR in process PID.  WRITE says
+   in which direction.  */
+
+static ssize_t
+linux_process_vm_xfer (pid_t pid, CORE_ADDR addr, gdb_byte *buf,
+		       size_t len, bool write)
+{
+#if defined (__NR_process_vm_readv) && defined (__NR_process_vm_writev)
+  struct iovec local = { buf, len };
+  struct iovec remote;
+
+  if (!remote_iov (&remote, addr, len))
+    {
+      errno = EFAULT;
+      return -1;
+    }
+
+  return syscall (write ? __NR_process_vm_writev : __NR_process_vm_readv,
+		  pid, &local, 1, &remote, 1, 0);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/* See nat/linux-process-vm.h.  */
+
+ssize_t
+linux_process_vm_read (pid_t pid, CORE_ADDR addr, gdb_byte *buf, size_t len)
+{
+  return linux_process_vm_xfer (pid, addr, buf, len, false);
+}
+
+/* See nat/linux-process-vm.h.  */
+
+ssize_t
+linux_process_vm_write (pid_t pid, CORE_ADDR addr, const gdb_byte *buf,
+			size_t len)
+{
+  /* process_vm_writev does not write to the local buffer.  */
+  return linux_process_vm_xfer (pid, addr, (gdb_byte *) buf, len, true);
+}
+
+/* See nat/linux-process-vm.h.  */
+
+ssize_t
+linux_process_vm_read_ranges
+  (pid_t pid, gdb::array_view<const memory_read_range> ranges)
+{
+#ifdef __NR_process_vm_readv
+  struct iovec local[max_iov];
+  struct iovec remote[max_iov];
+
+  size_t done = 0;
+  while (done < ranges.size ())
+    {
+      size_t count = std::min (ranges.size () - done, max_iov);
+      size_t total = 0;
+
+      for (size_t i = 0; i < count; ++i)
+	{
+	  const memory_read_range &range = ranges[done + i];
+
+	  if (!remote_iov (&remote[i], range.addr, range.len))
+	    {
+	      /* Read what comes before.  */
+	      count = i;
+	      break;
+	    }
+	  local[i].iov_base = range.buf;
+	  local[i].iov_len = range.len;
+	  total += range.len;
+	}
+
+      if (count == 0)
+	break;
+
+      ssize_t ret = syscall (__NR_process_vm_readv, pid, local, count,
+			     remote, count, 0);
+      if (ret == -1)
+	return done == 0 ? -1 : done;
+
+      /* A partial read stops at the first range that could not be read
+	 completely.  */
+      if ((size_t) ret < total)
+	{
+	  size_t left = ret;
+
+	  for (size_t i = 0; i < count && remote[i].iov_len <= left; ++i)
+	    {
+	      left -= remote[i].iov_len;
+	      ++done;
+	    }
+	  return done;
+	}
+
+      done += count;
+    }
+
+  if (done == 0 && !ranges.empty ())
+    {
+      errno = EFAULT;
+      return -1;
+    }
+
+  return done;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/* See nat/linux-process-vm.h.  */
+
+bool
+linux_process_vm_unsupported_errno (int errnum)
+{
+  return errnum == ENOSYS;
+}
+
+/* See nat/linux-process-vm.h.  */
+
+bool
+linux_process_vm_denied_errno (int errnum)
+{
+  return errnum == EPERM;
+}
@@ -0,0 +1,71 @@
+/* Access the memory of another process with process_vm_readv and
+   process_vm_writev.
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef NAT_LINUX_PROCESS_VM_H
+#define NAT_LINUX_PROCESS_VM_H
+
+#include "gdbsupport/array-view.h"
+#include "target/target.h"
+#include <sys/types.h>
+
+/* These transfer memory with a single system call per batch of ranges,
+   like /proc/PID/mem does per range, and unlike PTRACE_PEEKTEXT and
+   PTRACE_POKETEXT, which transfer a word at a time.  Unlike
+   /proc/PID/mem, they can't write to memory the process itself can't
+   write, such as its code, and they access whatever address space
+   the process has at the time of the call: if one of its threads
+   execs, that is the new one.  */
+
+/* Read LEN bytes at ADDR in the address space of process PID into
+   BUF.  Return the number of bytes read, which is less than LEN if
+   the range runs into memory that can't be read, or -1 with errno
+   set.  */
+
+extern ssize_t linux_process_vm_read (pid_t pid, CORE_ADDR addr,
+				      gdb_byte *buf, size_t len);
+
+/* Write LEN bytes from BUF at ADDR in the address space of process
+   PID.  Return the number of bytes written, or -1 with errno set.  */
+
+extern ssize_t linux_process_vm_write (pid_t pid, CORE_ADDR addr,
+				       const gdb_byte *buf, size_t len);
+
+/* Read each of RANGES in the address space of process PID, with as
+   few system calls as the kernel allows.  Return the number of
+   leading ranges that were read completely, or -1 with errno set if
+   none could be read because the system call failed.  */
+
+extern ssize_t linux_process_vm_read_ranges
+  (pid_t pid, gdb::array_view<const memory_read_range> ranges);
+
+/* Return true if ERRNUM, as set by one of the functions above, means
+   that the kernel does not have the system calls, so they can't be
+   used for any process.  */
+
+extern bool linux_process_vm_unsupported_errno (int errnum);
+
+/* Return true if ERRNUM, as set by one of the functions above, means
+   that a security policy forbids them for the process they were called
+   for, as opposed to the memory not being accessible.  They may still
+   be allowed for other processes.  */
+
+extern bool linux_process_vm_denied_errno (int errnum);
+
+#endif /* NAT_LINUX_PROCESS_VM_H */
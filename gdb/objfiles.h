@@ -170,8 +170,147 @@ struct objstats
 #define OBJSTATS struct objstats stats
 extern void print_objfile_statistics (void);
 
-/* Number of entries in the minimal symbol hash table.  */
-#define MINIMAL_SYMBOL_HASH_SIZE 2039
+/* A hash table of minimal symbols, indexed by the hash of one of their
+   names.  It uses open addressing with linear probing, and is sized
+   according to the number of symbols it holds.  Each slot records the
+   full hash of the name, so that most symbols whose name does not match
+   can be skipped without looking at the name.
+
+   The table is split into shards, according to the hash, so that it can
+   be built by several threads at once.  */
+
+class minimal_symbol_hash_table
+{
+public:
+
+  /* Replace the contents of the table.  SYMBOLS is an array of COUNT
+     minimal symbols.  The table will hold the symbols for which GET_HASH
+     returns true, with the hash it stores in its second argument.
+     GET_HASH is called once for each index, in the main thread.  */
+  void build (minimal_symbol *symbols, size_t count,
+	      gdb::function_view<bool (size_t, unsigned int *)> get_hash);
+
+  /* Call CALLBACK for each minimal symbol whose name's hash is HASH,
+     until it returns true.  Symbols that were placed at a higher index
+     in the array passed to BUILD are visited first.  */
+  template<typename F>
+  void find (unsigned int hash, F callback) const
+  {
+    if (m_slots.empty ())
+      return;
+
+    uint32_t mixed = mix (hash);
+    const shard &sh = m_shards[shard_of (mixed)];
+    for (uint32_t i = mixed & sh.mask; ; i = (i + 1) & sh.mask)
+      {
+	const slot &s = m_slots[sh.start + i];
+
+	if (s.index == empty_slot)
+	  return;
+	if (s.hash == hash && callback (&m_symbols[s.index]))
+	  return;
+      }
+  }
+
+private:
+
+  /* An entry of the table.  */
+  struct slot
+  {
+    unsigned int hash;
+    uint32_t index;
+  };
+
+  /* A part of the table that holds all the symbols whose mixed hash
+     has some value in its upper bits.  Its size is a power of two.  */
+  struct shard
+  {
+    size_t start;
+    uint32_t mask;
+  };
+
+  static constexpr uint32_t empty_slot = UINT32_MAX;
+
+  /* Spread the bits of HASH.  The upper bits of the result select a
+     shard, and the lower ones a slot in that shard.  */
+  static uint32_t mix (uint32_t hash)
+  {
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+  }
+
+  size_t shard_of (uint32_t mixed) const
+  {
+    return m_shard_bits == 0 ? 0 : mixed >> (32 - m_shard_bits);
+  }
+
+  minimal_symbol *m_symbols = nullptr;
+  unsigned int m_shard_bits = 0;
+  std::vector<shard> m_shards;
+  std::vector<slot> m_slots;
+};
+
+/* An index of the minimal symbols of an objfile by address.  The
+   addresses are kept in Eytzinger order, that is, in the breadth-first
+   order of a complete binary search tree.  A search then reads memory
+   in a predictable pattern, and the top levels of the tree, which
+   every search goes through, share a few cache lines.  */
+
+class minimal_symbol_address_index
+{
+public:
+
+  /* Replace the contents of the index with the addresses of the
+     COUNT minimal symbols at SYMBOLS, which must be sorted by
+     address.  */
+  void build (const minimal_symbol *symbols, size_t count);
+
+  /* Return the index of the last symbol whose address is less than
+     or equal to ADDR.  When several symbols have that address, this
+     is the last of them.  Return -1 if there is no such symbol.  */
+  int find (unrelocated_addr addr) const
+  {
+    size_t n = m_addrs.size ();
+    size_t k = 1;
+
+    if (n == 0)
+      return -1;
+
+    /* Descend the tree, going right whenever the node's address is
+       not above ADDR.  */
+    while (k < n)
+      k = 2 * k + (m_addrs[k] <= addr);
+
+    /* The last node where the search went left holds the first
+       address above ADDR.  Remove the trailing right turns, and that
+       left turn, to find it.  */
+    while ((k & 1) != 0)
+      k >>= 1;
+    k >>= 1;
+
+    if (k == 0)
+      return (int) n - 2;
+    return (int) m_positions[k] - 1;
+  }
+
+private:
+
+  /* Fill the subtree rooted at element K with the addresses of
+     SYMBOLS, starting at index NEXT.  Return the index of the first
+     symbol that was not used.  */
+  size_t fill (const minimal_symbol *symbols, size_t next, size_t k);
+
+  /* The addresses, in Eytzinger order.  Element 0 is unused, so that
+     the children of element K are 2K and 2K+1.  */
+  std::vector<unrelocated_addr> m_addrs;
+
+  /* The index in the sorted array of each element of M_ADDRS.  */
+  std::vector<uint32_t> m_positions;
+};
 
 /* An iterator for minimal symbols.  */
 
@@ -228,7 +367,8 @@ struct objfile_per_bfd_storage
   ~objfile_per_bfd_storage ();
 
   /* Intern STRING in this object's string cache and return the unique copy.
-     The copy has the same lifetime as this object.
+     The copy has the same lifetime as this object.  This can be called
+     from any thread.
 
      STRING must be null-terminated.  */
 
@@ -255,9 +395,10 @@ struct objfile_per_bfd_storage
 
   auto_obstack storage_obstack;
 
-  /* String cache.  */
+  /* String cache.  This is a concurrent bcache, so that names can be
+     interned from the worker threads that read the debug info.  */
 
-  gdb::bcache string_cache;
+  gdb::concurrent_bcache string_cache;
 
   /* The gdbarch associated with the BFD.  Note that this gdbarch is
      determined solely from BFD information, without looking at target
@@ -315,20 +456,24 @@ struct objfile_per_bfd_storage
   bool minsyms_read : 1;
 
   /* This is a hash table used to index the minimal symbols by (mangled)
-     name.  */
+     name, using msymbol_hash.  */
 
-  minimal_symbol *msymbol_hash[MINIMAL_SYMBOL_HASH_SIZE] {};
+  minimal_symbol_hash_table msymbol_hash;
 
   /* This hash table is used to index the minimal symbols by their
      demangled names.  Uses a language-specific hash function via
      search_name_hash.  */
 
-  minimal_symbol *msymbol_demangled_hash[MINIMAL_SYMBOL_HASH_SIZE] {};
+  minimal_symbol_hash_table msymbol_demangled_hash;
 
   /* All the different languages of symbols found in the demangled
      hash table.  */
   std::bitset<nr_languages> demangled_hash_languages;
 
+  /* This indexes the minimal symbols by address.  */
+
+  minimal_symbol_address_index msymbol_address_index;
+
 private:
   /* The BFD this object is associated to.  */
 
@@ -569,6 +569,90 @@ infpy_read_memory (PyObject *self, PyObject *args, PyObject *kw)
   return gdbpy_buffer_to_membuf (std::move (buffer), addr, length);
 }
 
+/* Implementation of Inferior.read_memory_ranges (ranges).
+   RANGES is a sequence of (address, length) pairs.  Read all of them
+   in one batch and return a list holding one buffer object per range.
+   Returns NULL on error, with a python exception set.  */
+static PyObject *
+infpy_read_memory_ranges (PyObject *self, PyObject *args, PyObject *kw)
+{
+  inferior_object *inf = (inferior_object *) self;
+  PyObject *ranges_obj;
+  static const char *keywords[] = { "ranges", NULL };
+
+  INFPY_REQUIRE_VALID (inf);
+
+  if (!gdb_PyArg_ParseTupleAndKeywords (args, kw, "O", keywords,
+					&ranges_obj))
+    return NULL;
+
+  gdbpy_ref<> seq (PySequence_Fast (ranges_obj,
+				    _("Argument must be a sequence.")));
+  if (seq == NULL)
+    return NULL;
+
+  Py_ssize_t count = PySequence_Fast_GET_SIZE (seq.get ());
+  std::vector<gdb::unique_xmalloc_ptr<gdb_byte>> buffers;
+  std::vector<memory_read_range> ranges;
+  buffers.reserve (count);
+  ranges.reserve (count);
+
+  for (Py_ssize_t i = 0; i < count; ++i)
+    {
+      PyObject *item = PySequence_Fast_GET_ITEM (seq.get (), i);
+      PyObject *addr_obj, *length_obj;
+      CORE_ADDR addr, length;
+
+      if (!PyTuple_Check (item)
+	  || !PyArg_ParseTuple (item, "OO", &addr_obj, &length_obj))
+	{
+	  PyErr_SetString (PyExc_TypeError,
+			   _("Each range must be an (address, length) tuple."));
+	  return NULL;
+	}
+
+      if (get_addr_from_python (addr_obj, &addr) < 0
+	  || get_addr_from_python (length_obj, &length) < 0)
+	return NULL;
+
+      /* Allocate at least one byte so that empty ranges still have a
+	 valid buffer to hand to the memoryview.  */
+      buffers.emplace_back ((gdb_byte *) xmalloc (std::max<CORE_ADDR> (length,
+								      1)));
+      ranges.push_back ({ addr, buffers.back ().get (), length });
+    }
+
+  try
+    {
+      scoped_restore_current_inferior_for_memory restore_inferior
+	(inf->inferior);
+
+      size_t failed;
+      if (target_read_memory_vec (ranges, &failed) != 0)
+	memory_error (TARGET_XFER_E_IO, ranges[failed].addr);
+    }
+  catch (const gdb_exception &except)
+    {
+      GDB_PY_HANDLE_EXCEPTION (except);
+    }
+
+  gdbpy_ref<> result (PyList_New (count));
+  if (result == NULL)
+    return NULL;
+
+  for (Py_ssize_t i = 0; i < count; ++i)
+    {
+      PyObject *membuf = gdbpy_buffer_to_membuf (std::move (buffers[i]),
+						 ranges[i].addr,
+						 ranges[i].len);
+      if (membuf == NULL)
+	return NULL;
+      PyList_SET_ITEM (result.get (), i, membuf);
+    }
+
+  return result.release ();
+}
+
 /* Implementation of Inferior.write_memory (address, buffer [, length]).
    Writes the contents of BUFFER (a Python object supporting the read
    buffer protocol) at ADDRESS in the inferior's memory.  Write LENGTH
@@ -1066,6 +1150,11 @@ Return true if this inferior is valid, false if not." },
     METH_VARARGS | METH_KEYWORDS,
     "read_memory (address, length) -> buffer\n\
 Return a buffer object for reading from the inferior's memory." },
+  { "read_memory_ranges", (PyCFunction) infpy_read_memory_ranges,
+    METH_VARARGS | METH_KEYWORDS,
+    "read_memory_ranges (ranges) -> list\n\
+Read several (address, length) ranges from the inferior's memory at once,\n\
+returning a list of buffer objects." },
   { "write_memory", (PyCFunction) infpy_write_memory,
     METH_VARARGS | METH_KEYWORDS,
     "write_memory (address, buffer [, length])\n\
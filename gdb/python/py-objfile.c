@@ -26,6 +26,8 @@
 #include "symtab.h"
 #include "python.h"
 #include "inferior.h"
+#include "minsyms.h"
+#include "progspace.h"
 
 struct objfile_object
 {
@@ -528,6 +530,93 @@ objfpy_lookup_static_symbol (PyObject *self, PyObject *args, PyObject *kw)
   Py_RETURN_NONE;
 }
 
+/* Implementation of
+   gdb.Objfile.lookup_minsyms_by_pc (pcs) -> List.
+   Returns a list with, for each address in PCS, None or a tuple of the
+   name and address of the minimal symbol of this objfile that contains
+   the address.  */
+
+static PyObject *
+objfpy_lookup_minsyms_by_pc (PyObject *self, PyObject *args, PyObject *kw)
+{
+  static const char *keywords[] = { "pcs", NULL };
+  objfile_object *obj = (objfile_object *) self;
+  PyObject *pcs_obj;
+
+  OBJFPY_REQUIRE_VALID (obj);
+
+  if (!gdb_PyArg_ParseTupleAndKeywords (args, kw, "O", keywords, &pcs_obj))
+    return nullptr;
+
+  gdbpy_ref<> iter (PyObject_GetIter (pcs_obj));
+  if (iter == nullptr)
+    return nullptr;
+
+  gdbpy_ref<> result (PyList_New (0));
+  if (result == nullptr)
+    return nullptr;
+
+  struct objfile *objfile = obj->objfile;
+  struct objfile *owner = objfile;
+  if (owner->separate_debug_objfile_backlink != nullptr)
+    owner = owner->separate_debug_objfile_backlink;
+
+  scoped_restore_current_program_space restore_pspace;
+  set_current_program_space (objfile->pspace);
+
+  while (true)
+    {
+      gdbpy_ref<> item (PyIter_Next (iter.get ()));
+      if (item == nullptr)
+	{
+	  if (PyErr_Occurred ())
+	    return nullptr;
+	  break;
+	}
+
+      CORE_ADDR pc;
+      if (get_addr_from_python (item.get (), &pc) < 0)
+	return nullptr;
+
+      bound_minimal_symbol msym;
+      try
+	{
+	  /* Only consider addresses in the sections of this objfile.
+	     Its separate debug objfiles have no sections of their own,
+	     but the minimal symbol lookup searches them as well.  */
+	  obj_section *section = find_pc_section (pc);
+	  if (section != nullptr && section->objfile == owner)
+	    msym = lookup_minimal_symbol_by_pc_section (pc, section);
+	}
+      catch (const gdb_exception &except)
+	{
+	  GDB_PY_HANDLE_EXCEPTION (except);
+	}
+
+      gdbpy_ref<> entry;
+      if (msym.minsym == nullptr)
+	entry = gdbpy_ref<>::new_reference (Py_None);
+      else
+	{
+	  gdbpy_ref<> name
+	    = host_string_to_python_string (msym.minsym->print_name ());
+	  if (name == nullptr)
+	    return nullptr;
+	  gdbpy_ref<> addr = gdb_py_object_from_ulongest (msym.value_address ());
+	  if (addr == nullptr)
+	    return nullptr;
+	  entry.reset (PyTuple_Pack (2, name.get (), addr.get ()));
+	  if (entry == nullptr)
+	    return nullptr;
+	}
+
+      if (PyList_Append (result.get (), entry.get ()) < 0)
+	return nullptr;
+    }
+
+  return result.release ();
+}
+
 /* Implement repr() for gdb.Objfile.  */
 
 static PyObject *
@@ -740,6 +829,12 @@ Look up a global symbol in this objfile and return it." },
     "lookup_static_symbol (name [, domain]).\n\
 Look up a static-linkage global symbol in this objfile and return it." },
 
+  { "lookup_minsyms_by_pc", (PyCFunction) objfpy_lookup_minsyms_by_pc,
+    METH_VARARGS | METH_KEYWORDS,
+    "lookup_minsyms_by_pc (pcs) -> List.\n\
+Return, for each address in PCS, None or a tuple of the name and address\n\
+of the minimal symbol of this objfile containing the address." },
+
   { NULL }
 };
 
@@ -34,6 +34,7 @@
 #include "remote.h"
 #include "remote-notif.h"
 #include "regcache.h"
+#include "user-regs.h"
 #include "value.h"
 #include "observable.h"
 #include "solib.h"
@@ -79,6 +80,10 @@
 #include <unordered_map>
 #include "async-event.h"
 #include "gdbsupport/selftest.h"
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 /* The remote target.  */
 
@@ -101,6 +106,7 @@ struct threads_listing_context;
 typedef int (*rmt_thread_action) (threadref *ref, void *context);
 struct protocol_feature;
 struct packet_reg;
+struct remote_thread_info;
 
 struct stop_reply;
 typedef std::unique_ptr<stop_reply> stop_reply_up;
@@ -302,6 +308,15 @@ enum {
      packets and the tag violation stop replies.  */
   PACKET_memory_tagging_feature,
 
+  /* Support for reading many memory ranges at once.  */
+  PACKET_vReadMemory,
+
+  /* Support for compressing packet payloads.  */
+  PACKET_QCompression,
+
+  /* Support for choosing the registers sent in stop replies.  */
+  PACKET_QExpediteRegisters,
+
   PACKET_MAX
 };
 
@@ -399,6 +414,33 @@ struct remote_arch_state
   long remote_packet_size;
 };
 
+/* The algorithms that can be used to compress packet payloads, once
+   selected with the QCompression packet.  */
+
+enum class remote_compression
+{
+  none,
+  zlib,
+  zstd,
+};
+
+/* Counts of the packets and bytes exchanged with the stub.  The
+   logical counts are payload sizes before compression, the wire
+   counts are what was actually written or read, framing included.  */
+
+struct remote_traffic_stats
+{
+  ULONGEST packets_sent = 0;
+  ULONGEST compressed_sent = 0;
+  ULONGEST logical_bytes_sent = 0;
+  ULONGEST wire_bytes_sent = 0;
+
+  ULONGEST packets_received = 0;
+  ULONGEST compressed_received = 0;
+  ULONGEST logical_bytes_received = 0;
+  ULONGEST wire_bytes_received = 0;
+};
+
 /* Description of the remote protocol state for the currently
    connected target.  This is per-target state, and independent of the
    selected architecture.  */
@@ -481,6 +523,28 @@ class remote_state
      reliable.  */
   bool noack_mode = false;
 
+  /* The compression algorithms the stub offered in its qSupported
+     reply.  */
+  std::vector<remote_compression> stub_compression;
+
+  /* The compression applied to packet payloads in both directions,
+     negotiated with QCompression.  */
+  remote_compression compression = remote_compression::none;
+
+  /* Counts of what went over the connection.  */
+  remote_traffic_stats traffic;
+
+  /* The number of memory read requests the stub accepts before it
+     has replied to the first, from its "MemoryReadWindow" qSupported
+     feature.  Zero if it did not report one.  */
+  int stub_memory_read_window = 0;
+
+  /* True if the stub accepted a set of registers to expedite with
+     QExpediteRegisters.  Its stop replies then leave out the
+     registers that did not change since the thread's previous
+     stop.  */
+  bool expedite_deltas = false;
+
   /* True if we're connected in extended remote mode.  */
   bool extended = false;
 
@@ -845,6 +909,9 @@ class remote_target : public process_stratum_target
 
   ULONGEST get_memory_xfer_limit () override;
 
+  ULONGEST read_memory_vec
+    (gdb::array_view<const memory_read_range> ranges) override;
+
   void rcmd (const char *command, struct ui_file *output) override;
 
   const char *pid_to_exec_file (int pid) override;
@@ -1180,6 +1247,11 @@ class remote_target : public process_stratum_target
   void remote_packet_size (const protocol_feature *feature,
 			   packet_support support, const char *value);
 
+  void remote_compression_feature (const protocol_feature *feature,
+				   packet_support support, const char *value);
+
+  remote_compression choose_compression ();
+
   void remote_serial_quit_handler ();
 
   void remote_detach_pid (int pid);
@@ -1224,6 +1296,21 @@ class remote_target : public process_stratum_target
 					  ULONGEST len_units,
 					  int unit_size, ULONGEST *xfered_len_units);
 
+  int memory_read_window ();
+
+  void send_expedited_registers ();
+
+  void apply_register_delta (ptid_t ptid, remote_thread_info *remote_thr,
+			     stop_reply *stop_reply);
+
+  target_xfer_status remote_read_bytes_pipelined (CORE_ADDR memaddr,
+						  gdb_byte *myaddr,
+						  ULONGEST len_units,
+						  int unit_size,
+						  ULONGEST chunk_units,
+						  int window,
+						  ULONGEST *xfered_len_units);
+
   target_xfer_status remote_xfer_live_readonly_partial (gdb_byte *readbuf,
 							ULONGEST memaddr,
 							ULONGEST len,
@@ -1256,6 +1343,7 @@ class remote_target : public process_stratum_target
 
   void skip_frame ();
   long read_frame (gdb::char_vector *buf_p);
+  long uncompress_frame (gdb::char_vector *buf_p, long len, long wire_len);
   int getpkt (gdb::char_vector *buf, bool forever = false,
 	      bool *is_notif = nullptr);
   int remote_vkill (int pid);
@@ -1498,6 +1586,15 @@ struct remote_thread_info : public private_thread_info
      to stop for a watchpoint.  */
   CORE_ADDR watch_data_address = 0;
 
+  /* The values of the expedited registers as of the thread's last stop
+     reply, indexed by register number, used to fill in the ones the
+     stub left out because they did not change.  An empty entry means
+     the value is not known.  */
+  std::vector<gdb::byte_vector> reg_shadow;
+
+  /* The architecture REG_SHADOW's register numbers are for.  */
+  gdbarch *reg_shadow_arch = nullptr;
+
   /* Get the thread's resume state.  */
   enum resume_state get_resume_state () const
   {
@@ -2225,6 +2322,183 @@ show_remote_packet_max_chars (struct ui_file *file, int from_tty,
 		      "display is %s.\n"), value);
 }
 
+/* The possible values of "set remote compression".  */
+
+static const char remote_compression_off[] = "off";
+static const char remote_compression_auto[] = "auto";
+static const char remote_compression_zlib[] = "zlib";
+static const char remote_compression_zstd[] = "zstd";
+
+static const char *const remote_compression_modes[] =
+{
+  remote_compression_off,
+  remote_compression_auto,
+  remote_compression_zlib,
+  remote_compression_zstd,
+  nullptr
+};
+
+/* The compression to ask the stub for when connecting.  */
+
+static const char *remote_compression_mode = remote_compression_off;
+
+static void
+show_remote_compression_mode (struct ui_file *file, int from_tty,
+			      struct cmd_list_element *c, const char *value)
+{
+  gdb_printf (file, _("Compression of remote packets is \"%s\".\n"),
+	      value);
+}
+
+/* The maximum number of memory read requests to have in flight at
+   once.  */
+
+static unsigned int remote_memory_read_window = 16;
+
+static void
+show_remote_memory_read_window (struct ui_file *file, int from_tty,
+				struct cmd_list_element *c, const char *value)
+{
+  gdb_printf (file, _("The maximum number of memory read requests "
+		      "in flight is %s.\n"), value);
+}
+
+/* The registers to ask the stub to include in its stop replies:
+   empty for the stub's default set, "all", or a list of register
+   names.  */
+
+static std::string remote_expedited_registers;
+
+static void
+set_remote_expedited_registers (const char *args, int from_tty,
+				struct cmd_list_element *c)
+{
+  remote_target *remote = get_current_remote_target ();
+
+  if (remote != nullptr)
+    remote->send_expedited_registers ();
+}
+
+static void
+show_remote_expedited_registers (struct ui_file *file, int from_tty,
+				 struct cmd_list_element *c,
+				 const char *value)
+{
+  if (*value == '\0')
+    gdb_printf (file, _("The registers expedited in stop replies "
+			"are the remote target's default.\n"));
+  else
+    gdb_printf (file, _("The registers expedited in stop replies "
+			"are \"%s\".\n"), value);
+}
+
+/* Payloads shorter than this are never compressed; the header and the
+   compressor's overhead would outweigh any saving.  */
+
+#define REMOTE_COMPRESS_MIN_PAYLOAD 64
+
+/* Return the name ALGO has in the QCompression packet.  */
+
+static const char *
+remote_compression_name (remote_compression algo)
+{
+  switch (algo)
+    {
+    case remote_compression::none:
+      return "none";
+    case remote_compression::zlib:
+      return "zlib";
+    case remote_compression::zstd:
+      return "zstd";
+    }
+
+  gdb_assert_not_reached ("unknown remote compression");
+}
+
+/* Compress the LEN bytes of payload in BUF with ALGO into *OUT, as a
+   '~' payload: the uncompressed length in hex, a colon, and the
+   escaped compressed data.  Return false if BUF could not be
+   compressed.  */
+
+static bool
+remote_compress_payload (remote_compression algo, const char *buf, int len,
+			 gdb::char_vector *out)
+{
+  gdb::byte_vector packed;
+  size_t packed_len;
+
+  switch (algo)
+    {
+    case remote_compression::zlib:
+      {
+	uLongf dest_len = compressBound (len);
+
+	packed.resize (dest_len);
+	if (compress2 (packed.data (), &dest_len, (const Bytef *) buf, len,
+		       Z_DEFAULT_COMPRESSION) != Z_OK)
+	  return false;
+	packed_len = dest_len;
+      }
+      break;
+
+#ifdef HAVE_ZSTD
+    case remote_compression::zstd:
+      packed.resize (ZSTD_compressBound (len));
+      packed_len = ZSTD_compress (packed.data (), packed.size (), buf, len,
+				  ZSTD_CLEVEL_DEFAULT);
+      if (ZSTD_isError (packed_len))
+	return false;
+      break;
+#endif
+
+    default:
+      return false;
+    }
+
+  std::string header = string_printf ("~%x:", len);
+  int escaped_units;
+
+  out->resize (header.size () + 2 * packed_len);
+  memcpy (out->data (), header.data (), header.size ());
+  int used = remote_escape_output (packed.data (), packed_len, 1,
+				   (gdb_byte *) out->data () + header.size (),
+				   &escaped_units, 2 * packed_len);
+  out->resize (header.size () + used);
+  return true;
+}
+
+/* Uncompress the PACKED_LEN bytes at PACKED with ALGO into OUT, which
+   must receive exactly OUT_LEN bytes.  Return false on error.  */
+
+static bool
+remote_uncompress (remote_compression algo, const gdb_byte *packed,
+		   size_t packed_len, char *out, size_t out_len)
+{
+  switch (algo)
+    {
+    case remote_compression::zlib:
+      {
+	uLongf dest_len = out_len;
+
+	return (uncompress ((Bytef *) out, &dest_len, packed,
+			    packed_len) == Z_OK
+		&& dest_len == out_len);
+      }
+
+#ifdef HAVE_ZSTD
+    case remote_compression::zstd:
+      {
+	size_t n = ZSTD_decompress (out, out_len, packed, packed_len);
+
+	return !ZSTD_isError (n) && n == out_len;
+      }
+#endif
+
+    default:
+      return false;
+    }
+}
+
 long
 remote_target::get_memory_write_packet_size ()
 {
@@ -5034,6 +5308,22 @@ remote_target::start_remote_1 (int from_tty, int extended_p)
 	rs->noack_mode = 1;
     }
 
+  /* Next, if the user asked for it, turn on compression of the packet
+     payloads.  The stub switches after sending its reply, and we
+     switch once we have read it.  */
+  remote_compression compression = choose_compression ();
+  if (compression != remote_compression::none)
+    {
+      std::string packet
+	= string_printf ("QCompression:%s",
+			 remote_compression_name (compression));
+
+      putpkt (packet.c_str ());
+      getpkt (&rs->buf);
+      if (m_features.packet_ok (rs->buf, PACKET_QCompression) == PACKET_OK)
+	rs->compression = compression;
+    }
+
   if (extended_p)
     {
       /* Tell the remote that we are using the extended protocol.  */
@@ -5053,6 +5343,10 @@ remote_target::start_remote_1 (int from_tty, int extended_p)
      address spaces in the program spaces.  */
   update_address_spaces ();
 
+  /* Tell the stub which registers we want in its stop replies, now
+     that we know their numbers.  */
+  send_expedited_registers ();
+
   /* On OSs where the list of libraries is global to all
      processes, we fetch them early.  */
   if (gdbarch_has_global_solist (current_inferior ()->arch ()))
@@ -5537,8 +5831,131 @@ remote_packet_size (remote_target *remote, const protocol_feature *feature,
   remote->remote_packet_size (feature, support, value);
 }
 
+void
+remote_target::remote_compression_feature (const protocol_feature *feature,
+					   packet_support support,
+					   const char *value)
+{
+  struct remote_state *rs = get_remote_state ();
+
+  m_features.m_protocol_packets[feature->packet].support = support;
+  rs->stub_compression.clear ();
+
+  if (support != PACKET_ENABLE || value == nullptr)
+    return;
+
+  /* VALUE is a comma-separated list of algorithms; ignore the ones we
+     don't know.  */
+  for (const gdb::unique_xmalloc_ptr<char> &name
+	 : delim_string_to_char_ptr_vec (value, ','))
+    if (strcmp (name.get (), "zlib") == 0)
+      rs->stub_compression.push_back (remote_compression::zlib);
+    else if (strcmp (name.get (), "zstd") == 0)
+      rs->stub_compression.push_back (remote_compression::zstd);
+}
+
+/* Return the compression to ask the stub for, according to "set
+   remote compression" and to what the stub offered.  */
+
+remote_compression
+remote_target::choose_compression ()
+{
+  struct remote_state *rs = get_remote_state ();
+
+  if (remote_compression_mode == remote_compression_off
+      || m_features.packet_support (PACKET_QCompression) == PACKET_DISABLE)
+    return remote_compression::none;
+
+  auto offered = [&] (remote_compression algo)
+    {
+      return std::find (rs->stub_compression.begin (),
+			rs->stub_compression.end (),
+			algo) != rs->stub_compression.end ();
+    };
+
+  if (remote_compression_mode == remote_compression_auto)
+    {
+#ifdef HAVE_ZSTD
+      if (offered (remote_compression::zstd))
+	return remote_compression::zstd;
+#endif
+      /* If the QCompression packet was forced on, assume that a stub
+	 which did not list any algorithm knows zlib.  */
+      if (offered (remote_compression::zlib)
+	  || rs->stub_compression.empty ())
+	return remote_compression::zlib;
+      return remote_compression::none;
+    }
+
+  remote_compression algo
+    = (remote_compression_mode == remote_compression_zstd
+       ? remote_compression::zstd : remote_compression::zlib);
+
+#ifndef HAVE_ZSTD
+  if (algo == remote_compression::zstd)
+    {
+      warning (_("GDB was built without zstd support, "
+		 "not compressing remote packets."));
+      return remote_compression::none;
+    }
+#endif
+
+  if (!offered (algo) && !rs->stub_compression.empty ())
+    {
+      warning (_("The remote target does not support %s compression."),
+	       remote_compression_name (algo));
+      return remote_compression::none;
+    }
+
+  return algo;
+}
+
+static void
+remote_compression_feature (remote_target *remote,
+			    const protocol_feature *feature,
+			    enum packet_support support, const char *value)
+{
+  remote->remote_compression_feature (feature, support, value);
+}
+
+/* Record the number of memory reads the stub lets us pipeline, from
+   its "MemoryReadWindow=N" qSupported feature.  */
+
+static void
+remote_memory_read_window_feature (remote_target *remote,
+				   const protocol_feature *feature,
+				   enum packet_support support,
+				   const char *value)
+{
+  struct remote_state *rs = remote->get_remote_state ();
+  char *value_end;
+
+  if (support != PACKET_ENABLE)
+    return;
+
+  if (value == nullptr || *value == '\0')
+    {
+      warning (_("Remote target reported \"%s\" without a size."),
+	       feature->name);
+      return;
+    }
+
+  errno = 0;
+  long window = strtol (value, &value_end, 16);
+  if (errno != 0 || *value_end != '\0' || window < 0 || window > INT_MAX)
+    {
+      warning (_("Remote target reported \"%s\" with a bad size: \"%s\"."),
+	       feature->name, value);
+      return;
+    }
+
+  rs->stub_memory_read_window = window;
+}
+
 static const struct protocol_feature remote_protocol_features[] = {
   { "PacketSize", PACKET_DISABLE, remote_packet_size, -1 },
+  { "MemoryReadWindow", PACKET_DISABLE, remote_memory_read_window_feature,
+    -1 },
   { "qXfer:auxv:read", PACKET_DISABLE, remote_supported_packet,
     PACKET_qXfer_auxv },
   { "qXfer:exec-file:read", PACKET_DISABLE, remote_supported_packet,
@@ -5642,6 +6059,12 @@ static const struct protocol_feature remote_protocol_features[] = {
   { "no-resumed", PACKET_DISABLE, remote_supported_packet, PACKET_no_resumed },
   { "memory-tagging", PACKET_DISABLE, remote_supported_packet,
     PACKET_memory_tagging_feature },
+  { "vReadMemory", PACKET_DISABLE, remote_supported_packet,
+    PACKET_vReadMemory },
+  { "QCompression", PACKET_DISABLE, remote_compression_feature,
+    PACKET_QCompression },
+  { "QExpediteRegisters", PACKET_DISABLE, remote_supported_packet,
+    PACKET_QExpediteRegisters },
 };
 
 static char *remote_support_xml;
@@ -7956,15 +8379,29 @@ Packet: '%s'\n"),
 			   hex_string (pnum), p, buf);
 
 		  cached_reg.num = reg->regnum;
-		  cached_reg.data = (gdb_byte *)
-		    xmalloc (register_size (event->arch, reg->regnum));
-
 		  p = p1 + 1;
-		  fieldsize = hex2bin (p, cached_reg.data,
-				       register_size (event->arch, reg->regnum));
-		  p += 2 * fieldsize;
-		  if (fieldsize < register_size (event->arch, reg->regnum))
-		    warning (_("Remote reply is too short: %s"), buf);
+
+		  /* A value made of 'x's means the register is unavailable;
+		     the stub sends this when only reporting the registers
+		     that changed since the previous stop.  */
+		  if (*p == 'x')
+		    {
+		      cached_reg.data = nullptr;
+		      while (*p == 'x')
+			++p;
+		    }
+		  else
+		    {
+		      cached_reg.data = (gdb_byte *)
+			xmalloc (register_size (event->arch, reg->regnum));
+
+		      fieldsize
+			= hex2bin (p, cached_reg.data,
+				   register_size (event->arch, reg->regnum));
+		      p += 2 * fieldsize;
+		      if (fieldsize < register_size (event->arch, reg->regnum))
+			warning (_("Remote reply is too short: %s"), buf);
+		    }
 
 		  event->regcache.push_back (cached_reg);
 		}
@@ -8262,6 +8699,121 @@ remote_target::select_thread_for_ambiguous_stop_reply
     return first_resumed_thread->ptid;
 }
 
+/* Send the register set of "set remote expedited-registers" to the
+   stub with QExpediteRegisters.  */
+
+void
+remote_target::send_expedited_registers ()
+{
+  struct remote_state *rs = get_remote_state ();
+
+  if (m_features.packet_support (PACKET_QExpediteRegisters) == PACKET_DISABLE)
+    return;
+
+  /* Nothing to do if the stub already uses its default set.  */
+  if (remote_expedited_registers.empty () && !rs->expedite_deltas)
+    return;
+
+  std::string packet = "QExpediteRegisters:";
+  bool empty = true;
+
+  if (remote_expedited_registers == "all")
+    {
+      packet += "all";
+      empty = false;
+    }
+  else if (!remote_expedited_registers.empty ())
+    {
+      gdbarch *gdbarch = current_inferior ()->arch ();
+      remote_arch_state *rsa = rs->get_remote_arch_state (gdbarch);
+
+      for (const char *name : gdb_argv (remote_expedited_registers.c_str ()))
+	{
+	  int regnum = user_reg_map_name_to_regnum (gdbarch, name,
+						    strlen (name));
+
+	  /* On some architectures, the standard "pc" and "sp" names are
+	     only user registers.  Use the raw registers they stand
+	     for.  */
+	  if (regnum >= gdbarch_num_regs (gdbarch))
+	    {
+	      if (strcmp (name, "pc") == 0)
+		regnum = gdbarch_pc_regnum (gdbarch);
+	      else if (strcmp (name, "sp") == 0)
+		regnum = gdbarch_sp_regnum (gdbarch);
+	    }
+
+	  if (regnum < 0 || regnum >= gdbarch_num_regs (gdbarch))
+	    {
+	      warning (_("Not expediting unknown register \"%s\"."), name);
+	      continue;
+	    }
+
+	  packet += string_printf ("%s%s", empty ? "" : ";",
+				   phex_nz (rsa->regs[regnum].pnum, 0));
+	  empty = false;
+	}
+    }
+
+  putpkt (packet.c_str ());
+  getpkt (&rs->buf);
+  if (m_features.packet_ok (rs->buf, PACKET_QExpediteRegisters) == PACKET_OK)
+    {
+      rs->expedite_deltas = !empty;
+
+      /* The stub now only sends the registers of the new set, so the
+	 shadow copies of the registers left out of it would go
+	 stale.  */
+      for (thread_info *tp : all_non_exited_threads (this))
+	{
+	  remote_thread_info *remote_thr = get_remote_thread_info (tp);
+
+	  remote_thr->reg_shadow.clear ();
+	  remote_thr->reg_shadow_arch = nullptr;
+	}
+    }
+}
+
+/* Record in REMOTE_THR the expedited registers of STOP_REPLY, a stop of
+   thread PTID, and supply the ones the stub left out of it because
+   they did not change since the thread's previous stop.  */
+
+void
+remote_target::apply_register_delta (ptid_t ptid,
+				     remote_thread_info *remote_thr,
+				     stop_reply *stop_reply)
+{
+  gdbarch *arch = stop_reply->arch;
+
+  if (arch == nullptr)
+    arch = find_inferior_ptid (this, ptid)->arch ();
+
+  if (remote_thr->reg_shadow_arch != arch)
+    {
+      remote_thr->reg_shadow.clear ();
+      remote_thr->reg_shadow.resize (gdbarch_num_regs (arch));
+      remote_thr->reg_shadow_arch = arch;
+    }
+
+  for (const cached_reg_t &reg : stop_reply->regcache)
+    {
+      /* A register reported as unavailable has no value to keep.  */
+      if (reg.data == nullptr)
+	remote_thr->reg_shadow[reg.num].clear ();
+      else
+	remote_thr->reg_shadow[reg.num].assign
+	  (reg.data, reg.data + register_size (arch, reg.num));
+    }
+
+  struct regcache *regcache = get_thread_arch_regcache (this, ptid, arch);
+
+  /* Only fill in registers the stop reply said nothing about.  */
+  for (int regnum = 0; regnum < remote_thr->reg_shadow.size (); regnum++)
+    if (!remote_thr->reg_shadow[regnum].empty ()
+	&& regcache->get_register_status (regnum) == REG_UNKNOWN)
+      regcache->raw_supply (regnum, remote_thr->reg_shadow[regnum].data ());
+}
+
 /* Called when it is decided that STOP_REPLY holds the info of the
    event that is to be returned to the core.  This function always
    destroys STOP_REPLY.  */
@@ -8290,16 +8842,13 @@ remote_target::process_stop_reply (struct stop_reply *stop_reply,
 	    = get_thread_arch_regcache (this, ptid, stop_reply->arch);
 
 	  for (cached_reg_t &reg : stop_reply->regcache)
-	    {
-	      regcache->raw_supply (reg.num, reg.data);
-	      xfree (reg.data);
-	    }
-
-	  stop_reply->regcache.clear ();
+	    regcache->raw_supply (reg.num, reg.data);
 	}
 
       remote_notice_new_inferior (ptid, false);
       remote_thread_info *remote_thr = get_remote_thread_info (this, ptid);
+      if (get_remote_state ()->expedite_deltas)
+	apply_register_delta (ptid, remote_thr, stop_reply);
       remote_thr->core = stop_reply->core;
       remote_thr->stop_reason = stop_reply->stop_reason;
       remote_thr->watch_data_address = stop_reply->watch_data_address;
@@ -9402,6 +9951,14 @@ remote_target::remote_read_bytes_1 (CORE_ADDR memaddr, gdb_byte *myaddr,
   todo_units = std::min (len_units,
 			 (ULONGEST) (buf_size_bytes / unit_size) / 2);
 
+  /* If the transfer needs several packets, and the stub lets us, send
+     them without waiting for each reply.  */
+  int window = memory_read_window ();
+  if (window > 1 && len_units > (ULONGEST) todo_units)
+    return remote_read_bytes_pipelined (memaddr, myaddr, len_units,
+					unit_size, todo_units, window,
+					xfered_len_units);
+
   /* Construct "m"<memaddr>","<len>".  */
   memaddr = remote_address_masked (memaddr);
   p = rs->buf.data ();
@@ -9425,6 +9982,97 @@ remote_target::remote_read_bytes_1 (CORE_ADDR memaddr, gdb_byte *myaddr,
   return (*xfered_len_units != 0) ? TARGET_XFER_OK : TARGET_XFER_EOF;
 }
 
+/* Return the number of memory read requests that may be in flight at
+   once, according to "set remote memory-read-window" and to what the
+   stub accepts.  */
+
+int
+remote_target::memory_read_window ()
+{
+  struct remote_state *rs = get_remote_state ();
+
+  /* With acks, each request would have to wait for its ack anyway,
+     and a lost packet would be retransmitted out of order.  */
+  if (!rs->noack_mode)
+    return 1;
+
+  return std::min (remote_memory_read_window,
+		   (unsigned int) rs->stub_memory_read_window);
+}
+
+/* Like remote_read_bytes_1, but read up to WINDOW packets of
+   CHUNK_UNITS units at once: send all the requests, then read the
+   replies in order.  This hides the link latency for all but the
+   first packet.  */
+
+target_xfer_status
+remote_target::remote_read_bytes_pipelined (CORE_ADDR memaddr,
+					    gdb_byte *myaddr,
+					    ULONGEST len_units,
+					    int unit_size,
+					    ULONGEST chunk_units,
+					    int window,
+					    ULONGEST *xfered_len_units)
+{
+  struct remote_state *rs = get_remote_state ();
+  int count = std::min ((ULONGEST) window,
+			(len_units + chunk_units - 1) / chunk_units);
+
+  for (int i = 0; i < count; i++)
+    {
+      ULONGEST offset = i * chunk_units;
+      ULONGEST todo = std::min (chunk_units, len_units - offset);
+      char *p = rs->buf.data ();
+
+      *p++ = 'm';
+      p += hexnumstr (p, (ULONGEST) remote_address_masked (memaddr + offset));
+      *p++ = ',';
+      p += hexnumstr (p, todo);
+      *p = '\0';
+      putpkt (rs->buf);
+    }
+
+  /* Take the data up to the first error or short reply.  The replies
+     to the requests after that must still be read, to stay in sync
+     with the stub.  */
+  ULONGEST done = 0;
+  bool first_failed = false;
+  bool complete = true;
+
+  for (int i = 0; i < count; i++)
+    {
+      getpkt (&rs->buf);
+      if (!complete)
+	continue;
+
+      if (rs->buf[0] == 'E'
+	  && isxdigit (rs->buf[1]) && isxdigit (rs->buf[2])
+	  && rs->buf[3] == '\0')
+	{
+	  first_failed = i == 0;
+	  complete = false;
+	  continue;
+	}
+
+      ULONGEST offset = i * chunk_units;
+      ULONGEST todo = std::min (chunk_units, len_units - offset);
+      int decoded_bytes = hex2bin (rs->buf.data (),
+				   myaddr + offset * unit_size,
+				   todo * unit_size);
+
+      done += decoded_bytes / unit_size;
+      if ((ULONGEST) (decoded_bytes / unit_size) != todo)
+	complete = false;
+    }
+
+  if (first_failed)
+    return TARGET_XFER_E_IO;
+
+  /* Return what we have.  Let higher layers handle partial reads.  */
+  *xfered_len_units = done;
+  return (done != 0) ? TARGET_XFER_OK : TARGET_XFER_EOF;
+}
+
 /* Using the set of read-only target sections of remote, read live
    read-only memory.
 
@@ -9761,8 +10409,8 @@ remote_target::putpkt_binary (const char *buf, int cnt)
   struct remote_state *rs = get_remote_state ();
   int i;
   unsigned char csum = 0;
-  gdb::def_vector<char> data (cnt + 6);
-  char *buf2 = data.data ();
+  gdb::char_vector compressed;
+  int logical_len = cnt;
 
   int ch;
   int tcount = 0;
@@ -9784,6 +10432,24 @@ remote_target::putpkt_binary (const char *buf, int cnt)
 	       "and then try again."));
     }
 
+  /* Compress the payload if that makes it shorter.  A payload that
+     starts with '~' must always be compressed, or the stub would take
+     it for a compressed one.  */
+  if (rs->compression != remote_compression::none
+      && (cnt >= REMOTE_COMPRESS_MIN_PAYLOAD || (cnt > 0 && buf[0] == '~'))
+      && remote_compress_payload (rs->compression, buf, cnt, &compressed)
+      && ((int) compressed.size () < cnt || buf[0] == '~'))
+    {
+      remote_debug_printf_nofunc ("Compressed packet from %d to %d bytes",
+				  cnt, (int) compressed.size ());
+      buf = compressed.data ();
+      cnt = compressed.size ();
+      rs->traffic.compressed_sent++;
+    }
+
+  gdb::def_vector<char> data (cnt + 6);
+  char *buf2 = data.data ();
+
   /* Copy the packet into buffer BUF2, encapsulating it
      and giving it a checksum.  */
 
@@ -9799,6 +10465,10 @@ remote_target::putpkt_binary (const char *buf, int cnt)
   *p++ = tohex ((csum >> 4) & 0xf);
   *p++ = tohex (csum & 0xf);
 
+  rs->traffic.packets_sent++;
+  rs->traffic.logical_bytes_sent += logical_len;
+  rs->traffic.wire_bytes_sent += p - buf2;
+
   /* Send it over and over until we get a positive ack.  */
 
   while (1)
@@ -9966,6 +10636,8 @@ remote_target::read_frame (gdb::char_vector *buf_p)
   int c;
   char *buf = buf_p->data ();
   struct remote_state *rs = get_remote_state ();
+  /* The caller has already read the '$' or '%'.  */
+  long wire_len = 1;
 
   csum = 0;
   bc = 0;
@@ -9990,6 +10662,7 @@ remote_target::read_frame (gdb::char_vector *buf_p)
 	    int check_1 = 0;
 
 	    buf[bc] = '\0';
+	    wire_len += 3;
 
 	    check_0 = readchar (remote_timeout);
 	    if (check_0 >= 0)
@@ -10010,11 +10683,11 @@ remote_target::read_frame (gdb::char_vector *buf_p)
 	       don't have any way to indicate a packet retransmission
 	       is necessary.  */
 	    if (rs->noack_mode)
-	      return bc;
+	      return uncompress_frame (buf_p, bc, wire_len);
 
 	    pktcsum = (fromhex (check_0) << 4) | fromhex (check_1);
 	    if (csum == pktcsum)
-	      return bc;
+	      return uncompress_frame (buf_p, bc, wire_len);
 
 	    remote_debug_printf
 	      ("Bad checksum, sentsum=0x%x, csum=0x%x, buf=%s",
@@ -10031,6 +10704,7 @@ remote_target::read_frame (gdb::char_vector *buf_p)
 	    csum += c;
 	    c = readchar (remote_timeout);
 	    csum += c;
+	    wire_len += 2;
 	    repeat = c - ' ' + 3;	/* Compute repeat count.  */
 
 	    /* The character before ``*'' is repeated.  */
@@ -10063,11 +10737,65 @@ remote_target::read_frame (gdb::char_vector *buf_p)
 
 	  buf[bc++] = c;
 	  csum += c;
+	  wire_len++;
 	  continue;
 	}
     }
 }
 
+/* Account for a frame of WIRE_LEN bytes, whose payload of LEN bytes
+   is in *BUF_P, and replace a compressed payload with its contents.
+   Return the length of the payload, or -1 if it is malformed.  */
+
+long
+remote_target::uncompress_frame (gdb::char_vector *buf_p, long len,
+				 long wire_len)
+{
+  struct remote_state *rs = get_remote_state ();
+  char *buf = buf_p->data ();
+
+  rs->traffic.packets_received++;
+  rs->traffic.wire_bytes_received += wire_len;
+
+  if (rs->compression != remote_compression::none && buf[0] == '~')
+    {
+      const char *colon = (const char *) memchr (buf, ':', len);
+      ULONGEST out_len;
+
+      if (colon == nullptr
+	  || unpack_varlen_hex (buf + 1, &out_len) != colon
+	  || out_len > INT_MAX / 2)
+	{
+	  remote_debug_printf ("Malformed compressed packet");
+	  return -1;
+	}
+
+      gdb::byte_vector packed (len);
+      int packed_len
+	= remote_unescape_input ((const gdb_byte *) colon + 1,
+				 buf + len - colon - 1,
+				 packed.data (), len);
+
+      if (buf_p->size () < out_len + 1)
+	buf_p->resize (out_len + 1);
+      buf = buf_p->data ();
+
+      if (!remote_uncompress (rs->compression, packed.data (), packed_len,
+			      buf, out_len))
+	{
+	  remote_debug_printf ("Could not uncompress packet");
+	  return -1;
+	}
+
+      buf[out_len] = '\0';
+      len = out_len;
+      rs->traffic.compressed_received++;
+    }
+
+  rs->traffic.logical_bytes_received += len;
+  return len;
+}
+
 /* Set this to the maximum number of seconds to wait instead of waiting forever
    in target_wait().  If this timer times out, then it generates an error and
    the command is aborted.  This replaces most of the need for timeouts in the
@@ -11599,6 +12327,99 @@ remote_target::get_memory_xfer_limit ()
   return get_memory_write_packet_size ();
 }
 
+/* Implementation of the read_memory_vec target method, with the
+   vReadMemory packet.  Each packet holds as many ranges as fit, both
+   in the request and, hex encoded, in the reply.  */
+
+ULONGEST
+remote_target::read_memory_vec
+  (gdb::array_view<const memory_read_range> ranges)
+{
+  if (m_features.packet_support (PACKET_vReadMemory) == PACKET_DISABLE)
+    return 0;
+
+  /* Like xfer_partial, make sure the stub reads from the process of
+     the current inferior, and from the selected traceframe, if any.  */
+  set_remote_traceframe ();
+  set_general_thread (inferior_ptid);
+
+  struct remote_state *rs = get_remote_state ();
+  ULONGEST reply_size = get_memory_read_packet_size ();
+
+  size_t done = 0;
+  while (done < ranges.size ())
+    {
+      char *p = rs->buf.data ();
+      /* Leave room for the longest range, two 64-bit numbers in hex
+	 and two separators, and the terminating NUL.  */
+      const char *request_end = p + get_remote_packet_size () - 35;
+      ULONGEST reply_len = 0;
+      size_t count = 0;
+
+      /* Construct "vReadMemory:"<addr>","<len>[";"<addr>","<len>]...  */
+      p += xsnprintf (p, get_remote_packet_size (), "vReadMemory:");
+      for (size_t i = done; i < ranges.size () && p < request_end; ++i)
+	{
+	  const memory_read_range &range = ranges[i];
+
+	  if (reply_len + 2 * range.len > reply_size)
+	    break;
+
+	  /* The stub rejects empty ranges; there is nothing to read
+	     for them anyway, and they take no room in the reply.  */
+	  if (range.len == 0)
+	    {
+	      ++count;
+	      continue;
+	    }
+
+	  if (reply_len > 0)
+	    *p++ = ';';
+	  reply_len += 2 * range.len;
+	  p += hexnumstr (p, (ULONGEST) remote_address_masked (range.addr));
+	  *p++ = ',';
+	  p += hexnumstr (p, range.len);
+	  ++count;
+	}
+      *p = '\0';
+
+      /* The next range is too large for a single packet; let the
+	 caller read it in pieces.  */
+      if (count == 0)
+	return done;
+
+      /* Nothing to read.  */
+      if (reply_len == 0)
+	{
+	  done += count;
+	  continue;
+	}
+
+      putpkt (rs->buf);
+      getpkt (&rs->buf);
+      if (m_features.packet_ok (rs->buf, PACKET_vReadMemory) != PACKET_OK)
+	return done;
+
+      /* The reply holds the contents of the ranges, one after the
+	 other.  It stops at the first range that could not be read.  */
+      p = rs->buf.data ();
+      size_t left = strlen (p);
+      for (size_t i = 0; i < count; ++i)
+	{
+	  const memory_read_range &range = ranges[done];
+
+	  if (left < 2 * range.len)
+	    return done;
+	  hex2bin (p, range.buf, range.len);
+	  p += 2 * range.len;
+	  left -= 2 * range.len;
+	  ++done;
+	}
+    }
+
+  return done;
+}
+
 int
 remote_target::search_memory (CORE_ADDR start_addr, ULONGEST search_space_len,
 			      const gdb_byte *pattern, ULONGEST pattern_len,
@@ -11850,6 +12671,44 @@ send_remote_packet (gdb::array_view<const char> &buf,
   callbacks->received (view);
 }
 
+/* Print the counts for the WHAT direction of "maint info
+   remote-traffic", with the ratio of wire to logical bytes.  */
+
+static void
+print_remote_traffic (const char *what, ULONGEST packets,
+		      ULONGEST compressed, ULONGEST logical, ULONGEST wire)
+{
+  gdb_printf (_("Packets %s: %s (%s compressed)\n"), what,
+	      pulongest (packets), pulongest (compressed));
+  gdb_printf (_("Bytes %s: %s, %s on the wire"), what,
+	      pulongest (logical), pulongest (wire));
+  if (logical != 0)
+    gdb_printf (_(" (%.1f%%)"), 100.0 * wire / logical);
+  gdb_printf ("\n");
+}
+
+/* Entry point for the 'maint info remote-traffic' command.  */
+
+static void
+maint_info_remote_traffic (const char *args, int from_tty)
+{
+  remote_target *remote = get_current_remote_target ();
+
+  if (remote == nullptr)
+    error (_("Not connected to a remote target."));
+
+  struct remote_state *rs = remote->get_remote_state ();
+  const remote_traffic_stats &t = rs->traffic;
+
+  gdb_printf (_("Compression: %s\n"),
+	      remote_compression_name (rs->compression));
+  print_remote_traffic (_("sent"), t.packets_sent, t.compressed_sent,
+			t.logical_bytes_sent, t.wire_bytes_sent);
+  print_remote_traffic (_("received"), t.packets_received,
+			t.compressed_received, t.logical_bytes_received,
+			t.wire_bytes_received);
+}
+
 /* Entry point for the 'maint packet' command.  */
 
 static void
@@ -15404,6 +16263,12 @@ Argument is a single section name (default: all loaded sections).\n\
 To compare only read-only loaded sections, specify the -r option."),
 	   &cmdlist);
 
+  add_cmd ("remote-traffic", class_maintenance, maint_info_remote_traffic,
+	   _("\
+Show the packets and bytes exchanged with the remote target.\n\
+The byte counts are shown both before compression and as sent on the wire."),
+	   &maintenanceinfolist);
+
   add_cmd ("packet", class_maintenance, cli_packet_command, _("\
 Send an arbitrary packet to a remote target.\n\
    maintenance packet TEXT\n\
@@ -15433,6 +16298,42 @@ Valid value is \"Ctrl-C\", \"BREAK\" or \"BREAK-g\". The default is \"Ctrl-C\"."
 			&remote_set_cmdlist,
 			&remote_show_cmdlist);
 
+  add_setshow_enum_cmd ("compression", class_support,
+			remote_compression_modes, &remote_compression_mode,
+			_("\
+Set compression of remote packets."), _("\
+Show compression of remote packets."), _("\
+When connecting, GDB can ask the remote target to compress the packets\n\
+it sends, and compresses its own, which helps on slow links.\n\
+\"off\" (the default) never compresses, \"auto\" uses the best algorithm\n\
+both sides support, and \"zlib\" or \"zstd\" asks for that algorithm.\n\
+The setting takes effect at the next connection."),
+			NULL, show_remote_compression_mode,
+			&remote_set_cmdlist, &remote_show_cmdlist);
+
+  add_setshow_zuinteger_cmd ("memory-read-window", class_support,
+			     &remote_memory_read_window, _("\
+Set the maximum number of memory read requests in flight."), _("\
+Show the maximum number of memory read requests in flight."), _("\
+When a memory read needs several packets, GDB can send up to this many\n\
+requests before waiting for the first reply, if the remote target\n\
+allows it and no-ack mode is in use.  This hides the link's latency on\n\
+large transfers.  Zero or one sends one request at a time."),
+			     NULL, show_remote_memory_read_window,
+			     &remote_set_cmdlist, &remote_show_cmdlist);
+
+  add_setshow_string_noescape_cmd ("expedited-registers", class_support,
+				   &remote_expedited_registers, _("\
+Set the registers the remote target includes in its stop replies."), _("\
+Show the registers the remote target includes in its stop replies."), _("\
+Either \"all\", or a list of register names separated by spaces.  After\n\
+each stop, the remote target sends the ones that changed since the\n\
+thread's previous stop, so GDB does not need to read the whole register\n\
+file again.  An empty value leaves the choice to the remote target."),
+				   set_remote_expedited_registers,
+				   show_remote_expedited_registers,
+				   &remote_set_cmdlist, &remote_show_cmdlist);
+
   add_setshow_boolean_cmd ("interrupt-on-connect", class_support,
 			   &interrupt_on_connect, _("\
 Set whether interrupt-sequence is sent to remote target when gdb connects to."), _("\
@@ -15725,6 +16626,15 @@ Show the maximum size of the address (in bits) in a memory packet."), NULL,
   add_packet_config_cmd (PACKET_memory_tagging_feature,
 			 "memory-tagging-feature", "memory-tagging-feature", 0);
 
+  add_packet_config_cmd (PACKET_vReadMemory, "vReadMemory",
+			 "read-memory-vec", 0);
+
+  add_packet_config_cmd (PACKET_QCompression, "QCompression",
+			 "compression", 0);
+
+  add_packet_config_cmd (PACKET_QExpediteRegisters, "QExpediteRegisters",
+			 "expedite-registers", 0);
+
   /* Assert that we've registered "set remote foo-packet" commands
      for all packet configs.  */
   {
@@ -153,6 +153,44 @@ code_cache_enabled_p (void)
   return code_cache_enabled;
 }
 
+/* The option sets this.  */
+
+static bool data_cache_enabled_1 = false;
+
+/* And set_data_cache updates this.
+   The reason for the separation is so that we don't flush the cache for
+   on->on transitions.  */
+static int data_cache_enabled = 0;
+
+/* This is called *after* the data-cache has been set.
+   Flush the cache for off->on and on->off transitions.  */
+
+static void
+set_data_cache (const char *args, int from_tty, struct cmd_list_element *c)
+{
+  if (data_cache_enabled != data_cache_enabled_1)
+    target_dcache_invalidate ();
+
+  data_cache_enabled = data_cache_enabled_1;
+}
+
+/* Show option "data-cache".  */
+
+static void
+show_data_cache (struct ui_file *file, int from_tty,
+		 struct cmd_list_element *c, const char *value)
+{
+  gdb_printf (file, _("Cache use for all memory accesses is %s.\n"), value);
+}
+
+/* Return true if "data cache" is enabled, otherwise, return false.  */
+
+int
+data_cache_enabled_p (void)
+{
+  return data_cache_enabled;
+}
+
 /* Implement the 'maint flush dcache' command.  */
 
 static void
@@ -190,6 +228,19 @@ access is on."),
 			   show_code_cache,
 			   &setlist, &showlist);
 
+  add_setshow_boolean_cmd ("data-cache", class_support,
+			   &data_cache_enabled_1, _("\
+Set cache use for all memory reads."), _("\
+Show cache use for all memory reads."), _("\
+When on, use the target memory cache for all memory reads while the\n\
+inferior is stopped, regardless of any configured memory regions.  This\n\
+speeds up reading large objects from remote targets, but must not be\n\
+used with memory-mapped I/O, whose contents can change without the\n\
+program running.  By default, caching for all memory reads is off."),
+			   set_data_cache,
+			   show_data_cache,
+			   &setlist, &showlist);
+
   add_cmd ("dcache", class_maintenance, maint_flush_dcache_command,
 	   _("\
 Force gdb to flush its target memory data cache.\n\
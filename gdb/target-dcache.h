@@ -32,4 +32,6 @@ extern int stack_cache_enabled_p (void);
 
 extern int code_cache_enabled_p (void);
 
+extern int data_cache_enabled_p (void);
+
 #endif /* TARGET_DCACHE_H */
@@ -162,6 +162,8 @@
   target_debug_do_print (host_address_to_string (X.get ()))
 #define target_debug_print_gdb_array_view_const_int(X)	\
   target_debug_do_print (host_address_to_string (X.data ()))
+#define target_debug_print_gdb_array_view_const_memory_read_range(X)	\
+  target_debug_do_print (pulongest (X.size ()))
 #define target_debug_print_record_print_flags(X) \
   target_debug_do_print (plongest (X))
 #define target_debug_print_thread_control_capabilities(X) \
@@ -113,6 +113,7 @@ struct dummy_target : public target_ops
   void goto_bookmark (const gdb_byte *arg0, int arg1) override;
   CORE_ADDR get_thread_local_address (ptid_t arg0, CORE_ADDR arg1, CORE_ADDR arg2) override;
   enum target_xfer_status xfer_partial (enum target_object arg0, const char *arg1, gdb_byte *arg2, const gdb_byte *arg3, ULONGEST arg4, ULONGEST arg5, ULONGEST *arg6) override;
+  ULONGEST read_memory_vec (gdb::array_view<const memory_read_range> arg0) override;
   ULONGEST get_memory_xfer_limit () override;
   std::vector<mem_region> memory_map () override;
   void flash_erase (ULONGEST arg0, LONGEST arg1) override;
@@ -288,6 +289,7 @@ struct debug_target : public target_ops
   void goto_bookmark (const gdb_byte *arg0, int arg1) override;
   CORE_ADDR get_thread_local_address (ptid_t arg0, CORE_ADDR arg1, CORE_ADDR arg2) override;
   enum target_xfer_status xfer_partial (enum target_object arg0, const char *arg1, gdb_byte *arg2, const gdb_byte *arg3, ULONGEST arg4, ULONGEST arg5, ULONGEST *arg6) override;
+  ULONGEST read_memory_vec (gdb::array_view<const memory_read_range> arg0) override;
   ULONGEST get_memory_xfer_limit () override;
   std::vector<mem_region> memory_map () override;
   void flash_erase (ULONGEST arg0, LONGEST arg1) override;
@@ -2476,6 +2478,32 @@ debug_target::xfer_partial (enum target_object arg0, const char *arg1, gdb_byte
   return result;
 }
 
+ULONGEST
+target_ops::read_memory_vec (gdb::array_view<const memory_read_range> arg0)
+{
+  return this->beneath ()->read_memory_vec (arg0);
+}
+
+ULONGEST
+dummy_target::read_memory_vec (gdb::array_view<const memory_read_range> arg0)
+{
+  return 0;
+}
+
+ULONGEST
+debug_target::read_memory_vec (gdb::array_view<const memory_read_range> arg0)
+{
+  gdb_printf (gdb_stdlog, "-> %s->read_memory_vec (...)\n", this->beneath ()->shortname ());
+  ULONGEST result
+    = this->beneath ()->read_memory_vec (arg0);
+  gdb_printf (gdb_stdlog, "<- %s->read_memory_vec (", this->beneath ()->shortname ());
+  target_debug_print_gdb_array_view_const_memory_read_range (arg0);
+  gdb_puts (") = ", gdb_stdlog);
+  target_debug_print_ULONGEST (result);
+  gdb_puts ("\n", gdb_stdlog);
+  return result;
+}
+
 ULONGEST
 target_ops::get_memory_xfer_limit ()
 {
@@ -1474,7 +1474,8 @@ raw_memory_xfer_partial (struct target_ops *ops, gdb_byte *readbuf,
   if (writebuf != NULL
       && inferior_ptid != null_ptid
       && target_dcache_init_p ()
-      && (stack_cache_enabled_p () || code_cache_enabled_p ()))
+      && (stack_cache_enabled_p () || code_cache_enabled_p ()
+	  || data_cache_enabled_p ()))
     {
       DCACHE *dcache = target_dcache_get ();
 
@@ -1557,7 +1558,11 @@ memory_xfer_partial_1 (struct target_ops *ops, enum target_object object,
       && get_traceframe_number () == -1
       && (region->attrib.cache
 	  || (stack_cache_enabled_p () && object == TARGET_OBJECT_STACK_MEMORY)
-	  || (code_cache_enabled_p () && object == TARGET_OBJECT_CODE_MEMORY)))
+	  || (code_cache_enabled_p () && object == TARGET_OBJECT_CODE_MEMORY)
+	  /* Memory can only be assumed not to change while no thread
+	     is running.  */
+	  || (data_cache_enabled_p ()
+	      && !threads_are_executing (inf->process_target ()))))
     {
       DCACHE *dcache = target_dcache_get_or_init ();
 
@@ -1759,6 +1764,94 @@ target_read_memory (CORE_ADDR memaddr, gdb_byte *myaddr, ssize_t len)
     return -1;
 }
 
+/* See target.h.  */
+
+int
+target_read_memory_vec (gdb::array_view<const memory_read_range> ranges,
+			size_t *failed)
+{
+  inferior *inf = current_inferior ();
+  process_stratum_target *proc_target = inf->process_target ();
+  target_ops *top_target = inf->top_target ();
+
+  /* The debug target only logs the calls that go through it.  */
+  if (top_target->stratum () == debug_stratum)
+    top_target = top_target->beneath ();
+
+  /* Only the process target can read many ranges at once.  The
+     ranges are read one by one if a target above it may provide
+     memory of its own, such as a record target, or if reading memory
+     needs more than going to the target, such as with overlays or
+     trace frames.  */
+  bool vectored = (inferior_ptid != null_ptid
+		   && proc_target != nullptr
+		   && top_target->stratum () <= thread_stratum
+		   && !overlay_debugging
+		   && !trust_readonly
+		   && get_traceframe_number () == -1
+		   && gdbarch_addressable_memory_unit_size (inf->arch ()) == 1);
+
+  std::vector<memory_read_range> direct;
+  size_t done = 0;
+  while (done < ranges.size ())
+    {
+      if (vectored)
+	{
+	  /* Collect the ranges that lie in a single readable memory
+	     region, and so can be read without further checks.  */
+	  direct.clear ();
+	  for (size_t i = done; i < ranges.size (); ++i)
+	    {
+	      memory_read_range range = ranges[i];
+	      ULONGEST reg_len;
+
+	      range.addr = gdbarch_remove_non_address_bits (inf->arch (),
+							    range.addr);
+	      if (!memory_xfer_check_region (range.buf, nullptr, range.addr,
+					     range.len, &reg_len, nullptr)
+		  || reg_len != range.len)
+		break;
+	      direct.push_back (range);
+	    }
+
+	  ULONGEST n = 0;
+	  if (!direct.empty ())
+	    {
+	      n = proc_target->read_memory_vec (direct);
+	      if (targetdebug)
+		gdb_printf (gdb_stdlog,
+			    "%s:target_read_memory_vec (%s ranges) = %s\n",
+			    proc_target->shortname (),
+			    pulongest (direct.size ()), pulongest (n));
+	    }
+
+	  if (!show_memory_breakpoints)
+	    for (ULONGEST i = 0; i < n; ++i)
+	      breakpoint_xfer_memory (direct[i].buf, nullptr, nullptr,
+				      direct[i].addr, direct[i].len);
+	  done += n;
+	  if (done == ranges.size ())
+	    break;
+
+	  /* If the target could not read anything, it probably cannot
+	     read many ranges at once.  Don't ask again.  */
+	  vectored = direct.empty () || n > 0;
+	}
+
+      /* Read the next range the usual way.  */
+      const memory_read_range &range = ranges[done];
+      if (target_read_memory (range.addr, range.buf, range.len) != 0)
+	{
+	  if (failed != nullptr)
+	    *failed = done;
+	  return -1;
+	}
+      ++done;
+    }
+
+  return 0;
+}
+
 /* See target/target.h.  */
 
 int
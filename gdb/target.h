@@ -805,6 +805,17 @@ struct target_ops
 						  ULONGEST *xfered_len)
       TARGET_DEFAULT_RETURN (TARGET_XFER_E_IO);
 
+    /* Read the memory ranges RANGES of the current inferior, with as
+       few requests as possible.  Return the number of ranges, from
+       the start of RANGES, that were read completely.  The caller
+       reads the other ranges with 'xfer_partial'; a target that
+       cannot read many ranges at once just returns 0.  This is only
+       called by target_read_memory_vec, which handles breakpoint
+       shadows, memory regions and the like.  */
+    virtual ULONGEST read_memory_vec
+      (gdb::array_view<const memory_read_range> ranges)
+      TARGET_DEFAULT_RETURN (0);
+
     /* Return the limit on the size of any single memory transfer
        for the target.  */
 
@@ -1578,6 +1589,17 @@ extern bool target_can_run_breakpoint_commands ();
 extern int target_read_raw_memory (CORE_ADDR memaddr, gdb_byte *myaddr,
 				   ssize_t len);
 
+/* Read all the memory ranges RANGES, in as few requests to the target
+   as possible.  This is equivalent to calling target_read_memory for
+   each range, but much faster on targets where each request has a
+   high cost, such as remote targets.  Return 0 if all the ranges were
+   read; otherwise return -1, with *FAILED, if not NULL, set to the
+   index of the first range that could not be read.  The contents of
+   the ranges that follow that one are unspecified.  */
+
+extern int target_read_memory_vec
+  (gdb::array_view<const memory_read_range> ranges, size_t *failed = nullptr);
+
 extern int target_read_stack (CORE_ADDR memaddr, gdb_byte *myaddr, ssize_t len);
 
 extern int target_read_code (CORE_ADDR memaddr, gdb_byte *myaddr, ssize_t len);
@@ -25,6 +25,20 @@
 
 /* This header is a stopgap until more code is shared.  */
 
+/* A range of memory to read in a batch with several others.  See
+   target_read_memory_vec in GDB, and the read_memory_vec target
+   method in GDBserver.  */
+
+struct memory_read_range
+{
+  /* The address of the range.  */
+  CORE_ADDR addr;
+  /* Where to store the contents of the range.  */
+  gdb_byte *buf;
+  /* The length of the range, in bytes.  */
+  ULONGEST len;
+};
+
 /* Read LEN bytes of target memory at address MEMADDR, placing the
    results in GDB's memory at MYADDR.  Return zero for success,
    nonzero if any error occurs.  This function must be provided by
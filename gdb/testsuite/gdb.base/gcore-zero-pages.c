@@ -0,0 +1,53 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright 2023 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define BUF_SIZE (4 * 1024 * 1024)
+
+/* Mostly zeros, with a few non-zero bytes around the middle and at
+   both ends.  */
+static unsigned char static_buf[BUF_SIZE];
+
+/* Non-zero bytes at the start, then only zeros.  */
+static unsigned char *heap_buf;
+
+static void
+done (void)
+{
+}
+
+int
+main (void)
+{
+  heap_buf = malloc (BUF_SIZE);
+  if (heap_buf == NULL)
+    return 1;
+  memset (heap_buf, 0, BUF_SIZE);
+  memset (heap_buf, 0x33, 100);
+
+  static_buf[0] = 0x11;
+  static_buf[BUF_SIZE / 2 - 1] = 0xa5;
+  static_buf[BUF_SIZE / 2] = 0x5a;
+  static_buf[BUF_SIZE - 1] = 0x42;
+
+  done ();
+
+  free (heap_buf);
+  return 0;
+}
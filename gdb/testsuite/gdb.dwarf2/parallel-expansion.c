@@ -0,0 +1,37 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright 2023 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+extern int pe_func_2 (int);
+
+struct pe_struct_1
+{
+  int field_1;
+};
+
+struct pe_struct_1 pe_var_1;
+
+int
+pe_func_1 (int x)
+{
+  return pe_func_2 (x) + pe_var_1.field_1;
+}
+
+int
+main (void)
+{
+  return pe_func_1 (0);
+}
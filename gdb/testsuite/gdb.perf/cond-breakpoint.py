@@ -0,0 +1,74 @@
+# Copyright (C) 2023 Free Software Foundation, Inc.
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import time
+
+from perftest import measure
+from perftest import perftest
+from perftest import testresult
+
+
+class MeasurementHitRate(measure.Measurement):
+    """Measurement of the number of breakpoint hits per second.  The
+    test function must set HITS to the number of hits."""
+
+    def __init__(self, result):
+        super(MeasurementHitRate, self).__init__("hits_per_second", result)
+        self.start_time = 0
+        self.hits = 0
+
+    def start(self, id):
+        self.hits = 0
+        self.start_time = time.perf_counter()
+
+    def stop(self, id):
+        elapsed = time.perf_counter() - self.start_time
+        self.result.record(id, self.hits / elapsed)
+
+
+class CondBreakpoint(perftest.TestCase):
+    def __init__(self, hits):
+        result_factory = testresult.SingleStatisticResultFactory()
+        self.hit_rate = MeasurementHitRate(result_factory.create_result())
+        measurements = [
+            measure.MeasurementWallTime(result_factory.create_result()),
+            self.hit_rate,
+        ]
+        super(CondBreakpoint, self).__init__(
+            "cond-breakpoint", measure.Measure(measurements)
+        )
+        self.hits = hits
+
+    def _run(self):
+        # The condition is false on every hit but the last.
+        count = int(gdb.parse_and_eval("count"))
+        gdb.execute("set variable stop_at = %d" % (count + self.hits))
+        gdb.execute("continue", False, True)
+        self.hit_rate.hits = self.hits
+
+    def warm_up(self):
+        gdb.execute("break tick if count == stop_at", False, True)
+        gdb.execute("set variable stop_at = count + 10", False, True)
+        gdb.execute("continue", False, True)
+
+    def execute_test(self):
+        for mode in ("host", "target"):
+            gdb.execute(
+                "set breakpoint condition-evaluation " + mode, False, True
+            )
+            # Only measure what the target supports.
+            if gdb.parameter("breakpoint condition-evaluation") != mode:
+                continue
+            self.measure.measure(self._run, mode)
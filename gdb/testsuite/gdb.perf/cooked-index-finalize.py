@@ -0,0 +1,71 @@
+# Copyright (C) 2023 Free Software Foundation, Inc.
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import re
+
+from perftest import measure
+from perftest import perftest
+from perftest import testresult
+
+
+class MeasurementFinalizePhase(measure.Measurement):
+    """Measurement of one phase of the finalization of the index, as
+    reported by "maint info cooked-index"."""
+
+    def __init__(self, phase, result):
+        name = phase.lower().replace(" ", "_")
+        super(MeasurementFinalizePhase, self).__init__(name, result)
+        self.phase = phase
+
+    def start(self, id):
+        pass
+
+    def stop(self, id):
+        output = gdb.execute("maint info cooked-index", False, True)
+        total = 0.0
+        for match in re.finditer(self.phase + r": ([0-9.]+) ms", output):
+            total += float(match.group(1))
+        # Report seconds, like the other time measurements.
+        self.result.record(id, total / 1000)
+
+
+class CookedIndexFinalize(perftest.TestCase):
+    def __init__(self, binfile, load_count):
+        result_factory = testresult.SingleStatisticResultFactory()
+        measurements = [measure.MeasurementWallTime(result_factory.create_result())]
+        for phase in ["Preparation time", "Canonicalization time", "Sorting time"]:
+            measurements.append(
+                MeasurementFinalizePhase(phase, result_factory.create_result())
+            )
+        super(CookedIndexFinalize, self).__init__(
+            "cooked-index-finalize", measure.Measure(measurements)
+        )
+        self.binfile = binfile
+        self.load_count = load_count
+
+    def _load(self):
+        # Unload the program first, so that the index is built again.
+        gdb.execute("file", False, True)
+        gdb.execute("file " + self.binfile, False, True)
+        # This waits until the index is finalized.
+        gdb.execute("maint info cooked-index", False, True)
+
+    def warm_up(self):
+        gdb.execute("set confirm off")
+        self._load()
+
+    def execute_test(self):
+        for i in range(self.load_count):
+            self.measure.measure(self._load, i)
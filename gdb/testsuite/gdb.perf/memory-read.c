@@ -0,0 +1,46 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <stdlib.h>
+
+/* The buffer GDB reads from, and its size in bytes.  */
+unsigned char *buffer;
+unsigned long buffer_size;
+
+static void
+breakpt (void)
+{
+}
+
+int
+main (int argc, char **argv)
+{
+  unsigned long i;
+
+  buffer_size = 64ul << 20;
+  if (argc > 1)
+    buffer_size = strtoul (argv[1], NULL, 0) << 20;
+
+  buffer = malloc (buffer_size);
+  if (buffer == NULL)
+    return 1;
+  for (i = 0; i < buffer_size; i++)
+    buffer[i] = i * 7;
+
+  breakpt ();
+  return 0;
+}
@@ -0,0 +1,78 @@
+# Copyright (C) 2023 Free Software Foundation, Inc.
+
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+import time
+
+from perftest import measure
+from perftest import perftest
+from perftest import testresult
+
+
+class MeasurementThroughput(measure.Measurement):
+    """Measurement of the memory read throughput, in MB/s.  The test
+    function must set NBYTES to the number of bytes it read."""
+
+    def __init__(self, result):
+        super(MeasurementThroughput, self).__init__("throughput", result)
+        self.start_time = 0
+        self.nbytes = 0
+
+    def start(self, id):
+        self.nbytes = 0
+        self.start_time = time.perf_counter()
+
+    def stop(self, id):
+        elapsed = time.perf_counter() - self.start_time
+        self.result.record(id, self.nbytes / elapsed / 1e6)
+
+
+class MemoryRead(perftest.TestCase):
+    def __init__(self, chunk_kib, scattered_count):
+        result_factory = testresult.SingleStatisticResultFactory()
+        self.throughput = MeasurementThroughput(result_factory.create_result())
+        measurements = [
+            measure.MeasurementWallTime(result_factory.create_result()),
+            self.throughput,
+        ]
+        super(MemoryRead, self).__init__("memory-read", measure.Measure(measurements))
+        self.chunk = chunk_kib * 1024
+        self.scattered_count = scattered_count
+
+    def warm_up(self):
+        self.inferior = gdb.selected_inferior()
+        self.base = int(gdb.parse_and_eval("buffer"))
+        self.size = int(gdb.parse_and_eval("buffer_size"))
+
+    def _read_large(self):
+        for addr in range(self.base, self.base + self.size, self.chunk):
+            length = min(self.chunk, self.base + self.size - addr)
+            self.inferior.read_memory(addr, length)
+        self.throughput.nbytes = self.size
+
+    def _read_scattered(self, length):
+        # Spread the ranges evenly over the whole buffer, so that each
+        # one touches a different page.
+        stride = self.size // self.scattered_count
+        ranges = [
+            (self.base + i * stride, length) for i in range(self.scattered_count)
+        ]
+        self.inferior.read_memory_ranges(ranges)
+        self.throughput.nbytes = self.scattered_count * length
+
+    def execute_test(self):
+        self.measure.measure(self._read_large, "large")
+        for length in (8, 64, 512):
+            func = lambda: self._read_scattered(length)
+            self.measure.measure(func, "scattered-%d" % length)
@@ -0,0 +1,67 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright 2023 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <pthread.h>
+
+#define NUM_THREADS 16
+#define ITERATIONS 100
+
+static pthread_barrier_t barrier;
+
+/* The number of times each thread went past the breakpoint.  */
+volatile unsigned counters[NUM_THREADS];
+
+/* Entry point for threads.  All threads start hitting the breakpoint
+   at the same time.  */
+
+static void *
+thread_func (void *arg)
+{
+  volatile unsigned *counter = &counters[(long) arg];
+  int i;
+
+  pthread_barrier_wait (&barrier);
+
+  for (i = 0; i < ITERATIONS; i++)
+    (*counter)++; /* Set breakpoint here.  */
+
+  return NULL;
+}
+
+static void
+all_done (void)
+{
+}
+
+int
+main (void)
+{
+  pthread_t threads[NUM_THREADS];
+  long i;
+
+  pthread_barrier_init (&barrier, NULL, NUM_THREADS);
+
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_create (&threads[i], NULL, thread_func, (void *) i);
+
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_join (threads[i], NULL);
+
+  all_done ();
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/* This testcase is part of GDB, the GNU debugger.
+
+   Copyright 2023 Free Software Foundation, Inc.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <pthread.h>
+#include "trace-common.h"
+
+#ifndef NUM_THREADS
+#define NUM_THREADS 4
+#endif
+
+#define ITERATIONS 10
+
+/* The iteration each thread was at when it last hit the tracepoint.  */
+int values[NUM_THREADS];
+
+/* Keep the tracepoint in a function of its own, so that the call
+   instruction at the label does not clobber a caller's red zone.  */
+
+static void __attribute__ ((noinline))
+hit (void)
+{
+  FAST_TRACEPOINT_LABEL(set_point);
+}
+
+static void *
+thread_function (void *arg)
+{
+  int id = (int) (long) arg;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      values[id] = i;
+      hit ();
+    }
+
+  return NULL;
+}
+
+static void
+end (void)
+{
+}
+
+int
+main (int argc, char *argv[], char *envp[])
+{
+  pthread_t threads[NUM_THREADS];
+  long i;
+
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_create (&threads[i], NULL, thread_function, (void *) i);
+
+  for (i = 0; i < NUM_THREADS; i++)
+    pthread_join (threads[i], NULL);
+
+  end ();
+
+  return 0;
+}
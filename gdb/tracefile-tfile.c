@@ -183,6 +183,8 @@ tfile_write_status (struct trace_file_writer *self,
     fprintf (writer->fp, ";tframes:%x", ts->traceframe_count);
   if (ts->traceframes_created >= 0)
     fprintf (writer->fp, ";tcreated:%x", ts->traceframes_created);
+  if (ts->traceframes_dropped >= 0)
+    fprintf (writer->fp, ";tdropped:%x", ts->traceframes_dropped);
   if (ts->buffer_free >= 0)
     fprintf (writer->fp, ";tfree:%x", ts->buffer_free);
   if (ts->buffer_size >= 0)
@@ -1819,6 +1819,10 @@ tstatus_command (const char *args, int from_tty)
 		  ts->traceframe_count);
     }
 
+  if (ts->traceframes_dropped > 0)
+    gdb_printf (_("%d trace frames were dropped by the target.\n"),
+		ts->traceframes_dropped);
+
   if (ts->buffer_free >= 0)
     {
       if (ts->buffer_size >= 0)
@@ -1982,6 +1986,8 @@ trace_status_mi (int on_stop)
     uiout->field_signed ("frames", ts->traceframe_count);
   if (ts->traceframes_created != -1)
     uiout->field_signed ("frames-created", ts->traceframes_created);
+  if (ts->traceframes_dropped != -1)
+    uiout->field_signed ("frames-dropped", ts->traceframes_dropped);
   if (ts->buffer_size != -1)
     uiout->field_signed ("buffer-size", ts->buffer_size);
   if (ts->buffer_free != -1)
@@ -3224,6 +3230,7 @@ parse_trace_status (const char *line, struct trace_status *ts)
   ts->stop_desc = NULL;
   ts->traceframe_count = -1;
   ts->traceframes_created = -1;
+  ts->traceframes_dropped = -1;
   ts->buffer_free = -1;
   ts->buffer_size = -1;
   ts->disconnected_tracing = 0;
@@ -3311,6 +3318,11 @@ Status line: '%s'\n"), p, line);
 	  p = unpack_varlen_hex (++p1, &val);
 	  ts->traceframes_created = val;
 	}
+      else if (strncmp (p, "tdropped", p1 - p) == 0)
+	{
+	  p = unpack_varlen_hex (++p1, &val);
+	  ts->traceframes_dropped = val;
+	}
       else if (strncmp (p, "tfree", p1 - p) == 0)
 	{
 	  p = unpack_varlen_hex (++p1, &val);
@@ -122,6 +122,11 @@ struct trace_status
 
   int traceframes_created;
 
+  /* Number of traceframes the target had to discard, e.g. because the
+     in-process agent's per-thread collection buffers were full.  */
+
+  int traceframes_dropped;
+
   /* Total size of the target's trace buffer.  */
 
   int buffer_size;
@@ -0,0 +1,75 @@
+/* Self tests for the concurrent bcache
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "gdbsupport/selftest.h"
+#include "gdbsupport/parallel-for.h"
+#include "bcache.h"
+
+namespace selftests {
+namespace bcache {
+
+/* Insert the same few names many times from the worker threads, and
+   check that each name was added exactly once and that every
+   insertion of a name returned the same copy.  */
+
+static void
+test_concurrent ()
+{
+  const int n_inserts = 100000;
+  const int n_names = 1000;
+
+  gdb::concurrent_bcache cache;
+  std::vector<const char *> results (n_inserts);
+  std::atomic<int> n_added { 0 };
+
+  gdb::parallel_for_each (1, 0, n_inserts, [&] (int iter, int end)
+    {
+      for (; iter < end; ++iter)
+	{
+	  std::string name = string_printf ("name_%d", iter % n_names);
+	  bool added;
+
+	  results[iter]
+	    = (const char *) cache.insert (name.c_str (), name.size () + 1,
+					   &added);
+	  if (added)
+	    n_added.fetch_add (1, std::memory_order_relaxed);
+	}
+    });
+
+  SELF_CHECK (n_added.load () == n_names);
+  for (int i = 0; i < n_inserts; ++i)
+    {
+      SELF_CHECK (results[i] == results[i % n_names]);
+      SELF_CHECK (string_printf ("name_%d", i % n_names) == results[i]);
+    }
+  SELF_CHECK (cache.memory_used () > 0);
+}
+
+} /* namespace bcache */
+} /* namespace selftests */
+
+void _initialize_bcache_selftests ();
+void
+_initialize_bcache_selftests ()
+{
+  selftests::register_test ("concurrent_bcache",
+			    selftests::bcache::test_concurrent);
+}
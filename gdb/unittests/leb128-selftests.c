@@ -0,0 +1,215 @@
+/* Self tests for the DWARF LEB128 readers
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "gdbsupport/selftest.h"
+#include "dwarf2/leb.h"
+
+namespace selftests {
+namespace leb128 {
+
+/* Append VALUE to BUF as an unsigned LEB128 number.  */
+
+static void
+append_uleb128 (std::vector<gdb_byte> &buf, ULONGEST value)
+{
+  do
+    {
+      gdb_byte byte = value & 0x7f;
+      value >>= 7;
+      if (value != 0)
+	byte |= 0x80;
+      buf.push_back (byte);
+    }
+  while (value != 0);
+}
+
+/* Append VALUE to BUF as a signed LEB128 number.  */
+
+static void
+append_sleb128 (std::vector<gdb_byte> &buf, LONGEST value)
+{
+  while (true)
+    {
+      gdb_byte byte = value & 0x7f;
+      value >>= 7;
+      if ((value == 0 && (byte & 0x40) == 0)
+	  || (value == -1 && (byte & 0x40) != 0))
+	{
+	  buf.push_back (byte);
+	  return;
+	}
+      buf.push_back (byte | 0x80);
+    }
+}
+
+/* Check that VALUE is read back correctly, both with plenty of data
+   after it, and right at the end of the buffer.  */
+
+static void
+check_value (ULONGEST value)
+{
+  std::vector<gdb_byte> buf;
+  append_uleb128 (buf, value);
+  size_t length = buf.size ();
+
+  for (int padding : { 0, 16 })
+    {
+      std::vector<gdb_byte> padded = buf;
+      padded.resize (length + padding, 0xff);
+      const gdb_byte *end = padded.data () + padded.size ();
+
+      unsigned int bytes_read;
+      SELF_CHECK (read_unsigned_leb128 (nullptr, padded.data (), end,
+					&bytes_read) == value);
+      SELF_CHECK (bytes_read == length);
+      SELF_CHECK (read_unsigned_leb128 (nullptr, padded.data (),
+					&bytes_read) == value);
+      SELF_CHECK (bytes_read == length);
+    }
+
+  std::vector<gdb_byte> sbuf;
+  append_sleb128 (sbuf, (LONGEST) value);
+  length = sbuf.size ();
+
+  for (int padding : { 0, 16 })
+    {
+      std::vector<gdb_byte> padded = sbuf;
+      padded.resize (length + padding, 0xff);
+      const gdb_byte *end = padded.data () + padded.size ();
+
+      unsigned int bytes_read;
+      SELF_CHECK (read_signed_leb128 (nullptr, padded.data (), end,
+				      &bytes_read) == (LONGEST) value);
+      SELF_CHECK (bytes_read == length);
+    }
+}
+
+static void
+test_values ()
+{
+  /* Every length, and both sides of each length boundary.  */
+  for (int bits = 0; bits <= 64; ++bits)
+    {
+      ULONGEST value = bits == 64 ? 0 : (ULONGEST) 1 << bits;
+      check_value (value);
+      check_value (value - 1);
+      check_value (value + 1);
+      check_value (-value);
+    }
+
+  /* A redundant encoding is still accepted.  */
+  static const gdb_byte redundant[] = { 0x85, 0x80, 0x00, 0, 0, 0, 0, 0 };
+  unsigned int bytes_read;
+  SELF_CHECK (read_unsigned_leb128 (nullptr, redundant,
+				    redundant + sizeof (redundant),
+				    &bytes_read) == 5);
+  SELF_CHECK (bytes_read == 3);
+
+  /* More than 8 bytes cannot be handled as a single word.  */
+  std::vector<gdb_byte> buf;
+  append_uleb128 (buf, (ULONGEST) 1 << 60);
+  buf.resize (16, 0);
+  SELF_CHECK (leb128_word_length (buf.data ()) == 0);
+}
+
+/* Fill BUF with numbers whose lengths are distributed roughly as in
+   .debug_info: mostly abbrev codes and small constants, some
+   references and line numbers, and a few addresses and hashes.
+   Return their sum.  */
+
+static ULONGEST
+make_bulk_data (std::vector<gdb_byte> &buf)
+{
+  const int count = 1 << 20;
+  uint64_t state = 1;
+  ULONGEST sum = 0;
+
+  for (int i = 0; i < count; ++i)
+    {
+      state = state * 6364136223846793005ull + 1442695040888963407ull;
+      uint64_t random = state >> 16;
+      ULONGEST value;
+      switch (random % 50)
+	{
+	case 0:
+	  value = state;
+	  break;
+	case 1: case 2: case 3: case 4:
+	  value = random & 0xfffffff;
+	  break;
+	case 5: case 6: case 7: case 8: case 9:
+	case 10: case 11: case 12: case 13: case 14:
+	  value = random & 0x3fff;
+	  break;
+	default:
+	  value = random & 0x7f;
+	  break;
+	}
+      append_uleb128 (buf, value);
+      sum += value;
+    }
+
+  return sum;
+}
+
+/* Decode a large buffer of numbers several times, so that the
+   decoding dominates the time taken by the test.  Run with "maint
+   time 1" to compare the word-at-a-time decoder (BOUNDED true) with
+   the byte loop.  */
+
+static void
+test_bulk (bool bounded)
+{
+  std::vector<gdb_byte> buf;
+  ULONGEST expected = make_bulk_data (buf);
+
+  for (int pass = 0; pass < 16; ++pass)
+    {
+      const gdb_byte *ptr = buf.data ();
+      const gdb_byte *end = ptr + buf.size ();
+      ULONGEST sum = 0;
+      while (ptr < end)
+	{
+	  unsigned int bytes_read;
+	  if (bounded)
+	    sum += read_unsigned_leb128 (nullptr, ptr, end, &bytes_read);
+	  else
+	    sum += read_unsigned_leb128 (nullptr, ptr, &bytes_read);
+	  ptr += bytes_read;
+	}
+
+      SELF_CHECK (sum == expected);
+    }
+}
+
+} /* namespace leb128 */
+} /* namespace selftests */
+
+void _initialize_leb128_selftests ();
+void
+_initialize_leb128_selftests ()
+{
+  selftests::register_test ("dwarf2_leb128",
+			    selftests::leb128::test_values);
+  selftests::register_test ("dwarf2_leb128_bulk_bytewise",
+			    [] () { selftests::leb128::test_bulk (false); });
+  selftests::register_test ("dwarf2_leb128_bulk_word",
+			    [] () { selftests::leb128::test_bulk (true); });
+}
@@ -0,0 +1,237 @@
+/* Self tests for the minimal symbol hash tables and address index
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "gdbsupport/selftest.h"
+#include "objfiles.h"
+#include "minsyms.h"
+
+namespace selftests {
+namespace minsym_hash {
+
+/* A set of minimal symbols with made-up names, as the hash table
+   sees them.  */
+
+struct symbol_set
+{
+  explicit symbol_set (size_t count)
+    : symbols (count), names (count)
+  {
+  }
+
+  /* Give symbol I the name NAME.  */
+  void set_name (size_t i, std::string name)
+  {
+    names[i] = std::move (name);
+    symbols[i].set_linkage_name (names[i].c_str ());
+  }
+
+  /* Build TABLE from the linkage names of all the symbols.  */
+  void build (minimal_symbol_hash_table &table)
+  {
+    table.build (symbols.data (), symbols.size (),
+		 [&] (size_t i, unsigned int *hash)
+      {
+	*hash = msymbol_hash (names[i].c_str ());
+	return true;
+      });
+  }
+
+  /* Return the indices of the symbols called NAME in TABLE, in the
+     order the table visits them.  */
+  std::vector<size_t> lookup (const minimal_symbol_hash_table &table,
+			      const char *name)
+  {
+    std::vector<size_t> result;
+
+    table.find (msymbol_hash (name), [&] (minimal_symbol *msym)
+      {
+	if (strcmp (msym->linkage_name (), name) == 0)
+	  result.push_back (msym - symbols.data ());
+	return false;
+      });
+    return result;
+  }
+
+  std::vector<minimal_symbol> symbols;
+  std::vector<std::string> names;
+};
+
+/* Check lookups in a table of COUNT symbols, where every seventh
+   symbol shares its name with the one before it.  */
+
+static void
+test_lookup (size_t count)
+{
+  symbol_set set (count);
+
+  for (size_t i = 0; i < count; ++i)
+    set.set_name (i, string_printf ("sym_%zu", i % 7 == 6 ? i - 1 : i));
+
+  minimal_symbol_hash_table table;
+  set.build (table);
+
+  for (size_t i = 0; i < count; ++i)
+    {
+      std::vector<size_t> found = set.lookup (table, set.names[i].c_str ());
+
+      if (i % 7 == 5 && i + 1 < count)
+	{
+	  /* The symbol added last is found first.  */
+	  SELF_CHECK (found.size () == 2);
+	  SELF_CHECK (found[0] == i + 1);
+	  SELF_CHECK (found[1] == i);
+	}
+      else if (i % 7 == 6)
+	SELF_CHECK (found.size () == 2);
+      else
+	{
+	  SELF_CHECK (found.size () == 1);
+	  SELF_CHECK (found[0] == i);
+	}
+    }
+
+  SELF_CHECK (set.lookup (table, "no_such_symbol").empty ());
+
+  /* The callback can stop the search.  */
+  int calls = 0;
+  table.find (msymbol_hash ("sym_5"), [&] (minimal_symbol *msym)
+    {
+      ++calls;
+      return strcmp (msym->linkage_name (), "sym_5") == 0;
+    });
+  SELF_CHECK (calls >= 1);
+
+  /* Rebuilding the table with only some of the symbols drops the
+     others.  */
+  table.build (set.symbols.data (), count,
+	       [&] (size_t i, unsigned int *hash)
+    {
+      *hash = msymbol_hash (set.names[i].c_str ());
+      return i % 2 == 0;
+    });
+  SELF_CHECK (set.lookup (table, "sym_0").size () == 1);
+  SELF_CHECK (set.lookup (table, "sym_1").empty ());
+}
+
+static void
+test_lookups ()
+{
+  /* An empty table.  */
+  minimal_symbol_hash_table empty;
+  SELF_CHECK (symbol_set (0).lookup (empty, "sym_0").empty ());
+
+  /* A table small enough to be a single shard, and one big enough to
+     be built in parallel.  */
+  test_lookup (100);
+  test_lookup (100000);
+}
+
+/* Build a table with many symbols whose names look like those of a
+   large C++ program, and look each of them up several times, so that
+   the lookups dominate the time taken by the test.  Run with "maint
+   time 1" to see the cost of a lookup.  */
+
+static void
+test_bulk ()
+{
+  const size_t count = 1 << 18;
+  symbol_set set (count);
+
+  for (size_t i = 0; i < count; ++i)
+    set.set_name (i, string_printf ("_ZN9namespace5class%zu6methodEv", i));
+
+  minimal_symbol_hash_table table;
+  set.build (table);
+
+  std::vector<unsigned int> hashes (count);
+  for (size_t i = 0; i < count; ++i)
+    hashes[i] = msymbol_hash (set.names[i].c_str ());
+
+  for (int pass = 0; pass < 8; ++pass)
+    {
+      size_t found = 0;
+
+      for (size_t i = 0; i < count; ++i)
+	{
+	  const char *name = set.names[i].c_str ();
+
+	  table.find (hashes[i], [&] (minimal_symbol *msym)
+	    {
+	      if (strcmp (msym->linkage_name (), name) != 0)
+		return false;
+	      ++found;
+	      return true;
+	    });
+	}
+
+      SELF_CHECK (found == count);
+    }
+}
+
+/* Check that the address index agrees with std::upper_bound, for
+   tables of every size up to a few levels of the tree, with duplicate
+   addresses.  */
+
+static void
+test_address_index ()
+{
+  for (size_t count = 0; count < 70; ++count)
+    {
+      std::vector<minimal_symbol> symbols (count);
+      std::vector<unrelocated_addr> addrs (count);
+
+      for (size_t i = 0; i < count; ++i)
+	{
+	  /* Addresses 10, 10, 20, 30, 30, 40, ... */
+	  addrs[i] = (unrelocated_addr) (10 * (i - i / 3 + 1));
+	  symbols[i].set_unrelocated_address (addrs[i]);
+	}
+
+      minimal_symbol_address_index index;
+      index.build (symbols.data (), count);
+
+      for (CORE_ADDR addr = 0; addr < 10 * count + 20; ++addr)
+	{
+	  auto it = std::upper_bound (addrs.begin (), addrs.end (),
+				      (unrelocated_addr) addr);
+	  int expected = (it - addrs.begin ()) - 1;
+
+	  SELF_CHECK (index.find ((unrelocated_addr) addr) == expected);
+	}
+    }
+
+  minimal_symbol_address_index empty;
+  SELF_CHECK (empty.find ((unrelocated_addr) 0) == -1);
+}
+
+} /* namespace minsym_hash */
+} /* namespace selftests */
+
+void _initialize_minsym_hash_selftests ();
+void
+_initialize_minsym_hash_selftests ()
+{
+  selftests::register_test ("minsym_hash",
+			    selftests::minsym_hash::test_lookups);
+  selftests::register_test ("minsym_hash_bulk",
+			    selftests::minsym_hash::test_bulk);
+  selftests::register_test ("minsym_address_index",
+			    selftests::minsym_hash::test_address_index);
+}
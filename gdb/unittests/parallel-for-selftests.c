@@ -31,25 +31,11 @@
 #if CXX_STD_THREAD
 
 #include "gdbsupport/thread-pool.h"
+#include "unittests/save-restore-n-threads.h"
 
 namespace selftests {
 namespace parallel_for {
 
-struct save_restore_n_threads
-{
-  save_restore_n_threads ()
-    : n_threads (gdb::thread_pool::g_thread_pool->thread_count ())
-  {
-  }
-
-  ~save_restore_n_threads ()
-  {
-    gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
-  }
-
-  int n_threads;
-};
-
 /* Define test_par using TEST in the FOR_EACH-defined part.  */
 #define TEST test_par
 #define FOR_EACH gdb::parallel_for_each
@@ -57,6 +43,13 @@ struct save_restore_n_threads
 #undef FOR_EACH
 #undef TEST
 
+/* Define test_guided using TEST in the FOR_EACH-defined part.  */
+#define TEST test_guided
+#define FOR_EACH gdb::parallel_for_each_guided
+#include "parallel-for-selftests.c"
+#undef FOR_EACH
+#undef TEST
+
 /* Define test_seq using TEST in the FOR_EACH-defined part.  */
 #define TEST test_seq
 #define FOR_EACH gdb::sequential_for_each
@@ -64,11 +57,43 @@ struct save_restore_n_threads
 #undef FOR_EACH
 #undef TEST
 
+/* Test gdb::parallel_sort.  */
+
+static void
+test_sort (int n_threads)
+{
+  save_restore_n_threads saver;
+  gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+
+  /* Use a small minimum run length, so that several runs are merged
+     even with few elements.  Try counts that do not divide evenly
+     into runs.  */
+  for (int n : { 0, 1, 7, 100, 1001 })
+    {
+      std::vector<int> values;
+      unsigned int seed = 1;
+      for (int i = 0; i < n; ++i)
+	{
+	  seed = seed * 1103515245 + 12345;
+	  values.push_back ((seed >> 16) % 100);
+	}
+
+      std::vector<int> expected = values;
+      std::sort (expected.begin (), expected.end ());
+
+      gdb::parallel_sort (values.begin (), values.end (),
+			  std::less<int> (), 10);
+      SELF_CHECK (values == expected);
+    }
+}
+
 static void
 test (int n_threads)
 {
   test_par (n_threads);
+  test_guided (n_threads);
   test_seq (n_threads);
+  test_sort (n_threads);
 }
 
 static void
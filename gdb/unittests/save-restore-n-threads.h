@@ -0,0 +1,47 @@
+/* Self test helper to restore the size of the thread pool
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef UNITTESTS_SAVE_RESTORE_N_THREADS_H
+#define UNITTESTS_SAVE_RESTORE_N_THREADS_H
+
+#include "gdbsupport/thread-pool.h"
+
+namespace selftests {
+
+/* Save the number of threads of the global thread pool, and restore it
+   on destruction, so that a test can change it freely.  */
+
+struct save_restore_n_threads
+{
+  save_restore_n_threads ()
+    : n_threads (gdb::thread_pool::g_thread_pool->thread_count ())
+  {
+  }
+
+  ~save_restore_n_threads ()
+  {
+    gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+  }
+
+  int n_threads;
+};
+
+} /* namespace selftests */
+
+#endif /* UNITTESTS_SAVE_RESTORE_N_THREADS_H */
@@ -0,0 +1,152 @@
+/* Self tests for the thread pool
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "defs.h"
+#include "gdbsupport/selftest.h"
+#include "gdbsupport/thread-pool.h"
+#include "unittests/save-restore-n-threads.h"
+
+#if CXX_STD_THREAD
+
+#include <atomic>
+
+namespace selftests {
+namespace thread_pool {
+
+/* A task that increments a counter.  */
+
+struct counting_task final : public gdb::pool_task
+{
+  void run () override
+  {
+    ++*counter;
+  }
+
+  std::atomic<int> *counter = nullptr;
+};
+
+/* A task that posts more counting tasks to a nested group, and then
+   waits for them.  This checks that a worker thread waiting for a
+   group does not deadlock.  */
+
+struct nested_task final : public gdb::pool_task
+{
+  void run () override
+  {
+    counting_task subtasks[4];
+    gdb::task_group group;
+    for (counting_task &task : subtasks)
+      {
+	task.counter = counter;
+	group.post (task);
+      }
+    group.wait ();
+  }
+
+  std::atomic<int> *counter = nullptr;
+};
+
+static void
+test (int n_threads)
+{
+  save_restore_n_threads saver;
+  gdb::thread_pool::g_thread_pool->set_thread_count (n_threads);
+
+#define NUMBER 1000
+
+  /* A simple batch of tasks.  */
+  std::atomic<int> counter (0);
+  {
+    std::vector<counting_task> tasks (NUMBER);
+    gdb::task_group group;
+    for (counting_task &task : tasks)
+      {
+	task.counter = &counter;
+	group.post (task);
+      }
+    group.wait ();
+  }
+  SELF_CHECK (counter == NUMBER);
+
+  /* Tasks posting tasks.  */
+  counter = 0;
+  {
+    std::vector<nested_task> tasks (NUMBER / 4);
+    gdb::task_group group;
+    for (nested_task &task : tasks)
+      {
+	task.counter = &counter;
+	group.post (task);
+      }
+    group.wait ();
+  }
+  SELF_CHECK (counter == NUMBER);
+
+#undef NUMBER
+
+  /* An exception thrown by a task is rethrown by 'wait', once.  */
+  auto throwing = gdb::make_function_task ([] ()
+    {
+      error (_("task failed"));
+    });
+  gdb::task_group group;
+  group.post (throwing);
+  bool caught = false;
+  try
+    {
+      group.wait ();
+    }
+  catch (const gdb_exception_error &ex)
+    {
+      caught = true;
+    }
+  SELF_CHECK (caught);
+  group.wait ();
+
+  /* The future-based interface still works.  */
+  gdb::future<int> result
+    = gdb::thread_pool::g_thread_pool->post_task<int> ([] ()
+      {
+	return 23;
+      });
+  SELF_CHECK (result.get () == 23);
+}
+
+static void
+test_n_threads ()
+{
+  test (0);
+  test (1);
+  test (3);
+}
+
+}
+}
+
+#endif /* CXX_STD_THREAD */
+
+void _initialize_thread_pool_selftests ();
+void
+_initialize_thread_pool_selftests ()
+{
+#if CXX_STD_THREAD
+  selftests::register_test ("thread_pool",
+			    selftests::thread_pool::test_n_threads);
+#endif /* CXX_STD_THREAD */
+}
@@ -90,8 +90,785 @@ gdb_agent_op_name (int op)
   return gdb_agent_op_names[op];
 }
 
+/* The maximum height of the agent expression stack.  */
+#define STACK_MAX 100
+
+/* Return the value of register REGNUM in REGCACHE, zero-extended.  */
+
+static ULONGEST
+agent_register_value (struct regcache *regcache, int regnum)
+{
+  /* This union is a convenient way to convert representations.  */
+  union
+  {
+    unsigned char bytes[8];
+    unsigned char u8;
+    unsigned short u16;
+    unsigned int u32;
+    ULONGEST u64;
+  } cnv;
+
+  switch (register_size (regcache->tdesc, regnum))
+    {
+    case 8:
+      collect_register (regcache, regnum, cnv.bytes);
+      return cnv.u64;
+    case 4:
+      collect_register (regcache, regnum, cnv.bytes);
+      return cnv.u32;
+    case 2:
+      collect_register (regcache, regnum, cnv.bytes);
+      return cnv.u16;
+    case 1:
+      collect_register (regcache, regnum, cnv.bytes);
+      return cnv.u8;
+    default:
+      internal_error ("unhandled register size");
+    }
+}
+
+/* Sign-extend VAL from its low BITS bits, as the "ext" operation
+   does.  */
+
+static ULONGEST
+agent_sign_extend (ULONGEST val, int bits)
+{
+  if (bits < (sizeof (LONGEST) * 8))
+    {
+      LONGEST mask = (LONGEST) 1 << (bits - 1);
+
+      val &= ((LONGEST) 1 << bits) - 1;
+      val = (val ^ mask) - mask;
+    }
+  return val;
+}
+
 #ifndef IN_PROCESS_AGENT
 
+/* Threaded code.
+
+   Rather than decoding bytecode each time an expression is evaluated,
+   such as for a breakpoint condition on every hit, GDBserver
+   translates it once into an array of ax_insn.  Each holds a pointer
+   to the routine implementing it, and its operands, already decoded.
+   Evaluating the expression is then a matter of calling these
+   routines in turn, each returning the next instruction to run.
+
+   The height of the stack before each bytecode is fixed, so the
+   translation also resolves every stack access to a fixed slot, and
+   checks for stack overflow and underflow once and for all.  Constant
+   operands are folded into the instructions that use them.
+   Expressions that this does not handle, or that would fail these
+   checks, are left to the interpreter, which reports the errors.  */
+
+struct ax_machine;
+struct ax_insn;
+
+/* A routine implementing an instruction.  Return the next instruction
+   to run, or NULL to stop, after setting M->result.  */
+
+typedef const ax_insn *(ax_insn_fn) (ax_machine *m, const ax_insn *insn);
+
+/* An instruction of threaded code.  */
+
+struct ax_insn
+{
+  /* The routine implementing the instruction.  */
+  ax_insn_fn *fn;
+
+  /* The stack slot the instruction operates on: the first operand of
+     a binary operation, which receives the result, the operand of a
+     unary one, or the slot a value is pushed to.  */
+  int slot;
+
+  /* The decoded immediate operand, if any: a constant, a size, a
+     register or trace state variable number, or the slot to copy from
+     for "pick".  */
+  ULONGEST arg;
+
+  /* For jumps, the instruction to jump to.  */
+  const ax_insn *target;
+};
+
+/* The threaded code of an agent expression.  */
+
+struct ax_threaded_code
+{
+  std::vector<ax_insn> insns;
+};
+
+/* The state of an evaluation of threaded code.  */
+
+struct ax_machine
+{
+  struct eval_agent_expr_context *ctx;
+
+  /* How evaluation ended.  */
+  enum eval_result_type result;
+
+  /* The value on top of the stack at the end, or NULL if the stack
+     was empty.  */
+  const ULONGEST *value;
+
+  ULONGEST stack[STACK_MAX];
+};
+
+/* Stop evaluation with error RESULT.  */
+
+static const ax_insn *
+ax_fail (ax_machine *m, enum eval_result_type result)
+{
+  m->result = result;
+  return nullptr;
+}
+
+/* Define the routines for binary operation NAME, which computes EXPR
+   from A, the operand below the top of the stack, and B, the top.
+   The _imm variant takes B from the instruction instead.  */
+
+#define AX_BINARY_OP(NAME, EXPR)					\
+  static const ax_insn *						\
+  ax_ ## NAME (ax_machine *m, const ax_insn *insn)			\
+  {									\
+    ULONGEST a = m->stack[insn->slot];					\
+    ULONGEST b = m->stack[insn->slot + 1];				\
+									\
+    m->stack[insn->slot] = (EXPR);					\
+    return insn + 1;							\
+  }									\
+									\
+  static const ax_insn *						\
+  ax_ ## NAME ## _imm (ax_machine *m, const ax_insn *insn)		\
+  {									\
+    ULONGEST a = m->stack[insn->slot];					\
+    ULONGEST b = insn->arg;						\
+									\
+    m->stack[insn->slot] = (EXPR);					\
+    return insn + 1;							\
+  }
+
+AX_BINARY_OP (add, a + b)
+AX_BINARY_OP (sub, a - b)
+AX_BINARY_OP (mul, a * b)
+AX_BINARY_OP (lsh, a << b)
+AX_BINARY_OP (rsh_signed, ((LONGEST) a) >> b)
+AX_BINARY_OP (rsh_unsigned, a >> b)
+AX_BINARY_OP (bit_and, a & b)
+AX_BINARY_OP (bit_or, a | b)
+AX_BINARY_OP (bit_xor, a ^ b)
+AX_BINARY_OP (equal, a == b)
+AX_BINARY_OP (less_signed, ((LONGEST) a) < ((LONGEST) b))
+AX_BINARY_OP (less_unsigned, a < b)
+
+#undef AX_BINARY_OP
+
+/* Likewise for the division operations, which may fail.  */
+
+#define AX_DIVISION_OP(NAME, EXPR)					\
+  static const ax_insn *						\
+  ax_ ## NAME (ax_machine *m, const ax_insn *insn)			\
+  {									\
+    ULONGEST a = m->stack[insn->slot];					\
+    ULONGEST b = m->stack[insn->slot + 1];				\
+									\
+    if (b == 0)								\
+      return ax_fail (m, expr_eval_divide_by_zero);			\
+    m->stack[insn->slot] = (EXPR);					\
+    return insn + 1;							\
+  }
+
+AX_DIVISION_OP (div_signed, ((LONGEST) a) / ((LONGEST) b))
+AX_DIVISION_OP (div_unsigned, a / b)
+AX_DIVISION_OP (rem_signed, ((LONGEST) a) % ((LONGEST) b))
+AX_DIVISION_OP (rem_unsigned, a % b)
+
+#undef AX_DIVISION_OP
+
+static const ax_insn *
+ax_log_not (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] = !m->stack[insn->slot];
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_bit_not (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] = ~m->stack[insn->slot];
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_ext (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] = agent_sign_extend (m->stack[insn->slot],
+					    insn->arg);
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_zero_ext (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] &= insn->arg;
+  return insn + 1;
+}
+
+/* Replace the address on top of the stack with the T it points
+   to.  */
+
+template<typename T>
+static const ax_insn *
+ax_ref (ax_machine *m, const ax_insn *insn)
+{
+  T val;
+
+  if (agent_mem_read (m->ctx, (unsigned char *) &val,
+		      (CORE_ADDR) m->stack[insn->slot], sizeof (val)) != 0)
+    return ax_fail (m, expr_eval_invalid_memory_access);
+  m->stack[insn->slot] = val;
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_const (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] = insn->arg;
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_reg (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] = agent_register_value (m->ctx->regcache,
+					       insn->arg);
+  return insn + 1;
+}
+
+/* Copy slot ARG to SLOT; this implements both "dup" and "pick".  */
+
+static const ax_insn *
+ax_pick (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] = m->stack[insn->arg];
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_swap (ax_machine *m, const ax_insn *insn)
+{
+  std::swap (m->stack[insn->slot], m->stack[insn->slot + 1]);
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_rot (ax_machine *m, const ax_insn *insn)
+{
+  ULONGEST *s = &m->stack[insn->slot];
+  ULONGEST tem = s[2];
+
+  s[2] = s[1];
+  s[1] = s[0];
+  s[0] = tem;
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_goto (ax_machine *m, const ax_insn *insn)
+{
+  return insn->target;
+}
+
+static const ax_insn *
+ax_if_goto (ax_machine *m, const ax_insn *insn)
+{
+  if (m->stack[insn->slot])
+    return insn->target;
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_end (ax_machine *m, const ax_insn *insn)
+{
+  m->result = expr_eval_no_error;
+  m->value = insn->slot < 0 ? nullptr : &m->stack[insn->slot];
+  return nullptr;
+}
+
+static const ax_insn *
+ax_trace (ax_machine *m, const ax_insn *insn)
+{
+  agent_mem_read (m->ctx, NULL, (CORE_ADDR) m->stack[insn->slot],
+		  m->stack[insn->slot + 1]);
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_trace_quick (ax_machine *m, const ax_insn *insn)
+{
+  agent_mem_read (m->ctx, NULL, (CORE_ADDR) m->stack[insn->slot],
+		  insn->arg);
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_tracenz (ax_machine *m, const ax_insn *insn)
+{
+  agent_mem_read_string (m->ctx, NULL, (CORE_ADDR) m->stack[insn->slot],
+			 m->stack[insn->slot + 1]);
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_tracev (ax_machine *m, const ax_insn *insn)
+{
+  agent_tsv_read (m->ctx, insn->arg);
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_getv (ax_machine *m, const ax_insn *insn)
+{
+  m->stack[insn->slot] = agent_get_trace_state_variable_value (insn->arg);
+  return insn + 1;
+}
+
+static const ax_insn *
+ax_setv (ax_machine *m, const ax_insn *insn)
+{
+  agent_set_trace_state_variable_value (insn->arg, m->stack[insn->slot]);
+  return insn + 1;
+}
+
+/* Read the big-endian operand of SIZE bytes at BYTES.  */
+
+static ULONGEST
+ax_operand (const unsigned char *bytes, int size)
+{
+  ULONGEST val = 0;
+
+  for (int i = 0; i < size; ++i)
+    val = (val << 8) + bytes[i];
+  return val;
+}
+
+/* Compute the height of the stack before each bytecode of AEXPR, in
+   HEIGHTS, and mark in TARGETS those that are jumped to.  Return
+   false if the heights are not consistent, or if anything in the
+   expression would make threaded code behave differently from the
+   interpreter.  */
+
+static bool
+ax_stack_heights (const struct agent_expr *aexpr, std::vector<int> &heights,
+		  std::vector<bool> &targets)
+{
+  const int length = aexpr->length;
+  std::vector<bool> boundary (length);
+  int height = 0;
+  /* Whether the instruction at PC can be reached by falling through
+     from the previous one.  */
+  bool live = true;
+  int pc = 0;
+
+  heights.assign (length, -1);
+  targets.assign (length, false);
+
+  while (pc < length)
+    {
+      unsigned char op = aexpr->bytes[pc];
+
+      if (op >= gdb_agent_op_last || pc + 1 + gdb_agent_op_sizes[op] > length)
+	return false;
+
+      const unsigned char *operand = &aexpr->bytes[pc + 1];
+      int consumed, produced;
+
+      switch (op)
+	{
+	case gdb_agent_op_add:
+	case gdb_agent_op_sub:
+	case gdb_agent_op_mul:
+	case gdb_agent_op_div_signed:
+	case gdb_agent_op_div_unsigned:
+	case gdb_agent_op_rem_signed:
+	case gdb_agent_op_rem_unsigned:
+	case gdb_agent_op_lsh:
+	case gdb_agent_op_rsh_signed:
+	case gdb_agent_op_rsh_unsigned:
+	case gdb_agent_op_bit_and:
+	case gdb_agent_op_bit_or:
+	case gdb_agent_op_bit_xor:
+	case gdb_agent_op_equal:
+	case gdb_agent_op_less_signed:
+	case gdb_agent_op_less_unsigned:
+	  consumed = 2, produced = 1;
+	  break;
+
+	case gdb_agent_op_trace:
+	case gdb_agent_op_tracenz:
+	  consumed = 2, produced = 0;
+	  break;
+
+	case gdb_agent_op_log_not:
+	case gdb_agent_op_bit_not:
+	case gdb_agent_op_ref8:
+	case gdb_agent_op_ref16:
+	case gdb_agent_op_ref32:
+	case gdb_agent_op_ref64:
+	case gdb_agent_op_trace_quick:
+	case gdb_agent_op_setv:
+	  consumed = 1, produced = 1;
+	  break;
+
+	case gdb_agent_op_ext:
+	case gdb_agent_op_zero_ext:
+	  if (operand[0] == 0)
+	    return false;
+	  consumed = 1, produced = 1;
+	  break;
+
+	case gdb_agent_op_const8:
+	case gdb_agent_op_const16:
+	case gdb_agent_op_const32:
+	case gdb_agent_op_const64:
+	case gdb_agent_op_reg:
+	case gdb_agent_op_getv:
+	  consumed = 0, produced = 1;
+	  break;
+
+	case gdb_agent_op_dup:
+	  consumed = 1, produced = 2;
+	  break;
+
+	case gdb_agent_op_pick:
+	  consumed = operand[0] + 1, produced = operand[0] + 2;
+	  break;
+
+	case gdb_agent_op_pop:
+	case gdb_agent_op_if_goto:
+	  consumed = 1, produced = 0;
+	  break;
+
+	case gdb_agent_op_swap:
+	  consumed = 2, produced = 2;
+	  break;
+
+	case gdb_agent_op_rot:
+	  consumed = 3, produced = 3;
+	  break;
+
+	case gdb_agent_op_goto:
+	case gdb_agent_op_end:
+	case gdb_agent_op_tracev:
+	  consumed = 0, produced = 0;
+	  break;
+
+	default:
+	  /* printf, and the operations the interpreter rejects.  */
+	  return false;
+	}
+
+      /* Pick up the height at a jump target that can not be reached
+	 from the previous instruction.  */
+      if (!live)
+	{
+	  if (!targets[pc])
+	    return false;
+	  height = heights[pc];
+	}
+      else if (targets[pc] && heights[pc] != height)
+	return false;
+
+      boundary[pc] = true;
+      heights[pc] = height;
+
+      if (height < consumed)
+	return false;
+      height += produced - consumed;
+      if (height >= STACK_MAX - 1)
+	return false;
+
+      if (op == gdb_agent_op_goto || op == gdb_agent_op_if_goto)
+	{
+	  int target = ax_operand (operand, 2);
+
+	  if (target >= length
+	      || (heights[target] != -1 && heights[target] != height)
+	      || (target <= pc && !boundary[target]))
+	    return false;
+	  targets[target] = true;
+	  heights[target] = height;
+	}
+
+      live = op != gdb_agent_op_goto && op != gdb_agent_op_end;
+      pc += 1 + gdb_agent_op_sizes[op];
+    }
+
+  /* Don't let evaluation run off the end, or jump into the middle of
+     an instruction.  */
+  if (live)
+    return false;
+  for (pc = 0; pc < length; ++pc)
+    if (targets[pc] && !boundary[pc])
+      return false;
+
+  return true;
+}
+
+/* See ax.h.  */
+
+void
+gdb_compile_agent_expr (struct agent_expr *aexpr)
+{
+  std::vector<int> heights;
+  std::vector<bool> targets;
+
+  aexpr->compiled = nullptr;
+  if (aexpr->length == 0 || !ax_stack_heights (aexpr, heights, targets))
+    return;
+
+  ax_threaded_code *code = new ax_threaded_code;
+  std::vector<ax_insn> &insns = code->insns;
+  /* The instruction each bytecode translates to, for resolving
+     jumps.  */
+  std::vector<int> insn_at (aexpr->length, -1);
+  /* The bytecode of the last instruction, if it is a constant that
+     the next bytecode may fold in, or -1.  */
+  int const_pc = -1;
+  int pc = 0;
+
+  for (; pc < aexpr->length; pc += 1 + gdb_agent_op_sizes[aexpr->bytes[pc]])
+    {
+      unsigned char op = aexpr->bytes[pc];
+      const unsigned char *operand = &aexpr->bytes[pc + 1];
+      int height = heights[pc];
+      ax_insn insn = { nullptr, height - 1, 0, nullptr };
+      ax_insn_fn *imm_fn = nullptr;
+
+      /* Folding a constant into a bytecode that is jumped to would
+	 make the jump skip the constant.  */
+      if (targets[pc])
+	const_pc = -1;
+      insn_at[pc] = insns.size ();
+
+      switch (op)
+	{
+#define AX_BINARY_CASE(NAME)					\
+	case gdb_agent_op_ ## NAME:				\
+	  insn.fn = ax_ ## NAME;				\
+	  imm_fn = ax_ ## NAME ## _imm;				\
+	  insn.slot = height - 2;				\
+	  break;
+
+	AX_BINARY_CASE (add)
+	AX_BINARY_CASE (sub)
+	AX_BINARY_CASE (mul)
+	AX_BINARY_CASE (lsh)
+	AX_BINARY_CASE (rsh_signed)
+	AX_BINARY_CASE (rsh_unsigned)
+	AX_BINARY_CASE (bit_and)
+	AX_BINARY_CASE (bit_or)
+	AX_BINARY_CASE (bit_xor)
+	AX_BINARY_CASE (equal)
+	AX_BINARY_CASE (less_signed)
+	AX_BINARY_CASE (less_unsigned)
+#undef AX_BINARY_CASE
+
+	case gdb_agent_op_div_signed:
+	  insn.fn = ax_div_signed;
+	  insn.slot = height - 2;
+	  break;
+	case gdb_agent_op_div_unsigned:
+	  insn.fn = ax_div_unsigned;
+	  insn.slot = height - 2;
+	  break;
+	case gdb_agent_op_rem_signed:
+	  insn.fn = ax_rem_signed;
+	  insn.slot = height - 2;
+	  break;
+	case gdb_agent_op_rem_unsigned:
+	  insn.fn = ax_rem_unsigned;
+	  insn.slot = height - 2;
+	  break;
+
+	case gdb_agent_op_trace:
+	  insn.fn = ax_trace;
+	  insn.slot = height - 2;
+	  break;
+	case gdb_agent_op_tracenz:
+	  insn.fn = ax_tracenz;
+	  insn.slot = height - 2;
+	  break;
+	case gdb_agent_op_trace_quick:
+	  insn.fn = ax_trace_quick;
+	  insn.arg = operand[0];
+	  break;
+	case gdb_agent_op_tracev:
+	  insn.fn = ax_tracev;
+	  insn.arg = ax_operand (operand, 2);
+	  break;
+
+	case gdb_agent_op_log_not:
+	  insn.fn = ax_log_not;
+	  break;
+	case gdb_agent_op_bit_not:
+	  insn.fn = ax_bit_not;
+	  break;
+
+	case gdb_agent_op_ext:
+	  if (const_pc >= 0)
+	    {
+	      insns.back ().arg = agent_sign_extend (insns.back ().arg,
+						     operand[0]);
+	      continue;
+	    }
+	  insn.fn = ax_ext;
+	  insn.arg = operand[0];
+	  break;
+	case gdb_agent_op_zero_ext:
+	  insn.arg = (operand[0] < (sizeof (LONGEST) * 8)
+		      ? ((ULONGEST) 1 << operand[0]) - 1 : ~(ULONGEST) 0);
+	  if (const_pc >= 0)
+	    {
+	      insns.back ().arg &= insn.arg;
+	      continue;
+	    }
+	  insn.fn = ax_zero_ext;
+	  break;
+
+	case gdb_agent_op_ref8:
+	  insn.fn = ax_ref<uint8_t>;
+	  break;
+	case gdb_agent_op_ref16:
+	  insn.fn = ax_ref<uint16_t>;
+	  break;
+	case gdb_agent_op_ref32:
+	  insn.fn = ax_ref<uint32_t>;
+	  break;
+	case gdb_agent_op_ref64:
+	  insn.fn = ax_ref<uint64_t>;
+	  break;
+
+	case gdb_agent_op_const8:
+	case gdb_agent_op_const16:
+	case gdb_agent_op_const32:
+	case gdb_agent_op_const64:
+	  insn.fn = ax_const;
+	  insn.slot = height;
+	  insn.arg = ax_operand (operand, gdb_agent_op_sizes[op]);
+	  break;
+
+	case gdb_agent_op_reg:
+	  insn.fn = ax_reg;
+	  insn.slot = height;
+	  insn.arg = ax_operand (operand, 2);
+	  break;
+
+	case gdb_agent_op_getv:
+	  insn.fn = ax_getv;
+	  insn.slot = height;
+	  insn.arg = ax_operand (operand, 2);
+	  break;
+	case gdb_agent_op_setv:
+	  insn.fn = ax_setv;
+	  insn.arg = ax_operand (operand, 2);
+	  break;
+
+	case gdb_agent_op_dup:
+	  insn.fn = ax_pick;
+	  insn.slot = height;
+	  insn.arg = height - 1;
+	  break;
+	case gdb_agent_op_pick:
+	  insn.fn = ax_pick;
+	  insn.slot = height;
+	  insn.arg = height - 1 - operand[0];
+	  break;
+
+	case gdb_agent_op_pop:
+	  /* The slot is simply no longer used.  */
+	  const_pc = -1;
+	  continue;
+	case gdb_agent_op_swap:
+	  insn.fn = ax_swap;
+	  insn.slot = height - 2;
+	  break;
+	case gdb_agent_op_rot:
+	  insn.fn = ax_rot;
+	  insn.slot = height - 3;
+	  break;
+
+	case gdb_agent_op_goto:
+	  insn.fn = ax_goto;
+	  insn.arg = ax_operand (operand, 2);
+	  break;
+	case gdb_agent_op_if_goto:
+	  insn.fn = ax_if_goto;
+	  insn.arg = ax_operand (operand, 2);
+	  break;
+
+	case gdb_agent_op_end:
+	  insn.fn = ax_end;
+	  break;
+
+	default:
+	  gdb_assert_not_reached ("unexpected agent expression op");
+	}
+
+      if (const_pc >= 0 && imm_fn != nullptr)
+	{
+	  /* Turn "const N; OP" into "OP_imm N".  */
+	  size_t n = insns.size ();
+
+	  insns[n - 1].fn = imm_fn;
+	  insns[n - 1].slot = insn.slot;
+
+	  /* And "add_imm M; add_imm N" into "add_imm M+N", such as
+	     for the offsets of a local variable from the frame base.  */
+	  if (imm_fn == ax_add_imm && !targets[const_pc] && n >= 2
+	      && insns[n - 2].fn == ax_add_imm
+	      && insns[n - 2].slot == insn.slot)
+	    {
+	      insns[n - 2].arg += insns[n - 1].arg;
+	      insns.pop_back ();
+	    }
+
+	  const_pc = -1;
+	  continue;
+	}
+
+      const_pc = insn.fn == ax_const ? pc : -1;
+      insns.push_back (insn);
+    }
+
+  for (ax_insn &insn : insns)
+    if (insn.fn == ax_goto || insn.fn == ax_if_goto)
+      insn.target = &insns[insn_at[insn.arg]];
+
+  aexpr->compiled = code;
+}
+
+/* Evaluate the threaded code CODE, like gdb_eval_agent_expr.  */
+
+static enum eval_result_type
+ax_run_threaded_code (struct eval_agent_expr_context *ctx,
+		      const ax_threaded_code *code, ULONGEST *rslt)
+{
+  ax_machine m;
+  const ax_insn *insn = code->insns.data ();
+
+  m.ctx = ctx;
+  while (insn != nullptr)
+    insn = insn->fn (&m, insn);
+
+  if (m.result == expr_eval_no_error && rslt != nullptr)
+    {
+      if (m.value == nullptr)
+	return expr_eval_empty_stack;
+      *rslt = *m.value;
+    }
+  return m.result;
+}
+
 /* The packet form of an agent expression consists of an 'X', number
    of bytes in expression, a comma, and then the bytes.  */
 
@@ -109,6 +886,7 @@ gdb_parse_agent_expr (const char **actparm)
   aexpr->length = xlen;
   aexpr->bytes = (unsigned char *) xmalloc (xlen);
   hex2bin (act, aexpr->bytes, xlen);
+  gdb_compile_agent_expr (aexpr);
   *actparm = act + (xlen * 2);
   return aexpr;
 }
@@ -118,11 +896,64 @@ gdb_free_agent_expr (struct agent_expr *aexpr)
 {
   if (aexpr != NULL)
     {
+      delete aexpr->compiled;
       free (aexpr->bytes);
       free (aexpr);
     }
 }
 
+/* See ax.h.  */
+
+bool
+gdb_agent_expr_trace_bound (const struct agent_expr *aexpr, ULONGEST *size)
+{
+  /* The header of a memory block, see agent_mem_read.  */
+  const ULONGEST mblock_header
+    = 1 + sizeof (CORE_ADDR) + sizeof (unsigned short);
+  ULONGEST total = 0;
+  int pc = 0;
+
+  while (pc < aexpr->length)
+    {
+      unsigned char op = aexpr->bytes[pc];
+
+      if (op >= gdb_agent_op_last
+	  || pc + 1 + gdb_agent_op_sizes[op] > aexpr->length)
+	return false;
+
+      switch (op)
+	{
+	case gdb_agent_op_trace_quick:
+	  total += mblock_header + aexpr->bytes[pc + 1];
+	  break;
+
+	case gdb_agent_op_tracev:
+	  total += 1 + sizeof (int) + sizeof (LONGEST);
+	  break;
+
+	case gdb_agent_op_goto:
+	case gdb_agent_op_if_goto:
+	  /* A backward jump may repeat collection any number of
+	     times.  */
+	  if ((aexpr->bytes[pc + 1] << 8) + aexpr->bytes[pc + 2] <= pc)
+	    return false;
+	  break;
+
+	case gdb_agent_op_trace:
+	case gdb_agent_op_tracenz:
+	case gdb_agent_op_trace16:
+	case gdb_agent_op_setv:
+	case gdb_agent_op_printf:
+	  return false;
+	}
+
+      pc += 1 + gdb_agent_op_sizes[op];
+    }
+
+  *size = total;
+  return true;
+}
+
 /* Convert the bytes of an agent expression back into hex digits, so
    they can be printed or uploaded.  This allocates the buffer,
    callers should free when they are done with it.  */
@@ -944,7 +1775,6 @@ gdb_eval_agent_expr (struct eval_agent_expr_context *ctx,
 		     ULONGEST *rslt)
 {
   int pc = 0;
-#define STACK_MAX 100
   ULONGEST stack[STACK_MAX], top;
   int sp = 0;
   unsigned char op;
@@ -984,6 +1814,12 @@ gdb_eval_agent_expr (struct eval_agent_expr_context *ctx,
       return expr_eval_empty_expression;
     }
 
+#ifndef IN_PROCESS_AGENT
+  /* Interpret the bytecode when debugging, to show each step.  */
+  if (aexpr->compiled != nullptr && !debug_threads)
+    return ax_run_threaded_code (ctx, aexpr->compiled, rslt);
+#endif
+
   /* Cache the stack top in its own variable. Much of the time we can
      operate on this variable, rather than syncing with the stack. It
      needs to be copied to the stack when sp changes.  */
@@ -1103,12 +1939,7 @@ gdb_eval_agent_expr (struct eval_agent_expr_context *ctx,
 
 	case gdb_agent_op_ext:
 	  arg = aexpr->bytes[pc++];
-	  if (arg < (sizeof (LONGEST) * 8))
-	    {
-	      LONGEST mask = 1 << (arg - 1);
-	      top &= ((LONGEST) 1 << arg) - 1;
-	      top = (top ^ mask) - mask;
-	    }
+	  top = agent_sign_extend (top, arg);
 	  break;
 
 	case gdb_agent_op_ref8:
@@ -1188,32 +2019,7 @@ gdb_eval_agent_expr (struct eval_agent_expr_context *ctx,
 	  stack[sp++] = top;
 	  arg = aexpr->bytes[pc++];
 	  arg = (arg << 8) + aexpr->bytes[pc++];
-	  {
-	    int regnum = arg;
-	    struct regcache *regcache = ctx->regcache;
-
-	    switch (register_size (regcache->tdesc, regnum))
-	      {
-	      case 8:
-		collect_register (regcache, regnum, cnv.u64.bytes);
-		top = cnv.u64.val;
-		break;
-	      case 4:
-		collect_register (regcache, regnum, cnv.u32.bytes);
-		top = cnv.u32.val;
-		break;
-	      case 2:
-		collect_register (regcache, regnum, cnv.u16.bytes);
-		top = cnv.u16.val;
-		break;
-	      case 1:
-		collect_register (regcache, regnum, cnv.u8.bytes);
-		top = cnv.u8.val;
-		break;
-	      default:
-		internal_error ("unhandled register size");
-	      }
-	  }
+	  top = agent_register_value (ctx->regcache, arg);
 	  break;
 
 	case gdb_agent_op_end:
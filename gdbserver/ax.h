@@ -38,11 +38,18 @@ enum eval_result_type
 #undef AX_RESULT_TYPE
   };
 
+struct ax_threaded_code;
+
 struct agent_expr
 {
   int length;
 
   unsigned char *bytes;
+
+  /* The expression translated to threaded code by
+     gdb_compile_agent_expr, or NULL if it is interpreted.  Only set in
+     GDBserver, never in the in-process agent.  */
+  struct ax_threaded_code *compiled;
 };
 
 #ifndef IN_PROCESS_AGENT
@@ -51,9 +58,23 @@ struct agent_expr
    of bytes in expression, a comma, and then the bytes.  */
 struct agent_expr *gdb_parse_agent_expr (const char **actparm);
 
+/* Translate AEXPR to threaded code, so that gdb_eval_agent_expr
+   evaluates it without decoding its bytecode each time.  Leave it to
+   be interpreted if it can't be translated.  gdb_parse_agent_expr
+   does this already.  */
+void gdb_compile_agent_expr (struct agent_expr *aexpr);
+
 /* Release an agent expression.  */
 void gdb_free_agent_expr (struct agent_expr *aexpr);
 
+/* Compute an upper bound of the trace buffer space evaluating AEXPR
+   can use, and store it in *SIZE.  Return false if the amount can't
+   be known without evaluating AEXPR, or if AEXPR assigns trace state
+   variables or calls printf, so that it must not be evaluated by
+   several threads at once.  */
+bool gdb_agent_expr_trace_bound (const struct agent_expr *aexpr,
+				 ULONGEST *size);
+
 /* Convert the bytes of an agent expression back into hex digits, so
    they can be printed or uploaded.  This allocates the buffer,
    callers should free when they are done with it.  */
@@ -32,6 +32,7 @@
 #include "nat/linux-ptrace.h"
 #include "nat/linux-procfs.h"
 #include "nat/linux-personality.h"
+#include "nat/linux-process-vm.h"
 #include <signal.h>
 #include <sys/ioctl.h>
 #include <fcntl.h>
@@ -415,6 +416,7 @@ open_proc_mem_file (process_info *proc)
 
   proc->priv->mem_fd
     = gdb_open_cloexec (filename, O_RDWR | O_LARGEFILE, 0).release ();
+  proc->priv->mem_fd_failed = proc->priv->mem_fd == -1;
 }
 
 process_info *
@@ -2061,7 +2063,11 @@ linux_process_target::maybe_move_out_of_jump_pad (lwp_info *lwp, int *wstat)
 
 	      /* Cancel any fast tracepoint lock this thread was
 		 holding.  */
-	      force_unlock_trace_buffer ();
+	      CORE_ADDR thread_area;
+
+	      if (low_get_thread_area (lwpid_of (current_thread),
+				       &thread_area) == 0)
+		force_unlock_trace_buffer (thread_area);
 	    }
 
 	  if (lwp->exit_jump_pad_bkpt != NULL)
@@ -5363,6 +5369,137 @@ linux_read_memory (CORE_ADDR memaddr, unsigned char *myaddr, int len)
 }
 
 
+/* Set if process_vm_readv and process_vm_writev are not available in
+   this kernel.  Whether they are allowed is recorded per process, in
+   process_info_private::process_vm_denied.  */
+
+static bool process_vm_unsupported = false;
+
+/* Return true if process_vm_readv and process_vm_writev may be used
+   to access the memory of PROC.  Unlike /proc/PID/mem, they do not
+   stick to one address space.  If a running thread execs, they may
+   access the new one, so only use them while all threads of PROC are
+   stopped.  */
+
+static bool
+process_vm_usable_p (process_info *proc)
+{
+  if (process_vm_unsupported || proc->priv->process_vm_denied)
+    return false;
+
+  return find_thread (proc->pid, [] (thread_info *thread)
+    {
+      return !get_thread_lwp (thread)->stopped;
+    }) == nullptr;
+}
+
+/* Record that a process_vm_readv or process_vm_writev call for PROC
+   failed with errno, and return errno.  */
+
+static int
+process_vm_failed (process_info *proc)
+{
+  int err = errno;
+
+  threads_debug_printf ("process_vm_readv/writev for pid %d failed: %s",
+			proc->pid, safe_strerror (err));
+  if (linux_process_vm_unsupported_errno (err))
+    process_vm_unsupported = true;
+  else if (linux_process_vm_denied_errno (err))
+    proc->priv->process_vm_denied = true;
+  return err;
+}
+
+/* Write LEN bytes from MYADDR to the memory of the current thread's
+   process at MEMADDR, a word at a time with PTRACE_POKEDATA.  This is
+   slow, but unlike process_vm_writev, it can write to read-only
+   mappings, such as where breakpoints are inserted.  Returns 0 on
+   success, or the value of errno.  */
+
+static int
+ptrace_write_memory (CORE_ADDR memaddr, const gdb_byte *myaddr, int len)
+{
+  int pid = lwpid_of (current_thread);
+  const CORE_ADDR word_size = sizeof (PTRACE_XFER_TYPE);
+
+  while (len > 0)
+    {
+      CORE_ADDR addr = memaddr & -word_size;
+      int skip = memaddr - addr;
+      int chunk = std::min ((int) word_size - skip, len);
+      PTRACE_XFER_TYPE word;
+
+      if (skip != 0 || chunk != word_size)
+	{
+	  /* A partial word; keep the bytes around it.  */
+	  errno = 0;
+	  word = ptrace (PTRACE_PEEKTEXT, pid,
+			 (PTRACE_TYPE_ARG3) (uintptr_t) addr,
+			 (PTRACE_TYPE_ARG4) 0);
+	  if (errno != 0)
+	    return errno;
+	}
+
+      memcpy ((gdb_byte *) &word + skip, myaddr, chunk);
+
+      errno = 0;
+      ptrace (PTRACE_POKETEXT, pid, (PTRACE_TYPE_ARG3) (uintptr_t) addr,
+	      (PTRACE_TYPE_ARG4) word);
+      if (errno != 0)
+	return errno;
+
+      memaddr += chunk;
+      myaddr += chunk;
+      len -= chunk;
+    }
+
+  return 0;
+}
+
+/* Helper for read_memory/write_memory using process_vm_readv and
+   process_vm_writev, for when /proc/PID/mem could not be opened.
+   Writes that process_vm_writev refuses, to read-only mappings, are
+   retried with ptrace.  Arguments and return value are like
+   proc_xfer_memory's.  */
+
+static int
+process_vm_xfer_memory (process_info *proc, CORE_ADDR memaddr,
+			unsigned char *readbuf, const gdb_byte *writebuf,
+			int len)
+{
+  if (!process_vm_usable_p (proc))
+    return EIO;
+
+  while (len > 0)
+    {
+      ssize_t bytes = (readbuf != nullptr
+		       ? linux_process_vm_read (proc->pid, memaddr,
+						readbuf, len)
+		       : linux_process_vm_write (proc->pid, memaddr,
+						 writebuf, len));
+
+      if (bytes < 0)
+	{
+	  int err = process_vm_failed (proc);
+
+	  if (writebuf != nullptr && err == EFAULT)
+	    return ptrace_write_memory (memaddr, writebuf, len);
+	  return err;
+	}
+      else if (bytes == 0)
+	return EIO;
+
+      memaddr += bytes;
+      if (readbuf != nullptr)
+	readbuf += bytes;
+      else
+	writebuf += bytes;
+      len -= bytes;
+    }
+
+  return 0;
+}
+
 /* Helper for read_memory/write_memory using /proc/PID/mem.  Because
    we can use a single read/write call, this can be much more
    efficient than banging away at PTRACE_PEEKTEXT.  Also, unlike
@@ -5380,7 +5517,12 @@ proc_xfer_memory (CORE_ADDR memaddr, unsigned char *readbuf,
 
   int fd = proc->priv->mem_fd;
   if (fd == -1)
-    return EIO;
+    {
+      if (proc->priv->mem_fd_failed)
+	return process_vm_xfer_memory (proc, memaddr, readbuf, writebuf,
+				       len);
+      return EIO;
+    }
 
   while (len > 0)
     {
@@ -5434,6 +5576,29 @@ linux_process_target::read_memory (CORE_ADDR memaddr,
   return proc_xfer_memory (memaddr, myaddr, nullptr, len);
 }
 
+/* Implement the read_memory_vec target_ops method, with
+   process_vm_readv, which reads many ranges in a single system
+   call.  */
+
+size_t
+linux_process_target::read_memory_vec
+  (gdb::array_view<const memory_read_range> ranges)
+{
+  process_info *proc = current_process ();
+
+  if (!process_vm_usable_p (proc))
+    return 0;
+
+  ssize_t done = linux_process_vm_read_ranges (proc->pid, ranges);
+  if (done == -1)
+    {
+      process_vm_failed (proc);
+      return 0;
+    }
+
+  return done;
+}
+
 /* Copy LEN bytes of data from debugger memory at MYADDR to inferior's
    memory at MEMADDR.  On failure (cannot write to the inferior)
    returns the value of errno.  Always succeeds if LEN is zero.  */
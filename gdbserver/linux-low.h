@@ -130,6 +130,14 @@ struct process_info_private
 
   /* The /proc/pid/mem file used for reading/writing memory.  */
   int mem_fd;
+
+  /* True if opening MEM_FD failed.  Memory is then accessed with
+     process_vm_readv and process_vm_writev instead.  */
+  bool mem_fd_failed;
+
+  /* True if process_vm_readv and process_vm_writev are not allowed for
+     this process.  */
+  bool process_vm_denied;
 };
 
 struct lwp_info;
@@ -172,6 +180,9 @@ class linux_process_target : public process_stratum_target
   int write_memory (CORE_ADDR memaddr, const unsigned char *myaddr,
 		    int len) override;
 
+  size_t read_memory_vec
+    (gdb::array_view<const memory_read_range> ranges) override;
+
   void look_up_symbols () override;
 
   void request_interrupt () override;
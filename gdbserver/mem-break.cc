@@ -2037,6 +2037,7 @@ clone_agent_expr (const struct agent_expr *src_ax)
   ax->length = src_ax->length;
   ax->bytes = (unsigned char *) xcalloc (ax->length, 1);
   memcpy (ax->bytes, src_ax->bytes, ax->length);
+  gdb_compile_agent_expr (ax);
   return ax;
 }
 
@@ -172,6 +172,8 @@ free_register_cache (struct regcache *regcache)
       if (regcache->registers_owned)
 	free (regcache->registers);
       free (regcache->register_status);
+      free (regcache->reported_registers);
+      free (regcache->reported_status);
       delete regcache;
     }
 }
@@ -271,6 +273,62 @@ find_regno (const struct target_desc *tdesc, const char *name)
   internal_error ("Unknown register %s requested", name);
 }
 
+/* See regcache.h.  */
+
+bool
+regcache_changed_since_report (struct regcache *regcache, int regno)
+{
+  const struct target_desc *tdesc = regcache->tdesc;
+
+  if (regcache->reported_registers == nullptr)
+    {
+      regcache->reported_registers
+	= (unsigned char *) xmalloc (tdesc->registers_size);
+      regcache->reported_status
+	= (unsigned char *) xcalloc (1, tdesc->reg_defs.size ());
+    }
+
+  if (regcache->register_status[regno] != REG_VALID)
+    {
+      /* GDB may still have the register's last value; tell it the
+	 register is unavailable now.  */
+      if ((enum register_status) regcache->reported_status[regno]
+	  == REG_UNAVAILABLE)
+	return false;
+      regcache->reported_status[regno] = REG_UNAVAILABLE;
+      return true;
+    }
+
+  const gdb::reg &reg = find_register_by_number (tdesc, regno);
+  int offset = reg.offset / 8;
+  int size = reg.size / 8;
+
+  if (regcache->reported_status[regno] == REG_VALID
+      && memcmp (regcache->reported_registers + offset,
+		 regcache->registers + offset, size) == 0)
+    return false;
+
+  memcpy (regcache->reported_registers + offset,
+	  regcache->registers + offset, size);
+  regcache->reported_status[regno] = REG_VALID;
+  return true;
+}
+
+/* See regcache.h.  */
+
+void
+regcache_forget_reported (struct regcache *regcache, int regno)
+{
+  if (regcache->reported_status == nullptr)
+    return;
+
+  if (regno == -1)
+    memset (regcache->reported_status, REG_UNKNOWN,
+	    regcache->tdesc->reg_defs.size ());
+  else
+    regcache->reported_status[regno] = REG_UNKNOWN;
+}
+
 static void
 free_register_cache_thread (struct thread_info *thread)
 {
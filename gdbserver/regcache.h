@@ -44,6 +44,14 @@ struct regcache : public reg_buffer_common
 #ifndef IN_PROCESS_AGENT
   /* One of REG_UNAVAILABLE or REG_VALID.  */
   unsigned char *register_status = nullptr;
+
+  /* The register values last reported to GDB in a stop reply, and for
+     each register, REG_VALID if GDB was told that value,
+     REG_UNAVAILABLE if GDB was told the register is unavailable, or
+     REG_UNKNOWN if neither.  Allocated the first time a register is
+     reported.  */
+  unsigned char *reported_registers = nullptr;
+  unsigned char *reported_status = nullptr;
 #endif
 
   /* See gdbsupport/common-regcache.h.  */
@@ -75,6 +83,20 @@ struct regcache *get_thread_regcache (struct thread_info *thread, int fetch);
 
 void free_register_cache (struct regcache *regcache);
 
+/* Return true if register REGNO of REGCACHE must be sent in a stop
+   reply that only includes what GDB does not already know, that is, if
+   its value changed since it was last reported.  If so, remember the
+   current value as reported.  An unavailable register must be sent,
+   as unavailable, if it was not already reported so.  */
+
+bool regcache_changed_since_report (struct regcache *regcache, int regno);
+
+/* Forget the reported value of register REGNO of REGCACHE, or of all of
+   its registers if REGNO is -1, so that the next stop reply includes
+   it.  */
+
+void regcache_forget_reported (struct regcache *regcache, int regno);
+
 /* Invalidate cached registers for one thread.  */
 
 void regcache_invalidate_thread (struct thread_info *);
@@ -26,10 +26,15 @@
 #include "debug.h"
 #include "dll.h"
 #include "gdbsupport/rsp-low.h"
+#include "gdbsupport/byte-vector.h"
 #include "gdbsupport/netstuff.h"
 #include "gdbsupport/filestuff.h"
 #include "gdbsupport/gdb-sigmask.h"
+#include "gdbsupport/scope-exit.h"
+#include "gdbsupport/scoped_restore.h"
+#include "gdbsupport/selftest.h"
 #include <ctype.h>
+#include <zlib.h>
 #if HAVE_SYS_IOCTL_H
 #include <sys/ioctl.h>
 #endif
@@ -101,6 +106,17 @@ static int remote_is_stdio = 0;
 static int remote_desc = -1;
 static int listen_desc = -1;
 
+/* Byte counts for the current connection, logged when it is closed.
+   The logical counts are payload sizes before compression, the wire
+   counts are what was actually sent or received, framing included.  */
+
+static struct
+{
+  ULONGEST packets_sent, compressed_sent, logical_sent, wire_sent;
+  ULONGEST packets_received, compressed_received;
+  ULONGEST logical_received, wire_received;
+} remote_traffic;
+
 #ifdef USE_WIN32API
 /* gnulib wraps these as macros, undo them.  */
 # undef read
@@ -208,49 +224,16 @@ handle_accept_event (int err, gdb_client_data client_data)
   target_async (0);
 }
 
-/* Prepare for a later connection to a remote debugger.
-   NAME is the filename used for communication.  */
+/* Create a socket listening on the host and port of PARSED, which
+   were parsed from NAME with HINT, and return its descriptor.  */
 
-void
-remote_prepare (const char *name)
+static int
+create_listen_socket (const char *name, const parsed_connection_spec &parsed,
+		      const struct addrinfo *hint)
 {
-  client_state &cs = get_client_state ();
 #ifdef USE_WIN32API
   static int winsock_initialized;
-#endif
-  socklen_t tmp;
-
-  remote_is_stdio = 0;
-  if (strcmp (name, STDIO_CONNECTION_NAME) == 0)
-    {
-      /* We need to record fact that we're using stdio sooner than the
-	 call to remote_open so start_inferior knows the connection is
-	 via stdio.  */
-      remote_is_stdio = 1;
-      cs.transport_is_reliable = 1;
-      return;
-    }
-
-  struct addrinfo hint;
-  struct addrinfo *ainfo;
-
-  memset (&hint, 0, sizeof (hint));
-  /* Assume no prefix will be passed, therefore we should use
-     AF_UNSPEC.  */
-  hint.ai_family = AF_UNSPEC;
-  hint.ai_socktype = SOCK_STREAM;
-  hint.ai_protocol = IPPROTO_TCP;
-
-  parsed_connection_spec parsed
-    = parse_connection_spec_without_prefix (name, &hint);
 
-  if (parsed.port_str.empty ())
-    {
-      cs.transport_is_reliable = 0;
-      return;
-    }
-
-#ifdef USE_WIN32API
   if (!winsock_initialized)
     {
       WSADATA wsad;
@@ -260,8 +243,9 @@ remote_prepare (const char *name)
     }
 #endif
 
+  struct addrinfo *ainfo;
   int r = getaddrinfo (parsed.host_str.c_str (), parsed.port_str.c_str (),
-		       &hint, &ainfo);
+		       hint, &ainfo);
 
   if (r != 0)
     error (_("%s: cannot resolve name: %s"), name, gai_strerror (r));
@@ -269,13 +253,14 @@ remote_prepare (const char *name)
   scoped_free_addrinfo freeaddrinfo (ainfo);
 
   struct addrinfo *iter;
+  int fd = -1;
 
   for (iter = ainfo; iter != NULL; iter = iter->ai_next)
     {
-      listen_desc = gdb_socket_cloexec (iter->ai_family, iter->ai_socktype,
-					iter->ai_protocol);
+      fd = gdb_socket_cloexec (iter->ai_family, iter->ai_socktype,
+			       iter->ai_protocol);
 
-      if (listen_desc >= 0)
+      if (fd >= 0)
 	break;
     }
 
@@ -283,9 +268,8 @@ remote_prepare (const char *name)
     perror_with_name ("Can't open socket");
 
   /* Allow rapid reuse of this port. */
-  tmp = 1;
-  setsockopt (listen_desc, SOL_SOCKET, SO_REUSEADDR, (char *) &tmp,
-	      sizeof (tmp));
+  socklen_t tmp = 1;
+  setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, (char *) &tmp, sizeof (tmp));
 
   switch (iter->ai_family)
     {
@@ -299,12 +283,82 @@ remote_prepare (const char *name)
       internal_error (_("Invalid 'ai_family' %d\n"), iter->ai_family);
     }
 
-  if (bind (listen_desc, iter->ai_addr, iter->ai_addrlen) != 0)
+  if (bind (fd, iter->ai_addr, iter->ai_addrlen) != 0)
     perror_with_name ("Can't bind address");
 
-  if (listen (listen_desc, 1) != 0)
+  if (listen (fd, 1) != 0)
     perror_with_name ("Can't listen on socket");
 
+  return fd;
+}
+
+/* Return the port socket FD listens on, or an empty string, after
+   complaining, if it cannot be found.  */
+
+static std::string
+listen_port_of (int fd)
+{
+  char listen_port[GDB_NI_MAX_PORT];
+  struct sockaddr_storage sockaddr;
+  socklen_t len = sizeof (sockaddr);
+
+  if (getsockname (fd, (struct sockaddr *) &sockaddr, &len) < 0)
+    perror_with_name ("Can't determine port");
+
+  int r = getnameinfo ((struct sockaddr *) &sockaddr, len,
+		       NULL, 0,
+		       listen_port, sizeof (listen_port),
+		       NI_NUMERICSERV);
+
+  if (r != 0)
+    {
+      fprintf (stderr, _("Can't obtain port where we are listening: %s"),
+	       gai_strerror (r));
+      return {};
+    }
+
+  return listen_port;
+}
+
+/* Prepare for a later connection to a remote debugger.
+   NAME is the filename used for communication.  */
+
+void
+remote_prepare (const char *name)
+{
+  client_state &cs = get_client_state ();
+
+  remote_is_stdio = 0;
+  if (strcmp (name, STDIO_CONNECTION_NAME) == 0)
+    {
+      /* We need to record fact that we're using stdio sooner than the
+	 call to remote_open so start_inferior knows the connection is
+	 via stdio.  */
+      remote_is_stdio = 1;
+      cs.transport_is_reliable = 1;
+      return;
+    }
+
+  struct addrinfo hint;
+
+  memset (&hint, 0, sizeof (hint));
+  /* Assume no prefix will be passed, therefore we should use
+     AF_UNSPEC.  */
+  hint.ai_family = AF_UNSPEC;
+  hint.ai_socktype = SOCK_STREAM;
+  hint.ai_protocol = IPPROTO_TCP;
+
+  parsed_connection_spec parsed
+    = parse_connection_spec_without_prefix (name, &hint);
+
+  if (parsed.port_str.empty ())
+    {
+      cs.transport_is_reliable = 0;
+      return;
+    }
+
+  listen_desc = create_listen_socket (name, parsed, &hint);
+
   cs.transport_is_reliable = 1;
 }
 
@@ -380,23 +434,10 @@ remote_open (const char *name)
 #endif /* USE_WIN32API */
   else
     {
-      char listen_port[GDB_NI_MAX_PORT];
-      struct sockaddr_storage sockaddr;
-      socklen_t len = sizeof (sockaddr);
+      std::string port = listen_port_of (listen_desc);
 
-      if (getsockname (listen_desc, (struct sockaddr *) &sockaddr, &len) < 0)
-	perror_with_name ("Can't determine port");
-
-      int r = getnameinfo ((struct sockaddr *) &sockaddr, len,
-			   NULL, 0,
-			   listen_port, sizeof (listen_port),
-			   NI_NUMERICSERV);
-
-      if (r != 0)
-	fprintf (stderr, _("Can't obtain port where we are listening: %s"),
-		 gai_strerror (r));
-      else
-	fprintf (stderr, _("Listening on port %s\n"), listen_port);
+      if (!port.empty ())
+	fprintf (stderr, _("Listening on port %s\n"), port.c_str ());
 
       fflush (stderr);
 
@@ -409,6 +450,20 @@ remote_open (const char *name)
 void
 remote_close (void)
 {
+  remote_debug_printf ("sent %s packets (%s compressed), "
+		       "%s bytes, %s on the wire",
+		       pulongest (remote_traffic.packets_sent),
+		       pulongest (remote_traffic.compressed_sent),
+		       pulongest (remote_traffic.logical_sent),
+		       pulongest (remote_traffic.wire_sent));
+  remote_debug_printf ("received %s packets (%s compressed), "
+		       "%s bytes, %s on the wire",
+		       pulongest (remote_traffic.packets_received),
+		       pulongest (remote_traffic.compressed_received),
+		       pulongest (remote_traffic.logical_received),
+		       pulongest (remote_traffic.wire_received));
+  remote_traffic = {};
+
   delete_file_handler (remote_desc);
 
   disable_async_io ();
@@ -424,6 +479,356 @@ remote_close (void)
   reset_readchar ();
 }
 
+/* Read-only observer sessions.
+
+   Besides the debugger, one more client may connect to the port
+   given with --observer, to list threads and read memory without
+   taking control of the inferior.  Its I/O is non-blocking, buffered,
+   and driven by the event loop, so a slow observer never holds up the
+   debugger's session.  */
+
+#ifndef USE_WIN32API
+
+static int observer_listen_desc = -1;
+
+struct observer_session
+{
+  /* The observer's connection, or -1 if none is connected.  */
+  int fd = -1;
+
+  /* Received bytes that do not form a complete packet yet.  */
+  std::string input;
+
+  /* Bytes still to be sent.  */
+  std::string output;
+
+  /* The timer retrying to send OUTPUT, or NOT_SCHEDULED.  */
+  int flush_timer = NOT_SCHEDULED;
+
+  /* The state the packet handlers keep.  */
+  observer_state state;
+};
+
+static observer_session observer;
+
+/* The most the observer's input or output may hold.  A well-behaved
+   observer waits for each reply, so needs much less; one that stops
+   reading, or floods us, is disconnected rather than let gdbserver's
+   memory grow.  */
+
+#define OBSERVER_BUFFER_LIMIT (4 * PBUFSIZ)
+
+/* Buffer for the observer's packets and replies.  */
+
+static char *observer_buf;
+
+static void handle_observer_accept (int err, gdb_client_data client_data);
+
+/* Drop the observer's connection and wait for a new one.  */
+
+static void
+observer_close ()
+{
+  delete_file_handler (observer.fd);
+  close (observer.fd);
+  if (observer.flush_timer != NOT_SCHEDULED)
+    delete_timer (observer.flush_timer);
+  observer = {};
+
+  fprintf (stderr, _("Observer disconnected\n"));
+  add_file_handler (observer_listen_desc, handle_observer_accept, NULL,
+		    "observer-listen");
+}
+
+static void observer_flush ();
+
+static void
+observer_flush_callback (gdb_client_data client_data)
+{
+  observer.flush_timer = NOT_SCHEDULED;
+  observer_flush ();
+}
+
+/* Send as much of the observer's pending output as its connection
+   takes without blocking, and try again later if some is left.  */
+
+static void
+observer_flush ()
+{
+  while (!observer.output.empty ())
+    {
+      ssize_t n = write (observer.fd, observer.output.data (),
+			 observer.output.size ());
+
+      if (n < 0)
+	{
+	  if (errno == EINTR)
+	    continue;
+	  if (errno == EAGAIN || errno == EWOULDBLOCK)
+	    break;
+	  observer_close ();
+	  return;
+	}
+      observer.output.erase (0, n);
+    }
+
+  if (!observer.output.empty ())
+    {
+      if (observer.flush_timer == NOT_SCHEDULED)
+	observer.flush_timer = create_timer (10, observer_flush_callback,
+					     NULL);
+    }
+  else if (observer.state.closing)
+    observer_close ();
+}
+
+/* Queue the LEN bytes of PAYLOAD to be sent to the observer as a
+   packet.  */
+
+static void
+observer_putpkt (const char *payload, int len)
+{
+  unsigned char csum = 0;
+
+  observer.output += '$';
+  for (int i = 0; i < len; i++)
+    {
+      observer.output += payload[i];
+      csum += payload[i];
+    }
+  observer.output += '#';
+  observer.output += tohex ((csum >> 4) & 0xf);
+  observer.output += tohex (csum & 0xf);
+}
+
+/* Handle the complete packets the observer sent, acknowledging each
+   and queuing the replies.  */
+
+static void
+observer_process_input ()
+{
+  std::string &input = observer.input;
+  size_t pos = 0;
+
+  while (pos < input.size () && !observer.state.closing)
+    {
+      /* Skip acknowledgments and interrupt requests; the observer
+	 can't interrupt the inferior.  */
+      if (input[pos] != '$')
+	{
+	  ++pos;
+	  continue;
+	}
+
+      size_t hash = input.find ('#', pos);
+      if (hash == std::string::npos || hash + 2 >= input.size ())
+	break;
+
+      const char *payload = input.data () + pos + 1;
+      size_t len = hash - pos - 1;
+      unsigned char csum = 0;
+      for (size_t i = 0; i < len; i++)
+	csum += payload[i];
+
+      bool valid = (isxdigit (input[hash + 1]) && isxdigit (input[hash + 2])
+		    && csum == ((fromhex (input[hash + 1]) << 4)
+				| fromhex (input[hash + 2])));
+      if (!valid)
+	{
+	  observer.output += '-';
+	  pos = hash + 3;
+	  continue;
+	}
+      observer.output += '+';
+
+      bool reply = true;
+      int reply_len = -1;
+      if (len >= PBUFSIZ)
+	write_enn (observer_buf);
+      else
+	{
+	  memcpy (observer_buf, payload, len);
+	  observer_buf[len] = '\0';
+
+	  try
+	    {
+	      reply = handle_observer_packet (observer.state, observer_buf,
+					      len, &reply_len);
+	    }
+	  catch (const gdb_exception_error &ex)
+	    {
+	      write_enn (observer_buf);
+	    }
+	}
+
+      if (reply)
+	observer_putpkt (observer_buf, (reply_len < 0 ? strlen (observer_buf)
+					: reply_len));
+      pos = hash + 3;
+    }
+
+  input.erase (0, pos);
+}
+
+/* Event-loop callback for data from the observer.  */
+
+static void
+handle_observer_event (int err, gdb_client_data client_data)
+{
+  char buf[BUFSIZ];
+
+  while (1)
+    {
+      ssize_t n = read (observer.fd, buf, sizeof (buf));
+
+      if (n > 0)
+	{
+	  observer.input.append (buf, n);
+	  observer_process_input ();
+	  observer_flush ();
+
+	  /* The connection may have been closed.  */
+	  if (observer.fd == -1)
+	    return;
+
+	  if (observer.input.size () > OBSERVER_BUFFER_LIMIT
+	      || observer.output.size () > OBSERVER_BUFFER_LIMIT)
+	    {
+	      fprintf (stderr, _("Observer buffer overflow\n"));
+	      observer_close ();
+	      return;
+	    }
+	  continue;
+	}
+      if (n < 0 && errno == EINTR)
+	continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	break;
+
+      /* End of file, or an error.  */
+      observer_close ();
+      return;
+    }
+
+  observer_process_input ();
+  observer_flush ();
+}
+
+/* Event-loop callback for a new observer connection.  */
+
+static void
+handle_observer_accept (int err, gdb_client_data client_data)
+{
+  int fd = accept (observer_listen_desc, NULL, NULL);
+
+  if (fd == -1)
+    {
+      perror ("Accepting observer failed");
+      return;
+    }
+
+  /* Serve one observer at a time.  */
+  delete_file_handler (observer_listen_desc);
+
+  socklen_t tmp = 1;
+  setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, (char *) &tmp, sizeof (tmp));
+  fcntl (fd, F_SETFD, FD_CLOEXEC);
+  fcntl (fd, F_SETFL, fcntl (fd, F_GETFL, 0) | O_NONBLOCK);
+
+  observer.fd = fd;
+  add_file_handler (fd, handle_observer_event, NULL, "observer");
+  fprintf (stderr, _("Observer connected\n"));
+}
+
+#endif /* USE_WIN32API */
+
+/* See remote-utils.h.  */
+
+void
+observer_open (const char *name)
+{
+#ifdef USE_WIN32API
+  error (_("Observer sessions are not supported on this host."));
+#else
+  struct addrinfo hint;
+
+  memset (&hint, 0, sizeof (hint));
+  hint.ai_family = AF_UNSPEC;
+  hint.ai_socktype = SOCK_STREAM;
+  hint.ai_protocol = IPPROTO_TCP;
+
+  parsed_connection_spec parsed
+    = parse_connection_spec_without_prefix (name, &hint);
+
+  if (parsed.port_str.empty ())
+    error (_("%s: observers can only connect over TCP, as HOST:PORT"), name);
+
+  observer_listen_desc = create_listen_socket (name, parsed, &hint);
+  observer_buf = (char *) xmalloc (PBUFSIZ + 1);
+
+  std::string port = listen_port_of (observer_listen_desc);
+
+  if (!port.empty ())
+    fprintf (stderr, _("Listening for observers on port %s\n"),
+	     port.c_str ());
+
+  fflush (stderr);
+
+  /* Don't die if an observer goes away while we write to it.  */
+  signal (SIGPIPE, SIG_IGN);
+
+  add_file_handler (observer_listen_desc, handle_observer_accept, NULL,
+		    "observer-listen");
+#endif
+}
+
+/* See remote-utils.h.  */
+
+bool
+observer_serve (int timeout_ms)
+{
+#ifdef USE_WIN32API
+  return false;
+#else
+  /* Accept a new observer too, if none is connected.  */
+  int fd = observer.fd != -1 ? observer.fd : observer_listen_desc;
+  if (fd == -1)
+    return false;
+
+  fd_set readset, writeset;
+  FD_ZERO (&readset);
+  FD_ZERO (&writeset);
+  FD_SET (fd, &readset);
+  if (!observer.output.empty ())
+    FD_SET (fd, &writeset);
+
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+
+  /* Let SIGCHLD, which the caller may block while it polls the target,
+     interrupt the wait, so that a stop of the inferior is not left
+     waiting for the timeout.  */
+  sigset_t mask;
+  gdb_sigmask (SIG_BLOCK, NULL, &mask);
+#ifdef SIGCHLD
+  sigdelset (&mask, SIGCHLD);
+#endif
+
+  if (pselect (fd + 1, &readset, &writeset, NULL, &timeout, &mask) > 0)
+    {
+      if (fd == observer_listen_desc)
+	handle_observer_accept (0, NULL);
+      else if (FD_ISSET (fd, &readset))
+	handle_observer_event (0, NULL);
+      else
+	observer_flush ();
+    }
+
+  return true;
+#endif
+}
+
 #endif
 
 #ifndef IN_PROCESS_AGENT
@@ -621,6 +1026,66 @@ read_prim (void *buf, int count)
     return read (remote_desc, buf, count);
 }
 
+/* Payloads shorter than this are never compressed; the header and
+   the zlib overhead would outweigh any saving.  */
+#define COMPRESS_MIN_PAYLOAD 64
+
+/* Compress the CNT bytes of payload in BUF into *OUT, as a '~'
+   payload: the uncompressed length in hex, a colon, and the escaped
+   zlib stream.  Return false if BUF could not be compressed.  */
+
+static bool
+compress_payload (const char *buf, int cnt, gdb::byte_vector *out)
+{
+  uLongf packed_len = compressBound (cnt);
+  gdb::byte_vector packed (packed_len);
+
+  if (compress2 (packed.data (), &packed_len, (const Bytef *) buf, cnt,
+		 Z_DEFAULT_COMPRESSION) != Z_OK)
+    return false;
+
+  std::string header = string_printf ("~%x:", cnt);
+  int escaped_len;
+
+  out->resize (header.size () + 2 * packed_len);
+  memcpy (out->data (), header.data (), header.size ());
+  int used = remote_escape_output (packed.data (), packed_len, 1,
+				   out->data () + header.size (),
+				   &escaped_len, 2 * packed_len);
+  out->resize (header.size () + used);
+  return true;
+}
+
+/* Replace the '~' payload in BUF, LEN bytes long, with its
+   uncompressed contents.  Return the new length, or -1 if the payload
+   is malformed.  */
+
+static int
+decompress_payload (char *buf, int len)
+{
+  const char *colon = (const char *) memchr (buf, ':', len);
+  ULONGEST out_len;
+
+  if (colon == nullptr
+      || unpack_varlen_hex (buf + 1, &out_len) != colon
+      || out_len >= PBUFSIZ)
+    return -1;
+
+  gdb::byte_vector packed (len);
+  int packed_len = remote_unescape_input ((const gdb_byte *) colon + 1,
+					  buf + len - colon - 1,
+					  packed.data (), len);
+
+  uLongf dest_len = out_len;
+  if (uncompress ((Bytef *) buf, &dest_len, packed.data (),
+		  packed_len) != Z_OK
+      || dest_len != out_len)
+    return -1;
+
+  buf[out_len] = '\0';
+  return out_len;
+}
+
 /* Send a packet to the remote machine, with error checking.
    The data of the packet is in BUF, and the length of the
    packet is in CNT.  Returns >= 0 on success, -1 otherwise.  */
@@ -634,6 +1099,22 @@ putpkt_binary_1 (char *buf, int cnt, int is_notif)
   char *buf2;
   char *p;
   int cc;
+  gdb::byte_vector compressed;
+  int logical_len = cnt;
+
+  /* A payload that starts with '~' must be sent compressed, or it
+     would be mistaken for a compressed one.  */
+  if (cs.compression != remote_compression::none
+      && (cnt >= COMPRESS_MIN_PAYLOAD || (cnt > 0 && buf[0] == '~'))
+      && compress_payload (buf, cnt, &compressed)
+      && ((int) compressed.size () < cnt || buf[0] == '~'))
+    {
+      remote_debug_printf ("putpkt: compressed %d bytes to %d", cnt,
+			   (int) compressed.size ());
+      buf = (char *) compressed.data ();
+      cnt = compressed.size ();
+      remote_traffic.compressed_sent++;
+    }
 
   buf2 = (char *) xmalloc (strlen ("$") + cnt + strlen ("#nn") + 1);
 
@@ -655,6 +1136,10 @@ putpkt_binary_1 (char *buf, int cnt, int is_notif)
 
   *p = '\0';
 
+  remote_traffic.packets_sent++;
+  remote_traffic.logical_sent += logical_len;
+  remote_traffic.wire_sent += p - buf2;
+
   /* Send it over and over until we get a positive ack.  */
 
   do
@@ -918,6 +1403,8 @@ getpkt (char *buf)
   char *bp;
   unsigned char csum, c1, c2;
   int c;
+  int len;
+  int wire_len;
 
   while (1)
     {
@@ -960,25 +1447,56 @@ getpkt (char *buf)
       c1 = fromhex (readchar ());
       c2 = fromhex (readchar ());
 
-      if (csum == (c1 << 4) + c2)
-	break;
-
-      if (cs.noack_mode)
+      if (csum != (c1 << 4) + c2)
 	{
+	  if (!cs.noack_mode)
+	    {
+	      fprintf (stderr,
+		       "Bad checksum, sentsum=0x%x, csum=0x%x, buf=%s\n",
+		       (c1 << 4) + c2, csum, buf);
+	      if (write_prim ("-", 1) != 1)
+		return -1;
+	      continue;
+	    }
+
 	  fprintf (stderr,
 		   "Bad checksum, sentsum=0x%x, csum=0x%x, "
 		   "buf=%s [no-ack-mode, Bad medium?]\n",
 		   (c1 << 4) + c2, csum, buf);
 	  /* Not much we can do, GDB wasn't expecting an ack/nac.  */
+	}
+
+      wire_len = bp - buf;
+      len = wire_len;
+      if (cs.compression == remote_compression::none || buf[0] != '~')
+	break;
+
+      len = decompress_payload (buf, wire_len);
+      if (len >= 0)
+	{
+	  remote_debug_printf ("getpkt: decompressed %d bytes to %d",
+			       wire_len, len);
+	  remote_traffic.compressed_received++;
 	  break;
 	}
 
-      fprintf (stderr, "Bad checksum, sentsum=0x%x, csum=0x%x, buf=%s\n",
-	       (c1 << 4) + c2, csum, buf);
+      /* The compressed payload is malformed.  Like for a bad checksum,
+	 ask GDB to send the packet again, if it expects acks.  */
+      if (cs.noack_mode)
+	{
+	  fprintf (stderr, "Malformed compressed packet [no-ack-mode]\n");
+	  return -1;
+	}
+
+      fprintf (stderr, "Malformed compressed packet\n");
       if (write_prim ("-", 1) != 1)
 	return -1;
     }
 
+  remote_traffic.packets_received++;
+  remote_traffic.wire_received += wire_len + strlen ("$#nn");
+  remote_traffic.logical_received += len;
+
   if (!cs.noack_mode)
     {
       remote_debug_printf ("getpkt (\"%s\");  [sending ack]", buf);
@@ -1007,7 +1525,7 @@ getpkt (char *buf)
       the_target->request_interrupt ();
     }
 
-  return bp - buf;
+  return len;
 }
 
 void
@@ -1032,8 +1550,11 @@ write_enn (char *buf)
 
 #ifndef IN_PROCESS_AGENT
 
+/* Write to BUF the number of register REGNO, as the start of its
+   "n:r" pair in a stop reply.  */
+
 static char *
-outreg (struct regcache *regcache, int regno, char *buf)
+outreg_number (int regno, char *buf)
 {
   if ((regno >> 12) != 0)
     *buf++ = tohex ((regno >> 12) & 0xf);
@@ -1042,6 +1563,14 @@ outreg (struct regcache *regcache, int regno, char *buf)
   *buf++ = tohex ((regno >> 4) & 0xf);
   *buf++ = tohex (regno & 0xf);
   *buf++ = ':';
+
+  return buf;
+}
+
+static char *
+outreg (struct regcache *regcache, int regno, char *buf)
+{
+  buf = outreg_number (regno, buf);
   collect_register_as_string (regcache, regno, buf);
   buf += 2 * register_size (regcache->tdesc, regno);
   *buf++ = ';';
@@ -1049,6 +1578,121 @@ outreg (struct regcache *regcache, int regno, char *buf)
   return buf;
 }
 
+/* Like outreg, but report register REGNO as unavailable, with an 'x'
+   in place of each hex digit of its value.  */
+
+static char *
+outreg_unavailable (struct regcache *regcache, int regno, char *buf)
+{
+  int size = register_size (regcache->tdesc, regno);
+
+  buf = outreg_number (regno, buf);
+  memset (buf, 'x', 2 * size);
+  buf += 2 * size;
+  *buf++ = ';';
+
+  return buf;
+}
+
+/* Write to BUF the registers GDB asked for with QExpediteRegisters,
+   together with the target's own expedited registers, leaving out
+   those whose values GDB already knows from an earlier stop reply for
+   this thread.  */
+
+static char *
+outreg_changed (client_state &cs, struct regcache *regcache, char *buf)
+{
+  const struct target_desc *tdesc = regcache->tdesc;
+  int num_regs = tdesc->reg_defs.size ();
+
+  auto maybe_outreg = [&] (int regno)
+    {
+      if (regno >= 0 && regno < num_regs
+	  && register_size (tdesc, regno) != 0
+	  && regcache_changed_since_report (regcache, regno))
+	{
+	  if (regcache->register_status[regno] == REG_VALID)
+	    buf = outreg (regcache, regno, buf);
+	  else
+	    buf = outreg_unavailable (regcache, regno, buf);
+	}
+    };
+
+  if (cs.expedite_all_regs)
+    {
+      for (int regno = 0; regno < num_regs; regno++)
+	maybe_outreg (regno);
+    }
+  else
+    {
+      for (const std::string &expedited_reg : tdesc->expedite_regs)
+	maybe_outreg (find_regno (tdesc, expedited_reg.c_str ()));
+      for (int regno : cs.expedited_regs)
+	maybe_outreg (regno);
+    }
+
+  return buf;
+}
+
+#if GDB_SELF_TEST
+
+namespace selftests {
+
+/* See remote-utils.h.  */
+
+void
+test_outreg_changed ()
+{
+  target_desc_up tdesc = allocate_target_description ();
+  tdesc_feature *feature
+    = tdesc_create_feature (tdesc.get (), "org.gnu.gdb.selftest");
+  tdesc_create_reg (feature, "r0", 0, 1, nullptr, 32, "int");
+  tdesc_create_reg (feature, "r1", 1, 1, nullptr, 32, "int");
+  static const char *expedite_regs[] = { nullptr };
+  init_target_desc (tdesc.get (), expedite_regs);
+
+  client_state &cs = get_client_state ();
+  scoped_restore restore_expedite_all
+    = make_scoped_restore (&cs.expedite_all_regs, true);
+
+  struct regcache *regcache = new_register_cache (tdesc.get ());
+  SCOPE_EXIT { free_register_cache (regcache); };
+
+  auto stop_reply_regs = [&] ()
+    {
+      char buf[64];
+
+      *outreg_changed (cs, regcache, buf) = '\0';
+      return std::string (buf);
+    };
+
+  const uint32_t r0 = 0x11111111;
+  const uint32_t r1 = 0x22222222;
+  supply_register (regcache, 0, &r0);
+  supply_register (regcache, 1, &r1);
+
+  /* All registers are sent at the first stop, and none while they do
+     not change.  */
+  SELF_CHECK (stop_reply_regs () == "00:11111111;01:22222222;");
+  SELF_CHECK (stop_reply_regs () == "");
+
+  /* A register that becomes unavailable is sent once, as such, so
+     that GDB does not keep using its previous value.  */
+  supply_register (regcache, 1, nullptr);
+  SELF_CHECK (stop_reply_regs () == "01:xxxxxxxx;");
+  SELF_CHECK (stop_reply_regs () == "");
+
+  /* Once available again, it is sent with its value, even though the
+     value is the one GDB was last told.  */
+  supply_register (regcache, 1, &r1);
+  SELF_CHECK (stop_reply_regs () == "01:22222222;");
+  SELF_CHECK (stop_reply_regs () == "");
+}
+
+} /* namespace selftests */
+
+#endif /* GDB_SELF_TEST */
+
 void
 prepare_resume_reply (char *buf, ptid_t ptid, const target_waitstatus &status)
 {
@@ -1186,10 +1830,13 @@ prepare_resume_reply (char *buf, ptid_t ptid, const target_waitstatus &status)
 	  }
 
 	/* Handle the expedited registers.  */
-	for (const std::string &expedited_reg :
-	     current_target_desc ()->expedite_regs)
-	  buf = outreg (regcache, find_regno (regcache->tdesc,
-					      expedited_reg.c_str ()), buf);
+	if (cs.expedite_all_regs || !cs.expedited_regs.empty ())
+	  buf = outreg_changed (cs, regcache, buf);
+	else
+	  for (const std::string &expedited_reg :
+	       current_target_desc ()->expedite_regs)
+	    buf = outreg (regcache, find_regno (regcache->tdesc,
+						expedited_reg.c_str ()), buf);
 	*buf = '\0';
 
 	/* Formerly, if the debugger had not used any thread features
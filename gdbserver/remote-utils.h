@@ -21,6 +21,15 @@
 
 int gdb_connected (void);
 
+/* The compression gdbserver applies to packet payloads, once GDB has
+   selected it with the QCompression packet.  */
+
+enum class remote_compression
+{
+  none,
+  zlib,
+};
+
 #define STDIO_CONNECTION_NAME "stdio"
 int remote_connection_is_stdio (void);
 
@@ -34,6 +43,18 @@ int getpkt (char *buf);
 void remote_prepare (const char *name);
 void remote_open (const char *name);
 void remote_close (void);
+
+/* Listen for read-only observer sessions on NAME, a HOST:PORT
+   specification.  */
+
+void observer_open (const char *name);
+
+/* Wait at most TIMEOUT_MS milliseconds for the observer, and answer the
+   requests it sent, or accept a new observer.  SIGCHLD interrupts the
+   wait even if blocked.  Return false, without waiting, if observers
+   are not enabled.  */
+
+bool observer_serve (int timeout_ms);
 void write_ok (char *buf);
 void write_enn (char *buf);
 void initialize_async_io (void);
@@ -43,6 +64,17 @@ void check_remote_input_interrupt_request (void);
 void prepare_resume_reply (char *buf, ptid_t ptid,
 			   const target_waitstatus &status);
 
+#if GDB_SELF_TEST
+namespace selftests {
+
+/* Check the registers stop replies include when GDB asked for only the
+   registers that changed.  */
+
+void test_outreg_changed ();
+
+} /* namespace selftests */
+#endif
+
 const char *decode_address_to_semicolon (CORE_ADDR *addrp, const char *start);
 void decode_address (CORE_ADDR *addrp, const char *start, int len);
 
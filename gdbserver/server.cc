@@ -29,9 +29,11 @@
 #include <signal.h>
 #endif
 #include "gdbsupport/gdb_vecs.h"
+#include "gdbsupport/byte-vector.h"
 #include "gdbsupport/gdb_wait.h"
 #include "gdbsupport/btrace-common.h"
 #include "gdbsupport/filestuff.h"
+#include "gdbsupport/gdb-sigmask.h"
 #include "tracepoint.h"
 #include "dll.h"
 #include "hostio.h"
@@ -783,6 +785,66 @@ handle_general_set (char *own_buf)
       return;
     }
 
+  if (startswith (own_buf, "QCompression:"))
+    {
+      const char *algo = own_buf + strlen ("QCompression:");
+
+      if (strcmp (algo, "zlib") == 0)
+	cs.compression = remote_compression::zlib;
+      else if (strcmp (algo, "none") == 0)
+	cs.compression = remote_compression::none;
+      else
+	{
+	  /* We don't know this algorithm, so complain to GDB.  */
+	  write_enn (own_buf);
+	  return;
+	}
+
+      remote_debug_printf ("[compression set to %s]", algo);
+
+      /* The OK reply is too short to be compressed, so GDB can read
+	 it before it switches over.  */
+      write_ok (own_buf);
+      return;
+    }
+
+  if (startswith (own_buf, "QExpediteRegisters:"))
+    {
+      const char *p = own_buf + strlen ("QExpediteRegisters:");
+      std::vector<int> regs;
+      bool all = strcmp (p, "all") == 0;
+
+      while (!all && *p != '\0')
+	{
+	  ULONGEST regno;
+	  const char *end = unpack_varlen_hex (p, &regno);
+
+	  if (end == p || (*end != ';' && *end != '\0'))
+	    {
+	      write_enn (own_buf);
+	      return;
+	    }
+
+	  regs.push_back (regno);
+	  p = *end == ';' ? end + 1 : end;
+	}
+
+      cs.expedited_regs = std::move (regs);
+      cs.expedite_all_regs = all;
+
+      /* GDB may not know any of the values we reported before.  */
+      for_each_thread ([] (thread_info *thread)
+	{
+	  struct regcache *regcache = thread_regcache_data (thread);
+
+	  if (regcache != nullptr)
+	    regcache_forget_reported (regcache, -1);
+	});
+
+      write_ok (own_buf);
+      return;
+    }
+
   if (startswith (own_buf, "QNonStop:"))
     {
       char *mode = own_buf + 9;
@@ -2409,6 +2471,15 @@ handle_query (char *own_buf, int packet_len, int *new_packet_len_p)
       if (cs.transport_is_reliable)
 	strcat (own_buf, ";QStartNoAckMode+");
 
+      strcat (own_buf, ";QCompression=zlib");
+
+      strcat (own_buf, ";QExpediteRegisters+");
+
+      /* We read the packets GDB sends in order, whether or not we
+	 have replied to the previous ones, so it may send up to 64
+	 memory reads without waiting.  */
+      strcat (own_buf, ";MemoryReadWindow=40");
+
       if (the_target->supports_qxfer_osdata ())
 	strcat (own_buf, ";qXfer:osdata:read+");
 
@@ -2477,6 +2548,8 @@ handle_query (char *own_buf, int packet_len, int *new_packet_len_p)
 
       strcat (own_buf, ";no-resumed+");
 
+      strcat (own_buf, ";vReadMemory+");
+
       if (target_supports_memory_tagging ())
 	strcat (own_buf, ";memory-tagging+");
 
@@ -2867,6 +2940,42 @@ err:
   return;
 }
 
+/* Wait for the event that ends an all-stop resume, and store it in
+   *STATUS.  While the inferior runs, keep answering the observer, if
+   observers are enabled and the target can be polled for events.  */
+
+static ptid_t
+wait_for_resumed_stop (struct target_waitstatus *status)
+{
+  if (target_supports_non_stop ())
+    {
+#ifdef SIGCHLD
+      /* Block SIGCHLD while polling the target, so that an event that
+	 comes before observer_serve waits still interrupts the wait.
+	 The mask must be restored before a blocking wait, which waits
+	 for SIGCHLD itself.  */
+      sigset_t mask, prev_mask;
+      sigemptyset (&mask);
+      sigaddset (&mask, SIGCHLD);
+      gdb_sigmask (SIG_BLOCK, &mask, &prev_mask);
+      SCOPE_EXIT { gdb_sigmask (SIG_SETMASK, &prev_mask, NULL); };
+#endif
+
+      while (true)
+	{
+	  ptid_t ptid = mywait (minus_one_ptid, status, TARGET_WNOHANG, 1);
+
+	  if (status->kind () != TARGET_WAITKIND_IGNORE)
+	    return ptid;
+
+	  if (!observer_serve (100))
+	    break;
+	}
+    }
+
+  return mywait (minus_one_ptid, status, 0, 1);
+}
+
 /* Resume target with ACTIONS, an array of NUM_ACTIONS elements.  */
 
 static void
@@ -2898,7 +3007,7 @@ resume (struct thread_resume *actions, size_t num_actions)
     write_ok (cs.own_buf);
   else
     {
-      cs.last_ptid = mywait (minus_one_ptid, &cs.last_status, 0, 1);
+      cs.last_ptid = wait_for_resumed_stop (&cs.last_status);
 
       if (cs.last_status.kind () == TARGET_WAITKIND_NO_RESUMED
 	  && !report_no_resumed)
@@ -3066,6 +3175,94 @@ handle_v_kill (char *own_buf)
     write_enn (own_buf);
 }
 
+/* Handle a vReadMemory packet: read each of the memory ranges it
+   lists, and reply with their contents, one after the other.  The
+   reply stops at the first range that cannot be read, or that does
+   not fit in the packet.  */
+
+static void
+handle_v_read_memory (char *own_buf)
+{
+  std::vector<std::pair<CORE_ADDR, ULONGEST>> ranges;
+  const char *p = own_buf + strlen ("vReadMemory:");
+
+  while (*p != '\0')
+    {
+      ULONGEST addr, len;
+
+      p = unpack_varlen_hex (p, &addr);
+      if (*p != ',')
+	{
+	  write_enn (own_buf);
+	  return;
+	}
+      p = unpack_varlen_hex (p + 1, &len);
+      if (*p == ';')
+	++p;
+      else if (*p != '\0')
+	{
+	  write_enn (own_buf);
+	  return;
+	}
+
+      /* An empty range would let the reply be empty, which GDB would
+	 take to mean that the packet is not supported.  */
+      if (len == 0)
+	{
+	  write_enn (own_buf);
+	  return;
+	}
+      ranges.emplace_back (addr, len);
+    }
+
+  /* Only send as many ranges as fit in the reply.  */
+  size_t room = (PBUFSIZ - 1) / 2;
+  size_t fit = 0;
+  for (; fit < ranges.size () && ranges[fit].second <= room; ++fit)
+    room -= ranges[fit].second;
+
+  gdb::byte_vector buf ((PBUFSIZ - 1) / 2 - room);
+  std::vector<memory_read_range> reads;
+  gdb_byte *p_buf = buf.data ();
+  for (size_t i = 0; i < fit; ++i)
+    {
+      reads.push_back ({ranges[i].first, p_buf, ranges[i].second});
+      p_buf += ranges[i].second;
+    }
+
+  /* Read them all at once if possible.  Traceframes are read range by
+     range.  */
+  size_t count = 0;
+  if (get_client_state ().current_traceframe < 0)
+    {
+      if (set_desired_process ())
+	count = read_inferior_memory_vec (reads);
+    }
+  else
+    {
+      for (; count < reads.size (); ++count)
+	{
+	  const memory_read_range &range = reads[count];
+
+	  if (range.len > 0
+	      && gdb_read_memory (range.addr, range.buf, range.len)
+		 != (int) range.len)
+	    break;
+	}
+    }
+
+  if (count == 0)
+    write_enn (own_buf);
+  else
+    {
+      size_t len = 0;
+      for (size_t i = 0; i < count; ++i)
+	len += reads[i].len;
+      bin2hex (buf.data (), own_buf, len);
+      own_buf[2 * len] = '\0';
+    }
+}
+
 /* Handle all of the extended 'v' packets.  */
 void
 handle_v_requests (char *own_buf, int packet_len, int *new_packet_len)
@@ -3140,6 +3337,17 @@ handle_v_requests (char *own_buf, int packet_len, int *new_packet_len)
       return;
     }
 
+  if (startswith (own_buf, "vReadMemory:"))
+    {
+      if (!target_running ())
+	{
+	  write_enn (own_buf);
+	  return;
+	}
+      handle_v_read_memory (own_buf);
+      return;
+    }
+
   if (startswith (own_buf, "vKill;"))
     {
       if (!target_running ())
@@ -3388,6 +3596,8 @@ gdbserver_usage (FILE *stream)
 	   "  --multi               Start server without a specific program, and\n"
 	   "                        only quit when explicitly commanded.\n"
 	   "  --once                Exit after the first connection has closed.\n"
+	   "  --observer=HOST:PORT  Also accept a read-only client on HOST:PORT, which\n"
+	   "                        can list threads and read memory.\n"
 	   "  --help                Print this message and then exit.\n"
 	   "  --version             Display version information and exit.\n"
 	   "\n"
@@ -3630,6 +3840,7 @@ captured_main (int argc, char *argv[])
   int pid;
   char *arg_end;
   const char *port = NULL;
+  const char *observer_port = NULL;
   char **next_arg = &argv[1];
   volatile int multi_mode = 0;
   volatile int attach = 0;
@@ -3640,6 +3851,8 @@ captured_main (int argc, char *argv[])
 
   selftests::register_test ("remote_memory_tagging",
 			    selftests::test_memory_tagging_functions);
+  selftests::register_test ("outreg_changed",
+			    selftests::test_outreg_changed);
 #endif
 
   current_directory = getcwd (NULL, 0);
@@ -3773,6 +3986,8 @@ captured_main (int argc, char *argv[])
 	startup_with_shell = false;
       else if (strcmp (*next_arg, "--once") == 0)
 	run_once = true;
+      else if (startswith (*next_arg, "--observer="))
+	observer_port = *next_arg + strlen ("--observer=");
       else if (strcmp (*next_arg, "--selftest") == 0)
 	selftest = true;
       else if (startswith (*next_arg, "--selftest="))
@@ -3825,6 +4040,9 @@ captured_main (int argc, char *argv[])
   if (port != NULL)
     remote_prepare (port);
 
+  if (observer_port != NULL)
+    observer_open (observer_port);
+
   bad_attach = 0;
   pid = 0;
 
@@ -3920,6 +4138,9 @@ captured_main (int argc, char *argv[])
   while (1)
     {
       cs.noack_mode = 0;
+      cs.compression = remote_compression::none;
+      cs.expedited_regs.clear ();
+      cs.expedite_all_regs = false;
       cs.multi_process = 0;
       cs.report_fork_events = 0;
       cs.report_vfork_events = 0;
@@ -4239,6 +4460,10 @@ process_serial_event (void)
 	    {
 	      regcache = get_thread_regcache (current_thread, 1);
 	      registers_from_string (regcache, &cs.own_buf[1]);
+	      /* GDB knows the values it wrote, but not whether the
+		 target accepted them as is; report them again at the
+		 next stop.  */
+	      regcache_forget_reported (regcache, -1);
 	      write_ok (cs.own_buf);
 	    }
 	}
@@ -4452,6 +4677,194 @@ process_serial_event (void)
   return 0;
 }
 
+/* Return the thread whose registers and memory the observer with
+   session state STATE reads: the one it selected with 'Hg', another
+   thread of the same process if that one is gone, or any thread.  */
+
+static thread_info *
+observer_thread (const observer_state &state)
+{
+  thread_info *thread = nullptr;
+
+  if (state.general_thread != null_ptid
+      && state.general_thread != minus_one_ptid)
+    {
+      thread = find_thread_ptid (state.general_thread);
+      if (thread == nullptr)
+	thread = find_any_thread_of_pid (state.general_thread.pid ());
+    }
+  if (thread == nullptr)
+    thread = get_first_thread ();
+
+  return thread;
+}
+
+/* Write to OWN_BUF as many of the threads in STATE's list of threads
+   to report as fit, in the format of the 'qfThreadInfo' reply.  */
+
+static void
+observer_list_threads (observer_state &state, char *own_buf)
+{
+  if (state.threads_to_list.empty ())
+    {
+      strcpy (own_buf, "l");
+      return;
+    }
+
+  char *p = own_buf;
+  size_t count = 0;
+
+  *p++ = 'm';
+  for (ptid_t ptid : state.threads_to_list)
+    {
+      /* Leave room for one more thread id and the terminator.  */
+      if (p - own_buf > PBUFSIZ - 64)
+	break;
+      if (count > 0)
+	*p++ = ',';
+      p += sprintf (p, "p%x.%lx", ptid.pid (), ptid.lwp ());
+      ++count;
+    }
+  *p = '\0';
+
+  state.threads_to_list.erase (state.threads_to_list.begin (),
+			       state.threads_to_list.begin () + count);
+}
+
+/* See server.h.  */
+
+bool
+handle_observer_packet (observer_state &state, char *own_buf, int packet_len,
+			int *new_packet_len)
+{
+  thread_info *thread = observer_thread (state);
+
+  /* Don't change the thread the debugger has selected.  */
+  scoped_restore_current_thread restore_thread;
+
+  if (thread != nullptr)
+    switch_to_thread (thread);
+
+  *new_packet_len = -1;
+
+  if (startswith (own_buf, "qSupported"))
+    {
+      sprintf (own_buf, "PacketSize=%x;qXfer:features:read+;multiprocess+",
+	       PBUFSIZ - 1);
+      if (the_target->supports_read_auxv ())
+	strcat (own_buf, ";qXfer:auxv:read+");
+      if (the_target->supports_qxfer_libraries_svr4 ())
+	strcat (own_buf, ";qXfer:libraries-svr4:read+");
+    }
+  else if (strcmp (own_buf, "?") == 0)
+    {
+      /* The observer sees the program as stopped, but it can't resume
+	 it.  */
+      if (thread == nullptr)
+	strcpy (own_buf, "W00");
+      else
+	sprintf (own_buf, "T00thread:p%x.%lx;", thread->id.pid (),
+		 thread->id.lwp ());
+    }
+  else if (strcmp (own_buf, "qC") == 0)
+    {
+      if (thread == nullptr)
+	write_enn (own_buf);
+      else
+	sprintf (own_buf, "QCp%x.%lx", thread->id.pid (), thread->id.lwp ());
+    }
+  else if (strcmp (own_buf, "qfThreadInfo") == 0)
+    {
+      state.threads_to_list.clear ();
+      for_each_thread ([&] (thread_info *thr)
+	{
+	  state.threads_to_list.push_back (thr->id);
+	});
+      observer_list_threads (state, own_buf);
+    }
+  else if (strcmp (own_buf, "qsThreadInfo") == 0)
+    observer_list_threads (state, own_buf);
+  else if (startswith (own_buf, "qAttached"))
+    strcpy (own_buf, "1");
+  else if (startswith (own_buf, "qXfer:features:read:")
+	   || startswith (own_buf, "qXfer:auxv:read:")
+	   || startswith (own_buf, "qXfer:libraries-svr4:read:"))
+    {
+      if (!handle_qxfer (own_buf, packet_len, new_packet_len))
+	own_buf[0] = '\0';
+    }
+  else if (startswith (own_buf, "Hg") || startswith (own_buf, "Hc"))
+    {
+      if (own_buf[1] == 'g')
+	state.general_thread = read_ptid (&own_buf[2], NULL);
+      write_ok (own_buf);
+    }
+  else if (own_buf[0] == 'T')
+    {
+      if (find_thread_ptid (read_ptid (&own_buf[1], NULL)) != nullptr)
+	write_ok (own_buf);
+      else
+	write_enn (own_buf);
+    }
+  else if (own_buf[0] == 'g')
+    {
+      if (thread == nullptr)
+	write_enn (own_buf);
+      else if (the_target->supports_thread_stopped ()
+	       && !target_thread_stopped (thread))
+	{
+	  /* The registers of a running thread are unavailable.  */
+	  int size = register_cache_size (current_target_desc ());
+
+	  memset (own_buf, 'x', size * 2);
+	  own_buf[size * 2] = '\0';
+	}
+      else
+	registers_to_string (get_thread_regcache (thread, 1), own_buf);
+    }
+  else if (own_buf[0] == 'm')
+    {
+      CORE_ADDR mem_addr;
+      unsigned int len;
+
+      decode_m_packet (&own_buf[1], &mem_addr, &len);
+      len = std::min (len, (unsigned int) (PBUFSIZ - 1) / 2);
+
+      gdb::byte_vector mem_buf (len);
+      if (len > 0
+	  && (thread == nullptr
+	      || read_inferior_memory (mem_addr, mem_buf.data (), len) != 0))
+	write_enn (own_buf);
+      else
+	bin2hex (mem_buf.data (), own_buf, len);
+    }
+  else if (own_buf[0] == 'D')
+    {
+      state.closing = true;
+      write_ok (own_buf);
+    }
+  else if (own_buf[0] == 'k')
+    {
+      /* Only end the session; the program belongs to the debugger.  */
+      state.closing = true;
+      return false;
+    }
+  else if (strchr ("MXGPZzcCsSAR!", own_buf[0]) != NULL
+	   || startswith (own_buf, "vCont;")
+	   || startswith (own_buf, "vKill")
+	   || startswith (own_buf, "vRun")
+	   || startswith (own_buf, "vAttach")
+	   || startswith (own_buf, "vFile:"))
+    write_enn (own_buf);
+  else
+    {
+      /* Everything else is unsupported, which GDB copes with.  */
+      own_buf[0] = '\0';
+    }
+
+  return true;
+}
+
 /* Event-loop callback for serial events.  */
 
 void
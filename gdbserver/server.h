@@ -84,6 +84,28 @@ extern void handle_v_requests (char *own_buf, int packet_len,
 extern void handle_serial_event (int err, gdb_client_data client_data);
 extern void handle_target_event (int err, gdb_client_data client_data);
 
+/* The state of a read-only observer session (see --observer).  */
+
+struct observer_state
+{
+  /* The thread the observer selected with 'Hg'.  */
+  ptid_t general_thread = null_ptid;
+
+  /* The threads still to be listed in reply to 'qsThreadInfo'.  */
+  std::vector<ptid_t> threads_to_list;
+
+  /* True once the observer has detached.  */
+  bool closing = false;
+};
+
+/* Handle the packet of PACKET_LEN bytes in OWN_BUF, sent by a
+   read-only observer with session state STATE, and write the reply to
+   OWN_BUF.  *NEW_PACKET_LEN is set to the length of a binary reply, or
+   to -1.  Packets that would modify or resume the inferior are
+   refused.  Return false if the packet takes no reply.  */
+extern bool handle_observer_packet (observer_state &state, char *own_buf,
+				    int packet_len, int *new_packet_len);
+
 /* Get rid of the currently pending stop replies that match PTID.  */
 extern void discard_queued_stop_replies (ptid_t ptid);
 
@@ -184,6 +206,17 @@ struct client_state
   /* If true, then we tell GDB to use noack mode by default.  */
   int transport_is_reliable = 0;
 
+  /* The compression GDB requested with QCompression.  */
+  remote_compression compression = remote_compression::none;
+
+  /* The registers GDB asked to have in stop replies with
+     QExpediteRegisters, by target description number, and whether it
+     asked for all of them.  Once GDB has configured the set, stop
+     replies leave out the registers that did not change since the
+     thread's previous stop.  */
+  std::vector<int> expedited_regs;
+  bool expedite_all_regs = false;
+
   /* The traceframe to be used as the source of data to send back to
      GDB.  A value of -1 means to get data from the live program.  */
 
@@ -96,6 +96,28 @@ read_inferior_memory (CORE_ADDR memaddr, unsigned char *myaddr, int len)
   return res;
 }
 
+/* See target.h.  */
+
+size_t
+read_inferior_memory_vec (gdb::array_view<const memory_read_range> ranges)
+{
+  size_t done = the_target->read_memory_vec (ranges);
+  gdb_assert (done <= ranges.size ());
+
+  for (size_t i = 0; i < done; ++i)
+    check_mem_read (ranges[i].addr, ranges[i].buf, ranges[i].len);
+
+  for (; done < ranges.size (); ++done)
+    {
+      const memory_read_range &range = ranges[done];
+
+      if (read_inferior_memory (range.addr, range.buf, range.len) != 0)
+	break;
+    }
+
+  return done;
+}
+
 /* See target/target.h.  */
 
 int
@@ -339,6 +361,13 @@ process_stratum_target::look_up_symbols ()
   /* Nop.  */
 }
 
+size_t
+process_stratum_target::read_memory_vec
+  (gdb::array_view<const memory_read_range> ranges)
+{
+  return 0;
+}
+
 bool
 process_stratum_target::supports_read_auxv ()
 {
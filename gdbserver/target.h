@@ -158,6 +158,16 @@ class process_stratum_target
   virtual int write_memory (CORE_ADDR memaddr, const unsigned char *myaddr,
 			    int len) = 0;
 
+  /* Read several ranges of memory from the inferior process, as many
+     at once as possible.  This should generally be called through
+     read_inferior_memory_vec, which handles breakpoint shadowing.
+
+     Return the number of leading RANGES that were read completely.
+     The default implementation reads none, leaving them all to be
+     read one by one with read_memory.  */
+  virtual size_t read_memory_vec
+    (gdb::array_view<const memory_read_range> ranges);
+
   /* Query GDB for the values of any symbols we're interested in.
      This function is called whenever we receive a "qSymbols::"
      query, which corresponds to every time more symbols (might)
@@ -704,6 +714,13 @@ target_thread_pending_child (thread_info *thread)
 
 int read_inferior_memory (CORE_ADDR memaddr, unsigned char *myaddr, int len);
 
+/* Read each of RANGES from the inferior's memory.  Return the number
+   of leading ranges that were read completely, stopping at the first
+   that could not be.  */
+
+size_t read_inferior_memory_vec
+  (gdb::array_view<const memory_read_range> ranges);
+
 /* Set GDBserver's current thread to the thread the client requested
    via Hg.  Also switches the current process to the requested
    process.  If the requested thread is not found in the thread list,
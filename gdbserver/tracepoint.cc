@@ -24,6 +24,7 @@
 #include <ctype.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <algorithm>
 #include <chrono>
 #include <inttypes.h>
 #include "ax.h"
@@ -120,6 +121,8 @@ trace_vdebug (const char *fmt, ...)
 # define traceframe_read_count IPA_SYM_EXPORTED_NAME (traceframe_read_count)
 # define traceframe_write_count IPA_SYM_EXPORTED_NAME (traceframe_write_count)
 # define traceframes_created IPA_SYM_EXPORTED_NAME (traceframes_created)
+# define collect_rings IPA_SYM_EXPORTED_NAME (collect_rings)
+# define collect_ring_buffers IPA_SYM_EXPORTED_NAME (collect_ring_buffers)
 # define trace_state_variables IPA_SYM_EXPORTED_NAME (trace_state_variables)
 # define get_raw_reg_ptr IPA_SYM_EXPORTED_NAME (get_raw_reg_ptr)
 # define get_trace_state_variable_value_ptr \
@@ -162,6 +165,8 @@ struct ipa_sym_addresses
   CORE_ADDR addr_traceframe_read_count;
   CORE_ADDR addr_traceframe_write_count;
   CORE_ADDR addr_traceframes_created;
+  CORE_ADDR addr_collect_rings;
+  CORE_ADDR addr_collect_ring_buffers;
   CORE_ADDR addr_trace_state_variables;
   CORE_ADDR addr_get_raw_reg_ptr;
   CORE_ADDR addr_get_trace_state_variable_value_ptr;
@@ -199,6 +204,8 @@ static struct
   IPA_SYM(traceframe_read_count),
   IPA_SYM(traceframe_write_count),
   IPA_SYM(traceframes_created),
+  IPA_SYM(collect_rings),
+  IPA_SYM(collect_ring_buffers),
   IPA_SYM(trace_state_variables),
   IPA_SYM(get_raw_reg_ptr),
   IPA_SYM(get_trace_state_variable_value_ptr),
@@ -744,6 +751,13 @@ struct tracepoint
   /* Cached sum of the sizes of traceframes created by this point.  */
   uint64_t traceframe_usage;
 
+  /* For fast tracepoints, the size of the largest traceframe a hit
+     can produce, not counting register blocks, whose size only the
+     in-process agent knows.  0 if there's no such bound, or if hits
+     must not be collected concurrently, in which case they are never
+     collected into a per-thread ring (see struct collect_ring).  */
+  uint32_t traceframe_bound;
+
   CORE_ADDR compiled_cond;
 
   /* Link to the next tracepoint in the list.  */
@@ -1206,6 +1220,97 @@ IP_AGENT_EXPORT_VAR unsigned int traceframe_read_count;
 
 IP_AGENT_EXPORT_VAR int traceframes_created;
 
+/* The jump pads serialize fast tracepoint collection with the global
+   `collecting' lock.  To keep threads hitting fast tracepoints from
+   serializing on it, the in-process agent holds the lock only long
+   enough to hand the thread over to a ring buffer of its own, and
+   then evaluates conditions and collects into that ring without any
+   lock.  This is only done for tracepoints whose traceframes have a
+   known upper size bound (see traceframe_bound in struct
+   tracepoint); others, and hits by threads that find all rings busy,
+   are collected into the shared trace buffer with the lock held, as
+   before.
+
+   Each ring has a single producer, the thread that claimed it, and a
+   single consumer, GDBserver, which merges the contents of all rings
+   into its own trace buffer whenever it uploads the in-process
+   agent's traceframes, ordering them by hit sequence number.  A ring
+   never makes its thread wait for GDBserver: if it has no room for a
+   new traceframe, the traceframe is dropped and counted instead.  */
+
+/* The number of per-thread rings.  */
+
+#define COLLECT_RING_COUNT 64
+
+/* The size of a ring's buffer, in bytes.  Must be a power of two.  */
+
+#define COLLECT_RING_SIZE 0x20000
+
+/* The largest traceframe that may be collected into a ring.  */
+
+#define COLLECT_RING_MAX_FRAME 0x4000
+
+/* The control block of a per-thread ring.  */
+
+struct collect_ring
+{
+  /* The thread area (see collecting_t) of the thread that claimed the
+     ring last, or 0 if it was never claimed.  */
+  uintptr_t thread_area;
+
+  /* While the owner is in gdb_collect without holding the
+     `collecting' lock, the address of the tracepoint object its jump
+     pad is for; 0 otherwise.  A ring is never claimed by another
+     thread while this is set.  */
+  uintptr_t tpoint;
+
+  /* Free-running byte counts.  HEAD is the number of bytes the owner
+     has produced, and only moves past a record once it is complete.
+     TAIL is the number of bytes GDBserver has consumed.  */
+  uintptr_t head;
+  uintptr_t tail;
+
+  /* The number of traceframes dropped because the ring was full.  */
+  uintptr_t dropped;
+
+  /* Private to the owner: the head position of the record being
+     built, and the end of the space reserved for it, or 0 if it
+     outgrew its reservation and will be dropped.  */
+  uintptr_t frame_head;
+  uintptr_t frame_end;
+};
+
+/* The header of each record in a ring's buffer.  A traceframe
+   follows, unless this record is padding up to the end of the
+   buffer.  Records are 8-byte aligned and never wrap around.  */
+
+struct collect_ring_record
+{
+  /* The size of the whole record.  */
+  uint32_t size;
+
+  /* The sequence number of the hit that produced the traceframe, or
+     0 for padding.  */
+  uint32_t seq;
+};
+
+#ifdef IN_PROCESS_AGENT
+
+EXTERN_C_PUSH
+IP_AGENT_EXPORT_VAR struct collect_ring collect_rings[COLLECT_RING_COUNT];
+IP_AGENT_EXPORT_VAR unsigned char
+  collect_ring_buffers[COLLECT_RING_COUNT][COLLECT_RING_SIZE];
+EXTERN_C_POP
+
+#else
+
+/* The number of traceframes the in-process agent has dropped in the
+   current run, as of the last upload.  */
+
+static unsigned int traceframes_dropped;
+
+#endif
+
 #ifndef IN_PROCESS_AGENT
 
 /* Read-only regions are address ranges whose contents don't change,
@@ -1296,6 +1401,11 @@ struct fast_tracepoint_ctx
 
   unsigned char *regs;
   struct tracepoint *tpoint;
+
+  /* The ring of the collecting thread, if collecting into one, and
+     the sequence number of this hit.  */
+  struct collect_ring *ring;
+  unsigned int seq;
 };
 
 /* Static tracepoint specific data to be passed down to
@@ -1467,6 +1577,12 @@ clear_inferior_trace_buffer (void)
   write_inferior_uinteger (ipa_sym_addrs.addr_traceframe_write_count, 0);
   write_inferior_uinteger (ipa_sym_addrs.addr_traceframe_read_count, 0);
   write_inferior_integer (ipa_sym_addrs.addr_traceframes_created, 0);
+
+  struct collect_ring rings[COLLECT_RING_COUNT] = {};
+
+  target_write_memory (ipa_sym_addrs.addr_collect_rings,
+		       (unsigned char *) rings, sizeof (rings));
+  traceframes_dropped = 0;
 }
 
 #endif
@@ -2182,6 +2298,118 @@ set_trace_state_variable_getter (int num, LONGEST (*getter) (void))
   tsv->getter = getter;
 }
 
+#ifdef IN_PROCESS_AGENT
+
+/* The target description index for IPA.  Passed from gdbserver, used
+   to select ipa_tdesc.  */
+EXTERN_C_PUSH
+IP_AGENT_EXPORT_VAR int ipa_tdesc_idx;
+EXTERN_C_POP
+
+/* Return the ring whose buffer holds TFRAME, or NULL if TFRAME is in
+   the shared trace buffer.  */
+
+static struct collect_ring *
+collect_ring_of (const struct traceframe *tframe)
+{
+  const unsigned char *p = (const unsigned char *) tframe;
+  const unsigned char *lo = &collect_ring_buffers[0][0];
+
+  if (p < lo || p >= lo + sizeof (collect_ring_buffers))
+    return NULL;
+  return &collect_rings[(p - lo) / COLLECT_RING_SIZE];
+}
+
+/* Return the size of the largest traceframe a hit of TPOINT can
+   produce, or 0 if hits of TPOINT can't be collected into a ring.  */
+
+static uint32_t
+ring_traceframe_bound (const struct tracepoint *tpoint)
+{
+  uint32_t size = tpoint->traceframe_bound;
+
+  if (size == 0)
+    return 0;
+
+  for (uint32_t i = 0; i < tpoint->numactions; i++)
+    if (tpoint->actions[i]->type == 'R')
+      size += 1 + get_ipa_tdesc (ipa_tdesc_idx)->registers_size;
+
+  return size <= COLLECT_RING_MAX_FRAME ? size : 0;
+}
+
+/* Start a traceframe for the hit of TPOINT with sequence number SEQ
+   in RING, reserving room for the largest traceframe TPOINT can
+   produce.  Returns NULL, counting the traceframe as dropped, if RING
+   doesn't have that much room free.  */
+
+static struct traceframe *
+add_ring_traceframe (struct collect_ring *ring, unsigned int seq,
+		     struct tracepoint *tpoint)
+{
+  unsigned char *buf = collect_ring_buffers[ring - collect_rings];
+  uintptr_t need, offset, pad, tail;
+  struct collect_ring_record *rec;
+  struct traceframe *tframe;
+
+  need = ((sizeof (struct collect_ring_record)
+	   + ring_traceframe_bound (tpoint) + 7) & ~(uintptr_t) 7);
+  offset = ring->head & (COLLECT_RING_SIZE - 1);
+  pad = (COLLECT_RING_SIZE - offset < need ? COLLECT_RING_SIZE - offset : 0);
+
+  /* GDBserver only ever moves the tail forward, so a stale value just
+     makes us see less room than there is.  */
+  tail = __atomic_load_n (&ring->tail, __ATOMIC_ACQUIRE);
+  if (ring->head + pad + need - tail > COLLECT_RING_SIZE)
+    {
+      ring->dropped++;
+      return NULL;
+    }
+
+  if (pad != 0)
+    {
+      rec = (struct collect_ring_record *) (buf + offset);
+      rec->size = pad;
+      rec->seq = 0;
+      offset = 0;
+    }
+
+  rec = (struct collect_ring_record *) (buf + offset);
+  rec->seq = seq;
+  ring->frame_head = ring->head + pad;
+  ring->frame_end = (uintptr_t) (buf + offset + need);
+
+  tframe = (struct traceframe *) (rec + 1);
+  tframe->tpnum = tpoint->number;
+  tframe->data_size = 0;
+
+  return tframe;
+}
+
+/* Flag that the traceframe TFRAME in RING is finished, making it
+   visible to GDBserver.  */
+
+static void
+finish_ring_traceframe (struct collect_ring *ring, struct traceframe *tframe)
+{
+  struct collect_ring_record *rec = ((struct collect_ring_record *) tframe) - 1;
+
+  if (ring->frame_end == 0)
+    {
+      /* Some block didn't fit.  Better to lose the whole traceframe
+	 than to upload a partial one.  */
+      ring->dropped++;
+      return;
+    }
+
+  rec->size = ((sizeof (*rec) + sizeof (*tframe) + tframe->data_size + 7)
+	       & ~(uint32_t) 7);
+  __atomic_store_n (&ring->head, ring->frame_head + rec->size,
+		    __ATOMIC_RELEASE);
+}
+
+#endif
+
 /* Add a raw traceframe for the given tracepoint.  */
 
 static struct traceframe *
@@ -2212,7 +2440,21 @@ add_traceframe_block (struct traceframe *tframe,
   if (!tframe)
     return NULL;
 
-  block = (unsigned char *) trace_buffer_alloc (amt);
+#ifdef IN_PROCESS_AGENT
+  struct collect_ring *ring = collect_ring_of (tframe);
+
+  if (ring != NULL)
+    {
+      block = tframe->data + tframe->data_size;
+      if (ring->frame_end == 0 || (uintptr_t) (block + amt) > ring->frame_end)
+	{
+	  ring->frame_end = 0;
+	  return NULL;
+	}
+    }
+  else
+#endif
+    block = (unsigned char *) trace_buffer_alloc (amt);
 
   if (!block)
     return NULL;
@@ -2220,7 +2462,12 @@ add_traceframe_block (struct traceframe *tframe,
   gdb_assert (tframe->tpnum == tpoint->number);
 
   tframe->data_size += amt;
+#ifdef IN_PROCESS_AGENT
+  /* Other threads may be collecting for TPOINT too.  */
+  __atomic_add_fetch (&tpoint->traceframe_usage, amt, __ATOMIC_RELAXED);
+#else
   tpoint->traceframe_usage += amt;
+#endif
 
   return block;
 }
@@ -2230,6 +2477,16 @@ add_traceframe_block (struct traceframe *tframe,
 static void
 finish_traceframe (struct traceframe *tframe)
 {
+#ifdef IN_PROCESS_AGENT
+  struct collect_ring *ring = collect_ring_of (tframe);
+
+  if (ring != NULL)
+    {
+      finish_ring_traceframe (ring, tframe);
+      return;
+    }
+#endif
+
   ++traceframe_write_count;
   ++traceframes_created;
 }
@@ -3669,7 +3926,7 @@ cmd_qtstatus (char *packet)
   sprintf (packet,
 	   "T%d;"
 	   "%s:%x;"
-	   "tframes:%x;tcreated:%x;"
+	   "tframes:%x;tcreated:%x;tdropped:%x;"
 	   "tfree:%x;tsize:%s;"
 	   "circular:%d;"
 	   "disconn:%d;"
@@ -3677,7 +3934,7 @@ cmd_qtstatus (char *packet)
 	   "username:%s;notes:%s:",
 	   tracing ? 1 : 0,
 	   stop_reason_rsp, tracing_stop_tpnum,
-	   traceframe_count, traceframes_created,
+	   traceframe_count, traceframes_created, traceframes_dropped,
 	   free_space (), phex_nz (trace_buffer_hi - trace_buffer_lo, 0),
 	   circular_trace_buffer,
 	   disconnected_tracing,
@@ -4601,24 +4858,48 @@ collect_data_at_tracepoint (struct tracepoint_hit_ctx *ctx, CORE_ADDR stop_pc,
 {
   struct traceframe *tframe;
   int acti;
+  uint64_t hits;
+  struct collect_ring *ring = NULL;
 
   /* Only count it as a hit when we actually collect data.  */
-  tpoint->hit_count++;
+#ifdef IN_PROCESS_AGENT
+  /* Other threads may be collecting for TPOINT too.  */
+  hits = __atomic_add_fetch (&tpoint->hit_count, 1, __ATOMIC_RELAXED);
+#else
+  hits = ++tpoint->hit_count;
+#endif
 
   /* If we've exceeded a defined pass count, record the event for
      later, and finish the collection for this hit.  This test is only
      for nonstepping tracepoints, stepping tracepoints test at the end
      of their while-stepping loop.  */
   if (tpoint->pass_count > 0
-      && tpoint->hit_count >= tpoint->pass_count
+      && hits >= tpoint->pass_count
       && tpoint->step_count == 0
       && stopping_tracepoint == NULL)
-    stopping_tracepoint = tpoint;
+    {
+#ifdef IN_PROCESS_AGENT
+      (void) cmpxchg (&stopping_tracepoint, (struct tracepoint *) NULL,
+		      tpoint);
+#else
+      stopping_tracepoint = tpoint;
+#endif
+    }
 
   trace_debug ("Making new traceframe for tracepoint %d at 0x%s, hit %" PRIu64,
-	       tpoint->number, paddress (tpoint->address), tpoint->hit_count);
+	       tpoint->number, paddress (tpoint->address), hits);
 
-  tframe = add_traceframe (tpoint);
+#ifdef IN_PROCESS_AGENT
+  if (ctx->type == fast_tracepoint)
+    ring = ((struct fast_tracepoint_ctx *) ctx)->ring;
+
+  if (ring != NULL)
+    tframe = add_ring_traceframe (ring,
+				  ((struct fast_tracepoint_ctx *) ctx)->seq,
+				  tpoint);
+  else
+#endif
+    tframe = add_traceframe (tpoint);
 
   if (tframe)
     {
@@ -4637,7 +4918,8 @@ collect_data_at_tracepoint (struct tracepoint_hit_ctx *ctx, CORE_ADDR stop_pc,
       finish_traceframe (tframe);
     }
 
-  if (tframe == NULL && tracing)
+  /* A full ring drops the traceframe instead.  */
+  if (tframe == NULL && tracing && ring == NULL)
     trace_buffer_is_full = 1;
 }
 
@@ -4680,14 +4962,6 @@ collect_data_at_step (struct tracepoint_hit_ctx *ctx,
 
 #endif
 
-#ifdef IN_PROCESS_AGENT
-/* The target description index for IPA.  Passed from gdbserver, used
-   to select ipa_tdesc.  */
-EXTERN_C_PUSH
-IP_AGENT_EXPORT_VAR int ipa_tdesc_idx;
-EXTERN_C_POP
-#endif
-
 static struct regcache *
 get_context_regcache (struct tracepoint_hit_ctx *ctx)
 {
@@ -5525,10 +5799,52 @@ typedef struct collecting_t
 
 #ifndef IN_PROCESS_AGENT
 
+/* Return the address of the IPA tracepoint object the thread
+   identified by THREAD_AREA is collecting for into its per-thread
+   ring, or 0 if it isn't.  If RING_ADDR is not NULL, store the
+   address of the ring's control block there.  */
+
+static CORE_ADDR
+collect_ring_tpoint (CORE_ADDR thread_area, CORE_ADDR *ring_addr)
+{
+  struct collect_ring rings[COLLECT_RING_COUNT];
+
+  if (read_inferior_memory (ipa_sym_addrs.addr_collect_rings,
+			    (unsigned char *) rings, sizeof (rings)) != 0)
+    return 0;
+
+  for (int i = 0; i < COLLECT_RING_COUNT; i++)
+    if (rings[i].thread_area == thread_area && rings[i].tpoint != 0)
+      {
+	if (ring_addr != NULL)
+	  *ring_addr = (ipa_sym_addrs.addr_collect_rings
+			+ i * sizeof (struct collect_ring));
+	return rings[i].tpoint;
+      }
+
+  return 0;
+}
+
 void
-force_unlock_trace_buffer (void)
+force_unlock_trace_buffer (CORE_ADDR thread_area)
 {
-  write_inferior_data_pointer (ipa_sym_addrs.addr_collecting, 0);
+  CORE_ADDR ipa_collecting, ring_addr;
+  collecting_t ipa_collecting_obj;
+
+  /* The thread may be collecting into its own ring, in which case
+     another thread may well be holding the lock.  */
+  if (collect_ring_tpoint (thread_area, &ring_addr) != 0)
+    write_inferior_data_pointer (ring_addr
+				 + offsetof (struct collect_ring, tpoint), 0);
+
+  if (read_inferior_data_pointer (ipa_sym_addrs.addr_collecting,
+				  &ipa_collecting) == 0
+      && ipa_collecting != 0
+      && read_inferior_memory (ipa_collecting,
+			       (unsigned char *) &ipa_collecting_obj,
+			       sizeof (ipa_collecting_obj)) == 0
+      && ipa_collecting_obj.thread_area == thread_area)
+    write_inferior_data_pointer (ipa_sym_addrs.addr_collecting, 0);
 }
 
 /* Check if the thread identified by THREAD_AREA which is stopped at
@@ -5658,6 +5974,7 @@ fast_tracepoint_collecting (CORE_ADDR thread_area,
   else
     {
       collecting_t ipa_collecting_obj;
+      CORE_ADDR ipa_tpoint;
 
       /* If `collecting' is set/locked, then the THREAD_AREA thread
 	 may or not be the one holding the lock.  We have to read the
@@ -5671,33 +5988,36 @@ fast_tracepoint_collecting (CORE_ADDR thread_area,
 	  return fast_tpoint_collect_result::not_collecting;
 	}
 
-      if (!ipa_collecting)
+      ipa_tpoint = 0;
+      if (ipa_collecting)
 	{
-	  trace_debug ("fast_tracepoint_collecting: not collecting"
-		       " (and nobody is).");
-	  return fast_tpoint_collect_result::not_collecting;
+	  /* Some thread is collecting.  Check which.  */
+	  if (read_inferior_memory (ipa_collecting,
+				    (unsigned char *) &ipa_collecting_obj,
+				    sizeof (ipa_collecting_obj)) != 0)
+	    goto again;
+
+	  if (ipa_collecting_obj.thread_area == thread_area)
+	    ipa_tpoint = ipa_collecting_obj.tpoint;
 	}
 
-      /* Some thread is collecting.  Check which.  */
-      if (read_inferior_memory (ipa_collecting,
-				(unsigned char *) &ipa_collecting_obj,
-				sizeof (ipa_collecting_obj)) != 0)
-	goto again;
+      /* Without the lock, the thread may still be collecting into
+	 its own ring.  */
+      if (ipa_tpoint == 0)
+	ipa_tpoint = collect_ring_tpoint (thread_area, NULL);
 
-      if (ipa_collecting_obj.thread_area != thread_area)
+      if (ipa_tpoint == 0)
 	{
-	  trace_debug ("fast_tracepoint_collecting: not collecting "
-		       "(another thread is)");
+	  trace_debug ("fast_tracepoint_collecting: not collecting");
 	  return fast_tpoint_collect_result::not_collecting;
 	}
 
-      tpoint
-	= fast_tracepoint_from_ipa_tpoint_address (ipa_collecting_obj.tpoint);
+      tpoint = fast_tracepoint_from_ipa_tpoint_address (ipa_tpoint);
       if (tpoint == NULL)
 	{
 	  warning ("fast_tracepoint_collecting: collecting, "
 		   "but tpoint %s not found?",
-		   paddress ((CORE_ADDR) ipa_collecting_obj.tpoint));
+		   paddress (ipa_tpoint));
 	  return fast_tpoint_collect_result::not_collecting;
 	}
 
@@ -5753,6 +6073,59 @@ EXTERN_C_PUSH
 IP_AGENT_EXPORT_VAR collecting_t *collecting;
 EXTERN_C_POP
 
+/* The sequence number of the last hit collected into a per-thread
+   ring.  Only touched with the `collecting' lock held.  */
+static unsigned int collect_ring_seq;
+
+/* Find the ring of the thread whose thread area is THREAD_AREA,
+   claiming one for it if it has none.  Must be called with the
+   `collecting' lock held.  Returns NULL if all rings belong to other
+   threads presently collecting into them.  */
+
+static struct collect_ring *
+claim_collect_ring (uintptr_t thread_area)
+{
+  /* Thread areas are usually page aligned, and a stack's worth of
+     pages apart.  */
+  unsigned int start = (thread_area >> 12) % COLLECT_RING_COUNT;
+  struct collect_ring *idle = NULL;
+
+  for (unsigned int i = 0; i < COLLECT_RING_COUNT; i++)
+    {
+      struct collect_ring *ring
+	= &collect_rings[(start + i) % COLLECT_RING_COUNT];
+
+      /* If the thread's ring is in use, this is a nested hit, e.g.,
+	 from a signal handler.  */
+      if (ring->thread_area == thread_area)
+	return ring->tpoint == 0 ? ring : NULL;
+      if (ring->thread_area == 0)
+	{
+	  ring->thread_area = thread_area;
+	  return ring;
+	}
+      if (idle == NULL && ring->tpoint == 0)
+	idle = ring;
+    }
+
+  /* Take over the ring of some thread that isn't collecting right
+     now.  What it left there is still to be uploaded, which is
+     fine.  */
+  if (idle != NULL)
+    idle->thread_area = thread_area;
+  return idle;
+}
+
+/* Take the `collecting' lock back on behalf of SELF, the collecting_t
+   object the jump pad built, which expects to release it.  */
+
+static void
+relock_collecting (collecting_t *self)
+{
+  while (cmpxchg (&collecting, (collecting_t *) NULL, self) != NULL)
+    ;
+}
+
 /* This is needed for -Wmissing-declarations.  */
 IP_AGENT_EXPORT_FUNC void gdb_collect (struct tracepoint *tpoint,
 				       unsigned char *regs);
@@ -5766,6 +6139,10 @@ gdb_collect (struct tracepoint *tpoint, unsigned char *regs)
 {
   struct fast_tracepoint_ctx ctx;
   const struct target_desc *ipa_tdesc;
+  /* The jump pad took the lock for us.  */
+  collecting_t *self = collecting;
+  struct collect_ring *ring = NULL;
+  bool locked = true;
 
   /* Don't do anything until the trace run is completely set up.  */
   if (!tracing)
@@ -5775,6 +6152,8 @@ gdb_collect (struct tracepoint *tpoint, unsigned char *regs)
   ctx.base.type = fast_tracepoint;
   ctx.regs = regs;
   ctx.regcache_initted = 0;
+  ctx.ring = NULL;
+  ctx.seq = 0;
   /* Wrap the regblock in a register cache (in the stack, we don't
      want to malloc here).  */
   ctx.regspace = (unsigned char *) alloca (ipa_tdesc->registers_size);
@@ -5796,6 +6175,39 @@ gdb_collect (struct tracepoint *tpoint, unsigned char *regs)
       if (ctx.tpoint->type != tpoint->type)
 	continue;
 
+      /* Hand the thread over to its own ring if this tracepoint's
+	 traceframes fit in one, so that other threads can collect
+	 meanwhile.  Otherwise, collect into the shared trace buffer,
+	 under the lock.  */
+      if (ring_traceframe_bound (ctx.tpoint) != 0
+	  && (ring != NULL
+	      || (ring = claim_collect_ring (self->thread_area)) != NULL))
+	{
+	  if (locked)
+	    {
+	      if (ring->tpoint == 0)
+		{
+		  ring->tpoint = self->tpoint;
+		  if (++collect_ring_seq == 0)
+		    ++collect_ring_seq;
+		  ctx.seq = collect_ring_seq;
+		}
+	      __atomic_store_n (&collecting, (collecting_t *) NULL,
+				__ATOMIC_RELEASE);
+	      locked = false;
+	    }
+	  ctx.ring = ring;
+	}
+      else
+	{
+	  if (!locked)
+	    {
+	      relock_collecting (self);
+	      locked = true;
+	    }
+	  ctx.ring = NULL;
+	}
+
       /* Test the condition if present, and collect if true.  */
       if (ctx.tpoint->cond == NULL
 	  || condition_true_at_tracepoint ((struct tracepoint_hit_ctx *) &ctx,
@@ -5812,6 +6224,11 @@ gdb_collect (struct tracepoint *tpoint, unsigned char *regs)
 	      || trace_buffer_is_full
 	      || expr_eval_result != expr_eval_no_error)
 	    {
+	      if (!locked)
+		{
+		  relock_collecting (self);
+		  locked = true;
+		}
 	      stop_tracing ();
 	      break;
 	    }
@@ -5823,11 +6240,22 @@ gdb_collect (struct tracepoint *tpoint, unsigned char *regs)
 	     condition expression evaluation.  */
 	  if (expr_eval_result != expr_eval_no_error)
 	    {
+	      if (!locked)
+		{
+		  relock_collecting (self);
+		  locked = true;
+		}
 	      stop_tracing ();
 	      break;
 	    }
 	}
     }
+
+  /* The jump pad releases the lock once we return.  */
+  if (!locked)
+    relock_collecting (self);
+  if (ring != NULL)
+    ring->tpoint = 0;
 }
 
 /* These global variables points to the corresponding functions.  This is
@@ -5978,8 +6406,13 @@ download_agent_expr (struct agent_expr *expr)
   CORE_ADDR expr_addr;
   CORE_ADDR expr_bytes;
 
-  expr_addr = target_malloc (sizeof (*expr));
-  target_write_memory (expr_addr, (unsigned char *) expr, sizeof (*expr));
+  /* The threaded code only exists in GDBserver.  */
+  struct agent_expr ipa_expr = *expr;
+  ipa_expr.compiled = nullptr;
+
+  expr_addr = target_malloc (sizeof (ipa_expr));
+  target_write_memory (expr_addr, (unsigned char *) &ipa_expr,
+		       sizeof (ipa_expr));
 
   expr_bytes = target_malloc (expr->length);
   write_inferior_data_pointer (expr_addr + offsetof (struct agent_expr, bytes),
@@ -5992,6 +6425,59 @@ download_agent_expr (struct agent_expr *expr)
 /* Align V up to N bits.  */
 #define UALIGN(V, N) (((V) + ((N) - 1)) & ~((N) - 1))
 
+/* Compute the traceframe_bound of the fast tracepoint TPOINT.  */
+
+static uint32_t
+fast_traceframe_bound (struct tracepoint *tpoint)
+{
+  /* The header of a memory block, see agent_mem_read.  */
+  const ULONGEST mblock_header
+    = 1 + sizeof (CORE_ADDR) + sizeof (unsigned short);
+  ULONGEST size = sizeof (struct traceframe);
+  ULONGEST expr_size;
+
+  /* The condition doesn't collect anything, but it must be safe to
+     evaluate concurrently too.  */
+  if (tpoint->cond != NULL
+      && !gdb_agent_expr_trace_bound (tpoint->cond, &expr_size))
+    return 0;
+
+  for (uint32_t i = 0; i < tpoint->numactions; i++)
+    {
+      struct tracepoint_action *action = tpoint->actions[i];
+
+      switch (action->type)
+	{
+	case 'M':
+	  {
+	    ULONGEST len = ((struct collect_memory_action *) action)->len;
+
+	    if (len > COLLECT_RING_MAX_FRAME)
+	      return 0;
+	    size += len + mblock_header * ((len + 65534) / 65535);
+	  }
+	  break;
+	case 'R':
+	  /* Accounted for by ring_traceframe_bound.  */
+	  break;
+	case 'X':
+	  if (!gdb_agent_expr_trace_bound
+	       (((struct eval_expr_action *) action)->expr, &expr_size)
+	      || expr_size > COLLECT_RING_MAX_FRAME)
+	    return 0;
+	  size += expr_size;
+	  break;
+	default:
+	  return 0;
+	}
+
+      if (size > COLLECT_RING_MAX_FRAME)
+	return 0;
+    }
+
+  return size;
+}
+
 /* Sync tracepoint with IPA, but leave maintenance of linked list to caller.  */
 
 static void
@@ -6024,6 +6510,9 @@ download_tracepoint_1 (struct tracepoint *tpoint)
       claim_jump_space (jentry - jump_entry);
     }
 
+  if (tpoint->type == fast_tracepoint)
+    tpoint->traceframe_bound = fast_traceframe_bound (tpoint);
+
   target_tracepoint = *tpoint;
 
   tpptr = target_malloc (sizeof (*tpoint));
@@ -6275,14 +6764,14 @@ download_trace_state_variables (void)
     }
 }
 
-/* Upload complete trace frames out of the IP Agent's trace buffer
-   into GDBserver's trace buffer.  This always uploads either all or
-   no trace frames.  This is the counter part of
+/* Upload complete trace frames out of the IP Agent's shared trace
+   buffer into GDBserver's trace buffer.  This always uploads either
+   all or no trace frames.  This is the counter part of
    `trace_alloc_trace_buffer'.  See its description of the atomic
    syncing mechanism.  */
 
 static void
-upload_fast_traceframes (void)
+upload_shared_fast_traceframes (void)
 {
   unsigned int ipa_traceframe_read_count, ipa_traceframe_write_count;
   unsigned int ipa_traceframe_read_count_racy, ipa_traceframe_write_count_racy;
@@ -6532,6 +7021,142 @@ upload_fast_traceframes (void)
   about_to_request_buffer_space_bkpt = NULL;
 
   target_unpause_all (true);
+}
+
+/* Upload the complete traceframes in the IP Agent's per-thread rings
+   into GDBserver's trace buffer, merging them in hit order.  See
+   struct collect_ring.  */
+
+static void
+upload_ring_traceframes (void)
+{
+  struct ring_traceframe
+  {
+    uint32_t seq;
+
+    /* Where the traceframe is in DATA.  */
+    size_t offset;
+  };
+
+  struct collect_ring rings[COLLECT_RING_COUNT];
+  std::vector<unsigned char> data;
+  std::vector<ring_traceframe> frames;
+  unsigned int dropped = 0;
+
+  if (read_inferior_memory (ipa_sym_addrs.addr_collect_rings,
+			    (unsigned char *) rings, sizeof (rings)))
+    return;
+
+  for (int i = 0; i < COLLECT_RING_COUNT; i++)
+    {
+      const struct collect_ring *ring = &rings[i];
+      uintptr_t len = ring->head - ring->tail;
+      uintptr_t offset = ring->tail & (COLLECT_RING_SIZE - 1);
+      uintptr_t first = std::min (len, COLLECT_RING_SIZE - offset);
+      CORE_ADDR buf = (ipa_sym_addrs.addr_collect_ring_buffers
+		       + i * COLLECT_RING_SIZE);
+      size_t start = data.size ();
+
+      dropped += ring->dropped;
+
+      if (len == 0)
+	continue;
+      if (len > COLLECT_RING_SIZE)
+	{
+	  warning ("Uploading: bad in-process agent ring %d "
+		   "(head %s, tail %s)", i,
+		   phex_nz (ring->head, sizeof (ring->head)),
+		   phex_nz (ring->tail, sizeof (ring->tail)));
+	  continue;
+	}
+
+      /* Records never straddle the end of the buffer, so the two
+	 pieces of a wrapped around range can just be concatenated.  */
+      data.resize (start + len);
+      if (read_inferior_memory (buf + offset, &data[start], first)
+	  || (first < len
+	      && read_inferior_memory (buf, &data[start + first], len - first)))
+	{
+	  data.resize (start);
+	  continue;
+	}
+
+      for (size_t pos = start; pos < start + len; )
+	{
+	  struct collect_ring_record rec;
+
+	  memcpy (&rec, &data[pos], sizeof (rec));
+	  if (rec.size < sizeof (rec) || rec.size > start + len - pos)
+	    {
+	      warning ("Uploading: bad record in in-process agent ring %d", i);
+	      break;
+	    }
+	  if (rec.seq != 0)
+	    frames.push_back ({ rec.seq, pos + sizeof (rec) });
+	  pos += rec.size;
+	}
+
+      /* Let the thread reuse the space.  */
+      write_inferior_data_pointer (ipa_sym_addrs.addr_collect_rings
+				   + i * sizeof (struct collect_ring)
+				   + offsetof (struct collect_ring, tail),
+				   ring->head);
+    }
+
+  traceframes_dropped = dropped;
+
+  if (frames.empty ())
+    return;
+
+  trace_debug ("Uploading %zu traceframes from the in-process agent's "
+	       "per-thread rings", frames.size ());
+
+  /* Sequence numbers wrap around, but only the most recent few
+     thousand hits can be pending.  */
+  std::stable_sort (frames.begin (), frames.end (),
+		    [] (const ring_traceframe &a, const ring_traceframe &b)
+		    {
+		      return (int32_t) (a.seq - b.seq) < 0;
+		    });
+
+  for (const ring_traceframe &f : frames)
+    {
+      struct traceframe ipa_tframe;
+      struct tracepoint *tpoint;
+      struct traceframe *tframe;
+      unsigned char *block;
+
+      memcpy (&ipa_tframe, &data[f.offset],
+	      offsetof (struct traceframe, data));
+
+      tpoint = find_next_tracepoint_by_number (NULL, ipa_tframe.tpnum);
+      if (tpoint == NULL)
+	continue;
+
+      tframe = add_traceframe (tpoint);
+      if (tframe == NULL)
+	{
+	  trace_buffer_is_full = 1;
+	  trace_debug ("Uploading: trace buffer is full");
+	  continue;
+	}
+
+      block = add_traceframe_block (tframe, tpoint, ipa_tframe.data_size);
+      if (block != NULL)
+	memcpy (block, &data[f.offset + offsetof (struct traceframe, data)],
+		ipa_tframe.data_size);
+      finish_traceframe (tframe);
+    }
+}
+
+/* Upload the IP Agent's complete traceframes into GDBserver's trace
+   buffer.  */
+
+static void
+upload_fast_traceframes (void)
+{
+  upload_shared_fast_traceframes ();
+  upload_ring_traceframes ();
 
   if (trace_buffer_is_full)
     stop_tracing ();
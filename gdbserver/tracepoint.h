@@ -132,7 +132,9 @@ fast_tpoint_collect_result fast_tracepoint_collecting
   (CORE_ADDR thread_area, CORE_ADDR stop_pc,
    struct fast_tpoint_collect_status *status);
 
-void force_unlock_trace_buffer (void);
+/* Cancel the fast tracepoint collection the thread identified by
+   THREAD_AREA was doing, releasing the collect lock if it holds it.  */
+void force_unlock_trace_buffer (CORE_ADDR thread_area);
 
 int handle_tracepoint_bkpts (struct thread_info *tinfo, CORE_ADDR stop_pc);
 
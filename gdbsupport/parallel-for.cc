@@ -0,0 +1,96 @@
+/* Parallel for loops
+
+   Copyright (C) 2023 Free Software Foundation, Inc.
+
+   This file is part of GDB.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include "common-defs.h"
+#include "gdbsupport/parallel-for.h"
+
+namespace gdb
+{
+
+/* See parallel-for.h.  */
+
+bool parallel_for_each_debug = false;
+
+namespace detail
+{
+
+/* See parallel-for.h.  */
+
+void
+guided_state::work (size_t thread)
+{
+  while (true)
+    {
+      size_t i = next_chunk.fetch_add (1, std::memory_order_relaxed);
+      if (i >= n_chunks)
+	break;
+
+      if (stats.empty ())
+	run_chunk (i);
+      else
+	{
+	  auto start = std::chrono::steady_clock::now ();
+	  run_chunk (i);
+	  stats[i].thread = thread;
+	  stats[i].duration = std::chrono::steady_clock::now () - start;
+	}
+    }
+}
+
+/* See parallel-for.h.  */
+
+void
+guided_state::print_stats (const std::vector<size_t> &elements,
+			   const std::vector<size_t> &sizes) const
+{
+  using ms = std::chrono::duration<double, std::milli>;
+
+  debug_printf (_("Parallel for (guided): n_chunks: %zu\n"), n_chunks);
+
+  /* The calling thread is numbered last, and threads may not have
+     processed any chunk at all, so find the highest number.  */
+  size_t n_threads = 0;
+  for (const guided_chunk_stats &chunk : stats)
+    n_threads = std::max (n_threads, chunk.thread + 1);
+
+  std::vector<size_t> thread_chunks (n_threads);
+  std::vector<ms> thread_time (n_threads);
+  for (size_t i = 0; i < stats.size (); ++i)
+    {
+      const guided_chunk_stats &chunk = stats[i];
+      ms duration = chunk.duration;
+
+      debug_printf (_("Parallel for (guided): chunk %zu on thread %zu\t: "
+		      "%zu elements"), i, chunk.thread, elements[i]);
+      if (!sizes.empty ())
+	debug_printf (_("\t(size: %zu)"), sizes[i]);
+      debug_printf (_("\t%.3f ms\n"), duration.count ());
+
+      ++thread_chunks[chunk.thread];
+      thread_time[chunk.thread] += duration;
+    }
+
+  for (size_t i = 0; i < n_threads; ++i)
+    debug_printf (_("Parallel for (guided): thread %zu\t: %zu chunks, "
+		    "%.3f ms\n"), i, thread_chunks[i], thread_time[i].count ());
+}
+
+}
+
+}
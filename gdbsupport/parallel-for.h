@@ -21,6 +21,8 @@
 #define GDBSUPPORT_PARALLEL_FOR_H
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <type_traits>
 #include "gdbsupport/invoke-result.h"
 #include "gdbsupport/thread-pool.h"
@@ -29,30 +31,75 @@
 namespace gdb
 {
 
+/* If true, print debug info about how the work of parallel_for_each
+   and parallel_for_each_guided is distributed across the threads.  */
+extern bool parallel_for_each_debug;
+
 namespace detail
 {
 
+/* A task that runs the callback of a parallel_for_each on one
+   subrange, and that stores the result.  These are posted to the
+   thread pool directly, so that no allocation is needed per
+   subrange.  */
+template<typename T, typename RandomIt>
+struct par_for_task final : public pool_task
+{
+  void run () override
+  {
+    result = callback (first, last);
+  }
+
+  /* The callback, and the subrange to invoke it on.  */
+  gdb::function_view<T (RandomIt, RandomIt)> callback;
+  RandomIt first {};
+  RandomIt last {};
+
+  /* The value returned by the callback.  */
+  T result {};
+};
+
+/* See the generic template.  */
+template<typename RandomIt>
+struct par_for_task<void, RandomIt> final : public pool_task
+{
+  void run () override
+  {
+    callback (first, last);
+  }
+
+  gdb::function_view<void (RandomIt, RandomIt)> callback;
+  RandomIt first {};
+  RandomIt last {};
+};
+
 /* This is a helper class that is used to accumulate results for
    parallel_for.  There is a specialization for 'void', below.  */
-template<typename T>
+template<typename T, typename RandomIt>
 struct par_for_accumulator
 {
 public:
 
   explicit par_for_accumulator (size_t n_threads)
-    : m_futures (n_threads)
+    : m_tasks (n_threads),
+      m_n_tasks (n_threads)
   {
   }
 
   /* The result type that is accumulated.  */
   typedef std::vector<T> result_type;
 
-  /* Post the Ith task to a background thread, and store a future for
-     later.  */
-  void post (size_t i, std::function<T ()> task)
+  /* Post the Ith task to a background thread.  It will invoke
+     CALLBACK on the subrange [FIRST, LAST), and the result is stored
+     for later.  */
+  void post (size_t i, gdb::function_view<T (RandomIt, RandomIt)> callback,
+	     RandomIt first, RandomIt last)
   {
-    m_futures[i]
-      = gdb::thread_pool::g_thread_pool->post_task (std::move (task));
+    par_for_task<T, RandomIt> &task = m_tasks[i];
+    task.callback = callback;
+    task.first = first;
+    task.last = last;
+    m_group.post (task);
   }
 
   /* Invoke TASK in the current thread, then compute all the results
@@ -60,69 +107,83 @@ struct par_for_accumulator
      which is returned.  */
   result_type finish (gdb::function_view<T ()> task)
   {
-    result_type result (m_futures.size () + 1);
+    result_type result (m_n_tasks + 1);
 
     result.back () = task ();
 
-    for (size_t i = 0; i < m_futures.size (); ++i)
-      result[i] = m_futures[i].get ();
+    /* This propagates any exception thrown by a background task.  */
+    m_group.wait ();
+    for (size_t i = 0; i < m_n_tasks; ++i)
+      result[i] = std::move (m_tasks[i].result);
 
     return result;
   }
 
-  /* Resize the results to N.  */
+  /* Only use the first N tasks.  */
   void resize (size_t n)
   {
-    m_futures.resize (n);
+    gdb_assert (n <= m_tasks.size ());
+    m_n_tasks = n;
   }
 
 private:
-  
-  /* A vector of futures coming from the tasks run in the
-     background.  */
-  std::vector<gdb::future<T>> m_futures;
+
+  /* The tasks that are run in the background.  */
+  std::vector<par_for_task<T, RandomIt>> m_tasks;
+
+  /* The number of tasks that are actually used.  */
+  size_t m_n_tasks;
+
+  /* The group used to wait for the tasks.  This must follow M_TASKS,
+     so that it is destroyed first -- its destructor waits for any
+     task that is still running.  */
+  task_group m_group;
 };
 
 /* See the generic template.  */
-template<>
-struct par_for_accumulator<void>
+template<typename RandomIt>
+struct par_for_accumulator<void, RandomIt>
 {
 public:
 
   explicit par_for_accumulator (size_t n_threads)
-    : m_futures (n_threads)
+    : m_tasks (n_threads)
   {
   }
 
   /* This specialization does not compute results.  */
   typedef void result_type;
 
-  void post (size_t i, std::function<void ()> task)
+  void post (size_t i, gdb::function_view<void (RandomIt, RandomIt)> callback,
+	     RandomIt first, RandomIt last)
   {
-    m_futures[i]
-      = gdb::thread_pool::g_thread_pool->post_task (std::move (task));
+    par_for_task<void, RandomIt> &task = m_tasks[i];
+    task.callback = callback;
+    task.first = first;
+    task.last = last;
+    m_group.post (task);
   }
 
   result_type finish (gdb::function_view<void ()> task)
   {
     task ();
 
-    for (auto &future : m_futures)
-      {
-	/* Use 'get' and not 'wait', to propagate any exception.  */
-	future.get ();
-      }
+    /* This propagates any exception thrown by a background task.  */
+    m_group.wait ();
   }
 
-  /* Resize the results to N.  */
+  /* Only use the first N tasks.  */
   void resize (size_t n)
   {
-    m_futures.resize (n);
+    gdb_assert (n <= m_tasks.size ());
   }
 
 private:
 
-  std::vector<gdb::future<void>> m_futures;
+  std::vector<par_for_task<void, RandomIt>> m_tasks;
+
+  /* See the generic template.  */
+  task_group m_group;
 };
 
 }
@@ -145,7 +206,8 @@ struct par_for_accumulator<void>
 
 template<class RandomIt, class RangeFunction>
 typename gdb::detail::par_for_accumulator<
-    typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type
+    typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type,
+    RandomIt
   >::result_type
 parallel_for_each (unsigned n, RandomIt first, RandomIt last,
 		   RangeFunction callback,
@@ -154,10 +216,6 @@ parallel_for_each (unsigned n, RandomIt first, RandomIt last,
   using result_type
     = typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type;
 
-  /* If enabled, print debug info about how the work is distributed across
-     the threads.  */
-  const bool parallel_for_each_debug = false;
-
   size_t n_worker_threads = thread_pool::g_thread_pool->thread_count ();
   size_t n_threads = n_worker_threads;
   size_t n_elements = last - first;
@@ -201,7 +259,7 @@ parallel_for_each (unsigned n, RandomIt first, RandomIt last,
     }
 
   size_t count = n_threads == 0 ? 0 : n_threads - 1;
-  gdb::detail::par_for_accumulator<result_type> results (count);
+  gdb::detail::par_for_accumulator<result_type, RandomIt> results (count);
 
   if (parallel_for_each_debug)
     {
@@ -270,8 +328,7 @@ parallel_for_each (unsigned n, RandomIt first, RandomIt last,
 	    debug_printf (_("\t(size: %zu)"), chunk_size);
 	  debug_printf (_("\n"));
 	}
-      results.post (i, [=] ()
-	{ return callback (first, end); });
+      results.post (i, callback, first, end);
       first = end;
     }
 
@@ -299,13 +356,327 @@ parallel_for_each (unsigned n, RandomIt first, RandomIt last,
     });
 }
 
+namespace detail
+{
+
+/* Statistics about one chunk of a parallel_for_each_guided, kept
+   when debugging.  */
+struct guided_chunk_stats
+{
+  /* The thread that processed the chunk.  Worker threads are
+     numbered from 0; the calling thread is numbered last.  */
+  size_t thread;
+
+  /* How long the chunk took.  */
+  std::chrono::steady_clock::duration duration;
+};
+
+/* The state shared by all the threads taking part in a
+   parallel_for_each_guided.  */
+struct guided_state
+{
+  explicit guided_state (size_t n_chunks_)
+    : n_chunks (n_chunks_)
+  {
+  }
+
+  /* Claim and process chunks until none are left.  THREAD is the
+     number of the current thread, for the statistics.  */
+  void work (size_t thread);
+
+  /* Print the statistics to the debug output.  ELEMENTS is the
+     number of elements of each chunk, and SIZES is the estimated cost
+     of each chunk, or empty if unknown.  */
+  void print_stats (const std::vector<size_t> &elements,
+		    const std::vector<size_t> &sizes) const;
+
+  /* The number of chunks.  */
+  const size_t n_chunks;
+
+  /* The next chunk to be claimed.  */
+  std::atomic<size_t> next_chunk {0};
+
+  /* Process the chunk with the given index.  */
+  gdb::function_view<void (size_t)> run_chunk;
+
+  /* The statistics for each chunk.  This is empty unless debugging
+     is enabled.  */
+  std::vector<guided_chunk_stats> stats;
+};
+
+/* A task that takes part in a parallel_for_each_guided from a worker
+   thread.  */
+struct guided_task final : public pool_task
+{
+  void run () override
+  {
+    state->work (thread);
+  }
+
+  guided_state *state = nullptr;
+  size_t thread = 0;
+};
+
+/* Storage for the results of parallel_for_each_guided, one per
+   chunk.  There is a specialization for 'void', below.  */
+template<typename T>
+struct guided_results
+{
+  /* The result type that is accumulated.  */
+  typedef std::vector<T> result_type;
+
+  explicit guided_results (size_t n_chunks)
+    : m_results (n_chunks)
+  {
+  }
+
+  /* Invoke CALLBACK on [FIRST, LAST), which is chunk I.  */
+  template<typename RangeFunction, typename RandomIt>
+  void run (size_t i, RangeFunction &callback, RandomIt first, RandomIt last)
+  {
+    m_results[i] = callback (first, last);
+  }
+
+  /* Return the results.  */
+  result_type release ()
+  {
+    return std::move (m_results);
+  }
+
+private:
+
+  std::vector<T> m_results;
+};
+
+/* See the generic template.  */
+template<>
+struct guided_results<void>
+{
+  /* This specialization does not compute results.  */
+  typedef void result_type;
+
+  explicit guided_results (size_t n_chunks)
+  {
+  }
+
+  template<typename RangeFunction, typename RandomIt>
+  void run (size_t i, RangeFunction &callback, RandomIt first, RandomIt last)
+  {
+    callback (first, last);
+  }
+
+  result_type release ()
+  {
+  }
+};
+
+}
+
+/* Like parallel_for_each, but using dynamic "guided" scheduling.
+
+   Rather than being split into one subrange per thread up front, the
+   range is cut into a sequence of chunks, and the threads -- including
+   the calling thread -- claim chunks one at a time from a shared
+   atomic cursor until none are left.  The chunks start out large and
+   shrink towards the end of the range: each chunk covers about
+   1/(2 * number of threads) of the work that remains.  This way, a
+   thread that ends up with one very expensive element does not hold
+   up the others, which simply keep claiming the remaining chunks.
+
+   N is the minimum number of elements in a chunk, and must not be 0.
+   If TASK_SIZE is not nullptr, it is used to estimate the cost of each
+   element, and the chunks are cut according to the estimated cost
+   rather than the number of elements.  In this case chunks also have
+   a minimum cost of 1/(8 * number of threads) of the total, so that
+   the number of chunks stays proportional to the number of threads.
+
+   CALLBACK is called once per chunk.  If it returns a non-void type,
+   then a vector of the results is returned, with one entry per chunk,
+   in the order of the range.  */
+
+template<class RandomIt, class RangeFunction>
+typename gdb::detail::guided_results<
+    typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type
+  >::result_type
+parallel_for_each_guided (unsigned n, RandomIt first, RandomIt last,
+			  RangeFunction callback,
+			  gdb::function_view<size_t(RandomIt)> task_size
+			    = nullptr)
+{
+  using result_type
+    = typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type;
+
+  gdb_assert (n > 0);
+
+  size_t n_worker_threads = thread_pool::g_thread_pool->thread_count ();
+  size_t n_threads = n_worker_threads + 1;
+  size_t n_elements = last - first;
+
+  /* Cut the range into chunks.  CHUNK_START holds the offset of the
+     start of each chunk, plus a final entry for the end of the range.
+     If TASK_SIZE is given, CHUNK_SIZE holds the estimated cost of
+     each chunk.  */
+  std::vector<size_t> chunk_start { 0 };
+  std::vector<size_t> chunk_size;
+  if (n_worker_threads == 0 || n_elements == 0)
+    chunk_start.push_back (n_elements);
+  else if (task_size == nullptr)
+    {
+      size_t offset = 0;
+      while (offset < n_elements)
+	{
+	  size_t remaining = n_elements - offset;
+	  size_t size = std::max (remaining / (2 * n_threads), (size_t) n);
+	  offset += std::min (size, remaining);
+	  chunk_start.push_back (offset);
+	}
+    }
+  else
+    {
+      /* As in parallel_for_each, clamp the element sizes so that the
+	 total cannot overflow.  */
+      size_t max_element_size = SIZE_MAX / n_elements;
+      std::vector<size_t> element_sizes (n_elements);
+      size_t total_size = 0;
+      for (size_t i = 0; i < n_elements; ++i)
+	{
+	  size_t element_size = task_size (first + i);
+	  gdb_assert (element_size > 0);
+	  element_sizes[i] = std::min (element_size, max_element_size);
+	  total_size += element_sizes[i];
+	}
+
+      size_t min_size = std::max (total_size / (8 * n_threads), (size_t) 1);
+      size_t remaining = total_size;
+      size_t offset = 0;
+      while (offset < n_elements)
+	{
+	  size_t target = std::max (remaining / (2 * n_threads), min_size);
+	  size_t size = 0;
+	  size_t count = 0;
+	  while (offset < n_elements && (count < n || size < target))
+	    {
+	      size += element_sizes[offset];
+	      ++offset;
+	      ++count;
+	    }
+	  remaining -= size;
+	  chunk_start.push_back (offset);
+	  chunk_size.push_back (size);
+	}
+    }
+
+  size_t n_chunks = chunk_start.size () - 1;
+  gdb::detail::guided_results<result_type> results (n_chunks);
+  gdb::detail::guided_state state (n_chunks);
+
+  auto run_chunk = [&] (size_t i)
+    {
+      results.run (i, callback, first + chunk_start[i],
+		   first + chunk_start[i + 1]);
+    };
+  state.run_chunk = run_chunk;
+
+  if (parallel_for_each_debug)
+    state.stats.resize (n_chunks);
+
+  /* Don't start more worker tasks than there are chunks for them.  */
+  size_t n_tasks = std::min (n_worker_threads, n_chunks - 1);
+  std::vector<gdb::detail::guided_task> tasks (n_tasks);
+  {
+    /* This is declared after the tasks, so that it is destroyed
+       first: the destructor waits for them if an exception is
+       thrown.  */
+    task_group group;
+    for (size_t i = 0; i < n_tasks; ++i)
+      {
+	tasks[i].state = &state;
+	tasks[i].thread = i;
+	group.post (tasks[i]);
+      }
+
+    /* The calling thread takes part too.  */
+    state.work (n_worker_threads);
+
+    /* This propagates any exception thrown by a background task.  */
+    group.wait ();
+  }
+
+  if (parallel_for_each_debug)
+    {
+      std::vector<size_t> chunk_elements (n_chunks);
+      for (size_t i = 0; i < n_chunks; ++i)
+	chunk_elements[i] = chunk_start[i + 1] - chunk_start[i];
+      state.print_stats (chunk_elements, chunk_size);
+    }
+
+  return results.release ();
+}
+
+/* Sort the range [FIRST, LAST) using COMP, like std::sort, but using
+   the thread pool.  The range is cut into one run per thread; the
+   runs are sorted in parallel, and then merged pairwise, with the
+   merges of each round also done in parallel.  The sort is not
+   stable.  Ranges shorter than MIN_RUN elements per thread are simply
+   sorted by the calling thread.  */
+
+template<class RandomIt, class Compare>
+void
+parallel_sort (RandomIt first, RandomIt last, Compare comp,
+	       size_t min_run = 4096)
+{
+  size_t n_elements = last - first;
+  size_t n_runs = std::min (thread_pool::g_thread_pool->thread_count () + 1,
+			    n_elements / std::max (min_run, (size_t) 1));
+  if (n_runs <= 1)
+    {
+      std::sort (first, last, comp);
+      return;
+    }
+
+  /* BOUNDS holds the start of each run, plus the end of the
+     range.  */
+  std::vector<RandomIt> bounds;
+  for (size_t i = 0; i < n_runs; ++i)
+    bounds.push_back (first + n_elements * i / n_runs);
+  bounds.push_back (last);
+
+  parallel_for_each_guided (1, (size_t) 0, n_runs,
+			    [&] (size_t start, size_t end)
+    {
+      for (; start < end; ++start)
+	std::sort (bounds[start], bounds[start + 1], comp);
+    });
+
+  while (bounds.size () > 2)
+    {
+      size_t n_merges = (bounds.size () - 1) / 2;
+      parallel_for_each_guided (1, (size_t) 0, n_merges,
+				[&] (size_t start, size_t end)
+	{
+	  for (; start < end; ++start)
+	    std::inplace_merge (bounds[2 * start], bounds[2 * start + 1],
+				bounds[2 * start + 2], comp);
+	});
+
+      /* Each merge joined two runs; an odd run at the end is kept
+	 as it is.  */
+      std::vector<RandomIt> next;
+      for (size_t i = 0; i < bounds.size () - 1; i += 2)
+	next.push_back (bounds[i]);
+      next.push_back (last);
+      bounds = std::move (next);
+    }
+}
+
 /* A sequential drop-in replacement of parallel_for_each.  This can be useful
    when debugging multi-threading behaviour, and you want to limit
    multi-threading in a fine-grained way.  */
 
 template<class RandomIt, class RangeFunction>
 typename gdb::detail::par_for_accumulator<
-    typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type
+    typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type,
+    RandomIt
   >::result_type
 sequential_for_each (unsigned n, RandomIt first, RandomIt last,
 		     RangeFunction callback,
@@ -313,7 +684,7 @@ sequential_for_each (unsigned n, RandomIt first, RandomIt last,
 {
   using result_type = typename gdb::invoke_result<RangeFunction, RandomIt, RandomIt>::type;
 
-  gdb::detail::par_for_accumulator<result_type> results (0);
+  gdb::detail::par_for_accumulator<result_type, RandomIt> results (0);
 
   /* Process all the remaining elements in the main thread.  */
   return results.finish ([=] ()
@@ -130,6 +130,86 @@ set_thread_name (const char *name)
 namespace gdb
 {
 
+#if CXX_STD_THREAD
+
+namespace detail
+{
+
+/* The state of a single worker thread.  Like the thread pool itself,
+   these are never destroyed; however, the slot of a worker whose
+   thread has exited can be reused by a new thread.  */
+
+struct thread_pool_worker
+{
+  explicit thread_pool_worker (size_t index_)
+    : index (index_)
+  {
+  }
+
+  /* The index of this worker in the list of all workers.  This is
+     used to choose where to start looking when stealing.  */
+  const size_t index;
+
+  /* Protects the fields below.  */
+  std::mutex mutex;
+
+  /* The tasks assigned to this worker.  The worker itself takes tasks
+     from the back, while other workers steal from the front.  */
+  std::deque<pool_task *> tasks;
+
+  /* True if the thread of this worker has been asked to exit.  It
+     will do so once its deque is empty.  This is only written while
+     holding MUTEX, but is atomic so that a sleeping worker can check
+     it.  */
+  std::atomic<bool> exiting {false};
+
+  /* True if no thread is running for this worker.  */
+  bool dead = false;
+};
+
+/* A snapshot of the workers.  Once published by set_thread_count,
+   this is never modified.  */
+
+struct thread_pool_worker_list
+{
+  /* All the workers that may still be holding tasks, including ones
+     that are exiting.  Work is stolen from any of these.  */
+  std::vector<thread_pool_worker *> all;
+
+  /* The workers that accept tasks posted from outside the pool.  */
+  std::vector<thread_pool_worker *> active;
+};
+
+}
+
+/* The worker for the current thread, or nullptr if the current
+   thread is not one of the pool's threads.  */
+static thread_local detail::thread_pool_worker *current_worker;
+
+/* A pool_task that owns a packaged task, and that deletes itself
+   once it has run.  This is used to implement post_task.  */
+
+class packaged_pool_task final : public pool_task
+{
+public:
+  explicit packaged_pool_task (std::packaged_task<void ()> &&task)
+    : m_task (std::move (task))
+  {
+  }
+
+  void run () override
+  {
+    m_task ();
+    delete this;
+  }
+
+private:
+
+  std::packaged_task<void ()> m_task;
+};
+
+#endif /* CXX_STD_THREAD */
+
 /* The thread pool detach()s its threads, so that the threads will not
    prevent the process from exiting.  However, it was discovered that
    if any detached threads were still waiting on a condition variable,
@@ -153,19 +233,57 @@ void
 thread_pool::set_thread_count (size_t num_threads)
 {
 #if CXX_STD_THREAD
-  std::lock_guard<std::mutex> guard (m_tasks_mutex);
+  std::lock_guard<std::mutex> guard (m_resize_mutex);
+
+  const detail::thread_pool_worker_list *old_list = m_workers.load ();
+  std::unique_ptr<detail::thread_pool_worker_list> new_list
+    (new detail::thread_pool_worker_list);
+
+  /* Workers beyond the new size are asked to exit below, once the new
+     list has been published.  */
+  std::vector<detail::thread_pool_worker *> surplus;
+  if (old_list != nullptr)
+    {
+      new_list->all = old_list->all;
+      for (detail::thread_pool_worker *worker : old_list->active)
+	{
+	  if (new_list->active.size () < num_threads)
+	    new_list->active.push_back (worker);
+	  else
+	    surplus.push_back (worker);
+	}
+    }
 
   /* If the new size is larger, start some new threads.  */
-  if (m_thread_count < num_threads)
+  if (new_list->active.size () < num_threads)
     {
       /* Ensure that signals used by gdb are blocked in the new
 	 threads.  */
       block_signals blocker;
-      for (size_t i = m_thread_count; i < num_threads; ++i)
+      while (new_list->active.size () < num_threads)
 	{
+	  /* Reuse the slot of a worker whose thread has exited, if
+	     there is one.  */
+	  detail::thread_pool_worker *worker = nullptr;
+	  for (detail::thread_pool_worker *candidate : new_list->all)
+	    {
+	      std::lock_guard<std::mutex> worker_guard (candidate->mutex);
+	      if (candidate->dead)
+		{
+		  candidate->dead = false;
+		  candidate->exiting = false;
+		  worker = candidate;
+		  break;
+		}
+	    }
+
+	  bool is_new = worker == nullptr;
+	  if (is_new)
+	    worker = new detail::thread_pool_worker (new_list->all.size ());
+
 	  try
 	    {
-	      std::thread thread (&thread_pool::thread_function, this);
+	      std::thread thread (&thread_pool::thread_function, this, worker);
 	      thread.detach ();
 	    }
 	  catch (const std::system_error &)
@@ -173,47 +291,181 @@ thread_pool::set_thread_count (size_t num_threads)
 	      /* libstdc++ may not implement std::thread, and will
 		 throw an exception on use.  It seems fine to ignore
 		 this, and any other sort of startup failure here.  */
-	      num_threads = i;
+	      if (is_new)
+		delete worker;
+	      else
+		{
+		  std::lock_guard<std::mutex> worker_guard (worker->mutex);
+		  worker->dead = true;
+		}
 	      break;
 	    }
+
+	  if (is_new)
+	    new_list->all.push_back (worker);
+	  new_list->active.push_back (worker);
 	}
     }
-  /* If the new size is smaller, terminate some existing threads.  */
-  if (num_threads < m_thread_count)
+
+  m_thread_count = new_list->active.size ();
+  m_workers.store (new_list.get ());
+  m_worker_lists.push_back (std::move (new_list));
+
+  /* If the new size is smaller, terminate some existing threads.  A
+     thread only exits once it has run all the tasks in its deque.  */
+  for (detail::thread_pool_worker *worker : surplus)
     {
-      for (size_t i = num_threads; i < m_thread_count; ++i)
-	m_tasks.emplace ();
-      m_tasks_cv.notify_all ();
+      std::lock_guard<std::mutex> worker_guard (worker->mutex);
+      worker->exiting = true;
+    }
+  if (!surplus.empty ())
+    {
+      {
+	std::lock_guard<std::mutex> sleep_guard (m_sleep_mutex);
+      }
+      m_sleep_cv.notify_all ();
     }
-
-  m_thread_count = num_threads;
 #else
   /* No threads available, simply ignore the request.  */
 #endif /* CXX_STD_THREAD */
 }
 
+/* See thread-pool.h.  */
+
+void
+thread_pool::run_task (pool_task *task)
+{
+  task_group *group = task->m_group;
+
+  std::exception_ptr exception;
+  try
+    {
+      task->run ();
+    }
+  catch (...)
+    {
+      exception = std::current_exception ();
+    }
+
+  /* Note that TASK may be destroyed as soon as its group has been
+     notified, so it must not be used after this point.  */
+  if (group != nullptr)
+    group->task_done (std::move (exception));
+}
+
 #if CXX_STD_THREAD
 
 void
 thread_pool::do_post_task (std::packaged_task<void ()> &&func)
 {
-  std::packaged_task<void ()> t (std::move (func));
+  post (new packaged_pool_task (std::move (func)));
+}
+
+void
+thread_pool::post (pool_task *task)
+{
+  while (true)
+    {
+      detail::thread_pool_worker *worker = current_worker;
+      if (worker == nullptr)
+	{
+	  const detail::thread_pool_worker_list *list = m_workers.load ();
+	  if (list == nullptr || list->active.empty ())
+	    {
+	      /* Just execute it now.  */
+	      run_task (task);
+	      return;
+	    }
+
+	  size_t n = m_next_worker.fetch_add (1, std::memory_order_relaxed);
+	  worker = list->active[n % list->active.size ()];
+	}
+
+      {
+	std::lock_guard<std::mutex> guard (worker->mutex);
+	/* A worker thread can always post to its own deque: even if
+	   it has been asked to exit, it will first run all its
+	   tasks.  */
+	if (worker == current_worker || !worker->exiting)
+	  {
+	    worker->tasks.push_back (task);
+	    /* This is incremented while the lock is held, so that a
+	       thief can never decrement it first.  */
+	    ++m_queued;
+	    break;
+	  }
+      }
+
+      /* The chosen worker was asked to exit after we looked at the
+	 list of workers.  Try again; by now, the new list has been
+	 published.  */
+    }
+
+  wake_one ();
+}
 
-  if (m_thread_count != 0)
+void
+thread_pool::wake_one ()
+{
+  /* This pairs with the increment of M_SLEEPERS in thread_function:
+     either the sleeper sees the new value of M_QUEUED, or we see that
+     there is a sleeper.  Taking the mutex ensures that the sleeper is
+     actually waiting on the condition variable before it is
+     notified.  */
+  if (m_sleepers.load () > 0)
     {
-      std::lock_guard<std::mutex> guard (m_tasks_mutex);
-      m_tasks.emplace (std::move (t));
-      m_tasks_cv.notify_one ();
+      {
+	std::lock_guard<std::mutex> guard (m_sleep_mutex);
+      }
+      m_sleep_cv.notify_one ();
     }
-  else
+}
+
+pool_task *
+thread_pool::find_task (detail::thread_pool_worker *self)
+{
+  /* First look in our own deque, newest task first.  */
+  {
+    std::lock_guard<std::mutex> guard (self->mutex);
+    if (!self->tasks.empty ())
+      {
+	pool_task *result = self->tasks.back ();
+	self->tasks.pop_back ();
+	--m_queued;
+	return result;
+      }
+  }
+
+  /* A worker that is exiting does not steal.  */
+  if (self->exiting || m_queued.load () == 0)
+    return nullptr;
+
+  /* Steal the oldest task from some other worker.  Each worker starts
+     looking at a different place, to spread out the contention.  */
+  const detail::thread_pool_worker_list *list = m_workers.load ();
+  size_t n_workers = list->all.size ();
+  for (size_t i = 1; i < n_workers; ++i)
     {
-      /* Just execute it now.  */
-      t ();
+      detail::thread_pool_worker *victim
+	= list->all[(self->index + i) % n_workers];
+      if (victim == self)
+	continue;
+
+      std::lock_guard<std::mutex> guard (victim->mutex);
+      if (!victim->tasks.empty ())
+	{
+	  pool_task *result = victim->tasks.front ();
+	  victim->tasks.pop_front ();
+	  --m_queued;
+	  return result;
+	}
     }
+
+  return nullptr;
 }
 
 void
-thread_pool::thread_function ()
+thread_pool::thread_function (detail::thread_pool_worker *self)
 {
   /* This must be done here, because on macOS one can only set the
      name of the current thread.  */
@@ -223,26 +475,157 @@ thread_pool::thread_function ()
      stack.  */
   gdb::alternate_signal_stack signal_stack;
 
+  current_worker = self;
+
   while (true)
     {
-      optional<task_t> t;
+      pool_task *task = find_task (self);
+      if (task != nullptr)
+	{
+	  run_task (task);
+	  continue;
+	}
 
+      if (self->exiting)
+	{
+	  std::lock_guard<std::mutex> guard (self->mutex);
+	  if (self->tasks.empty ())
+	    {
+	      self->dead = true;
+	      break;
+	    }
+	  continue;
+	}
+
+      /* Nothing to do, so sleep until more work arrives.  See
+	 wake_one.  */
+      ++m_sleepers;
       {
-	/* We want to hold the lock while examining the task list, but
-	   not while invoking the task function.  */
-	std::unique_lock<std::mutex> guard (m_tasks_mutex);
-	while (m_tasks.empty ())
-	  m_tasks_cv.wait (guard);
-	t = std::move (m_tasks.front());
-	m_tasks.pop ();
+	std::unique_lock<std::mutex> guard (m_sleep_mutex);
+	m_sleep_cv.wait (guard, [&] ()
+	  {
+	    return m_queued.load () > 0 || self->exiting;
+	  });
       }
+      --m_sleepers;
+    }
+
+  current_worker = nullptr;
+}
+
+#endif /* CXX_STD_THREAD */
+
+/* See thread-pool.h.  */
+
+task_group::~task_group ()
+{
+  wait_until ();
+}
+
+/* See thread-pool.h.  */
+
+void
+task_group::post (pool_task &task)
+{
+  task.m_group = this;
+#if CXX_STD_THREAD
+  {
+    std::lock_guard<std::mutex> guard (m_mutex);
+    ++m_pending;
+  }
+  thread_pool::g_thread_pool->post (&task);
+#else
+  thread_pool::run_task (&task);
+#endif /* CXX_STD_THREAD */
+}
+
+/* See thread-pool.h.  */
 
-      if (!t.has_value ())
-	break;
-      (*t) ();
+void
+task_group::wait ()
+{
+  wait_until ();
+
+  std::exception_ptr exception;
+  {
+#if CXX_STD_THREAD
+    std::lock_guard<std::mutex> guard (m_mutex);
+#endif /* CXX_STD_THREAD */
+    std::swap (exception, m_exception);
+  }
+
+  if (exception != nullptr)
+    std::rethrow_exception (exception);
+}
+
+/* See thread-pool.h.  */
+
+future_status
+task_group::wait_until
+     (optional<std::chrono::steady_clock::time_point> deadline)
+{
+#if CXX_STD_THREAD
+  using clock = std::chrono::steady_clock;
+
+  detail::thread_pool_worker *worker = current_worker;
+  std::unique_lock<std::mutex> guard (m_mutex);
+
+  while (m_pending != 0)
+    {
+      if (deadline.has_value () && clock::now () >= *deadline)
+	return future_status::timeout;
+
+      if (worker == nullptr)
+	{
+	  if (deadline.has_value ())
+	    m_cv.wait_until (guard, *deadline);
+	  else
+	    m_cv.wait (guard);
+	  continue;
+	}
+
+      /* In a worker thread, run other tasks while waiting.
+	 Otherwise, if every worker were waiting like this, the tasks
+	 being waited for might never be run.  */
+      guard.unlock ();
+      pool_task *task = thread_pool::g_thread_pool->find_task (worker);
+      if (task != nullptr)
+	thread_pool::run_task (task);
+      guard.lock ();
+
+      if (task == nullptr && m_pending != 0)
+	{
+	  clock::time_point limit
+	    = clock::now () + std::chrono::milliseconds (1);
+	  if (deadline.has_value () && *deadline < limit)
+	    limit = *deadline;
+	  m_cv.wait_until (guard, limit);
+	}
     }
+#endif /* CXX_STD_THREAD */
+
+  return future_status::ready;
 }
 
+/* See thread-pool.h.  */
+
+void
+task_group::task_done (std::exception_ptr exception)
+{
+#if CXX_STD_THREAD
+  /* The notification is done while holding the lock, because the
+     group may be destroyed as soon as a waiter sees that M_PENDING is
+     zero.  */
+  std::lock_guard<std::mutex> guard (m_mutex);
 #endif /* CXX_STD_THREAD */
 
+  if (exception != nullptr && m_exception == nullptr)
+    m_exception = std::move (exception);
+
+#if CXX_STD_THREAD
+  if (--m_pending == 0)
+    m_cv.notify_all ();
+#endif /* CXX_STD_THREAD */
+}
+
 } /* namespace gdb */
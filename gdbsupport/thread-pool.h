@@ -20,11 +20,14 @@
 #ifndef GDBSUPPORT_THREAD_POOL_H
 #define GDBSUPPORT_THREAD_POOL_H
 
-#include <queue>
 #include <vector>
+#include <memory>
 #include <functional>
 #include <chrono>
+#include <exception>
 #if CXX_STD_THREAD
+#include <atomic>
+#include <deque>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
@@ -81,6 +84,8 @@ class future
   future &operator= (future &&other) = default;
   future &operator= (const future &other) = delete;
 
+  bool valid () const { return true; }
+
   void wait () const { }
 
   template<class Rep, class Period>
@@ -103,6 +108,8 @@ template<>
 class future<void>
 {
 public:
+  bool valid () const { return true; }
+
   void wait () const { }
 
   template<class Rep, class Period>
@@ -118,11 +125,153 @@ class future<void>
 #endif /* CXX_STD_THREAD */
 
 
+class task_group;
+
+/* A unit of work that can be submitted to the thread pool without
+   any allocation.  The storage for a task is owned by whoever posts
+   it, and it must remain valid until the task has run -- normally
+   this is ensured by posting the task via a task_group and waiting
+   for the group.  */
+class pool_task
+{
+public:
+  pool_task () = default;
+  DISABLE_COPY_AND_ASSIGN (pool_task);
+
+  /* Do the work of this task.  This may be called in a worker
+     thread.  */
+  virtual void run () = 0;
+
+protected:
+
+  ~pool_task () = default;
+
+private:
+
+  friend class thread_pool;
+  friend class task_group;
+
+  /* The group this task belongs to, or nullptr.  */
+  task_group *m_group = nullptr;
+};
+
+/* A pool_task that simply invokes a callable object, which is stored
+   inline.  */
+template<typename F>
+class function_task final : public pool_task
+{
+public:
+  explicit function_task (F func)
+    : m_func (std::move (func))
+  {
+  }
+
+  void run () override
+  {
+    m_func ();
+  }
+
+private:
+
+  F m_func;
+};
+
+/* Create a function_task from FUNC.  */
+template<typename F>
+function_task<F>
+make_function_task (F func)
+{
+  return function_task<F> (std::move (func));
+}
+
+/* A task group, or latch, tracks a batch of tasks submitted to the
+   thread pool, so that they can all be waited for at once.  Tasks
+   are not owned by the group, but they must outlive it.
+
+   If a task throws an exception, it is caught and the first such
+   exception is rethrown by 'wait'.  */
+class task_group
+{
+public:
+  task_group () = default;
+
+  /* The destructor waits for all outstanding tasks.  Any exception
+     that was not yet rethrown by 'wait' is discarded.  */
+  ~task_group ();
+
+  DISABLE_COPY_AND_ASSIGN (task_group);
+
+  /* Post TASK to the global thread pool as a member of this group.
+     If the thread pool has no threads, TASK is run immediately.  */
+  void post (pool_task &task);
+
+  /* Wait for all the tasks posted to this group to complete.  If any
+     of them threw an exception, the first such exception is rethrown
+     here.  */
+  void wait ();
+
+  /* Wait for at most DURATION for all tasks in this group to
+     complete.  This never rethrows an exception; call 'wait' for
+     that.  */
+  template<class Rep, class Period>
+  future_status wait_for (const std::chrono::duration<Rep,Period> &duration)
+  {
+    using clock = std::chrono::steady_clock;
+    clock::duration limit
+      = std::chrono::duration_cast<clock::duration> (duration);
+    return wait_until (clock::now () + limit);
+  }
+
+private:
+
+  friend class thread_pool;
+
+  /* Wait until no task of this group is outstanding, or until
+     DEADLINE has passed, if it is set.  When called from a worker
+     thread, other tasks are run while waiting.  */
+  future_status wait_until
+       (optional<std::chrono::steady_clock::time_point> deadline = {});
+
+  /* Called when a task in this group has finished running.
+     EXCEPTION is the exception it threw, if any.  */
+  void task_done (std::exception_ptr exception);
+
+  /* The first exception thrown by a task, if any.  */
+  std::exception_ptr m_exception;
+
+#if CXX_STD_THREAD
+  /* The number of tasks that have been posted but that have not yet
+     finished.  This is protected by M_MUTEX.  */
+  size_t m_pending = 0;
+
+  /* Used to signal the waiting thread when M_PENDING drops to
+     zero.  */
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+#endif /* CXX_STD_THREAD */
+};
+
+#if CXX_STD_THREAD
+namespace detail
+{
+struct thread_pool_worker;
+struct thread_pool_worker_list;
+}
+#endif /* CXX_STD_THREAD */
+
 /* A thread pool.
 
    There is a single global thread pool, see g_thread_pool.  Tasks can
    be submitted to the thread pool.  They will be processed in worker
-   threads as time allows.  */
+   threads as time allows.
+
+   Each worker thread has its own deque of tasks.  A task submitted
+   from a worker thread is pushed onto that worker's own deque, while
+   tasks submitted from other threads are distributed among the
+   workers in a round-robin fashion.  A worker takes tasks from the
+   back of its own deque; when that is empty, it steals tasks from
+   the front of the other workers' deques.  This way there is no
+   single lock that all the threads contend for.  */
 class thread_pool
 {
 public:
@@ -178,32 +327,64 @@ class thread_pool
 
 private:
 
+  friend class task_group;
+
   thread_pool () = default;
 
+  /* Run TASK in the current thread, and notify its group, if any.  */
+  static void run_task (pool_task *task);
+
 #if CXX_STD_THREAD
   /* The callback for each worker thread.  */
-  void thread_function ();
+  void thread_function (detail::thread_pool_worker *self);
 
   /* Post a task to the thread pool.  A future is returned, which can
      be used to wait for the result.  */
   void do_post_task (std::packaged_task<void ()> &&func);
 
+  /* Post TASK to the thread pool.  The caller owns TASK.  If there
+     are no worker threads, TASK is run immediately.  */
+  void post (pool_task *task);
+
+  /* Find a task for SELF to run, either from its own deque or by
+     stealing from another worker.  Returns nullptr if no task could
+     be found.  */
+  pool_task *find_task (detail::thread_pool_worker *self);
+
+  /* Wake up a sleeping worker, if there is one.  */
+  void wake_one ();
+
   /* The current thread count.  */
   size_t m_thread_count = 0;
 
-  /* A convenience typedef for the type of a task.  */
-  typedef std::packaged_task<void ()> task_t;
+  /* The current list of workers.  This is replaced, but never
+     modified, by set_thread_count.  */
+  std::atomic<const detail::thread_pool_worker_list *> m_workers {nullptr};
+
+  /* Every list of workers that was ever published, the last one
+     being the current one.  Old lists are kept alive so that a thread
+     that loaded a stale pointer from M_WORKERS can still use it.  */
+  std::vector<std::unique_ptr<detail::thread_pool_worker_list>>
+       m_worker_lists;
+
+  /* Serializes calls to set_thread_count.  */
+  std::mutex m_resize_mutex;
+
+  /* Used to choose a worker for a task posted from outside the
+     pool.  */
+  std::atomic<size_t> m_next_worker {0};
+
+  /* The number of tasks that are sitting in some worker's deque.  */
+  std::atomic<size_t> m_queued {0};
 
-  /* The tasks that have not been processed yet.  An optional is used
-     to represent a task.  If the optional is empty, then this means
-     that the receiving thread should terminate.  If the optional is
-     non-empty, then it is an actual task to evaluate.  */
-  std::queue<optional<task_t>> m_tasks;
+  /* The number of workers that are sleeping, or about to sleep,
+     waiting for a task.  */
+  std::atomic<size_t> m_sleepers {0};
 
-  /* A condition variable and mutex that are used for communication
-     between the main thread and the worker threads.  */
-  std::condition_variable m_tasks_cv;
-  std::mutex m_tasks_mutex;
+  /* A condition variable and mutex that are used to put idle workers
+     to sleep, and to wake them when work arrives.  */
+  std::condition_variable m_sleep_cv;
+  std::mutex m_sleep_mutex;
 #endif /* CXX_STD_THREAD */
 };
 